@@ -51,6 +51,36 @@ static MV scaleMv(MV mv, int scale)
     return MV((int16_t)mvx, (int16_t)mvy);
 }
 
+/* the blocks of the CUs of a pool start on a cache line */
+static inline uint32_t alignLine(uint32_t size)
+{
+    return (size + 63) & ~63;
+}
+
+/* copy numPart entries of every byte field of a CU, the copies of the
+ * partition counts of whole CUs have a constant size and are inlined */
+template<int numPart>
+static void copyFieldsN(uint8_t* dst, uint32_t dstStride, const uint8_t* src, uint32_t srcStride)
+{
+    for (int i = 0; i < NUM_CU_FIELDS; i++)
+        memcpy(dst + i * dstStride, src + i * srcStride, numPart);
+}
+
+static void copyFields(uint8_t* dst, uint32_t dstStride, const uint8_t* src, uint32_t srcStride, uint32_t numPart)
+{
+    switch (numPart)
+    {
+    case 4:   copyFieldsN<4>(dst, dstStride, src, srcStride); break;
+    case 16:  copyFieldsN<16>(dst, dstStride, src, srcStride); break;
+    case 64:  copyFieldsN<64>(dst, dstStride, src, srcStride); break;
+    case 256: copyFieldsN<256>(dst, dstStride, src, srcStride); break;
+    default:
+        for (int i = 0; i < NUM_CU_FIELDS; i++)
+            memcpy(dst + i * dstStride, src + i * srcStride, numPart);
+        break;
+    }
+}
+
 //! \ingroup TLibCommon
 //! \{
 
@@ -69,55 +99,30 @@ TComDataCU::TComDataCU()
     m_cuLeft  = NULL;
     m_chromaFormat = 0;
     m_baseQp       = 0;
-    m_dataCUMemPool.qpMemBlock             = NULL;
-    m_dataCUMemPool.depthMemBlock          = NULL;
-    m_dataCUMemPool.log2CUSizeMemBlock     = NULL;
-    m_dataCUMemPool.skipFlagMemBlock       = NULL;
-    m_dataCUMemPool.partSizeMemBlock       = NULL;
-    m_dataCUMemPool.predModeMemBlock       = NULL;
-    m_dataCUMemPool.cuTQBypassMemBlock     = NULL;
-    m_dataCUMemPool.mergeFlagMemBlock      = NULL;
-    m_dataCUMemPool.lumaIntraDirMemBlock   = NULL;
-    m_dataCUMemPool.chromaIntraDirMemBlock = NULL;
-    m_dataCUMemPool.interDirMemBlock       = NULL;
-    m_dataCUMemPool.trIdxMemBlock          = NULL;
-    m_dataCUMemPool.transformSkipMemBlock  = NULL;
-    m_dataCUMemPool.cbfMemBlock            = NULL;
-    m_dataCUMemPool.mvpIdxMemBlock         = NULL;
-    m_dataCUMemPool.trCoeffMemBlock        = NULL;
-    m_dataCUMemPool.m_tqBypassYuvMemBlock  = NULL;
+    m_dataCUMemPool.memBlock = NULL;
+    m_fields       = NULL;
+    m_fieldStride  = 0;
 }
 
 
-bool TComDataCU::initialize(uint32_t numPartition, uint32_t sizeL, uint32_t sizeC, uint32_t numBlocks, bool isLossless)
+uint32_t TComDataCU::blockSize(uint32_t numPartition, uint32_t sizeL, uint32_t sizeC, bool isLossless)
 {
-    bool ok = true;
-
-    ok &= m_cuMvFieldMemPool.initialize(numPartition, numBlocks);
-
-    CHECKED_MALLOC(m_dataCUMemPool.qpMemBlock, char,  numPartition * numBlocks);
+    uint32_t size = alignLine(NUM_CU_FIELDS * numPartition);
 
-    CHECKED_MALLOC(m_dataCUMemPool.depthMemBlock, uint8_t, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.log2CUSizeMemBlock, uint8_t, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.skipFlagMemBlock, bool, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.partSizeMemBlock, char, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.predModeMemBlock, char, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.cuTQBypassMemBlock, bool, numPartition * numBlocks);
+    size += alignLine(sizeof(coeff_t) * (sizeL + sizeC * 2));
+    if (isLossless)
+        size += alignLine(sizeof(pixel) * (sizeL + sizeC * 2));
 
-    CHECKED_MALLOC(m_dataCUMemPool.mergeFlagMemBlock, bool,  numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.lumaIntraDirMemBlock, uint8_t, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.chromaIntraDirMemBlock, uint8_t, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.interDirMemBlock, uint8_t, numPartition * numBlocks);
+    return size;
+}
 
-    CHECKED_MALLOC(m_dataCUMemPool.trIdxMemBlock, uint8_t, numPartition * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.transformSkipMemBlock, uint8_t, numPartition * 3 * numBlocks);
+bool TComDataCU::initialize(uint32_t numPartition, uint32_t sizeL, uint32_t sizeC, uint32_t numBlocks, bool isLossless)
+{
+    bool ok = true;
 
-    CHECKED_MALLOC(m_dataCUMemPool.cbfMemBlock, uint8_t, numPartition * 3 * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.mvpIdxMemBlock, uint8_t, numPartition * 2 * numBlocks);
-    CHECKED_MALLOC(m_dataCUMemPool.trCoeffMemBlock, coeff_t, (sizeL + sizeC * 2) * numBlocks);
+    ok &= m_cuMvFieldMemPool.initialize(numPartition, numBlocks);
 
-    if (isLossless)
-        CHECKED_MALLOC(m_dataCUMemPool.m_tqBypassYuvMemBlock, pixel, (sizeL + sizeC * 2) * numBlocks);
+    CHECKED_MALLOC(m_dataCUMemPool.memBlock, uint8_t, blockSize(numPartition, sizeL, sizeC, isLossless) * numBlocks);
 
     return ok;
 
@@ -142,38 +147,40 @@ void TComDataCU::create(TComDataCU *cu, uint32_t numPartition, uint32_t cuSize,
     m_cuMvField[0].create(&cu->m_cuMvFieldMemPool, numPartition, index, 0);
     m_cuMvField[1].create(&cu->m_cuMvFieldMemPool, numPartition, index, 1);
 
-    m_qp                 = cu->m_dataCUMemPool.qpMemBlock             + index * numPartition;
-    m_depth              = cu->m_dataCUMemPool.depthMemBlock          + index * numPartition;
-    m_log2CUSize         = cu->m_dataCUMemPool.log2CUSizeMemBlock     + index * numPartition;
-    m_skipFlag           = cu->m_dataCUMemPool.skipFlagMemBlock       + index * numPartition;
-    m_partSizes          = cu->m_dataCUMemPool.partSizeMemBlock       + index * numPartition;
-    m_predModes          = cu->m_dataCUMemPool.predModeMemBlock       + index * numPartition;
-    m_cuTransquantBypass = cu->m_dataCUMemPool.cuTQBypassMemBlock     + index * numPartition;
-
-    m_bMergeFlags        = cu->m_dataCUMemPool.mergeFlagMemBlock      + index * numPartition;
-    m_lumaIntraDir       = cu->m_dataCUMemPool.lumaIntraDirMemBlock   + index * numPartition;
-    m_chromaIntraDir     = cu->m_dataCUMemPool.chromaIntraDirMemBlock + index * numPartition;
-    m_interDir           = cu->m_dataCUMemPool.interDirMemBlock       + index * numPartition;
-
-    m_trIdx              = cu->m_dataCUMemPool.trIdxMemBlock          + index * numPartition;
-    m_transformSkip[0]   = cu->m_dataCUMemPool.transformSkipMemBlock  + index * numPartition * 3;
-    m_transformSkip[1]   = m_transformSkip[0]                         + numPartition;
-    m_transformSkip[2]   = m_transformSkip[0]                         + numPartition * 2;
-
-    m_cbf[0]             = cu->m_dataCUMemPool.cbfMemBlock            + index * numPartition * 3;
-    m_cbf[1]             = m_cbf[0]                                   + numPartition;
-    m_cbf[2]             = m_cbf[0]                                   + numPartition * 2;
-
-    m_mvpIdx[0]          = cu->m_dataCUMemPool.mvpIdxMemBlock         + index * numPartition * 2;
-    m_mvpIdx[1]          = m_mvpIdx[0]                                + numPartition;
-
-    m_trCoeff[0]         = cu->m_dataCUMemPool.trCoeffMemBlock        + index * (sizeL + sizeC * 2);
-    m_trCoeff[1]         = m_trCoeff[0]                               + sizeL;
-    m_trCoeff[2]         = m_trCoeff[0]                               + sizeL + sizeC;
+    X265_CHECK(sizeof(bool) == 1 && sizeof(char) == 1, "byte field size check\n");
+
+    m_fields      = cu->m_dataCUMemPool.memBlock + index * blockSize(numPartition, sizeL, sizeC, isLossless);
+    m_fieldStride = numPartition;
+
+    m_qp                 = (char*)m_fields    + CU_FIELD_QP * numPartition;
+    m_depth              = m_fields           + CU_FIELD_DEPTH * numPartition;
+    m_log2CUSize         = m_fields           + CU_FIELD_LOG2_CU_SIZE * numPartition;
+    m_partSizes          = (char*)m_fields    + CU_FIELD_PART_SIZE * numPartition;
+    m_predModes          = (char*)m_fields    + CU_FIELD_PRED_MODE * numPartition;
+    m_lumaIntraDir       = m_fields           + CU_FIELD_LUMA_DIR * numPartition;
+    m_skipFlag           = (bool*)m_fields    + CU_FIELD_SKIP * numPartition;
+    m_cuTransquantBypass = (bool*)m_fields    + CU_FIELD_TQBYPASS * numPartition;
+    m_chromaIntraDir     = m_fields           + CU_FIELD_CHROMA_DIR * numPartition;
+    m_trIdx              = m_fields           + CU_FIELD_TR_IDX * numPartition;
+    m_transformSkip[0]   = m_fields           + CU_FIELD_TSKIP * numPartition;
+    m_transformSkip[1]   = m_transformSkip[0] + numPartition;
+    m_transformSkip[2]   = m_transformSkip[0] + numPartition * 2;
+    m_cbf[0]             = m_fields           + CU_FIELD_CBF * numPartition;
+    m_cbf[1]             = m_cbf[0]           + numPartition;
+    m_cbf[2]             = m_cbf[0]           + numPartition * 2;
+    m_bMergeFlags        = (bool*)m_fields    + CU_FIELD_MERGE * numPartition;
+    m_interDir           = m_fields           + CU_FIELD_INTER_DIR * numPartition;
+    m_mvpIdx[0]          = m_fields           + CU_FIELD_MVP_IDX * numPartition;
+    m_mvpIdx[1]          = m_mvpIdx[0]        + numPartition;
+
+    uint8_t* coeffBlock  = m_fields + alignLine(NUM_CU_FIELDS * numPartition);
+    m_trCoeff[0]         = (coeff_t*)coeffBlock;
+    m_trCoeff[1]         = m_trCoeff[0]       + sizeL;
+    m_trCoeff[2]         = m_trCoeff[0]       + sizeL + sizeC;
 
     if (isLossless)
     {
-        m_tqBypassOrigYuv[0] = cu->m_dataCUMemPool.m_tqBypassYuvMemBlock  + index * (sizeL + sizeC * 2);
+        m_tqBypassOrigYuv[0] = (pixel*)(coeffBlock + alignLine(sizeof(coeff_t) * (sizeL + sizeC * 2)));
         m_tqBypassOrigYuv[1] = m_tqBypassOrigYuv[0]                       + sizeL;
         m_tqBypassOrigYuv[2] = m_tqBypassOrigYuv[0]                       + sizeL + sizeC;
     }
@@ -185,111 +192,18 @@ void TComDataCU::create(TComDataCU *cu, uint32_t numPartition, uint32_t cuSize,
 
 void TComDataCU::destroy()
 {
-    if (m_dataCUMemPool.qpMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.qpMemBlock);
-        m_dataCUMemPool.qpMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.depthMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.depthMemBlock);
-        m_dataCUMemPool.depthMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.log2CUSizeMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.log2CUSizeMemBlock);
-        m_dataCUMemPool.log2CUSizeMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.cbfMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.cbfMemBlock);
-        m_dataCUMemPool.cbfMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.interDirMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.interDirMemBlock);
-        m_dataCUMemPool.interDirMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.mergeFlagMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.mergeFlagMemBlock);
-        m_dataCUMemPool.mergeFlagMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.lumaIntraDirMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.lumaIntraDirMemBlock);
-        m_dataCUMemPool.lumaIntraDirMemBlock = NULL;
-    }
-
-    if(m_dataCUMemPool.chromaIntraDirMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.chromaIntraDirMemBlock);
-        m_dataCUMemPool.chromaIntraDirMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.trIdxMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.trIdxMemBlock);
-        m_dataCUMemPool.trIdxMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.transformSkipMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.transformSkipMemBlock);
-        m_dataCUMemPool.transformSkipMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.trCoeffMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.trCoeffMemBlock);
-        m_dataCUMemPool.trCoeffMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.mvpIdxMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.mvpIdxMemBlock);
-        m_dataCUMemPool.mvpIdxMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.cuTQBypassMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.cuTQBypassMemBlock);
-        m_dataCUMemPool.cuTQBypassMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.skipFlagMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.skipFlagMemBlock);
-        m_dataCUMemPool.skipFlagMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.partSizeMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.partSizeMemBlock);
-        m_dataCUMemPool.partSizeMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.predModeMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.predModeMemBlock);
-        m_dataCUMemPool.predModeMemBlock = NULL;
-    }
-
-    if (m_dataCUMemPool.m_tqBypassYuvMemBlock)
-    {
-        X265_FREE(m_dataCUMemPool.m_tqBypassYuvMemBlock);
-        m_dataCUMemPool.m_tqBypassYuvMemBlock = NULL;
-    }
+    X265_FREE(m_dataCUMemPool.memBlock);
+    m_dataCUMemPool.memBlock = NULL;
 
     m_cuMvFieldMemPool.destroy();
 }
 
+void TComDataCU::setFields(int first, int count, int value)
+{
+    for (int i = first; i < first + count; i++)
+        memset(m_fields + i * m_fieldStride, value, m_numPartitions);
+}
+
 // ====================================================================================================================
 // Public member functions
 // ====================================================================================================================
@@ -333,23 +247,13 @@ void TComDataCU::initCU(Frame* pic, uint32_t cuAddr)
 
     X265_CHECK(m_numPartitions > 0, "unexpected partition count\n");
 
-    memset(m_skipFlag,           false,         m_numPartitions * sizeof(*m_skipFlag));
-    memset(m_predModes,          MODE_NONE,     m_numPartitions * sizeof(*m_predModes));
-    memset(m_partSizes,          SIZE_NONE,     m_numPartitions * sizeof(*m_partSizes));
-    memset(m_cuTransquantBypass, false,         m_numPartitions * sizeof(*m_cuTransquantBypass));
-    memset(m_depth,              0,             m_numPartitions * sizeof(*m_depth));
-    memset(m_trIdx,              0,             m_numPartitions * sizeof(*m_trIdx));
-    memset(m_transformSkip[0],   0,             m_numPartitions * sizeof(*m_transformSkip[0]));
-    memset(m_transformSkip[1],   0,             m_numPartitions * sizeof(*m_transformSkip[1]));
-    memset(m_transformSkip[2],   0,             m_numPartitions * sizeof(*m_transformSkip[2]));
-    memset(m_log2CUSize,         g_maxLog2CUSize, m_numPartitions * sizeof(*m_log2CUSize));
-    memset(m_bMergeFlags,        false,         m_numPartitions * sizeof(*m_bMergeFlags));
-    memset(m_lumaIntraDir,       DC_IDX,        m_numPartitions * sizeof(*m_lumaIntraDir));
-    memset(m_chromaIntraDir,     0,             m_numPartitions * sizeof(*m_chromaIntraDir));
-    memset(m_interDir,           0,             m_numPartitions * sizeof(*m_interDir));
-    memset(m_cbf[0],             0,             m_numPartitions * sizeof(*m_cbf[0]));
-    memset(m_cbf[1],             0,             m_numPartitions * sizeof(*m_cbf[1]));
-    memset(m_cbf[2],             0,             m_numPartitions * sizeof(*m_cbf[2]));
+    setFields(CU_FIELD_DEPTH, 1, 0);
+    setFields(CU_FIELD_LOG2_CU_SIZE, 1, g_maxLog2CUSize);
+    setFields(CU_FIELD_PART_SIZE, 1, SIZE_NONE);
+    setFields(CU_FIELD_PRED_MODE, 1, MODE_NONE);
+    setFields(CU_FIELD_LUMA_DIR, 1, DC_IDX);
+    setFields(CU_FIELD_SKIP, CU_FIELD_MERGE - CU_FIELD_SKIP, 0);
+    setFields(CU_FIELD_MERGE, 2, 0);
     if (qp != m_qp)
         memcpy(m_qp,             qp,            m_numPartitions * sizeof(*m_qp));
 
@@ -419,30 +323,17 @@ void TComDataCU::initSubCU(TComDataCU* cu, CU* cuData, uint32_t partUnitIdx, uin
         m_count[i] = cu->m_count[i];
     }
 
-    int sizeInBool = sizeof(bool) * m_numPartitions;
-    int sizeInChar = sizeof(char) * m_numPartitions;
-
-    memset(m_qp,                 qp,     sizeInChar);
-    memset(m_lumaIntraDir,       DC_IDX, sizeInChar);
-    memset(m_chromaIntraDir,     0,      sizeInChar);
-    memset(m_trIdx,              0,      sizeInChar);
-    memset(m_transformSkip[0],   0,      sizeInChar);
-    memset(m_transformSkip[1],   0,      sizeInChar);
-    memset(m_transformSkip[2],   0,      sizeInChar);
-    memset(m_cbf[0],             0,      sizeInChar);
-    memset(m_cbf[1],             0,      sizeInChar);
-    memset(m_cbf[2],             0,      sizeInChar);
-    memset(m_depth,              depth,  sizeInChar);
-    memset(m_log2CUSize,         log2CUSize, sizeInChar);
-    memset(m_partSizes,          SIZE_NONE, sizeInChar);
-    memset(m_predModes,          MODE_NONE, sizeInChar);
-    memset(m_skipFlag,           false, sizeInBool);
-    memset(m_cuTransquantBypass, false, sizeInBool);
+    setFields(CU_FIELD_QP, 1, qp);
+    setFields(CU_FIELD_DEPTH, 1, depth);
+    setFields(CU_FIELD_LOG2_CU_SIZE, 1, log2CUSize);
+    setFields(CU_FIELD_PART_SIZE, 1, SIZE_NONE);
+    setFields(CU_FIELD_PRED_MODE, 1, MODE_NONE);
+    setFields(CU_FIELD_LUMA_DIR, 1, DC_IDX);
+    setFields(CU_FIELD_SKIP, CU_FIELD_MERGE - CU_FIELD_SKIP, 0);
 
     if (m_slice->m_sliceType != I_SLICE)
     {
-        memset(m_bMergeFlags,      0, sizeInBool);
-        memset(m_interDir,         0, sizeInChar);
+        setFields(CU_FIELD_MERGE, 2, 0);
 
         m_cuMvField[0].clearMvField();
         m_cuMvField[1].clearMvField();
@@ -508,33 +399,8 @@ void TComDataCU::copyPartFrom(TComDataCU* cu, CU* cuData, uint32_t partUnitIdx,
     m_mvBits           += cu->m_mvBits;
     m_coeffBits        += cu->m_coeffBits;
 
-    uint32_t offset       = cuData->numPartitions * partUnitIdx;
-    uint32_t numPartition = cuData->numPartitions;
-    int sizeInBool  = sizeof(bool) * numPartition;
-    int sizeInChar  = sizeof(char) * numPartition;
-    memcpy(m_skipFlag  + offset, cu->getSkipFlag(),       sizeof(*m_skipFlag)   * numPartition);
-    memcpy(m_qp        + offset, cu->getQP(),             sizeInChar);
-    memcpy(m_partSizes + offset, cu->getPartitionSize(),  sizeof(*m_partSizes) * numPartition);
-    memcpy(m_predModes + offset, cu->getPredictionMode(), sizeof(*m_predModes) * numPartition);
-    memcpy(m_cuTransquantBypass + offset, cu->getCUTransquantBypass(), sizeof(*m_cuTransquantBypass) * numPartition);
-    memcpy(m_bMergeFlags      + offset, cu->getMergeFlag(),         sizeInBool);
-    memcpy(m_lumaIntraDir     + offset, cu->getLumaIntraDir(),      sizeInChar);
-    memcpy(m_chromaIntraDir   + offset, cu->getChromaIntraDir(),    sizeInChar);
-    memcpy(m_interDir         + offset, cu->getInterDir(),          sizeInChar);
-    memcpy(m_trIdx            + offset, cu->getTransformIdx(),      sizeInChar);
-    memcpy(m_transformSkip[0] + offset, cu->getTransformSkip(TEXT_LUMA),     sizeInChar);
-    memcpy(m_transformSkip[1] + offset, cu->getTransformSkip(TEXT_CHROMA_U), sizeInChar);
-    memcpy(m_transformSkip[2] + offset, cu->getTransformSkip(TEXT_CHROMA_V), sizeInChar);
-
-    memcpy(m_cbf[0] + offset, cu->getCbf(TEXT_LUMA), sizeInChar);
-    memcpy(m_cbf[1] + offset, cu->getCbf(TEXT_CHROMA_U), sizeInChar);
-    memcpy(m_cbf[2] + offset, cu->getCbf(TEXT_CHROMA_V), sizeInChar);
-
-    memcpy(m_depth  + offset, cu->getDepth(),  sizeInChar);
-    memcpy(m_log2CUSize + offset, cu->getLog2CUSize(), sizeInChar);
-
-    memcpy(m_mvpIdx[0] + offset, cu->getMVPIdx(REF_PIC_LIST_0), sizeInChar);
-    memcpy(m_mvpIdx[1] + offset, cu->getMVPIdx(REF_PIC_LIST_1), sizeInChar);
+    uint32_t offset = cuData->numPartitions * partUnitIdx;
+    copyFields(m_fields + offset, m_fieldStride, cu->m_fields, cu->m_fieldStride, cuData->numPartitions);
 
     m_cuAboveLeft      = cu->getCUAboveLeft();
     m_cuAboveRight     = cu->getCUAboveRight();
@@ -576,34 +442,7 @@ void TComDataCU::copyToPic(uint32_t depth)
     cu->m_mvBits          = m_mvBits;
     cu->m_coeffBits       = m_coeffBits;
 
-    int sizeInBool  = sizeof(bool) * m_numPartitions;
-    int sizeInChar  = sizeof(char) * m_numPartitions;
-
-    memcpy(cu->getSkipFlag() + m_absIdxInCTU, m_skipFlag, sizeof(*m_skipFlag) * m_numPartitions);
-
-    memcpy(cu->getQP() + m_absIdxInCTU, m_qp, sizeInChar);
-
-    memcpy(cu->getPartitionSize()  + m_absIdxInCTU, m_partSizes, sizeof(*m_partSizes) * m_numPartitions);
-    memcpy(cu->getPredictionMode() + m_absIdxInCTU, m_predModes, sizeof(*m_predModes) * m_numPartitions);
-    memcpy(cu->getCUTransquantBypass() + m_absIdxInCTU, m_cuTransquantBypass, sizeof(*m_cuTransquantBypass) * m_numPartitions);
-    memcpy(cu->getMergeFlag()         + m_absIdxInCTU, m_bMergeFlags,      sizeInBool);
-    memcpy(cu->getLumaIntraDir()      + m_absIdxInCTU, m_lumaIntraDir,     sizeInChar);
-    memcpy(cu->getChromaIntraDir()    + m_absIdxInCTU, m_chromaIntraDir,   sizeInChar);
-    memcpy(cu->getInterDir()          + m_absIdxInCTU, m_interDir,         sizeInChar);
-    memcpy(cu->getTransformIdx()      + m_absIdxInCTU, m_trIdx,            sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_LUMA)     + m_absIdxInCTU, m_transformSkip[0], sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_CHROMA_U) + m_absIdxInCTU, m_transformSkip[1], sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_CHROMA_V) + m_absIdxInCTU, m_transformSkip[2], sizeInChar);
-
-    memcpy(cu->getCbf(TEXT_LUMA)     + m_absIdxInCTU, m_cbf[0], sizeInChar);
-    memcpy(cu->getCbf(TEXT_CHROMA_U) + m_absIdxInCTU, m_cbf[1], sizeInChar);
-    memcpy(cu->getCbf(TEXT_CHROMA_V) + m_absIdxInCTU, m_cbf[2], sizeInChar);
-
-    memcpy(cu->getDepth()  + m_absIdxInCTU, m_depth,  sizeInChar);
-    memcpy(cu->getLog2CUSize() + m_absIdxInCTU, m_log2CUSize, sizeInChar);
-
-    memcpy(cu->getMVPIdx(REF_PIC_LIST_0) + m_absIdxInCTU, m_mvpIdx[0], sizeInChar);
-    memcpy(cu->getMVPIdx(REF_PIC_LIST_1) + m_absIdxInCTU, m_mvpIdx[1], sizeInChar);
+    copyFields(cu->m_fields + m_absIdxInCTU, cu->m_fieldStride, m_fields, m_fieldStride, m_numPartitions);
 
     m_cuMvField[0].copyTo(cu->getCUMvField(REF_PIC_LIST_0), m_absIdxInCTU);
     m_cuMvField[1].copyTo(cu->getCUMvField(REF_PIC_LIST_1), m_absIdxInCTU);
@@ -671,31 +510,8 @@ void TComDataCU::copyToPic(uint32_t depth, uint32_t partIdx, uint32_t partDepth)
     cu->m_mvBits          = m_mvBits;
     cu->m_coeffBits       = m_coeffBits;
 
-    int sizeInBool  = sizeof(bool) * qNumPart;
-    int sizeInChar  = sizeof(char) * qNumPart;
-    memcpy(cu->getSkipFlag() + partOffset, m_skipFlag,   sizeof(*m_skipFlag)   * qNumPart);
-
-    memcpy(cu->getQP() + partOffset, m_qp, sizeInChar);
-    memcpy(cu->getPartitionSize()  + partOffset, m_partSizes, sizeof(*m_partSizes) * qNumPart);
-    memcpy(cu->getPredictionMode() + partOffset, m_predModes, sizeof(*m_predModes) * qNumPart);
-    memcpy(cu->getCUTransquantBypass() + partOffset, m_cuTransquantBypass, sizeof(*m_cuTransquantBypass) * qNumPart);
-    memcpy(cu->getMergeFlag()         + partOffset, m_bMergeFlags,      sizeInBool);
-    memcpy(cu->getLumaIntraDir()      + partOffset, m_lumaIntraDir,     sizeInChar);
-    memcpy(cu->getChromaIntraDir()    + partOffset, m_chromaIntraDir,   sizeInChar);
-    memcpy(cu->getInterDir()          + partOffset, m_interDir,         sizeInChar);
-    memcpy(cu->getTransformIdx()      + partOffset, m_trIdx,            sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_LUMA)     + partOffset, m_transformSkip[0], sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_CHROMA_U) + partOffset, m_transformSkip[1], sizeInChar);
-    memcpy(cu->getTransformSkip(TEXT_CHROMA_V) + partOffset, m_transformSkip[2], sizeInChar);
-    memcpy(cu->getCbf(TEXT_LUMA)     + partOffset, m_cbf[0], sizeInChar);
-    memcpy(cu->getCbf(TEXT_CHROMA_U) + partOffset, m_cbf[1], sizeInChar);
-    memcpy(cu->getCbf(TEXT_CHROMA_V) + partOffset, m_cbf[2], sizeInChar);
-
-    memcpy(cu->getDepth()  + partOffset, m_depth,  sizeInChar);
-    memcpy(cu->getLog2CUSize() + partOffset, m_log2CUSize, sizeInChar);
-
-    memcpy(cu->getMVPIdx(REF_PIC_LIST_0) + partOffset, m_mvpIdx[0], sizeInChar);
-    memcpy(cu->getMVPIdx(REF_PIC_LIST_1) + partOffset, m_mvpIdx[1], sizeInChar);
+    copyFields(cu->m_fields + partOffset, cu->m_fieldStride, m_fields, m_fieldStride, qNumPart);
+
     m_cuMvField[0].copyTo(cu->getCUMvField(REF_PIC_LIST_0), m_absIdxInCTU, partStart, qNumPart);
     m_cuMvField[1].copyTo(cu->getCUMvField(REF_PIC_LIST_1), m_absIdxInCTU, partStart, qNumPart);
 
@@ -81,25 +81,34 @@ enum NDBFBlockBorderTag
     NUM_SGU_BORDER
 };
 
+/* All CUs of a pool share one allocation. Each CU owns a contiguous block
+ * starting on a cache line, holding its byte sized per-partition fields (one
+ * array of numPartitions entries per field, in CUField order), then its
+ * coefficients and its lossless source pixels */
 struct DataCUMemPool
 {
-    char*    qpMemBlock;
-    uint8_t* depthMemBlock;
-    uint8_t* log2CUSizeMemBlock;
-    bool*    skipFlagMemBlock;
-    char*    partSizeMemBlock;
-    char*    predModeMemBlock;
-    bool*    cuTQBypassMemBlock;
-    bool*    mergeFlagMemBlock;
-    uint8_t* lumaIntraDirMemBlock;
-    uint8_t* chromaIntraDirMemBlock;
-    uint8_t* interDirMemBlock;
-    uint8_t* trIdxMemBlock;
-    uint8_t* transformSkipMemBlock;
-    uint8_t* cbfMemBlock;
-    uint8_t* mvpIdxMemBlock;
-    coeff_t* trCoeffMemBlock;
-    pixel*   m_tqBypassYuvMemBlock;
+    uint8_t* memBlock;
+};
+
+// Byte sized per-partition fields, in their order within a CU block
+enum CUField
+{
+    CU_FIELD_QP,
+    CU_FIELD_DEPTH,
+    CU_FIELD_LOG2_CU_SIZE,
+    CU_FIELD_PART_SIZE,
+    CU_FIELD_PRED_MODE,
+    CU_FIELD_LUMA_DIR,
+    CU_FIELD_SKIP,          // the fields from skip to cbf are cleared together
+    CU_FIELD_TQBYPASS,
+    CU_FIELD_CHROMA_DIR,
+    CU_FIELD_TR_IDX,
+    CU_FIELD_TSKIP,         // 3 fields, Y/Cb/Cr
+    CU_FIELD_CBF = CU_FIELD_TSKIP + 3,
+    CU_FIELD_MERGE = CU_FIELD_CBF + 3,
+    CU_FIELD_INTER_DIR,
+    CU_FIELD_MVP_IDX,       // 2 fields, list 0 and 1
+    NUM_CU_FIELDS = CU_FIELD_MVP_IDX + 2
 };
 
 struct CU
@@ -224,6 +233,8 @@ public:
 
     DataCUMemPool m_dataCUMemPool;
     TComCUMvField m_cuMvFieldMemPool;
+    uint8_t*      m_fields;          ///< byte fields of this CU, NUM_CU_FIELDS arrays of m_fieldStride entries
+    uint32_t      m_fieldStride;     ///< entries of each field array, the partitions of the allocated CU size
 
     // CU data. Index is the CU index. Neighbour CUs (top-left, top, top-right, left) are appended to the end,
     // required for prediction of current CU.
@@ -245,6 +256,11 @@ protected:
 
     void xDeriveCenterIdx(uint32_t partIdx, uint32_t& outPartIdxCenter);
 
+    void setFields(int first, int count, int value);
+
+    /// bytes of the block of one CU within a pool
+    static uint32_t blockSize(uint32_t numPartition, uint32_t sizeL, uint32_t sizeC, bool isLossless);
+
 public:
 
     TComDataCU();
@@ -146,6 +146,14 @@ uint32_t TComPicYuv::getCUHeight(int rowNum)
 /* Copy pixels from an x265_picture into internal TComPicYuv instance.
  * Shift pixels as necessary, mask off bits above X265_DEPTH for safety. */
 void TComPicYuv::copyFromPicture(const x265_picture& pic, int padx, int pady)
+{
+    copyPictureRows(pic, padx, pady, 0, m_picHeight - pady);
+    extendPictureBottom(padx, pady);
+}
+
+/* Returns the size of the input picture and the internal padding of
+ * copyFromPicture() in padx and pady */
+void TComPicYuv::getInputPadding(int& padx, int& pady, int& width, int& height) const
 {
     /* m_picWidth is the width that is being encoded, padx indicates how many
      * of those pixels are padding to reach multiple of MinCU(4) size.
@@ -157,8 +165,8 @@ void TComPicYuv::copyFromPicture(const x265_picture& pic, int padx, int pady)
      * The same applies to m_picHeight and pady */
 
     /* width and height - without padsize (input picture raw width and height) */
-    int width = m_picWidth - padx;
-    int height = m_picHeight - pady;
+    width = m_picWidth - padx;
+    height = m_picHeight - pady;
 
     /* internal pad to multiple of 16x16 blocks */
     uint8_t rem = width & 15;
@@ -171,66 +179,69 @@ void TComPicYuv::copyFromPicture(const x265_picture& pic, int padx, int pady)
      * warnings from valgrind about using uninitialized pixels */
     padx++;
     pady++;
+}
+
+/* Convert the input rows [row, row + numRows) and the chroma rows they cover,
+ * then extend their right edge while they are still in cache. row must be a
+ * multiple of the chroma subsampling. Bands of rows may be copied by
+ * different threads */
+void TComPicYuv::copyPictureRows(const x265_picture& pic, int padx, int pady, int row, int numRows)
+{
+    int width, height;
+    getInputPadding(padx, pady, width, height);
+
+    int rowC = row >> m_vChromaShift;
+    int numRowsC = ((row + numRows) >> m_vChromaShift) - rowC;
+    int widthC = width >> m_hChromaShift;
+
+    pixel *yPixel = getLumaAddr() + row * getStride();
+    pixel *uPixel = getCbAddr() + rowC * getCStride();
+    pixel *vPixel = getCrAddr() + rowC * getCStride();
 
     if (pic.bitDepth < X265_DEPTH)
     {
-        pixel *yPixel = getLumaAddr();
-        pixel *uPixel = getCbAddr();
-        pixel *vPixel = getCrAddr();
-
-        uint8_t *yChar = (uint8_t*)pic.planes[0];
-        uint8_t *uChar = (uint8_t*)pic.planes[1];
-        uint8_t *vChar = (uint8_t*)pic.planes[2];
+        uint8_t *yChar = (uint8_t*)pic.planes[0] + row * pic.stride[0];
+        uint8_t *uChar = (uint8_t*)pic.planes[1] + rowC * pic.stride[1];
+        uint8_t *vChar = (uint8_t*)pic.planes[2] + rowC * pic.stride[2];
         int shift = X265_MAX(0, X265_DEPTH - pic.bitDepth);
 
-        primitives.planecopy_cp(yChar, pic.stride[0] / sizeof(*yChar), yPixel, getStride(), width, height, shift);
-        primitives.planecopy_cp(uChar, pic.stride[1] / sizeof(*uChar), uPixel, getCStride(), width >> m_hChromaShift, height >> m_vChromaShift, shift);
-        primitives.planecopy_cp(vChar, pic.stride[2] / sizeof(*vChar), vPixel, getCStride(), width >> m_hChromaShift, height >> m_vChromaShift, shift);
+        primitives.planecopy_cp(yChar, pic.stride[0] / sizeof(*yChar), yPixel, getStride(), width, numRows, shift);
+        primitives.planecopy_cp(uChar, pic.stride[1] / sizeof(*uChar), uPixel, getCStride(), widthC, numRowsC, shift);
+        primitives.planecopy_cp(vChar, pic.stride[2] / sizeof(*vChar), vPixel, getCStride(), widthC, numRowsC, shift);
     }
     else if (pic.bitDepth == 8)
     {
-        pixel *yPixel = getLumaAddr();
-        pixel *uPixel = getCbAddr();
-        pixel *vPixel = getCrAddr();
+        uint8_t *yChar = (uint8_t*)pic.planes[0] + row * pic.stride[0];
+        uint8_t *uChar = (uint8_t*)pic.planes[1] + rowC * pic.stride[1];
+        uint8_t *vChar = (uint8_t*)pic.planes[2] + rowC * pic.stride[2];
 
-        uint8_t *yChar = (uint8_t*)pic.planes[0];
-        uint8_t *uChar = (uint8_t*)pic.planes[1];
-        uint8_t *vChar = (uint8_t*)pic.planes[2];
-
-        for (int r = 0; r < height; r++)
+        for (int r = 0; r < numRows; r++)
         {
             for (int c = 0; c < width; c++)
             {
-                yPixel[c] = (pixel)yChar[c];
+                yPixel[r * getStride() + c] = (pixel)yChar[c];
             }
 
-            yPixel += getStride();
             yChar += pic.stride[0] / sizeof(*yChar);
         }
 
-        for (int r = 0; r < height >> m_vChromaShift; r++)
+        for (int r = 0; r < numRowsC; r++)
         {
-            for (int c = 0; c < width >> m_hChromaShift; c++)
+            for (int c = 0; c < widthC; c++)
             {
-                uPixel[c] = (pixel)uChar[c];
-                vPixel[c] = (pixel)vChar[c];
+                uPixel[r * getCStride() + c] = (pixel)uChar[c];
+                vPixel[r * getCStride() + c] = (pixel)vChar[c];
             }
 
-            uPixel += getCStride();
-            vPixel += getCStride();
             uChar += pic.stride[1] / sizeof(*uChar);
             vChar += pic.stride[2] / sizeof(*vChar);
         }
     }
     else /* pic.bitDepth > 8 */
     {
-        pixel *yPixel = getLumaAddr();
-        pixel *uPixel = getCbAddr();
-        pixel *vPixel = getCrAddr();
-
-        uint16_t *yShort = (uint16_t*)pic.planes[0];
-        uint16_t *uShort = (uint16_t*)pic.planes[1];
-        uint16_t *vShort = (uint16_t*)pic.planes[2];
+        uint16_t *yShort = (uint16_t*)((uint8_t*)pic.planes[0] + row * pic.stride[0]);
+        uint16_t *uShort = (uint16_t*)((uint8_t*)pic.planes[1] + rowC * pic.stride[1]);
+        uint16_t *vShort = (uint16_t*)((uint8_t*)pic.planes[2] + rowC * pic.stride[2]);
 
         /* defensive programming, mask off bits that are supposed to be zero */
         uint16_t mask = (1 << X265_DEPTH) - 1;
@@ -238,54 +249,57 @@ void TComPicYuv::copyFromPicture(const x265_picture& pic, int padx, int pady)
 
         /* shift and mask pixels to final size */
 
-        primitives.planecopy_sp(yShort, pic.stride[0] / sizeof(*yShort), yPixel, getStride(), width, height, shift, mask);
-        primitives.planecopy_sp(uShort, pic.stride[1] / sizeof(*uShort), uPixel, getCStride(), width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
-        primitives.planecopy_sp(vShort, pic.stride[2] / sizeof(*vShort), vPixel, getCStride(), width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
+        primitives.planecopy_sp(yShort, pic.stride[0] / sizeof(*yShort), yPixel, getStride(), width, numRows, shift, mask);
+        primitives.planecopy_sp(uShort, pic.stride[1] / sizeof(*uShort), uPixel, getCStride(), widthC, numRowsC, shift, mask);
+        primitives.planecopy_sp(vShort, pic.stride[2] / sizeof(*vShort), vPixel, getCStride(), widthC, numRowsC, shift, mask);
     }
 
     /* extend the right edge if width was not multiple of the minimum CU size */
     if (padx)
     {
-        pixel *Y = getLumaAddr();
-        pixel *U = getCbAddr();
-        pixel *V = getCrAddr();
-
-        for (int r = 0; r < height; r++)
+        for (int r = 0; r < numRows; r++)
         {
             for (int x = 0; x < padx; x++)
             {
-                Y[width + x] = Y[width - 1];
+                yPixel[width + x] = yPixel[width - 1];
             }
 
-            Y += getStride();
+            yPixel += getStride();
         }
 
-        for (int r = 0; r < height >> m_vChromaShift; r++)
+        for (int r = 0; r < numRowsC; r++)
         {
             for (int x = 0; x < padx >> m_hChromaShift; x++)
             {
-                U[(width >> m_hChromaShift) + x] = U[(width >> m_hChromaShift) - 1];
-                V[(width >> m_hChromaShift) + x] = V[(width >> m_hChromaShift) - 1];
+                uPixel[widthC + x] = uPixel[widthC - 1];
+                vPixel[widthC + x] = vPixel[widthC - 1];
             }
 
-            U += getCStride();
-            V += getCStride();
+            uPixel += getCStride();
+            vPixel += getCStride();
         }
     }
+}
+
+/* extend the bottom if height was not multiple of the minimum CU size, once
+ * all the rows of the input picture have been copied */
+void TComPicYuv::extendPictureBottom(int padx, int pady)
+{
+    int width, height;
+    getInputPadding(padx, pady, width, height);
 
-    /* extend the bottom if height was not multiple of the minimum CU size */
     if (pady)
     {
         pixel *Y = getLumaAddr() + (height - 1) * getStride();
         pixel *U = getCbAddr() + ((height >> m_vChromaShift) - 1) * getCStride();
         pixel *V = getCrAddr() + ((height >> m_vChromaShift) - 1) * getCStride();
 
-        for (uint32_t i = 1; i <= pady; i++)
+        for (int i = 1; i <= pady; i++)
         {
             memcpy(Y + i * getStride(), Y, (width + padx) * sizeof(pixel));
         }
 
-        for (uint32_t j = 1; j <= pady >> m_vChromaShift; j++)
+        for (int j = 1; j <= pady >> m_vChromaShift; j++)
         {
             memcpy(U + j * getCStride(), U, ((width + padx) >> m_hChromaShift) * sizeof(pixel));
             memcpy(V + j * getCStride(), V, ((width + padx) >> m_hChromaShift) * sizeof(pixel));
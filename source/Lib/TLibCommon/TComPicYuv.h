@@ -160,6 +160,14 @@ public:
     uint32_t getCUHeight(int rowNum);
 
     void  copyFromPicture(const x265_picture&, int padx, int pady);
+
+    // copyFromPicture() in bands of rows, see PictureCopy
+    void  copyPictureRows(const x265_picture&, int padx, int pady, int row, int numRows);
+    void  extendPictureBottom(int padx, int pady);
+
+protected:
+
+    void  getInputPadding(int& padx, int& pady, int& width, int& height) const;
 }; // END CLASS DEFINITION TComPicYuv
 
 void updateChecksum(const pixel* plane, uint32_t& checksumVal, uint32_t height, uint32_t width, uint32_t stride, int row, uint32_t cuHeight);
@@ -52,6 +52,7 @@ TComYuv::TComYuv()
     m_buf[0] = NULL;
     m_buf[1] = NULL;
     m_buf[2] = NULL;
+    m_alloc  = NULL;
 }
 
 TComYuv::~TComYuv()
@@ -59,7 +60,7 @@ TComYuv::~TComYuv()
     destroy();
 }
 
-bool TComYuv::create(uint32_t width, uint32_t height, int csp)
+void TComYuv::setSize(uint32_t width, uint32_t height, int csp)
 {
     m_hChromaShift = CHROMA_H_SHIFT(csp);
     m_vChromaShift = CHROMA_V_SHIFT(csp);
@@ -71,14 +72,23 @@ bool TComYuv::create(uint32_t width, uint32_t height, int csp)
     m_cwidth  = width  >> m_hChromaShift;
     m_cheight = height >> m_vChromaShift;
 
+    m_stride  = m_width;
+    m_cstride = m_cwidth;
+
     m_csp = csp;
     m_part = partitionFromSizes(m_width, m_height);
+}
+
+bool TComYuv::create(uint32_t width, uint32_t height, int csp)
+{
+    setSize(width, height, csp);
 
     uint32_t sizeL = width * height;
     uint32_t sizeC = m_cwidth * m_cheight;
     X265_CHECK((sizeC & 15) == 0, "invalid size");
     // memory allocation (padded for SIMD reads)
-    CHECKED_MALLOC(m_buf[0], pixel, sizeL + sizeC * 2 + 8);
+    CHECKED_MALLOC(m_alloc, pixel, sizeL + sizeC * 2 + 8);
+    m_buf[0] = m_alloc;
     m_buf[1] = m_buf[0] + sizeL;
     m_buf[2] = m_buf[0] + sizeL + sizeC;
     return true;
@@ -87,10 +97,19 @@ fail:
     return false;
 }
 
+/* a view has the size of a block but no buffer, setPartView() points it at
+ * the pixels of the block within a larger buffer */
+void TComYuv::createView(uint32_t width, uint32_t height, int csp)
+{
+    setSize(width, height, csp);
+    m_alloc = NULL;
+}
+
 void TComYuv::destroy()
 {
     // memory free
-    X265_FREE(m_buf[0]);
+    X265_FREE(m_alloc);
+    m_alloc  = NULL;
     m_buf[0] = NULL;
     m_buf[1] = NULL;
     m_buf[2] = NULL;
@@ -131,9 +150,9 @@ void TComYuv::copyFromYuv(TComYuv* srcYuv)
 {
     X265_CHECK(m_width <= srcYuv->m_width && m_height <= srcYuv->m_height, "invalid size\n");
 
-    primitives.luma_copy_pp[m_part](m_buf[0], m_width, srcYuv->m_buf[0], srcYuv->m_width);
-    primitives.chroma[m_csp].copy_pp[m_part](m_buf[1], m_cwidth, srcYuv->m_buf[1], srcYuv->m_cwidth);
-    primitives.chroma[m_csp].copy_pp[m_part](m_buf[2], m_cwidth, srcYuv->m_buf[2], srcYuv->m_cwidth);
+    primitives.luma_copy_pp[m_part](m_buf[0], m_stride, srcYuv->m_buf[0], srcYuv->m_stride);
+    primitives.chroma[m_csp].copy_pp[m_part](m_buf[1], m_cstride, srcYuv->m_buf[1], srcYuv->m_cstride);
+    primitives.chroma[m_csp].copy_pp[m_part](m_buf[2], m_cstride, srcYuv->m_buf[2], srcYuv->m_cstride);
 }
 
 void TComYuv::copyToPartYuv(TComYuv* dstPicYuv, uint32_t partIdx)
@@ -165,6 +184,18 @@ void TComYuv::copyPartToYuv(TComYuv* dstPicYuv, uint32_t partIdx)
     primitives.chroma[m_csp].copy_pp[part](dstV, dstPicYuv->getCStride(), srcV, getCStride());
 }
 
+void TComYuv::setPartView(TComYuv* srcYuv, uint32_t srcPartIdx)
+{
+    X265_CHECK(!m_alloc, "setPartView() on an allocated buffer\n");
+    X265_CHECK(m_width <= srcYuv->m_width && m_height <= srcYuv->m_height, "invalid size\n");
+
+    m_buf[0]  = srcYuv->getLumaAddr(srcPartIdx);
+    m_buf[1]  = srcYuv->getCbAddr(srcPartIdx);
+    m_buf[2]  = srcYuv->getCrAddr(srcPartIdx);
+    m_stride  = srcYuv->m_stride;
+    m_cstride = srcYuv->m_cstride;
+}
+
 void TComYuv::addClip(TComYuv* srcYuv0, ShortYuv* srcYuv1, uint32_t log2Size)
 {
     addClipLuma(srcYuv0, srcYuv1, log2Size);
@@ -66,6 +66,7 @@ private:
     // ------------------------------------------------------------------------------------------------------------------
 
     pixel* m_buf[3];
+    pixel* m_alloc;    // allocated buffer, NULL when this is a view of another buffer
 
     // ------------------------------------------------------------------------------------------------------------------
     //  Parameter for general YUV buffer usage
@@ -75,27 +76,31 @@ private:
     uint32_t m_height;
     uint32_t m_cwidth;
     uint32_t m_cheight;
+    uint32_t m_stride;
+    uint32_t m_cstride;
 
     int m_hChromaShift;
     int m_vChromaShift;
     int m_csp;
 
-    int getChromaAddrOffset(uint32_t idx, uint32_t width)
+    int getChromaAddrOffset(uint32_t idx, uint32_t stride)
     {
         int blkX = g_zscanToPelX[idx] >> m_hChromaShift;
         int blkY = g_zscanToPelY[idx] >> m_vChromaShift;
 
-        return blkX + blkY * width;
+        return blkX + blkY * stride;
     }
 
-    static int getAddrOffset(uint32_t idx, uint32_t width)
+    static int getAddrOffset(uint32_t idx, uint32_t stride)
     {
         int blkX = g_zscanToPelX[idx];
         int blkY = g_zscanToPelY[idx];
 
-        return blkX + blkY * width;
+        return blkX + blkY * stride;
     }
 
+    void    setSize(uint32_t width, uint32_t height, int csp);
+
 public:
 
     int m_part; // partitionFromSizes(m_width, m_height)
@@ -108,6 +113,7 @@ public:
     // ------------------------------------------------------------------------------------------------------------------
 
     bool    create(uint32_t width, uint32_t height, int csp); ///< Create  YUV buffer
+    void    createView(uint32_t width, uint32_t height, int csp); ///< Create YUV view without a buffer of its own
     void    destroy();                                        ///< Destroy YUV buffer
     void    clear();                                          ///< clear   YUV buffer
 
@@ -130,6 +136,9 @@ public:
     //  Copy the part of Big YUV buffer to other Small YUV buffer
     void    copyPartToYuv(TComYuv* dstPicYuv, uint32_t srcPartIdx);
 
+    //  Reference the part of Big YUV buffer in place of a copy, only for views (read-only use)
+    void    setPartView(TComYuv* srcYuv, uint32_t srcPartIdx);
+
     // ------------------------------------------------------------------------------------------------------------------
     //  Algebraic operation for YUV buffer
     // ------------------------------------------------------------------------------------------------------------------
@@ -156,18 +165,18 @@ public:
     pixel* getChromaAddr(uint32_t chromaId)    { return m_buf[chromaId]; }
 
     //  Access starting position of YUV partition unit buffer
-    pixel* getLumaAddr(uint32_t partUnitIdx) { return m_buf[0] + getAddrOffset(partUnitIdx, m_width); }
+    pixel* getLumaAddr(uint32_t partUnitIdx) { return m_buf[0] + getAddrOffset(partUnitIdx, m_stride); }
 
-    pixel* getCbAddr(uint32_t partUnitIdx) { return m_buf[1] + getChromaAddrOffset(partUnitIdx, m_cwidth); }
+    pixel* getCbAddr(uint32_t partUnitIdx) { return m_buf[1] + getChromaAddrOffset(partUnitIdx, m_cstride); }
 
-    pixel* getCrAddr(uint32_t partUnitIdx) { return m_buf[2] + getChromaAddrOffset(partUnitIdx, m_cwidth); }
+    pixel* getCrAddr(uint32_t partUnitIdx) { return m_buf[2] + getChromaAddrOffset(partUnitIdx, m_cstride); }
 
-    pixel* getChromaAddr(uint32_t chromaId, uint32_t partUnitIdx) { return m_buf[chromaId] + getChromaAddrOffset(partUnitIdx, m_cwidth); }
+    pixel* getChromaAddr(uint32_t chromaId, uint32_t partUnitIdx) { return m_buf[chromaId] + getChromaAddrOffset(partUnitIdx, m_cstride); }
 
     //  Get stride value of YUV buffer
-    uint32_t getStride()    { return m_width;   }
+    uint32_t getStride()    { return m_stride;  }
 
-    uint32_t getCStride()   { return m_cwidth;  }
+    uint32_t getCStride()   { return m_cstride; }
 
     uint32_t getHeight()    { return m_height;  }
 
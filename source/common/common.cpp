@@ -32,6 +32,10 @@
 #include <sys/timeb.h>
 #else
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 int64_t x265_mdate(void)
@@ -49,7 +53,7 @@ int64_t x265_mdate(void)
 
 using namespace x265;
 
-#define X265_ALIGNBYTES 32
+#define X265_ALIGNBYTES 64
 
 #if _WIN32
 #if defined(__MINGW32__) && !defined(__MINGW64_VERSION_MAJOR)
@@ -207,3 +211,68 @@ error:
     fclose(fh);
     return NULL;
 }
+
+/* Map an entire file read-only into memory. Pages are loaded on first access,
+ * so large files cost neither startup time nor resident memory until used */
+const uint8_t* x265_map_file(const char *filename, size_t *size)
+{
+    void *addr = NULL;
+    *size = 0;
+
+#if _WIN32
+    HANDLE fh = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "unable to open file %s\n", filename);
+        return NULL;
+    }
+    LARGE_INTEGER fSize;
+    if (GetFileSizeEx(fh, &fSize) && fSize.QuadPart > 0 && (uint64_t)fSize.QuadPart <= (size_t)-1)
+    {
+        HANDLE map = CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (map)
+        {
+            addr = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(map);
+            *size = (size_t)fSize.QuadPart;
+        }
+    }
+    CloseHandle(fh);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "unable to open file %s\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0 && (uint64_t)st.st_size <= (size_t)-1)
+    {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+            addr = NULL;
+        else
+            *size = (size_t)st.st_size;
+    }
+    close(fd);
+#endif
+
+    if (!addr)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "unable to map file %s\n", filename);
+        *size = 0;
+    }
+    return (const uint8_t*)addr;
+}
+
+void x265_unmap_file(const uint8_t *addr, size_t size)
+{
+    if (!addr)
+        return;
+#if _WIN32
+    (void)size;
+    UnmapViewOfFile(addr);
+#else
+    munmap((void*)addr, size);
+#endif
+}
@@ -277,5 +277,7 @@ double x265_qScale2qp(double qScale);
 double x265_qp2qScale(double qp);
 uint32_t x265_picturePlaneSize(int csp, int width, int height, int plane);
 char* x265_slurp_file(const char *filename);
+const uint8_t* x265_map_file(const char *filename, size_t *size);
+void x265_unmap_file(const uint8_t *addr, size_t size);
 
 #endif // ifndef X265_COMMON_H
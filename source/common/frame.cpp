@@ -51,8 +51,14 @@ Frame::Frame()
     m_avgQpRc = 0;
     m_avgQpAq = 0;
     m_bChromaPlanesExtended = false;
+    m_weightState = WEIGHTS_NONE;
+    m_bWeightsValid = false;
+    m_weightRef[0] = m_weightRef[1] = NULL;
+    m_weightRefPoc[0] = m_weightRefPoc[1] = -1;
+    m_weightNext = NULL;
     m_intraData = NULL;
     m_interData = NULL;
+    m_analysis = NULL;
 }
 
 bool Frame::create(x265_param *param, Window& display, Window& conformance)
@@ -64,7 +70,7 @@ bool Frame::create(x265_param *param, Window& display, Window& conformance)
 
     bool ok = true;
     ok &= m_origPicYuv->create(param->sourceWidth, param->sourceHeight, param->internalCsp, g_maxCUSize, g_maxFullDepth);
-    ok &= m_lowres.create(m_origPicYuv, param->bframes, !!param->rc.aqMode);
+    ok &= m_lowres.create(m_origPicYuv, param->bframes, !!param->rc.aqMode, !!param->bLookaheadQres);
 
     bool isVbv = param->rc.vbvBufferSize > 0 && param->rc.vbvMaxBitrate > 0;
     if (ok && (isVbv || param->rc.aqMode))
@@ -160,6 +166,8 @@ void Frame::destroy()
     }
     m_lowres.destroy();
 
+    X265_FREE(m_analysis);
+    m_analysis = NULL;
     X265_FREE(m_rowDiagQp);
     X265_FREE(m_rowDiagQScale);
     X265_FREE(m_rowDiagSatd);
@@ -37,6 +37,7 @@ namespace x265 {
 // private namespace
 
 class Encoder;
+struct AnalysisFrameData;
 
 class Frame
 {
@@ -67,6 +68,17 @@ public:
 
     bool              m_bChromaPlanesExtended; // orig chroma planes motion extended for weightp analysis
 
+    /* weightp analysis performed by the lookahead for the references this
+     * frame is expected to have as nearest reference of each list */
+    enum { WEIGHTS_NONE, WEIGHTS_QUEUED, WEIGHTS_ACTIVE, WEIGHTS_DONE };
+    volatile int      m_weightState;
+    bool              m_bWeightsValid;      // analysis succeeded
+    Frame*            m_weightRef[2];       // expected references, NULL for unused lists
+    int               m_weightRefPoc[2];
+    WeightParam       m_weights[2][3];
+    Event             m_weightsDone;
+    Frame*            m_weightNext;         // Lookahead weight queue
+
     /* TODO: much of this data can be moved to RCE */
     double*           m_rowDiagQp;
     double*           m_rowDiagQScale;
@@ -86,6 +98,7 @@ public:
 
     x265_intra_data*  m_intraData;  // intra analysis information
     x265_inter_data*  m_interData;  // inter analysis information
+    AnalysisFrameData* m_analysis;  // analysis saved to or loaded from param.analysisFileName
 
     Frame();
     ~Frame() {}
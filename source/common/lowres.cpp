@@ -27,13 +27,29 @@
 
 using namespace x265;
 
-bool Lowres::create(TComPicYuv *orig, int _bframes, bool bAQEnabled)
+bool Lowres::create(TComPicYuv *orig, int _bframes, bool bAQEnabled, bool bQres)
 {
-    isLowres = true;
     bframes = _bframes;
-    width = orig->getWidth() / 2;
-    lines = orig->getHeight() / 2;
-    lumaStride = width + 2 * orig->getLumaMarginX();
+    if (!createPlanes(orig->getWidth() / 2, orig->getHeight() / 2, orig->getLumaMarginX(), orig->getLumaMarginY(), bAQEnabled))
+        return false;
+
+    if (bQres)
+    {
+        /* the pre-analysis only measures frame costs, it needs no AQ data */
+        qres = new Lowres();
+        qres->bframes = _bframes;
+        return qres->createPlanes(width / 2, lines / 2, orig->getLumaMarginX(), orig->getLumaMarginY(), false);
+    }
+
+    return true;
+}
+
+bool Lowres::createPlanes(int lowresWidth, int lowresHeight, int marginX, int marginY, bool bAQEnabled)
+{
+    isLowres = true;
+    width = lowresWidth;
+    lines = lowresHeight;
+    lumaStride = width + 2 * marginX;
     if (lumaStride & 31)
         lumaStride += 32 - (lumaStride & 31);
     int cuWidth = (width + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
@@ -44,8 +60,8 @@ bool Lowres::create(TComPicYuv *orig, int _bframes, bool bAQEnabled)
     width = cuWidth * X265_LOWRES_CU_SIZE;
     lines = cuHeight * X265_LOWRES_CU_SIZE;
 
-    size_t planesize = lumaStride * (lines + 2 * orig->getLumaMarginY());
-    size_t padoffset = lumaStride * orig->getLumaMarginY() + orig->getLumaMarginX();
+    size_t planesize = lumaStride * (lines + 2 * marginY);
+    size_t padoffset = lumaStride * marginY + marginX;
 
     if (bAQEnabled)
     {
@@ -123,10 +139,39 @@ void Lowres::destroy()
     X265_FREE(invQscaleFactor);
     X265_FREE(qpCuTreeOffset);
     X265_FREE(propagateCost);
+
+    if (qres)
+    {
+        qres->destroy();
+        delete qres;
+        qres = NULL;
+    }
 }
 
 // (re) initialize lowres state
 void Lowres::init(TComPicYuv *orig, int poc, int type)
+{
+    reset(poc, type);
+
+    /* downscale and generate 4 hpel planes for lookahead */
+    primitives.frame_init_lowres_core(orig->getLumaAddr(),
+                                      lowresPlane[0], lowresPlane[1], lowresPlane[2], lowresPlane[3],
+                                      orig->getStride(), lumaStride, width, lines);
+
+    extendPlanes(orig->getLumaMarginX(), orig->getLumaMarginY());
+
+    if (qres)
+    {
+        /* downscale the fpel lowres plane once more for the pre-analysis */
+        qres->reset(poc, type);
+        primitives.frame_init_lowres_core(lowresPlane[0],
+                                          qres->lowresPlane[0], qres->lowresPlane[1], qres->lowresPlane[2], qres->lowresPlane[3],
+                                          lumaStride, qres->lumaStride, qres->width, qres->lines);
+        qres->extendPlanes(orig->getLumaMarginX(), orig->getLumaMarginY());
+    }
+}
+
+void Lowres::reset(int poc, int type)
 {
     bIntraCalculated = false;
     bLastMiniGopBFrame = false;
@@ -137,6 +182,7 @@ void Lowres::init(TComPicYuv *orig, int poc, int type)
     leadingBframes = 0;
     indB = 0;
     satdCost = (int64_t)-1;
+    lowresCostForRc = NULL;
     memset(costEst, -1, sizeof(costEst));
     memset(weightedCostDelta, 0, sizeof(weightedCostDelta));
 
@@ -161,16 +207,14 @@ void Lowres::init(TComPicYuv *orig, int poc, int type)
     {
         intraMbs[i] = 0;
     }
+}
 
-    /* downscale and generate 4 hpel planes for lookahead */
-    primitives.frame_init_lowres_core(orig->getLumaAddr(),
-                                      lowresPlane[0], lowresPlane[1], lowresPlane[2], lowresPlane[3],
-                                      orig->getStride(), lumaStride, width, lines);
-
-    /* extend hpel planes for motion search */
-    extendPicBorder(lowresPlane[0], lumaStride, width, lines, orig->getLumaMarginX(), orig->getLumaMarginY());
-    extendPicBorder(lowresPlane[1], lumaStride, width, lines, orig->getLumaMarginX(), orig->getLumaMarginY());
-    extendPicBorder(lowresPlane[2], lumaStride, width, lines, orig->getLumaMarginX(), orig->getLumaMarginY());
-    extendPicBorder(lowresPlane[3], lumaStride, width, lines, orig->getLumaMarginX(), orig->getLumaMarginY());
+/* extend hpel planes for motion search */
+void Lowres::extendPlanes(int marginX, int marginY)
+{
+    extendPicBorder(lowresPlane[0], lumaStride, width, lines, marginX, marginY);
+    extendPicBorder(lowresPlane[1], lumaStride, width, lines, marginX, marginY);
+    extendPicBorder(lowresPlane[2], lumaStride, width, lines, marginX, marginY);
+    extendPicBorder(lowresPlane[3], lumaStride, width, lines, marginX, marginY);
     fpelPlane = lowresPlane[0];
 }
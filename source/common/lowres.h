@@ -139,9 +139,19 @@ struct Lowres : public ReferencePlanes
     uint16_t* propagateCost;
     double    weightedCostDelta[X265_BFRAME_MAX + 2];
 
-    bool create(TComPicYuv *orig, int _bframes, bool bAqEnabled);
+    /* quarter resolution downscale of this lowres frame, used by the slicetype
+     * pre-analysis (--lookahead-qres), else NULL */
+    Lowres*   qres;
+
+    bool create(TComPicYuv *orig, int _bframes, bool bAqEnabled, bool bQres);
     void destroy();
     void init(TComPicYuv *orig, int poc, int sliceType);
+
+protected:
+
+    bool createPlanes(int lowresWidth, int lowresHeight, int marginX, int marginY, bool bAqEnabled);
+    void reset(int poc, int sliceType);
+    void extendPlanes(int marginX, int marginY);
 };
 }
 
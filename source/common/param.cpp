@@ -100,13 +100,16 @@ void x265_param_default(x265_param *param)
 
     /* Applying default values to all elements in the param structure */
     param->cpuid = x265::cpu_detect();
+    param->primitiveCache = NULL;
     param->bEnableWavefront = 1;
     param->poolNumThreads = 0;
     param->frameNumThreads = 0;
+    param->bDynamicRefLag = 0;
 
     param->logLevel = X265_LOG_INFO;
     param->csvfn = NULL;
     param->rc.lambdaFileName = NULL;
+    param->analysisFileName = NULL;
     param->bLogCuStats = 0;
     param->decodedPictureHashSEI = 0;
 
@@ -138,6 +141,7 @@ void x265_param_default(x265_param *param)
     param->bframes = 4;
     param->lookaheadDepth = 20;
     param->bFrameAdaptive = X265_B_ADAPT_TRELLIS;
+    param->bLookaheadQres = 0;
     param->bBPyramid = 1;
     param->scenecutThreshold = 40; /* Magic number pulled in from x264 */
 
@@ -155,6 +159,9 @@ void x265_param_default(x265_param *param)
     param->bEnableWeightedBiPred = 0;
     param->bEnableEarlySkip = 0;
     param->bEnableCbfFastMode = 0;
+    param->depthPrediction = 0;
+    param->bEnableStaticSkip = 0;
+    param->bEnableFastIntraModes = 0;
     param->bEnableAMP = 0;
     param->bEnableRectInter = 0;
     param->rdLevel = 3;
@@ -176,6 +183,7 @@ void x265_param_default(x265_param *param)
     param->rdPenalty = 0;
     param->psyRd = 0.0;
     param->psyRdoq = 0.0;
+    param->targetFps = 0.0;
     param->bIntraInBFrames = 1;
     param->bLossless = 0;
     param->bCULossless = 0;
@@ -184,6 +192,7 @@ void x265_param_default(x265_param *param)
     param->rc.vbvMaxBitrate = 0;
     param->rc.vbvBufferSize = 0;
     param->rc.vbvBufferInit = 0.9;
+    param->rc.bLowLatency = 0;
     param->rc.rfConstant = 28;
     param->rc.bitrate = 0;
     param->rc.rateTolerance = 1.0;
@@ -201,6 +210,8 @@ void x265_param_default(x265_param *param)
     param->rc.bStatRead = 0;
     param->rc.bStatWrite = 0;
     param->rc.statFileName = NULL;
+    param->rc.segmentStart = 0;
+    param->rc.bBinaryStats = 0;
     param->rc.complexityBlur = 20;
     param->rc.qblur = 0.5;
     param->rc.bEnableSlowFirstPass = 0;
@@ -534,10 +545,12 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
         }
     }
     OPT("csv") p->csvfn = value;
+    OPT("primitive-cache") p->primitiveCache = value;
     OPT("scaling-list") p->scalingLists = value;
     OPT("lambda-file") p->rc.lambdaFileName = value;
     OPT("threads") p->poolNumThreads = atoi(value);
     OPT("frame-threads") p->frameNumThreads = atoi(value);
+    OPT("dynamic-ref-lag") p->bDynamicRefLag = atobool(value);
     OPT2("level-idc", "level")
     {
         /* allow "5.1" or "51", both converted to integer 51 */
@@ -569,6 +582,8 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("max-merge") p->maxNumMergeCand = (uint32_t)atoi(value);
     OPT("early-skip") p->bEnableEarlySkip = atobool(value);
     OPT("fast-cbf") p->bEnableCbfFastMode = atobool(value);
+    OPT("depth-pred") p->depthPrediction = atoi(value);
+    OPT("static-skip") p->bEnableStaticSkip = atobool(value);
     OPT("rdpenalty") p->rdPenalty = atoi(value);
     OPT("tskip") p->bEnableTransformSkip = atobool(value);
     OPT("no-tskip-fast") p->bEnableTSkipFast = atobool(value);
@@ -578,6 +593,7 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("cu-lossless") p->bCULossless = atobool(value);
     OPT("constrained-intra") p->bEnableConstrainedIntra = atobool(value);
     OPT("fast-intra") p->bEnableFastIntra = atobool(value);
+    OPT("fast-intra-modes") p->bEnableFastIntraModes = atobool(value);
     OPT("open-gop") p->bOpenGOP = atobool(value);
     OPT("scenecut")
     {
@@ -591,6 +607,7 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("keyint") p->keyframeMax = atoi(value);
     OPT("min-keyint") p->keyframeMin = atoi(value);
     OPT("rc-lookahead") p->lookaheadDepth = atoi(value);
+    OPT("lookahead-qres") p->bLookaheadQres = atobool(value);
     OPT("bframes") p->bframes = atoi(value);
     OPT("bframe-bias") p->bFrameBias = atoi(value);
     OPT("b-adapt")
@@ -638,6 +655,7 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("vbv-maxrate") p->rc.vbvMaxBitrate = atoi(value);
     OPT("vbv-bufsize") p->rc.vbvBufferSize = atoi(value);
     OPT("vbv-init")    p->rc.vbvBufferInit = atof(value);
+    OPT("rc-low-latency") p->rc.bLowLatency = atobool(value);
     OPT("crf-max")     p->rc.rfConstantMax = atof(value);
     OPT("crf-min")     p->rc.rfConstantMin = atof(value);
     OPT("crf")
@@ -661,6 +679,8 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
     OPT("cutree")    p->rc.cuTree = atobool(value);
     OPT("slow-firstpass") p->rc.bEnableSlowFirstPass = atobool(value);
     OPT("analysis-mode") p->analysisMode = parseName(value, x265_analysis_names, bError);
+    OPT("analysis-file") p->analysisFileName = strdup(value);
+    OPT("target-fps") p->targetFps = atof(value);
     OPT("sar")
     {
         p->vui.aspectRatioIdc = parseName(value, x265_sar_names, bError);
@@ -735,6 +755,8 @@ int x265_param_parse(x265_param *p, const char *name, const char *value)
         p->rc.bStatRead = pass & 2;
     }
     OPT("stats") p->rc.statFileName = strdup(value);
+    OPT("segment-start") p->rc.segmentStart = atoi(value);
+    OPT("binary-stats") p->rc.bBinaryStats = atobool(value);
     else
         return X265_PARAM_BAD_NAME;
 #undef OPT
@@ -946,6 +968,8 @@ int x265_check_params(x265_param *param)
           "Rate control mode is out of range");
     CHECK(param->rdLevel < 0 || param->rdLevel > 6,
           "RD Level is out of range");
+    CHECK(param->depthPrediction < 0 || param->depthPrediction > 2,
+          "Depth prediction mode is out of range");
     CHECK(param->bframes > param->lookaheadDepth && !param->rc.bStatRead,
           "Lookahead depth must be greater than the max consecutive bframe count");
     CHECK(param->bframes < 0,
@@ -960,6 +984,7 @@ int x265_check_params(x265_param *param)
           "Aq-Strength is out of range");
     CHECK(param->psyRd < 0 || 2.0 < param->psyRd, "Psy-rd strength must be between 0 and 2.0");
     CHECK(param->psyRdoq < 0 || 10.0 < param->psyRdoq, "Psy-rdoq strength must be between 0 and 10.0");
+    CHECK(param->targetFps < 0, "Target fps (--target-fps) must be 0 or higher");
     CHECK(param->bEnableWavefront < 0, "WaveFrontSynchro cannot be negative");
     CHECK(!param->bEnableWavefront && param->rc.vbvBufferSize, "VBV requires wave-front parallelism (--wpp)");
     CHECK((param->vui.aspectRatioIdc < 0
@@ -1035,6 +1060,8 @@ int x265_check_params(x265_param *param)
           "Constant rate-factor is incompatible with 2pass");
     CHECK(param->rc.rateControlMode == X265_RC_CQP && param->rc.bStatRead,
           "Constant QP is incompatible with 2pass");
+    CHECK(param->rc.segmentStart < 0,
+          "Segment start frame must not be negative");
     return check_failed;
 }
 
@@ -1143,8 +1170,9 @@ void x265_print_params(x265_param *param)
 
     if (param->rc.vbvBufferSize)
     {
-        x265_log(param, X265_LOG_INFO, "VBV/HRD buffer / max-rate / init    : %d / %d / %.3f\n",
-                 param->rc.vbvBufferSize, param->rc.vbvMaxBitrate, param->rc.vbvBufferInit);
+        x265_log(param, X265_LOG_INFO, "VBV/HRD buffer / max-rate / init    : %d / %d / %.3f%s\n",
+                 param->rc.vbvBufferSize, param->rc.vbvMaxBitrate, param->rc.vbvBufferInit,
+                 param->rc.bLowLatency ? " (low-latency)" : "");
     }
 
     x265_log(param, X265_LOG_INFO, "tools: ");
@@ -1154,6 +1182,9 @@ void x265_print_params(x265_param *param)
     TOOLOPT(param->bEnableCbfFastMode, "cfm");
     TOOLOPT(param->bEnableConstrainedIntra, "cip");
     TOOLOPT(param->bEnableEarlySkip, "esd");
+    TOOLOPT(param->bEnableStaticSkip, "static-skip");
+    if (param->depthPrediction)
+        fprintf(stderr, "depth-pred=%d ", param->depthPrediction);
     fprintf(stderr, "rd=%d ", param->rdLevel);
     if (param->psyRd > 0.)
         fprintf(stderr, "psy-rd=%.2lf ", param->psyRd);
@@ -1161,6 +1192,8 @@ void x265_print_params(x265_param *param)
         fprintf(stderr, "psy-rdoq=%.2lf ", param->psyRdoq);
     if (param->noiseReduction)
         fprintf(stderr, "nr=%d ", param->noiseReduction);
+    if (param->targetFps > 0.)
+        fprintf(stderr, "target-fps=%.2lf ", param->targetFps);
 
     TOOLOPT(param->bEnableLoopFilter, "lft");
     if (param->bEnableSAO)
@@ -1168,10 +1201,16 @@ void x265_print_params(x265_param *param)
     TOOLOPT(param->bEnableSignHiding, "signhide");
     TOOLOPT(param->bCULossless, "cu-lossless");
     TOOLOPT(param->bEnableFastIntra, "fast-intra");
+    TOOLOPT(param->bEnableFastIntraModes, "fast-intra-modes");
+    TOOLOPT(param->bLookaheadQres, "lookahead-qres");
+    TOOLOPT(param->frameNumThreads > 1 && param->bDynamicRefLag, "dynamic-ref-lag");
     if (param->bEnableTransformSkip)
         fprintf(stderr, "tskip%s ", param->bEnableTSkipFast ? "-fast" : "");
     TOOLOPT(param->rc.bStatWrite, "stats-write");
     TOOLOPT(param->rc.bStatRead,  "stats-read");
+    if (param->rc.segmentStart)
+        fprintf(stderr, "segment-start=%d ", param->rc.segmentStart);
+    TOOLOPT(param->rc.bStatWrite && param->rc.bBinaryStats, "binary-stats");
     fprintf(stderr, "\n");
     fflush(stderr);
 }
@@ -1191,6 +1230,7 @@ char *x265_param2string(x265_param *p)
     s += sprintf(s, " fps=%u/%u", p->fpsNum, p->fpsDenom);
     s += sprintf(s, " bitdepth=%d", p->internalBitDepth);
     BOOL(p->bEnableWavefront, "wpp");
+    BOOL(p->bDynamicRefLag, "dynamic-ref-lag");
     s += sprintf(s, " ctu=%d", p->maxCUSize);
     s += sprintf(s, " tu-intra-depth=%d", p->tuQTMaxIntraDepth);
     s += sprintf(s, " tu-inter-depth=%d", p->tuQTMaxInterDepth);
@@ -1202,6 +1242,8 @@ char *x265_param2string(x265_param *p)
     s += sprintf(s, " max-merge=%d", p->maxNumMergeCand);
     BOOL(p->bEnableEarlySkip, "early-skip");
     BOOL(p->bEnableCbfFastMode, "fast-cbf");
+    s += sprintf(s, " depth-pred=%d", p->depthPrediction);
+    BOOL(p->bEnableStaticSkip, "static-skip");
     s += sprintf(s, " rdpenalty=%d", p->rdPenalty);
     BOOL(p->bEnableTransformSkip, "tskip");
     BOOL(p->bEnableTSkipFast, "tskip-fast");
@@ -1210,12 +1252,14 @@ char *x265_param2string(x265_param *p)
     BOOL(p->bCULossless, "cu-lossless");
     BOOL(p->bEnableConstrainedIntra, "constrained-intra");
     BOOL(p->bEnableFastIntra, "fast-intra");
+    BOOL(p->bEnableFastIntraModes, "fast-intra-modes");
     BOOL(p->bOpenGOP, "open-gop");
     s += sprintf(s, " interlace=%d", p->interlaceMode);
     s += sprintf(s, " keyint=%d", p->keyframeMax);
     s += sprintf(s, " min-keyint=%d", p->keyframeMin);
     s += sprintf(s, " scenecut=%d", p->scenecutThreshold);
     s += sprintf(s, " rc-lookahead=%d", p->lookaheadDepth);
+    BOOL(p->bLookaheadQres, "lookahead-qres");
     s += sprintf(s, " bframes=%d", p->bframes);
     s += sprintf(s, " bframe-bias=%d", p->bFrameBias);
     s += sprintf(s, " b-adapt=%d", p->bFrameAdaptive);
@@ -1229,6 +1273,7 @@ char *x265_param2string(x265_param *p)
     s += sprintf(s, " rd=%d", p->rdLevel);
     s += sprintf(s, " psy-rd=%.2f", p->psyRd);
     s += sprintf(s, " psy-rdoq=%.2f", p->psyRdoq);
+    s += sprintf(s, " target-fps=%.2f", p->targetFps);
     BOOL(p->bEnableSignHiding, "signhide");
     BOOL(p->bEnableLoopFilter, "lft");
     BOOL(p->bEnableSAO, "sao");
@@ -1250,10 +1295,13 @@ char *x265_param2string(x265_param *p)
         if (p->rc.bStatRead)
             s += sprintf( s, " cplxblur=%.1f qblur=%.1f",
                           p->rc.complexityBlur, p->rc.qblur);
+        if (p->rc.segmentStart)
+            s += sprintf(s, " segment-start=%d", p->rc.segmentStart);
         if (p->rc.vbvBufferSize)
         {
             s += sprintf(s, " vbv-maxrate=%d vbv-bufsize=%d",
                           p->rc.vbvMaxBitrate, p->rc.vbvBufferSize);
+            BOOL(p->rc.bLowLatency, "rc-low-latency");
             if (p->rc.rateControlMode == X265_RC_CRF)
                 s += sprintf(s, " crf-max=%.1f", p->rc.rfConstantMax);
         }
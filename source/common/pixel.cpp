@@ -948,6 +948,46 @@ void estimateCUPropagateCost(int *dst, uint16_t *propagateIn, int32_t *intraCost
         dst[i] = (int)(propagateAmount * propagateNum / propagateDenom + 0.5);
     }
 }
+
+/* Split the propagate amounts of a row of CUs between the (up to) four CUs
+ * of the reference each one is predicted from by the given list. dst holds
+ * six rows of len entries: the column and row of the top-left target CU and
+ * the amounts for the top-left, top-right, bottom-left and bottom-right
+ * targets, zero when the CU does not propagate through this list */
+void estimateCUPropagateList(int32_t *dst, int *propagateAmount, uint16_t *lowresCosts, int16_t (*mvs)[2],
+                             int listWeight, int list, int cuy, int len)
+{
+    int32_t *posX = dst, *posY = dst + len;
+    int32_t *amount0 = dst + 2 * len, *amount1 = dst + 3 * len, *amount2 = dst + 4 * len, *amount3 = dst + 5 * len;
+
+    for (int i = 0; i < len; i++)
+    {
+        int32_t listsUsed = lowresCosts[i] >> 14;
+        int32_t listAmount = propagateAmount[i];
+
+        if (listAmount <= 0 || !((listsUsed >> list) & 1))
+        {
+            posX[i] = posY[i] = 0;
+            amount0[i] = amount1[i] = amount2[i] = amount3[i] = 0;
+            continue;
+        }
+
+        /* Apply bipred weighting. */
+        if (listsUsed == 3)
+            listAmount = (listAmount * listWeight + 32) >> 6;
+
+        int32_t x = mvs[i][0];
+        int32_t y = mvs[i][1];
+        posX[i] = (x >> 5) + i;
+        posY[i] = (y >> 5) + cuy;
+        x &= 31;
+        y &= 31;
+        amount0[i] = (listAmount * ((32 - y) * (32 - x)) + 512) >> 10;
+        amount1[i] = (listAmount * ((32 - y) * x) + 512) >> 10;
+        amount2[i] = (listAmount * (y * (32 - x)) + 512) >> 10;
+        amount3[i] = (listAmount * (y * x) + 512) >> 10;
+    }
+}
 }  // end anonymous namespace
 
 namespace x265 {
@@ -1280,5 +1320,6 @@ void Setup_C_PixelPrimitives(EncoderPrimitives &p)
     p.planecopy_cp = planecopy_cp_c;
     p.planecopy_sp = planecopy_sp_c;
     p.propagateCost = estimateCUPropagateCost;
+    p.propagateList = estimateCUPropagateList;
 }
 }
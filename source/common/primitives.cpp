@@ -109,6 +109,15 @@ void Setup_Alias_Primitives(EncoderPrimitives &p)
     primitives.sa8d_inter[LUMA_16x12] = primitives.satd[LUMA_16x12];
     primitives.sa8d_inter[LUMA_12x16] = primitives.satd[LUMA_12x16];
 }
+
+void Setup_Candidate_Primitives(EncoderPrimitives &p, int cpuMask)
+{
+    Setup_C_Primitives(p);
+    Setup_Instrinsic_Primitives(p, cpuMask);
+#if ENABLE_ASSEMBLY
+    Setup_Assembly_Primitives(p, cpuMask);
+#endif
+}
 }
 using namespace x265;
 
@@ -132,6 +141,10 @@ void x265_setup_primitives(x265_param *param, int cpuid)
         x265_log(param, X265_LOG_WARNING, "Assembly not supported in this binary\n");
 #endif
 
+        /* the candidates are timed before the aliases are copied */
+        if (param->primitiveCache)
+            Setup_Tuned_Primitives(primitives, cpuid, param);
+
         Setup_Alias_Primitives(primitives);
 
         initROM();
@@ -201,6 +201,7 @@ typedef void (*planecopy_cp_t) (uint8_t *src, intptr_t srcStride, pixel *dst, in
 typedef void (*planecopy_sp_t) (uint16_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask);
 
 typedef void (*cutree_propagate_cost) (int *dst, uint16_t *propagateIn, int32_t *intraCosts, uint16_t *interCosts, int32_t *invQscales, double *fpsFactor, int len);
+typedef void (*cutree_propagate_list) (int32_t *dst, int *propagateAmount, uint16_t *lowresCosts, int16_t (*mvs)[2], int listWeight, int list, int cuy, int len);
 
 /* Define a structure containing function pointers to optimized encoder
  * primitives.  Each pointer can reference either an assembly routine,
@@ -285,6 +286,7 @@ struct EncoderPrimitives
     planecopy_sp_t    planecopy_sp;
 
     cutree_propagate_cost    propagateCost;
+    cutree_propagate_list    propagateList;
 
     struct
     {
@@ -314,6 +316,14 @@ void Setup_C_Primitives(EncoderPrimitives &p);
 void Setup_Instrinsic_Primitives(EncoderPrimitives &p, int cpuMask);
 void Setup_Assembly_Primitives(EncoderPrimitives &p, int cpuMask);
 void Setup_Alias_Primitives(EncoderPrimitives &p);
+
+/* the primitives the encoder would use on a CPU with only the capabilities of
+ * cpuMask, without the aliases */
+void Setup_Candidate_Primitives(EncoderPrimitives &p, int cpuMask);
+
+/* time the candidates of the hottest primitives on this CPU, install the
+ * fastest in p, and cache the choices in param->primitiveCache (primtune.cpp) */
+void Setup_Tuned_Primitives(EncoderPrimitives &p, int cpuMask, const x265_param *param);
 }
 
 #endif // ifndef X265_PRIMITIVES_H
@@ -0,0 +1,541 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+
+#include <stddef.h>
+
+/* Runtime calibration of the hottest primitives. The primitive tables are
+ * chosen from the CPU flags, but on some CPUs the primitives of a lower ISA
+ * level are faster than the ones chosen. The candidates of each primitive are
+ * the primitives the encoder would use if the CPU stopped at each ISA level;
+ * they are timed on this CPU and the fastest is installed when it is clearly
+ * faster. The choices are cached in a text file, one section per CPU model,
+ * build and CPU capability mask, so later opens only read the file:
+ *
+ *   cpu <cpu model> | <build info> | <version> | <cpu mask>
+ *   <primitive> <partition> <ISA level>
+ *   ...
+ */
+
+#if X265_ARCH_X86
+extern "C" void x265_cpu_cpuid(uint32_t op, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx);
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+using namespace x265;
+
+namespace {
+enum TuneKind
+{
+    TUNE_CMP,   // pixelcmp_t
+    TUNE_PP,    // filter_pp_t
+    TUNE_HPS,   // filter_hps_t
+    TUNE_PS,    // filter_ps_t
+    TUNE_SP,    // filter_sp_t
+    TUNE_SS,    // filter_ss_t
+    TUNE_HV,    // filter_hv_pp_t
+    TUNE_DCT,   // dct_t
+    TUNE_IDCT,  // idct_t
+};
+
+struct TuneFamily
+{
+    const char *name;
+    TuneKind    kind;
+    size_t      offset;
+    int         count;
+};
+
+#define FAMILY(name, kind, member, count) { name, kind, offsetof(EncoderPrimitives, member), count }
+
+const TuneFamily tuneFamilies[] =
+{
+    FAMILY("sad",        TUNE_CMP,  sad,        NUM_LUMA_PARTITIONS),
+    FAMILY("satd",       TUNE_CMP,  satd,       NUM_LUMA_PARTITIONS),
+    FAMILY("sa8d_inter", TUNE_CMP,  sa8d_inter, NUM_LUMA_PARTITIONS),
+    FAMILY("luma_hpp",   TUNE_PP,   luma_hpp,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_hps",   TUNE_HPS,  luma_hps,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_vpp",   TUNE_PP,   luma_vpp,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_vps",   TUNE_PS,   luma_vps,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_vsp",   TUNE_SP,   luma_vsp,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_vss",   TUNE_SS,   luma_vss,   NUM_LUMA_PARTITIONS),
+    FAMILY("luma_hvpp",  TUNE_HV,   luma_hvpp,  NUM_LUMA_PARTITIONS),
+    FAMILY("dct",        TUNE_DCT,  dct,        NUM_DCTS),
+    FAMILY("idct",       TUNE_IDCT, idct,       NUM_IDCTS),
+};
+
+#undef FAMILY
+
+const uint8_t lumaPartDims[NUM_LUMA_PARTITIONS][2] =
+{
+    { 4, 4 },   { 8, 8 },   { 16, 16 }, { 32, 32 }, { 64, 64 },
+    { 8, 4 },   { 4, 8 },
+    { 16, 8 },  { 8, 16 },
+    { 32, 16 }, { 16, 32 },
+    { 64, 32 }, { 32, 64 },
+    { 16, 12 }, { 12, 16 }, { 16, 4 },  { 4, 16 },
+    { 32, 24 }, { 24, 32 }, { 32, 8 },  { 8, 32 },
+    { 64, 48 }, { 48, 64 }, { 64, 16 }, { 16, 64 },
+};
+
+const uint8_t transformSizes[NUM_DCTS] = { 4, 4, 8, 16, 32 };
+
+/* the ISA levels, each with the CPU flags which first appear at that level.
+ * Flags which are not listed (SSE2_IS_SLOW, SLOW_SHUFFLE, ...) are kept at
+ * every level */
+struct TuneLevel
+{
+    const char *name;
+    int         flags;
+};
+
+const TuneLevel tuneLevels[] =
+{
+    { "SSE2",  X265_CPU_SSE2 },
+    { "SSE3",  X265_CPU_SSE3 },
+    { "SSSE3", X265_CPU_SSSE3 },
+    { "SSE4",  X265_CPU_SSE4 | X265_CPU_SSE42 },
+    { "AVX",   X265_CPU_AVX | X265_CPU_XOP | X265_CPU_FMA4 },
+    { "AVX2",  X265_CPU_AVX2 | X265_CPU_FMA3 | X265_CPU_BMI1 | X265_CPU_BMI2 },
+};
+
+#define NUM_TUNE_LEVELS (int)(sizeof(tuneLevels) / sizeof(tuneLevels[0]))
+#define MAX_CANDIDATES  (NUM_TUNE_LEVELS + 1)
+
+/* a candidate must be this much faster than the default primitive */
+const double tuneMargin = 0.95;
+
+/* pixels processed by each timed round of a primitive */
+const int tunePixels = 1 << 17;
+const int tuneRounds = 3;
+
+const intptr_t tuneStride = 128;
+const int tuneMarginRows = 8;
+
+struct TuneBuffers
+{
+    pixel*   fenc;    // FENC_STRIDE
+    pixel*   src;     // tuneStride, with tuneMarginRows of margin
+    int16_t* srcS;
+    pixel*   dst;
+    int16_t* dstS;
+    int16_t* resi;    // transform input and output
+    int32_t* coef;
+
+    bool create()
+    {
+        size_t planeSize = tuneStride * (64 + 2 * tuneMarginRows);
+        fenc = X265_MALLOC(pixel, FENC_STRIDE * 64);
+        src = X265_MALLOC(pixel, planeSize);
+        srcS = X265_MALLOC(int16_t, planeSize);
+        dst = X265_MALLOC(pixel, planeSize);
+        dstS = X265_MALLOC(int16_t, planeSize);
+        resi = X265_MALLOC(int16_t, 32 * 32);
+        coef = X265_MALLOC(int32_t, 32 * 32);
+        if (!fenc || !src || !srcS || !dst || !dstS || !resi || !coef)
+            return false;
+
+        uint32_t seed = 1;
+        for (int i = 0; i < FENC_STRIDE * 64; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            fenc[i] = (pixel)((seed >> 16) & ((1 << X265_DEPTH) - 1));
+        }
+        for (size_t i = 0; i < planeSize; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            src[i] = (pixel)((seed >> 16) & ((1 << X265_DEPTH) - 1));
+            srcS[i] = (int16_t)((seed >> 16) & 0x3fff) - 0x2000;
+        }
+        for (int i = 0; i < 32 * 32; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            resi[i] = (int16_t)((seed >> 16) & 0x1ff) - 0x100;
+            coef[i] = (int32_t)((seed >> 8) & 0x1ff) - 0x100;
+        }
+
+        return true;
+    }
+
+    void destroy()
+    {
+        X265_FREE(fenc);
+        X265_FREE(src);
+        X265_FREE(srcS);
+        X265_FREE(dst);
+        X265_FREE(dstS);
+        X265_FREE(resi);
+        X265_FREE(coef);
+    }
+};
+
+/* the timed rounds last a few microseconds, below the resolution of
+ * x265_mdate(), so they are measured in CPU cycles like the test bench */
+inline int64_t tuneClock()
+{
+#if X265_ARCH_X86 && defined(_MSC_VER)
+    return (int64_t)__rdtsc();
+#elif X265_ARCH_X86 && defined(__GNUC__)
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return (int64_t)(((uint64_t)hi << 32) | lo);
+#else
+    return x265_mdate();
+#endif
+}
+
+/* run a primitive of the given kind count times, returns the elapsed time */
+int64_t timePrimitive(TuneKind kind, const void *slot, int width, TuneBuffers& b, int count)
+{
+    intptr_t margin = tuneMarginRows * tuneStride + tuneMarginRows;
+    pixel *src = b.src + margin;
+    int16_t *srcS = b.srcS + margin;
+    int sum = 0;
+
+    int64_t start = tuneClock();
+    switch (kind)
+    {
+    case TUNE_CMP:
+    {
+        pixelcmp_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            sum += f(b.fenc, FENC_STRIDE, src, tuneStride);
+        break;
+    }
+    case TUNE_PP:
+    {
+        filter_pp_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(src, tuneStride, b.dst, tuneStride, 2);
+        break;
+    }
+    case TUNE_HPS:
+    {
+        filter_hps_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(src, tuneStride, b.dstS, tuneStride, 2, 0);
+        break;
+    }
+    case TUNE_PS:
+    {
+        filter_ps_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(src, tuneStride, b.dstS, tuneStride, 2);
+        break;
+    }
+    case TUNE_SP:
+    {
+        filter_sp_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(srcS, tuneStride, b.dst, tuneStride, 2);
+        break;
+    }
+    case TUNE_SS:
+    {
+        filter_ss_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(srcS, tuneStride, b.dstS, tuneStride, 2);
+        break;
+    }
+    case TUNE_HV:
+    {
+        filter_hv_pp_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(src, tuneStride, b.dst, tuneStride, 2, 2);
+        break;
+    }
+    case TUNE_DCT:
+    {
+        dct_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(b.resi, b.coef, width);
+        break;
+    }
+    case TUNE_IDCT:
+    {
+        idct_t f;
+        memcpy(&f, slot, sizeof(f));
+        for (int i = 0; i < count; i++)
+            f(b.coef, b.dstS, width);
+        break;
+    }
+    }
+    int64_t elapsed = tuneClock() - start;
+
+    x265_emms();
+    (void)sum;
+    return elapsed;
+}
+
+/* model must hold 64 characters */
+void cpuModel(char *model)
+{
+    strcpy(model, "unknown");
+#if X265_ARCH_X86
+    uint32_t regs[12];
+    uint32_t eax, ebx, ecx, edx;
+    x265_cpu_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000004)
+        return;
+    for (uint32_t i = 0; i < 3; i++)
+        x265_cpu_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+
+    char brand[sizeof(regs) + 1];
+    memcpy(brand, regs, sizeof(regs));
+    brand[sizeof(regs)] = 0;
+
+    const char *p = brand;
+    while (*p == ' ')
+        p++;
+    if (*p)
+        sprintf(model, "%.63s", p);
+#endif
+}
+
+struct Candidates
+{
+    const char       *names[MAX_CANDIDATES];
+    EncoderPrimitives tables[MAX_CANDIDATES];
+    int               count;
+};
+
+int findCandidate(const Candidates& c, const char *name)
+{
+    for (int i = 0; i < c.count; i++)
+        if (!strcmp(c.names[i], name))
+            return i;
+
+    return -1;
+}
+
+/* apply a cached section, returns the number of primitives replaced or -1 if
+ * the file has no section for this key */
+int loadCache(const char *fname, const char *key, EncoderPrimitives& p, const Candidates& c)
+{
+    FILE *fh = fopen(fname, "r");
+    if (!fh)
+        return -1;
+
+    char line[512];
+    bool bFound = false;
+    int replaced = 0;
+    while (fgets(line, sizeof(line), fh))
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (!strncmp(line, "cpu ", 4))
+        {
+            if (bFound)
+                break;
+            bFound = !strcmp(line + 4, key);
+            continue;
+        }
+        if (!bFound)
+            continue;
+
+        char family[32], level[16];
+        int index;
+        if (sscanf(line, "%31s %d %15s", family, &index, level) != 3)
+            continue;
+
+        int cand = findCandidate(c, level);
+        for (size_t f = 0; f < sizeof(tuneFamilies) / sizeof(tuneFamilies[0]) && cand >= 0; f++)
+        {
+            const TuneFamily& tf = tuneFamilies[f];
+            if (strcmp(tf.name, family) || index < 0 || index >= tf.count)
+                continue;
+
+            size_t offset = tf.offset + index * sizeof(pixelcmp_t);
+            const char *src = (const char*)&c.tables[cand] + offset;
+            void *null = NULL;
+            if (memcmp(src, &null, sizeof(pixelcmp_t)))
+            {
+                memcpy((char*)&p + offset, src, sizeof(pixelcmp_t));
+                replaced++;
+            }
+        }
+    }
+
+    fclose(fh);
+    return bFound ? replaced : -1;
+}
+}
+
+namespace x265 {
+void Setup_Tuned_Primitives(EncoderPrimitives &p, int cpuMask, const x265_param *param)
+{
+    const char *fname = param->primitiveCache;
+
+    char model[64];
+    cpuModel(model);
+    char key[512];
+    sprintf(key, "%s | %.200s | %.200s | %x", model, x265_build_info_str, x265_version_str, cpuMask);
+
+    /* the candidates are C and every ISA level the CPU supports. Each level
+     * keeps the flags of the lower levels */
+    Candidates *cand = new Candidates;
+    cand->count = 0;
+    cand->names[cand->count] = "C";
+    memset(&cand->tables[cand->count], 0, sizeof(EncoderPrimitives));
+    Setup_Candidate_Primitives(cand->tables[cand->count++], 0);
+    for (int l = 0; l < NUM_TUNE_LEVELS; l++)
+    {
+        if (!(cpuMask & tuneLevels[l].flags))
+            continue;
+
+        int mask = cpuMask;
+        for (int h = l + 1; h < NUM_TUNE_LEVELS; h++)
+            mask &= ~tuneLevels[h].flags;
+
+        cand->names[cand->count] = tuneLevels[l].name;
+        memset(&cand->tables[cand->count], 0, sizeof(EncoderPrimitives));
+        Setup_Candidate_Primitives(cand->tables[cand->count++], mask);
+    }
+
+    int replaced = loadCache(fname, key, p, *cand);
+    if (replaced >= 0)
+    {
+        x265_log(param, X265_LOG_INFO, "primitive tuning: %d primitives replaced, read from %s\n", replaced, fname);
+        delete cand;
+        return;
+    }
+
+    TuneBuffers buf;
+    if (!buf.create())
+    {
+        buf.destroy();
+        delete cand;
+        x265_log(param, X265_LOG_ERROR, "primitive tuning: buffer allocation failure\n");
+        return;
+    }
+
+    x265_log(param, X265_LOG_INFO, "primitive tuning: calibrating primitives for %s\n", model);
+
+    char *section = X265_MALLOC(char, 64 * 1024);
+    int sectionLen = section ? sprintf(section, "cpu %s\n", key) : 0;
+    int tuned = 0;
+    replaced = 0;
+
+    for (size_t f = 0; f < sizeof(tuneFamilies) / sizeof(tuneFamilies[0]); f++)
+    {
+        const TuneFamily& tf = tuneFamilies[f];
+        for (int i = 0; i < tf.count; i++)
+        {
+            int width, height;
+            if (tf.kind == TUNE_DCT || tf.kind == TUNE_IDCT)
+                width = height = transformSizes[i];
+            else
+            {
+                width = lumaPartDims[i][0];
+                height = lumaPartDims[i][1];
+
+                /* these sa8d are replaced by satd in Setup_Alias_Primitives */
+                if (tf.kind == TUNE_CMP && !strcmp(tf.name, "sa8d_inter") && ((width | height) & 7))
+                    continue;
+            }
+
+            size_t offset = tf.offset + i * sizeof(pixelcmp_t);
+            const char *current = (const char*)&p + offset;
+            void *null = NULL;
+            if (!memcmp(current, &null, sizeof(pixelcmp_t)))
+                continue;
+
+            /* the distinct candidates, the current primitive first */
+            int distinct[MAX_CANDIDATES];
+            int numDistinct = 0;
+            for (int c = cand->count - 1; c >= 0; c--)
+            {
+                const char *slot = (const char*)&cand->tables[c] + offset;
+                if (!memcmp(slot, &null, sizeof(pixelcmp_t)) || !memcmp(slot, current, sizeof(pixelcmp_t)))
+                    continue;
+
+                bool bSeen = false;
+                for (int d = 0; d < numDistinct; d++)
+                    bSeen |= !memcmp(slot, (const char*)&cand->tables[distinct[d]] + offset, sizeof(pixelcmp_t));
+                if (!bSeen)
+                    distinct[numDistinct++] = c;
+            }
+            if (!numDistinct)
+                continue;
+
+            int count = X265_MAX(tunePixels / (width * height), 8);
+            int64_t best = INT64_MAX;
+            int bestCand = -1;
+            for (int d = -1; d < numDistinct; d++)
+            {
+                const char *slot = d < 0 ? current : (const char*)&cand->tables[distinct[d]] + offset;
+                int64_t fastest = INT64_MAX;
+
+                timePrimitive(tf.kind, slot, width, buf, 1);
+                for (int r = 0; r < tuneRounds; r++)
+                    fastest = X265_MIN(fastest, timePrimitive(tf.kind, slot, width, buf, count));
+
+                if (d < 0)
+                    best = (int64_t)(fastest * tuneMargin);
+                else if (fastest < best)
+                {
+                    best = fastest;
+                    bestCand = distinct[d];
+                }
+            }
+
+            tuned++;
+            if (bestCand >= 0)
+            {
+                memcpy((char*)&p + offset, (const char*)&cand->tables[bestCand] + offset, sizeof(pixelcmp_t));
+                replaced++;
+                if (section && sectionLen < 63 * 1024)
+                    sectionLen += sprintf(section + sectionLen, "%s %d %s\n", tf.name, i, cand->names[bestCand]);
+            }
+        }
+    }
+
+    x265_log(param, X265_LOG_INFO, "primitive tuning: %d of %d primitives replaced\n", replaced, tuned);
+
+    /* unbuffered, so the section is passed to a single write and concurrent
+     * encoders append whole sections */
+    FILE *fh = section ? fopen(fname, "a") : NULL;
+    if (fh)
+    {
+        section[sectionLen++] = '\n';
+        setvbuf(fh, NULL, _IONBF, 0);
+        fwrite(section, 1, sectionLen, fh);
+        fclose(fh);
+    }
+    else
+        x265_log(param, X265_LOG_WARNING, "primitive tuning: unable to write %s\n", fname);
+
+    X265_FREE(section);
+    buf.destroy();
+    delete cand;
+}
+}
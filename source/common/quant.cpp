@@ -548,6 +548,62 @@ uint32_t Quant::rdoQuant(TComDataCU* cu, int16_t* dstCoeff, uint32_t log2TrSize,
         const uint32_t cgPosY   = cgBlkPos >> codeParams.log2TrSizeCG;
         const uint32_t cgPosX   = cgBlkPos - (cgPosY << codeParams.log2TrSizeCG);
         const uint64_t cgBlkPosMask = ((uint64_t)1 << cgBlkPos);
+
+        /* RDOQ measures distortion as the squared difference between the unquantized coded level
+         * and the original DCT coefficient. The result is shifted scaleBits to account for the
+         * FIX15 nature of the CABAC cost tables minus the forward transform scale.
+         *
+         * The cost of not coding a coefficient (all distortion, no signal bits) does not depend on
+         * the CABAC state, so it is measured for the whole group before the coded levels */
+        int64_t cgUncodedCost = 0;
+        int cgLevels = 0;
+        for (uint32_t scanPosinCG = 0; scanPosinCG < cgSize; scanPosinCG++)
+        {
+            scanPos = (cgScanPos << MLS_CG_SIZE) + scanPosinCG;
+            uint32_t blkPos = codeParams.scan[scanPos];
+            int signCoef    = m_resiDctCoeff[blkPos];
+
+            costUncoded[scanPos] = (int64_t)(signCoef * signCoef) << scaleBits;
+            if (usePsy && blkPos)
+                /* when no residual coefficient is coded, predicted coef == recon coef */
+                costUncoded[scanPos] -= PSYVALUE(m_fencDctCoeff[blkPos] - signCoef);
+
+            cgUncodedCost += costUncoded[scanPos];
+            cgLevels |= dstCoeff[blkPos];
+        }
+
+        totalUncodedCost += cgUncodedCost;
+
+        if (!cgLevels && cgScanPos)
+        {
+            /* no coefficient of this group was quantized to a non-zero level, so none can be coded.
+             * Its uncoded distortion is added with the cost of a 0 bit in the significant CG bitmap,
+             * the coefficient costs are not needed by the last position and sign hiding passes.
+             * Coeff group 0 is always measured in full, its coefficients are searched for the last
+             * position */
+            totalRdCost += cgUncodedCost;
+
+            if (lastScanPos < 0)
+                costCoeffGroupSig[cgScanPos] = 0;
+            else
+            {
+                /* context set update made at coefficient 0 of the group, c1 is unchanged by
+                 * zero levels */
+                c2 = 0;
+                goRiceParam = 0;
+                c1Idx = 0;
+                c2Idx = 0;
+                ctxSet = (cgScanPos == 1 || !bIsLuma) ? 0 : 2;
+                ctxSet -= ((int32_t)(c1 - 1) >> 31);
+                c1 = 1;
+
+                uint32_t ctxSig = getSigCoeffGroupCtxInc(sigCoeffGroupFlag64, cgPosX, cgPosY, codeParams.log2TrSizeCG);
+                costCoeffGroupSig[cgScanPos] = SIGCOST(estBitsSbac.significantCoeffGroupBits[ctxSig][0]);
+                totalRdCost += costCoeffGroupSig[cgScanPos];
+            }
+            continue;
+        }
+
         memset(&cgRdStats, 0, sizeof(coeffGroupRDStats));
 
         const int patternSigCtx = calcPatternSigCtx(sigCoeffGroupFlag64, cgPosX, cgPosY, codeParams.log2TrSizeCG);
@@ -561,18 +617,6 @@ uint32_t Quant::rdoQuant(TComDataCU* cu, int16_t* dstCoeff, uint32_t log2TrSize,
             int signCoef         = m_resiDctCoeff[blkPos];            /* pre-quantization DCT coeff */
             int predictedCoef    = m_fencDctCoeff[blkPos] - signCoef; /* predicted DCT = source DCT - residual DCT*/
 
-            /* RDOQ measures distortion as the squared difference between the unquantized coded level
-             * and the original DCT coefficient. The result is shifted scaleBits to account for the
-             * FIX15 nature of the CABAC cost tables minus the forward transform scale */
-
-            /* cost of not coding this coefficient (all distortion, no signal bits) */
-            costUncoded[scanPos] = (int64_t)(signCoef * signCoef) << scaleBits;
-            if (usePsy && blkPos)
-                /* when no residual coefficient is coded, predicted coef == recon coef */
-                costUncoded[scanPos] -= PSYVALUE(predictedCoef);
-
-            totalUncodedCost += costUncoded[scanPos];
-
             if (maxAbsLevel && lastScanPos < 0)
             {
                 /* remember the first non-zero coef found in this reverse scan as the last pos */
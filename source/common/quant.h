@@ -86,6 +86,9 @@ public:
     /* one-time setup */
     bool init(bool useRDOQ, double psyScale, const ScalingList& scalingList, Entropy& entropy);
 
+    /* enable or disable RDOQ for the following frames */
+    void setRDOQ(bool useRDOQ) { m_useRDOQ = useRDOQ; }
+
     /* CU setup */
     void setQPforQuant(TComDataCU* cu);
 
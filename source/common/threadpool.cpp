@@ -57,12 +57,15 @@ private:
 
 public:
 
+    WorkerStats    m_stats;
+
     PoolThread(ThreadPoolImpl& pool, int id)
         : m_pool(pool)
         , m_id(id)
         , m_dirty(false)
         , m_exited(false)
     {
+        memset(&m_stats, 0, sizeof(m_stats));
     }
 
     bool isDirty() const  { return m_dirty; }
@@ -122,6 +125,8 @@ public:
 
     int getThreadCount() const { return m_numThreads; }
 
+    void getWorkerStats(int id, WorkerStats& stats) const { stats = m_threads[id].m_stats; }
+
     void release();
 
     void Stop();
@@ -151,6 +156,7 @@ void PoolThread::threadMain()
     while (m_pool.IsValid())
     {
         /* Walk list of job providers, looking for work */
+        int64_t startTime = x265_mdate();
         JobProvider *cur = m_pool.m_firstProvider;
         while (cur)
         {
@@ -159,16 +165,24 @@ void PoolThread::threadMain()
             if (cur->findJob(m_id) == true)
                 break;
 
+            m_stats.numMisses++;
             cur = cur->m_nextProvider;
         }
 
         // this thread has reached the end of the provider list
         m_dirty = false;
 
+        int64_t endTime = x265_mdate();
         if (cur == NULL)
         {
             m_pool.markThreadAsleep(m_id);
             m_wakeEvent.wait();
+            m_stats.idleTime += x265_mdate() - endTime;
+        }
+        else
+        {
+            m_stats.busyTime += endTime - startTime;
+            m_stats.numJobs++;
         }
     }
 
@@ -35,6 +35,15 @@ class ThreadPool;
 
 int getCpuCount();
 
+// Cumulative activity of a worker thread of the pool, times in microseconds
+struct WorkerStats
+{
+    int64_t  busyTime;   // time spent walking the provider list when a job was found
+    int64_t  idleTime;   // time spent asleep, waiting to be poked
+    uint64_t numJobs;    // findJob() calls which performed work
+    uint64_t numMisses;  // findJob() calls which found no work
+};
+
 // Any class that wants to distribute work to the thread pool must
 // derive from JobProvider and implement FindJob().
 class JobProvider
@@ -104,6 +113,10 @@ public:
 
     virtual int  getThreadCount() const = 0;
 
+    // The counters are updated by the worker without synchronization, they
+    // are only suitable for reporting
+    virtual void getWorkerStats(int id, WorkerStats& stats) const = 0;
+
     friend class JobProvider;
 };
 } // end namespace x265
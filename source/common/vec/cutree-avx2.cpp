@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+
+using namespace x265;
+
+namespace {
+/* The C primitives compute in double precision, these do the same operations
+ * in the same order (no fused multiply-add) so the results are bit exact */
+void propagateCost(int *dst, uint16_t *propagateIn, int32_t *intraCosts, uint16_t *interCosts,
+                   int32_t *invQscales, double *fpsFactor, int len)
+{
+    double fps = *fpsFactor / 256;
+    __m256d vfps = _mm256_set1_pd(fps);
+    __m256d vhalf = _mm256_set1_pd(0.5);
+    __m128i vmask = _mm_set1_epi32((1 << 14) - 1);
+
+    int i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i intra = _mm_loadu_si128((__m128i*)(intraCosts + i));
+        __m128i invq  = _mm_loadu_si128((__m128i*)(invQscales + i));
+        __m128i prop  = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i*)(propagateIn + i)));
+        __m128i inter = _mm_and_si128(_mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i*)(interCosts + i))), vmask);
+
+        __m256d intraCost = _mm256_cvtepi32_pd(_mm_mullo_epi32(intra, invq));
+        __m256d amount    = _mm256_add_pd(_mm256_cvtepi32_pd(prop), _mm256_mul_pd(intraCost, vfps));
+        __m256d denom     = _mm256_cvtepi32_pd(intra);
+        __m256d num       = _mm256_sub_pd(denom, _mm256_cvtepi32_pd(inter));
+        __m256d res       = _mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(amount, num), denom), vhalf);
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvttpd_epi32(res));
+    }
+
+    for (; i < len; i++)
+    {
+        double intraCost       = intraCosts[i] * invQscales[i];
+        double propagateAmount = (double)propagateIn[i] + intraCost * fps;
+        double propagateNum    = (double)intraCosts[i] - (interCosts[i] & ((1 << 14) - 1));
+        double propagateDenom  = (double)intraCosts[i];
+        dst[i] = (int)(propagateAmount * propagateNum / propagateDenom + 0.5);
+    }
+}
+
+void propagateList(int32_t *dst, int *propagateAmount, uint16_t *lowresCosts, int16_t (*mvs)[2],
+                   int listWeight, int list, int cuy, int len)
+{
+    int32_t *posX = dst, *posY = dst + len;
+    int32_t *amount0 = dst + 2 * len, *amount1 = dst + 3 * len, *amount2 = dst + 4 * len, *amount3 = dst + 5 * len;
+
+    const __m256i vzero   = _mm256_setzero_si256();
+    const __m256i v31     = _mm256_set1_epi32(31);
+    const __m256i v32     = _mm256_set1_epi32(32);
+    const __m256i v512    = _mm256_set1_epi32(512);
+    const __m256i vbipred = _mm256_set1_epi32(3);
+    const __m256i vweight = _mm256_set1_epi32(listWeight);
+    const __m256i vlist   = _mm256_set1_epi32(1 << list);
+    const __m256i vcuy    = _mm256_set1_epi32(cuy);
+    const __m256i vidx    = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        __m256i amount = _mm256_loadu_si256((__m256i*)(propagateAmount + i));
+        __m256i used   = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i*)(lowresCosts + i))), 14);
+        __m256i mv     = _mm256_loadu_si256((__m256i*)(mvs + i));
+
+        /* CUs with a positive amount which use this list */
+        __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi32(amount, vzero),
+                                        _mm256_cmpeq_epi32(_mm256_and_si256(used, vlist), vlist));
+
+        /* Apply bipred weighting. */
+        __m256i weighted = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(amount, vweight), v32), 6);
+        amount = _mm256_blendv_epi8(amount, weighted, _mm256_cmpeq_epi32(used, vbipred));
+
+        __m256i x = _mm256_srai_epi32(_mm256_slli_epi32(mv, 16), 16);
+        __m256i y = _mm256_srai_epi32(mv, 16);
+        __m256i cux = _mm256_add_epi32(_mm256_srai_epi32(x, 5), _mm256_add_epi32(vidx, _mm256_set1_epi32(i)));
+        __m256i cuyv = _mm256_add_epi32(_mm256_srai_epi32(y, 5), vcuy);
+        x = _mm256_and_si256(x, v31);
+        y = _mm256_and_si256(y, v31);
+        __m256i x1 = _mm256_sub_epi32(v32, x);
+        __m256i y1 = _mm256_sub_epi32(v32, y);
+
+        __m256i a0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(amount, _mm256_mullo_epi32(y1, x1)), v512), 10);
+        __m256i a1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(amount, _mm256_mullo_epi32(y1, x)), v512), 10);
+        __m256i a2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(amount, _mm256_mullo_epi32(y, x1)), v512), 10);
+        __m256i a3 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(amount, _mm256_mullo_epi32(y, x)), v512), 10);
+
+        _mm256_storeu_si256((__m256i*)(posX + i), _mm256_and_si256(cux, mask));
+        _mm256_storeu_si256((__m256i*)(posY + i), _mm256_and_si256(cuyv, mask));
+        _mm256_storeu_si256((__m256i*)(amount0 + i), _mm256_and_si256(a0, mask));
+        _mm256_storeu_si256((__m256i*)(amount1 + i), _mm256_and_si256(a1, mask));
+        _mm256_storeu_si256((__m256i*)(amount2 + i), _mm256_and_si256(a2, mask));
+        _mm256_storeu_si256((__m256i*)(amount3 + i), _mm256_and_si256(a3, mask));
+    }
+
+    for (; i < len; i++)
+    {
+        int32_t listsUsed = lowresCosts[i] >> 14;
+        int32_t listAmount = propagateAmount[i];
+
+        if (listAmount <= 0 || !((listsUsed >> list) & 1))
+        {
+            posX[i] = posY[i] = 0;
+            amount0[i] = amount1[i] = amount2[i] = amount3[i] = 0;
+            continue;
+        }
+
+        if (listsUsed == 3)
+            listAmount = (listAmount * listWeight + 32) >> 6;
+
+        int32_t x = mvs[i][0];
+        int32_t y = mvs[i][1];
+        posX[i] = (x >> 5) + i;
+        posY[i] = (y >> 5) + cuy;
+        x &= 31;
+        y &= 31;
+        amount0[i] = (listAmount * ((32 - y) * (32 - x)) + 512) >> 10;
+        amount1[i] = (listAmount * ((32 - y) * x) + 512) >> 10;
+        amount2[i] = (listAmount * (y * (32 - x)) + 512) >> 10;
+        amount3[i] = (listAmount * (y * x) + 512) >> 10;
+    }
+}
+}
+
+namespace x265 {
+void Setup_Vec_PixelPrimitives_avx2(EncoderPrimitives &p)
+{
+    p.propagateCost = propagateCost;
+    p.propagateList = propagateList;
+}
+}
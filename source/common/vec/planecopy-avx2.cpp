@@ -0,0 +1,119 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+
+using namespace x265;
+
+namespace {
+/* Input picture conversions of TComPicYuv::copyFromPicture(). Each row is
+ * converted 32 pixels at a time, the remainder of the row in C */
+
+#if HIGH_BIT_DEPTH
+void planecopy_cp(uint8_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift)
+{
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+        for (; c + 32 <= width; c += 32)
+        {
+            __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(src + c)));
+            __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(src + c + 16)));
+            _mm256_storeu_si256((__m256i*)(dst + c), _mm256_sll_epi16(lo, vshift));
+            _mm256_storeu_si256((__m256i*)(dst + c + 16), _mm256_sll_epi16(hi, vshift));
+        }
+
+        for (; c < width; c++)
+            dst[c] = ((pixel)src[c]) << shift;
+
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+void planecopy_sp(uint16_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask)
+{
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+    __m256i vmask = _mm256_set1_epi16(mask);
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+        for (; c + 32 <= width; c += 32)
+        {
+            __m256i lo = _mm256_loadu_si256((__m256i*)(src + c));
+            __m256i hi = _mm256_loadu_si256((__m256i*)(src + c + 16));
+            _mm256_storeu_si256((__m256i*)(dst + c), _mm256_and_si256(_mm256_srl_epi16(lo, vshift), vmask));
+            _mm256_storeu_si256((__m256i*)(dst + c + 16), _mm256_and_si256(_mm256_srl_epi16(hi, vshift), vmask));
+        }
+
+        for (; c < width; c++)
+            dst[c] = (pixel)((src[c] >> shift) & mask);
+
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+#else // if HIGH_BIT_DEPTH
+
+void planecopy_sp(uint16_t *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask)
+{
+    __m128i vshift = _mm_cvtsi32_si128(shift);
+    __m256i vmask = _mm256_set1_epi16(mask);
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+        for (; c + 32 <= width; c += 32)
+        {
+            __m256i lo = _mm256_and_si256(_mm256_srl_epi16(_mm256_loadu_si256((__m256i*)(src + c)), vshift), vmask);
+            __m256i hi = _mm256_and_si256(_mm256_srl_epi16(_mm256_loadu_si256((__m256i*)(src + c + 16)), vshift), vmask);
+
+            /* the mask keeps the values below 256, so the saturating pack is
+             * exact. packus interleaves the 128bit lanes of its sources */
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+            _mm256_storeu_si256((__m256i*)(dst + c), packed);
+        }
+
+        for (; c < width; c++)
+            dst[c] = (pixel)((src[c] >> shift) & mask);
+
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+#endif // if HIGH_BIT_DEPTH
+}
+
+namespace x265 {
+void Setup_Vec_PlanecopyPrimitives_avx2(EncoderPrimitives &p)
+{
+#if HIGH_BIT_DEPTH
+    p.planecopy_cp = planecopy_cp;
+#endif
+    p.planecopy_sp = planecopy_sp;
+}
+}
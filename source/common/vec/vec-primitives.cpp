@@ -32,12 +32,12 @@
 #define HAVE_SSE4
 #define HAVE_AVX2
 #elif defined(__GNUC__)
-#if __clang__ || (__GNUC__ >= 4 && __GNUC_MINOR__ >= 3)
+#if __clang__ || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3)
 #define HAVE_SSE3
 #define HAVE_SSSE3
 #define HAVE_SSE4
 #endif
-#if __clang__ || (__GNUC__ >= 4 && __GNUC_MINOR__ >= 7)
+#if __clang__ || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)
 #define HAVE_AVX2
 #endif
 #elif defined(_MSC_VER)
@@ -56,6 +56,8 @@ namespace x265 {
 void Setup_Vec_DCTPrimitives_sse3(EncoderPrimitives&);
 void Setup_Vec_DCTPrimitives_ssse3(EncoderPrimitives&);
 void Setup_Vec_DCTPrimitives_sse41(EncoderPrimitives&);
+void Setup_Vec_PixelPrimitives_avx2(EncoderPrimitives&);
+void Setup_Vec_PlanecopyPrimitives_avx2(EncoderPrimitives&);
 
 /* Use primitives for the best available vector architecture */
 void Setup_Instrinsic_Primitives(EncoderPrimitives &p, int cpuMask)
@@ -77,6 +79,13 @@ void Setup_Instrinsic_Primitives(EncoderPrimitives &p, int cpuMask)
     {
         Setup_Vec_DCTPrimitives_sse41(p);
     }
+#endif
+#ifdef HAVE_AVX2
+    if (cpuMask & X265_CPU_AVX2)
+    {
+        Setup_Vec_PixelPrimitives_avx2(p);
+        Setup_Vec_PlanecopyPrimitives_avx2(p);
+    }
 #endif
     (void)p;
     (void)cpuMask;
@@ -39,6 +39,17 @@ extern "C" {
 #include "dct8.h"
 }
 
+/* vec/planecopy-avx2.cpp replaces the plane copy assembly on AVX2 hosts when
+ * the compiler builds it; this must match the HAVE_AVX2 logic of
+ * vec/vec-primitives.cpp */
+#if defined(__INTEL_COMPILER) || \
+    (defined(__GNUC__) && (__clang__ || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define VEC_PLANECOPY_AVX2(cpuMask) ((cpuMask) & X265_CPU_AVX2)
+#else
+#define VEC_PLANECOPY_AVX2(cpuMask) 0
+#endif
+
 #define INIT2_NAME(name1, name2, cpu) \
     p.name1[LUMA_16x16] = x265_pixel_ ## name2 ## _16x16 ## cpu; \
     p.name1[LUMA_16x8]  = x265_pixel_ ## name2 ## _16x8 ## cpu;
@@ -1426,7 +1437,8 @@ void Setup_Assembly_Primitives(EncoderPrimitives &p, int cpuMask)
         p.intra_pred[1][BLOCK_8x8] = x265_intra_pred_dc8_sse4;
         p.intra_pred[1][BLOCK_16x16] = x265_intra_pred_dc16_sse4;
         p.intra_pred[1][BLOCK_32x32] = x265_intra_pred_dc32_sse4;
-        p.planecopy_cp = x265_upShift_8_sse4;
+        if (!VEC_PLANECOPY_AVX2(cpuMask))
+            p.planecopy_cp = x265_upShift_8_sse4;
 
         INTRA_ANG_SSE4_COMMON(sse4);
         INTRA_ANG_SSE4_HIGH(sse4);
@@ -1569,7 +1581,8 @@ void Setup_Assembly_Primitives(EncoderPrimitives &p, int cpuMask)
         p.dct[DCT_4x4] = x265_dct4_sse2;
         p.idct[IDCT_4x4] = x265_idct4_sse2;
         p.idct[IDST_4x4] = x265_idst4_sse2;
-        p.planecopy_sp = x265_downShift_16_sse2;
+        if (!VEC_PLANECOPY_AVX2(cpuMask))
+            p.planecopy_sp = x265_downShift_16_sse2;
         p.copy_shl[BLOCK_4x4] = x265_copy_shl_4_sse2;
         p.copy_shl[BLOCK_8x8] = x265_copy_shl_8_sse2;
         p.copy_shl[BLOCK_16x16] = x265_copy_shl_16_sse2;
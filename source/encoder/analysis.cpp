@@ -26,8 +26,10 @@
 #include "threading.h"
 
 #include "analysis.h"
+#include "analysisfile.h"
 #include "rdcost.h"
 #include "encoder.h"
+#include "slicetype.h"
 
 #include "PPA/ppa.h"
 
@@ -47,6 +49,8 @@ Analysis::Analysis() : JobProvider(NULL)
     for (int i = 0; i < MAX_PRED_TYPES; i++)
         m_modePredYuv[i] = NULL;
     m_bJobsQueued = false;
+    m_predMinDepth = 0;
+    m_predMaxDepth = NUM_CU_DEPTH - 1;
     m_totalNumME = m_numAcquiredME = m_numCompletedME = 0;
     m_totalNumJobs = m_numAcquiredJobs = m_numCompletedJobs = 0;
 }
@@ -142,8 +146,13 @@ bool Analysis::create(uint32_t numCUDepth, uint32_t maxWidth, ThreadLocalData *t
         m_bestMergeRecoYuv[i] = new TComYuv;
         ok &= m_bestMergeRecoYuv[i]->create(cuSize, cuSize, csp);
 
+        /* only the CTU is copied from the source picture, the deeper
+         * levels reference their part of it */
         m_origYuv[i] = new TComYuv;
-        ok &= m_origYuv[i]->create(cuSize, cuSize, csp);
+        if (i)
+            m_origYuv[i]->createView(cuSize, cuSize, csp);
+        else
+            ok &= m_origYuv[i]->create(cuSize, cuSize, csp);
     }
 
     m_bEncodeDQP = false;
@@ -279,13 +288,19 @@ void Analysis::parallelAnalysisJob(int threadId, int jobId)
         TComPicYuv* fenc = cu->m_pic->getPicYuvOrg();
 
         slave = &m_tld[threadId].analysis;
+        slave->setEffort(m_param);
         slave->m_me.setSourcePlane(fenc->getLumaAddr(), fenc->getStride());
         slave->m_log = &slave->m_sliceTypeLog[cu->m_slice->m_sliceType];
         slave->m_rdEntropyCoders = this->m_rdEntropyCoders;
-        m_origYuv[0]->copyPartToYuv(slave->m_origYuv[depth], m_curCUData->encodeIdx);
+        if (depth)
+            slave->m_origYuv[depth]->setPartView(m_origYuv[0], m_curCUData->encodeIdx);
+        else
+            m_origYuv[0]->copyPartToYuv(slave->m_origYuv[depth], m_curCUData->encodeIdx);
         slave->setQP(cu->m_slice, m_rdCost.m_qp);
+        slave->m_refLagPixels = m_refLagPixels;
         slave->m_quant.setQPforQuant(cu);
         slave->m_quant.m_nr = m_quant.m_nr;
+        slave->resetCTUCache(); // the slave's cached results belong to another CTU
     }
 
     if (m_param->rdLevel <= 4)
@@ -327,10 +342,14 @@ void Analysis::parallelME(int threadId, int meId)
     else
     {
         slave = &m_tld[threadId].analysis;
-
+        slave->setEffort(m_param);
         slave->m_me.setSourcePlane(fenc->getLumaAddr(), fenc->getStride());
-        m_origYuv[0]->copyPartToYuv(slave->m_origYuv[depth], m_curCUData->encodeIdx);
+        if (depth)
+            slave->m_origYuv[depth]->setPartView(m_origYuv[0], m_curCUData->encodeIdx);
+        else
+            m_origYuv[0]->copyPartToYuv(slave->m_origYuv[depth], m_curCUData->encodeIdx);
         slave->setQP(cu->m_slice, m_rdCost.m_qp);
+        slave->m_refLagPixels = m_refLagPixels;
     }
 
     uint32_t partAddr;
@@ -360,21 +379,44 @@ void Analysis::compressCU(TComDataCU* cu)
     if (cu->m_slice->m_pps->bUseDQP)
         m_bEncodeDQP = true;
 
+    // search results of the previous CTU are no longer relevant
+    resetCTUCache();
+
     // initialize CU data
     m_bestCU[0]->initCU(pic, cuAddr);
     m_tempCU[0]->initCU(pic, cuAddr);
 
+    m_predMinDepth = 0;
+    m_predMaxDepth = g_maxCUDepth;
+    m_seedMv[0] = m_seedMv[1] = NULL;
+    m_seedRefIdx[0] = m_seedRefIdx[1] = NULL;
+
+    /* decisions of an earlier encode read from the analysis file, when they
+     * are all valid in this frame. Decisions scaled from another resolution
+     * only seed the analysis */
+    AnalysisFrameData shared;
+    bool bSeed = m_param->analysisMode == X265_ANALYSIS_LOAD && pic->m_analysis && pic->m_analysis->bSeed;
+    bool bShared = m_param->analysisMode == X265_ANALYSIS_LOAD && pic->m_analysis && !bSeed &&
+                   getSharedCTU(cu, *pic->m_analysis, shared);
+
     // analysis of CU
     uint32_t numPartition = cu->m_cuLocalData->numPartitions;
     if (m_bestCU[0]->m_slice->m_sliceType == I_SLICE)
     {
-        if (m_param->analysisMode == X265_ANALYSIS_LOAD && pic->m_intraData)
+        if (bShared)
         {
             uint32_t zOrder = 0;
-            compressSharedIntraCTU(m_bestCU[0], m_tempCU[0], false, cu->m_cuLocalData, 
-                &pic->m_intraData->depth[cuAddr * cu->m_numPartitions],
-                &pic->m_intraData->partSizes[cuAddr * cu->m_numPartitions],
-                &pic->m_intraData->modes[cuAddr * cu->m_numPartitions], zOrder);
+            compressSharedCTU(m_bestCU[0], m_tempCU[0], 0, cu->m_cuLocalData, shared, zOrder);
+        }
+        else if (m_param->analysisMode == X265_ANALYSIS_LOAD && pic->m_intraData)
+        {
+            memset(&shared, 0, sizeof(shared));
+            shared.depth = &pic->m_intraData->depth[cuAddr * cu->m_numPartitions];
+            shared.partSize = (uint8_t*)&pic->m_intraData->partSizes[cuAddr * cu->m_numPartitions];
+            shared.lumaIntraDir = &pic->m_intraData->modes[cuAddr * cu->m_numPartitions];
+
+            uint32_t zOrder = 0;
+            compressSharedCTU(m_bestCU[0], m_tempCU[0], 0, cu->m_cuLocalData, shared, zOrder);
         }
         else
         {
@@ -414,7 +456,24 @@ void Analysis::compressCU(TComDataCU* cu)
     }
     else
     {
-        if (m_param->rdLevel < 5)
+        if (bSeed)
+            seedCTU(m_bestCU[0], *pic->m_analysis);
+        else if (m_param->depthPrediction && !bShared)
+            predictDepthRange(m_bestCU[0]);
+
+        if (bShared)
+        {
+            uint32_t zOrder = 0;
+            compressSharedCTU(m_bestCU[0], m_tempCU[0], 0, cu->m_cuLocalData, shared, zOrder);
+        }
+        else if (m_param->bEnableStaticSkip && checkStaticSkip(cu))
+        {
+            /* the CU stats below count it as a skipped depth 0 CU, like any
+             * other skip CU, so the row stats used by rate control see it */
+            X265_CHECK(cu->isSkipped(0) && !cu->getDepth(0), "static skip CTU not coded as depth 0 skip\n");
+            m_log->cntStaticSkipCtu++;
+        }
+        else if (m_param->rdLevel < 5)
         {
             TComDataCU* outBestCU = NULL;
 
@@ -472,6 +531,9 @@ void Analysis::compressCU(TComDataCU* cu)
             while (i < numPartition);
         }
     }
+
+    if (m_param->analysisMode == X265_ANALYSIS_SAVE && pic->m_analysis)
+        saveSharedCTU(cu, pic->m_analysis);
 }
 
 void Analysis::compressIntraCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu)
@@ -485,8 +547,8 @@ void Analysis::compressIntraCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, u
         // get original YUV data from picture
         m_origYuv[depth]->copyFromPicYuv(pic->getPicYuvOrg(), cuAddr, absPartIdx);
     else
-        // copy partition YUV from depth 0 CTU cache
-        m_origYuv[0]->copyPartToYuv(m_origYuv[depth], absPartIdx);
+        // reference partition YUV in the depth 0 CTU cache
+        m_origYuv[depth]->setPartView(m_origYuv[0], absPartIdx);
     Slice* slice = outTempCU->m_slice;
     // We need to split, so don't try these modes.
     int cu_split_flag = !(cu->flags & CU::LEAF);
@@ -609,8 +671,8 @@ void Analysis::compressIntraCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, u
 #endif
 }
 
-void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu, uint8_t* sharedDepth,
-                                      char* sharedPartSizes, uint8_t* sharedModes, uint32_t &zOrder)
+void Analysis::compressSharedCTU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu,
+                                 const AnalysisFrameData& shared, uint32_t &zOrder)
 {
     Frame* pic = outBestCU->m_pic;
 
@@ -621,7 +683,7 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
     int32_t ctuToDepthIndex = g_maxCUDepth - 1;
 
     if (depth)
-        m_origYuv[0]->copyPartToYuv(m_origYuv[depth], cu->encodeIdx);
+        m_origYuv[depth]->setPartView(m_origYuv[0], cu->encodeIdx);
     else
         m_origYuv[depth]->copyFromPicYuv(pic->getPicYuvOrg(), outBestCU->getAddr(), cu->encodeIdx);
 
@@ -629,10 +691,13 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
     int32_t cu_split_flag = !(cu->flags & CU::LEAF);
     int32_t cu_unsplit_flag = !(cu->flags & CU::SPLIT_MANDATORY);
 
-    if (cu_unsplit_flag && ((zOrder == cu->encodeIdx) && (depth == sharedDepth[zOrder])))
+    if (cu_unsplit_flag && ((zOrder == cu->encodeIdx) && (depth == shared.depth[zOrder])))
     {
         m_quant.setQPforQuant(outTempCU);
-        checkIntra(outTempCU, (PartSize)sharedPartSizes[zOrder], cu, &sharedModes[zOrder]);
+        if (!shared.predMode || shared.predMode[zOrder] == MODE_INTRA)
+            checkIntra(outTempCU, (PartSize)shared.partSize[zOrder], cu, &shared.lumaIntraDir[zOrder]);
+        else
+            checkSharedInter(outTempCU, cu, shared, zOrder);
         checkBestMode(outBestCU, outTempCU, depth);
 
         if (depth != g_maxCUDepth)
@@ -643,11 +708,11 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
         }
 
         // set current best CU cost to 0 marking as best CU present in shared CU data
-        outBestCU->m_totalRDCost = 0;
+        outBestCU->m_totalRDCost = outBestCU->m_totalPsyCost = 0;
         bSubBranch = false;
 
-        // increment zOrder offset to point to next best depth in sharedDepth buffer
-        zOrder += g_depthInc[ctuToDepthIndex][sharedDepth[zOrder]];
+        // increment zOrder offset to point to next best depth in shared depth buffer
+        zOrder += g_depthInc[ctuToDepthIndex][shared.depth[zOrder]];
     }
 
     // copy original YUV samples in lossless mode
@@ -660,6 +725,7 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
         uint32_t    nextDepth     = depth + 1;
         TComDataCU* subBestPartCU = m_bestCU[nextDepth];
         TComDataCU* subTempPartCU = m_tempCU[nextDepth];
+        bool bSharedBest = false;
         for (uint32_t partUnitIdx = 0; partUnitIdx < 4; partUnitIdx++)
         {
             CU *child_cu = pic->getCU(outTempCU->getAddr())->m_cuLocalData + cu->childIdx + partUnitIdx;
@@ -677,11 +743,11 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
                 // set current best CU cost to 1 marking as non-best CU by default
                 subTempPartCU->m_totalRDCost = 1;
 
-                compressSharedIntraCTU(subBestPartCU, subTempPartCU, nextDepth, child_cu, sharedDepth, sharedPartSizes, sharedModes, zOrder);
+                compressSharedCTU(subBestPartCU, subTempPartCU, nextDepth, child_cu, shared, zOrder);
                 outTempCU->copyPartFrom(subBestPartCU, child_cu, partUnitIdx, nextDepth); // Keep best part data to current temporary data.
 
                 if (!subBestPartCU->m_totalRDCost) // if cost is 0, CU is best CU
-                    outTempCU->m_totalRDCost = 0;  // set outTempCU cost to 0, so later check will use this CU as best CU
+                    bSharedBest = true;
 
                 m_bestRecoYuv[nextDepth]->copyToPartYuv(m_tmpRecoYuv[depth], child_cu->numPartitions * partUnitIdx);
             }
@@ -690,7 +756,7 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
                 subBestPartCU->copyToPic(nextDepth);
                 outTempCU->copyPartFrom(subBestPartCU, child_cu, partUnitIdx, nextDepth);
 
-                // increment zOrder offset to point to next best depth in sharedDepth buffer
+                // increment zOrder offset to point to next best depth in shared depth buffer
                 zOrder += g_depthInc[ctuToDepthIndex][nextDepth];
             }
         }
@@ -724,6 +790,10 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
             else
                 outTempCU->setQPSubParts(outTempCU->getRefQP(targetPartIdx), 0, depth); // set QP to default QP
         }
+        /* set outTempCU cost to 0, so the check below uses this CU as best CU. This is done
+         * after all sub-CUs were added since those outside the picture add the maximum cost */
+        if (bSharedBest)
+            outTempCU->m_totalRDCost = outTempCU->m_totalPsyCost = 0;
         m_rdEntropyCoders[nextDepth][CI_NEXT_BEST].store(m_rdEntropyCoders[depth][CI_TEMP_BEST]);
         checkBestMode(outBestCU, outTempCU, depth);
     }
@@ -746,10 +816,188 @@ void Analysis::compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTe
 #endif
 }
 
+/* Point shared at the analysis of this CTU and check that the saved decisions
+ * can be coded in this frame. The frame type may have been changed and
+ * references, AMP or frame parallelism may differ from the encode which
+ * saved them; such CTUs are analyzed normally */
+bool Analysis::getSharedCTU(TComDataCU* ctu, const AnalysisFrameData& frame, AnalysisFrameData& shared)
+{
+    Slice* slice = ctu->m_slice;
+    uint32_t offset = ctu->getAddr() * ctu->m_numPartitions;
+
+    shared.record = frame.record;
+    shared.depth = frame.depth + offset;
+    shared.partSize = frame.partSize + offset;
+    shared.predMode = frame.predMode + offset;
+    shared.lumaIntraDir = frame.lumaIntraDir + offset;
+    shared.mergeFlag = frame.mergeFlag + offset;
+    shared.interDir = frame.interDir + offset;
+    for (int l = 0; l < 2; l++)
+    {
+        shared.mv[l] = frame.mv[l] + offset;
+        shared.refIdx[l] = frame.refIdx[l] + offset;
+        shared.mvpIdx[l] = frame.mvpIdx[l] + offset;
+    }
+    shared.next = NULL;
+
+    for (uint32_t i = 0; i < ctu->m_numPartitions; i++)
+    {
+        /* partitions outside of the picture hold no decision */
+        if (ctu->getCUPelX() + g_zscanToPelX[i] >= (uint32_t)m_param->sourceWidth ||
+            ctu->getCUPelY() + g_zscanToPelY[i] >= (uint32_t)m_param->sourceHeight)
+            continue;
+
+        if (shared.depth[i] > g_maxCUDepth)
+            return false;
+        if (shared.predMode[i] == MODE_INTRA)
+        {
+            if ((shared.partSize[i] != SIZE_2Nx2N && shared.partSize[i] != SIZE_NxN) || shared.lumaIntraDir[i] >= 35)
+                return false;
+            continue;
+        }
+        if (shared.predMode[i] != MODE_INTER || slice->isIntra())
+            return false;
+
+        PartSize partSize = (PartSize)shared.partSize[i];
+        if (partSize == SIZE_NxN || partSize > SIZE_nRx2N || (partSize >= SIZE_2NxnU && !slice->m_sps->bUseAMP))
+            return false;
+        int interDir = shared.interDir[i];
+        if (!interDir || interDir > (slice->isInterB() ? 3 : 1))
+            return false;
+        for (int l = 0; l < 2; l++)
+        {
+            if (!(interDir & (1 << l)))
+                continue;
+            int refIdx = shared.refIdx[l][i];
+            if (refIdx < 0 || refIdx >= slice->m_numRefIdx[l] || shared.mvpIdx[l][i] >= AMVP_NUM_CANDS)
+                return false;
+            /* the saving encode may have used other references (--ref,
+             * --bframes, --b-pyramid), the motion is only valid towards the
+             * same frame */
+            if (refIdx >= frame.record->numRefIdx[l] || frame.record->refPoc[l][refIdx] != slice->m_refPOCList[l][refIdx])
+                return false;
+            /* only part of the reference frames is available with frame parallelism */
+            if (m_bFrameParallel && shared.mv[l][i].y >= (m_refLagPixels + 1) * 4)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* Code an inter CU with the partitions and motion saved in the analysis file,
+ * without motion search. Saved merge candidates which are not derived again
+ * here (their neighbours were coded differently) are coded as AMVP motion */
+void Analysis::checkSharedInter(TComDataCU*& outTempCU, CU* cuData, const AnalysisFrameData& shared, uint32_t zOrder)
+{
+    TComMvField mvFieldNeighbours[MRG_MAX_NUM_CANDS][2]; // double length for mv of both lists
+    uint8_t interDirNeighbours[MRG_MAX_NUM_CANDS];
+    MV amvpCand[AMVP_NUM_CANDS];
+    MV mvc[(MD_ABOVE_LEFT + 1) * 2 + 1];
+
+    uint32_t depth = outTempCU->getDepth(0);
+    PartSize partSize = (PartSize)shared.partSize[zOrder];
+
+    outTempCU->setSkipFlagSubParts(false, 0, depth);
+    outTempCU->setPartSizeSubParts(partSize, 0, depth);
+    outTempCU->setPredModeSubParts(MODE_INTER, 0, depth);
+    outTempCU->setCUTransquantBypassSubParts(!!m_param->bLossless, 0, depth);
+
+    int numPart = outTempCU->getNumPartInter();
+    for (int partIdx = 0; partIdx < numPart; partIdx++)
+    {
+        uint32_t partAddr;
+        int width, height;
+        outTempCU->getPartIndexAndSize(partIdx, partAddr, width, height);
+
+        uint32_t idx = zOrder + partAddr;
+        int interDir = shared.interDir[idx];
+        TComMvField field[2];
+        for (int l = 0; l < 2; l++)
+            if (interDir & (1 << l))
+                field[l].setMvField(shared.mv[l][idx], shared.refIdx[l][idx]);
+
+        bool bMerge = false;
+        if (shared.mergeFlag[idx])
+        {
+            uint32_t maxNumMergeCand = outTempCU->m_slice->m_maxNumMergeCand;
+            uint32_t mergeIdx = shared.mvpIdx[0][idx];
+            if (mergeIdx < maxNumMergeCand)
+            {
+                outTempCU->getInterMergeCandidates(partAddr, partIdx, mvFieldNeighbours, interDirNeighbours, maxNumMergeCand);
+                if (outTempCU->isBipredRestriction() && interDirNeighbours[mergeIdx] == 3)
+                {
+                    interDirNeighbours[mergeIdx] = 1;
+                    mvFieldNeighbours[mergeIdx][1].refIdx = NOT_VALID;
+                }
+                const TComMvField* cand = mvFieldNeighbours[mergeIdx];
+                bMerge = mergeIdx < maxNumMergeCand && interDirNeighbours[mergeIdx] == interDir &&
+                         (!(interDir & 1) || (cand[0].mv == field[0].mv && cand[0].refIdx == field[0].refIdx)) &&
+                         (!(interDir & 2) || (cand[1].mv == field[1].mv && cand[1].refIdx == field[1].refIdx));
+            }
+            if (bMerge)
+            {
+                outTempCU->setMergeFlag(partAddr, true);
+                outTempCU->setMergeIndex(partAddr, mergeIdx);
+                outTempCU->setInterDirSubParts(interDir, partAddr, partIdx, depth);
+                outTempCU->getCUMvField(REF_PIC_LIST_0)->setAllMvField(mvFieldNeighbours[mergeIdx][0], partSize, partAddr, 0, partIdx);
+                outTempCU->getCUMvField(REF_PIC_LIST_1)->setAllMvField(mvFieldNeighbours[mergeIdx][1], partSize, partAddr, 0, partIdx);
+            }
+        }
+
+        if (!bMerge)
+        {
+            outTempCU->setMergeFlag(partAddr, false);
+            outTempCU->setInterDirSubParts(interDir, partAddr, partIdx, depth);
+            for (int l = 0; l < 2; l++)
+            {
+                TComCUMvField* mvField = outTempCU->getCUMvField(l);
+                mvField->setAllMvField(field[l], partSize, partAddr, 0, partIdx);
+                if (interDir & (1 << l))
+                {
+                    /* the saved predictor index is kept, the predictors may differ */
+                    int mvpIdx = shared.mvpIdx[l][idx];
+                    outTempCU->fillMvpCand(partIdx, partAddr, l, field[l].refIdx, amvpCand, mvc);
+                    mvField->setMvd(partAddr, field[l].mv - amvpCand[mvpIdx]);
+                    outTempCU->setMVPIdx(l, partAddr, mvpIdx);
+                }
+            }
+        }
+
+        prepMotionCompensation(outTempCU, cuData, partIdx);
+        motionCompensation(m_tmpPredYuv[depth], true, true);
+    }
+
+    encodeResAndCalcRdInterCU(outTempCU, cuData, m_origYuv[depth], m_tmpPredYuv[depth], m_tmpResiYuv[depth], m_bestResiYuv[depth], m_tmpRecoYuv[depth]);
+    checkDQP(outTempCU);
+}
+
+/* Store the final decisions of this CTU into the analysis of the frame */
+void Analysis::saveSharedCTU(TComDataCU* ctu, AnalysisFrameData* frame)
+{
+    uint32_t numPartition = ctu->m_numPartitions;
+    uint32_t offset = ctu->getAddr() * numPartition;
+
+    memcpy(frame->depth + offset, ctu->getDepth(), numPartition);
+    memcpy(frame->partSize + offset, ctu->getPartitionSize(), numPartition);
+    memcpy(frame->predMode + offset, ctu->getPredictionMode(), numPartition);
+    memcpy(frame->lumaIntraDir + offset, ctu->getLumaIntraDir(), numPartition);
+    memcpy(frame->interDir + offset, ctu->getInterDir(), numPartition);
+    for (int l = 0; l < 2; l++)
+    {
+        memcpy(frame->mv[l] + offset, ctu->getCUMvField(l)->m_mv, numPartition * sizeof(MV));
+        memcpy(frame->refIdx[l] + offset, ctu->getCUMvField(l)->m_refIdx, numPartition);
+        memcpy(frame->mvpIdx[l] + offset, ctu->getMVPIdx(l), numPartition);
+    }
+    for (uint32_t i = 0; i < numPartition; i++)
+        frame->mergeFlag[offset + i] = ctu->getMergeFlag(i);
+}
+
 void Analysis::checkIntra(TComDataCU*& outTempCU, PartSize partSize, CU *cu, uint8_t* sharedModes)
 {
     //PPAScopeEvent(CheckRDCostIntra + depth);
     uint32_t depth = g_log2Size[m_param->maxCUSize] - cu->log2CUSize;
+    outTempCU->setSkipFlagSubParts(false, 0, depth);
     outTempCU->setPartSizeSubParts(partSize, 0, depth);
     outTempCU->setPredModeSubParts(MODE_INTRA, 0, depth);
     outTempCU->setCUTransquantBypassSubParts(!!m_param->bLossless, 0, depth);
@@ -768,6 +1016,11 @@ void Analysis::checkIntra(TComDataCU*& outTempCU, PartSize partSize, CU *cu, uin
     if (outTempCU->m_slice->m_pps->bTransquantBypassEnabled)
         m_entropyCoder.codeCUTransquantBypassFlag(outTempCU->getCUTransquantBypass(0));
 
+    if (!outTempCU->m_slice->isIntra())
+    {
+        m_entropyCoder.codeSkipFlag(outTempCU, 0);
+        m_entropyCoder.codePredMode(outTempCU->getPredictionMode(0));
+    }
     m_entropyCoder.codePartSize(outTempCU, 0, depth);
     m_entropyCoder.codePredInfo(outTempCU, 0);
     outTempCU->m_mvBits = m_entropyCoder.getNumberOfWrittenBits();
@@ -801,8 +1054,8 @@ void Analysis::compressInterCU_rd0_4(TComDataCU*& outBestCU, TComDataCU*& outTem
     uint32_t absPartIdx = cu->encodeIdx;
 
     if (depth)
-        // copy partition YUV from depth 0 CTU cache
-        m_origYuv[0]->copyPartToYuv(m_origYuv[depth], absPartIdx);
+        // reference partition YUV in the depth 0 CTU cache
+        m_origYuv[depth]->setPartView(m_origYuv[0], absPartIdx);
     else
         // get original YUV data from picture
         m_origYuv[depth]->copyFromPicYuv(pic->getPicYuvOrg(), cuAddr, absPartIdx);
@@ -850,6 +1103,7 @@ void Analysis::compressInterCU_rd0_4(TComDataCU*& outBestCU, TComDataCU*& outTem
             delta = 1;
         if (minDepth > 0)
             minDepth = minDepth - delta;
+        minDepth = X265_MAX(minDepth, m_predMinDepth);
     }
     if (depth >= minDepth)
     {
@@ -1178,6 +1432,15 @@ void Analysis::compressInterCU_rd0_4(TComDataCU*& outBestCU, TComDataCU*& outTem
                 fillOrigYUVBuffer(outBestCU, m_origYuv[depth]);
         }
     }
+    else if (cu_unsplit_flag && depth < m_predMinDepth)
+        m_log->cntDepthPredSkipCu[depth]++;
+
+    // do not split beyond the predicted maximum depth
+    if (bSubBranch && cu_split_flag && outBestCU && depth >= m_predMaxDepth)
+    {
+        bSubBranch = false;
+        m_log->cntDepthPredSkipSplit[depth]++;
+    }
 
     // further split
     if (bSubBranch && cu_split_flag)
@@ -1404,8 +1667,8 @@ void Analysis::compressInterCU_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTem
     uint32_t absPartIdx = cu->encodeIdx;
 
     if (depth)
-        // copy partition YUV from depth 0 CTU cache
-        m_origYuv[0]->copyPartToYuv(m_origYuv[depth], absPartIdx);
+        // reference partition YUV in the depth 0 CTU cache
+        m_origYuv[depth]->setPartView(m_origYuv[0], absPartIdx);
     else
         // get original YUV data from picture
         m_origYuv[depth]->copyFromPicYuv(pic->getPicYuvOrg(), cuAddr, absPartIdx);
@@ -1418,8 +1681,12 @@ void Analysis::compressInterCU_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTem
     int cu_split_flag = !(cu->flags & CU::LEAF);
     int cu_unsplit_flag = !(cu->flags & CU::SPLIT_MANDATORY);
 
-    // We need to split, so don't try these modes.
-    if (cu_unsplit_flag)
+    // We need to split, so don't try these modes. Also skip them above the
+    // predicted minimum depth when splitting is possible
+    bool bSkipByDepth = cu_unsplit_flag && cu_split_flag && depth < m_predMinDepth;
+    if (bSkipByDepth)
+        m_log->cntDepthPredSkipCu[depth]++;
+    if (cu_unsplit_flag && !bSkipByDepth)
     {
         m_quant.setQPforQuant(outTempCU);
 
@@ -1475,7 +1742,7 @@ void Analysis::compressInterCU_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTem
                 }
 
                 // Try AMP (SIZE_2NxnU, SIZE_2NxnD, SIZE_nLx2N, SIZE_nRx2N)
-                if (slice->m_sps->maxAMPDepth > depth)
+                if (slice->m_sps->maxAMPDepth > depth && m_param->bEnableAMP)
                 {
                     bool bTestAMP_Hor = false, bTestAMP_Ver = false;
                     bool bTestMergeAMP_Hor = false, bTestMergeAMP_Ver = false;
@@ -1585,8 +1852,16 @@ void Analysis::compressInterCU_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTem
             fillOrigYUVBuffer(outBestCU, m_origYuv[depth]);
     }
 
+    // do not split beyond the predicted maximum depth
+    bool bTrySplit = cu_split_flag && !outBestCU->isSkipped(0);
+    if (bTrySplit && cu_unsplit_flag && depth >= m_predMaxDepth)
+    {
+        bTrySplit = false;
+        m_log->cntDepthPredSkipSplit[depth]++;
+    }
+
     // further split
-    if (cu_split_flag && !outBestCU->isSkipped(0))
+    if (bTrySplit)
     {
         uint32_t    nextDepth     = depth + 1;
         TComDataCU* subBestPartCU = m_bestCU[nextDepth];
@@ -1701,8 +1976,8 @@ void Analysis::checkMerge2Nx2N_rd0_4(TComDataCU*& outBestCU, TComDataCU*& outTem
     for (uint32_t mergeCand = 0; mergeCand < maxNumMergeCand; ++mergeCand)
     {
         if (!m_bFrameParallel ||
-            (mvFieldNeighbours[mergeCand][0].mv.y < (m_param->searchRange + 1) * 4 &&
-             mvFieldNeighbours[mergeCand][1].mv.y < (m_param->searchRange + 1) * 4))
+            (mvFieldNeighbours[mergeCand][0].mv.y < (m_refLagPixels + 1) * 4 &&
+             mvFieldNeighbours[mergeCand][1].mv.y < (m_refLagPixels + 1) * 4))
         {
             // set MC parameters, interprets depth relative to CTU level
             outTempCU->setMergeIndex(0, mergeCand);
@@ -1805,8 +2080,8 @@ void Analysis::checkMerge2Nx2N_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTem
         for (uint32_t mergeCand = 0; mergeCand < maxNumMergeCand; ++mergeCand)
         {
             if (m_bFrameParallel &&
-                (mvFieldNeighbours[mergeCand][0].mv.y >= (m_param->searchRange + 1) * 4 ||
-                 mvFieldNeighbours[mergeCand][1].mv.y >= (m_param->searchRange + 1) * 4))
+                (mvFieldNeighbours[mergeCand][0].mv.y >= (m_refLagPixels + 1) * 4 ||
+                 mvFieldNeighbours[mergeCand][1].mv.y >= (m_refLagPixels + 1) * 4))
             {
                 continue;
             }
@@ -1983,8 +2258,8 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
     // Reference sample smoothing
     TComPattern::initAdiPattern(cu, cuData, partOffset, initTrDepth, m_predBuf, m_refAbove, m_refLeft, m_refAboveFlt, m_refLeftFlt, ALL_IDX);
 
-    pixel* fenc     = m_origYuv[depth]->getLumaAddr();
-    uint32_t stride = m_origYuv[depth]->getStride();
+    pixel* fenc         = m_origYuv[depth]->getLumaAddr();
+    uint32_t fencStride = m_origYuv[depth]->getStride();
 
     pixel *above         = m_refAbove    + tuSize - 1;
     pixel *aboveFiltered = m_refAboveFlt + tuSize - 1;
@@ -1997,22 +2272,22 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
     // 33 Angle modes once
     ALIGN_VAR_32(pixel, buf_trans[32 * 32]);
     ALIGN_VAR_32(pixel, tmp[33 * 32 * 32]);
+    ALIGN_VAR_32(pixel, bufScale[32 * 32]);
+    pixel _above[4 * 32 + 1];
+    pixel _left[4 * 32 + 1];
     int scaleTuSize = tuSize;
-    int scaleStride = stride;
+    int scaleStride = tuSize;
     int costShift = 0;
     int sizeIdx = log2TrSize - 2;
 
     if (tuSize > 32)
     {
         // origin is 64x64, we scale to 32x32 and setup required parameters
-        ALIGN_VAR_32(pixel, bufScale[32 * 32]);
-        primitives.scale2D_64to32(bufScale, fenc, stride);
+        primitives.scale2D_64to32(bufScale, fenc, fencStride);
         fenc = bufScale;
 
         // reserve space in case primitives need to store data in above
         // or left buffers
-        pixel _above[4 * 32 + 1];
-        pixel _left[4 * 32 + 1];
         pixel *aboveScale  = _above + 2 * 32;
         pixel *leftScale   = _left + 2 * 32;
         aboveScale[0] = leftScale[0] = above[0];
@@ -2021,6 +2296,7 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
 
         scaleTuSize = 32;
         scaleStride = 32;
+        fencStride = 32;
         costShift = 2;
         sizeIdx = 5 - 2; // log2(scaleTuSize) - 2
 
@@ -2040,12 +2316,37 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
     uint64_t mpms;
     uint32_t rbits = getIntraRemModeBits(cu, partOffset, depth, preds, mpms);
 
+    uint64_t modeCosts[35];
+    for (mode = 0; mode < 35; mode++)
+        modeCosts[mode] = MAX_INT64;
+
+    /* with --fast-intra-modes, measure only the modes suggested by the
+     * enclosing PU of twice this size */
+    uint32_t zOrder = cuData->encodeIdx;
+    if (m_param->bEnableFastIntraModes)
+    {
+        uint64_t modeMask = getIntraModeSubset(cu, zOrder, log2TrSize, mpms, isInterLikely(cu, zOrder, log2TrSize));
+        if (modeMask)
+        {
+            uint32_t usad;
+            bmode = estIntraModeSubset(cu, partOffset, depth, modeMask, mpms, rbits, fenc, fencStride, left, above,
+                                       leftFiltered, aboveFiltered, scaleTuSize, costShift, modeCosts, usad, bbits);
+            storeIntraModeCosts(zOrder, log2TrSize, modeCosts);
+
+            cu->setLumaIntraDirSubParts(bmode, partOffset, depth + initTrDepth);
+            cu->m_totalBits = bbits;
+            cu->m_totalDistortion = usad;
+            cu->m_sa8dCost = modeCosts[bmode];
+            return;
+        }
+    }
+
     // DC
     primitives.intra_pred[DC_IDX][sizeIdx](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
-    bsad = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
+    bsad = sa8d(fenc, fencStride, tmp, scaleStride) << costShift;
     bmode = mode = DC_IDX;
     bbits = (mpms & ((uint64_t)1 << mode)) ? getIntraModeBits(cu, mode, partOffset, depth) : rbits;
-    bcost = m_rdCost.calcRdSADCost(bsad, bbits);
+    modeCosts[mode] = bcost = m_rdCost.calcRdSADCost(bsad, bbits);
 
     pixel *abovePlanar = above;
     pixel *leftPlanar  = left;
@@ -2058,14 +2359,14 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
 
     // PLANAR
     primitives.intra_pred[PLANAR_IDX][sizeIdx](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
-    sad = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
+    sad = sa8d(fenc, fencStride, tmp, scaleStride) << costShift;
     mode = PLANAR_IDX;
     bits = (mpms & ((uint64_t)1 << mode)) ? getIntraModeBits(cu, mode, partOffset, depth) : rbits;
-    cost = m_rdCost.calcRdSADCost(sad, bits);
+    modeCosts[mode] = cost = m_rdCost.calcRdSADCost(sad, bits);
     COPY4_IF_LT(bcost, cost, bmode, mode, bsad, sad, bbits, bits);
 
     // Transpose NxN
-    primitives.transpose[sizeIdx](buf_trans, fenc, scaleStride);
+    primitives.transpose[sizeIdx](buf_trans, fenc, fencStride);
 
     primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
 
@@ -2076,10 +2377,10 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
 #define TRY_ANGLE(angle) \
     modeHor = angle < 18; \
     cmp = modeHor ? buf_trans : fenc; \
-    srcStride = modeHor ? scaleTuSize : scaleStride; \
+    srcStride = modeHor ? scaleTuSize : fencStride; \
     sad = sa8d(cmp, srcStride, &tmp[(angle - 2) * predsize], scaleTuSize) << costShift; \
     bits = (mpms & ((uint64_t)1 << angle)) ? getIntraModeBits(cu, angle, partOffset, depth) : rbits; \
-    cost = m_rdCost.calcRdSADCost(sad, bits)
+    modeCosts[angle] = cost = m_rdCost.calcRdSADCost(sad, bits)
 
     if (m_param->bEnableFastIntra)
     {
@@ -2126,6 +2427,9 @@ void Analysis::checkIntraInInter_rd0_4(TComDataCU* cu, CU* cuData)
         }
     }
 
+    if (m_param->bEnableFastIntraModes)
+        storeIntraModeCosts(zOrder, log2TrSize, modeCosts);
+
     cu->setLumaIntraDirSubParts(bmode, partOffset, depth + initTrDepth);
     cu->m_totalBits = bbits;
     cu->m_totalDistortion = bsad;
@@ -2362,7 +2666,8 @@ void Analysis::encodeResidue(TComDataCU* ctu, CU* cuData, uint32_t absPartIdx, u
     }
     else
     {
-        m_origYuv[0]->copyPartToYuv(m_origYuv[depth], absPartIdx);
+        if (depth)
+            m_origYuv[depth]->setPartView(m_origYuv[0], absPartIdx);
         generateCoeffRecon(cu, cuData, m_origYuv[depth], m_modePredYuv[5][depth], m_tmpResiYuv[depth], m_tmpRecoYuv[depth]);
         checkDQP(cu);
         m_tmpRecoYuv[depth]->copyToPicYuv(pic->getPicYuvRec(), cuAddr, absPartIdx);
@@ -2450,45 +2755,254 @@ void Analysis::fillOrigYUVBuffer(TComDataCU* cu, TComYuv* fencYuv)
     /* TODO: is this extra copy really necessary? the source pixels will still
      * be available when getLumaOrigYuv() is used */
 
-    uint32_t width  = 1 << cu->getLog2CUSize(0);
-    uint32_t height = 1 << cu->getLog2CUSize(0);
+    uint32_t width = 1 << cu->getLog2CUSize(0);
+    int part = partitionFromLog2Size(cu->getLog2CUSize(0));
+    int csp = m_param->internalCsp;
+
+    primitives.luma_copy_pp[part](cu->getLumaOrigYuv(), width, fencYuv->getLumaAddr(), fencYuv->getStride());
+
+    uint32_t widthC = width >> cu->getHorzChromaShift();
+    primitives.chroma[csp].copy_pp[part](cu->getChromaOrigYuv(1), widthC, fencYuv->getChromaAddr(1), fencYuv->getCStride());
+    primitives.chroma[csp].copy_pp[part](cu->getChromaOrigYuv(2), widthC, fencYuv->getChromaAddr(2), fencYuv->getCStride());
+}
+
+/* Predict the range of CU depths worth analyzing for this CTU from the depths
+ * chosen for the co-located CTUs of the nearest references and for the coded
+ * neighbor CTUs. The range is left open where the lookahead found intra to be
+ * cheaper than inter prediction (occlusions, scene changes), since the depths
+ * of the neighborhood say little about such content, and the maximum depth is
+ * left open where the AQ offsets within the CTU vary widely */
+void Analysis::predictDepthRange(TComDataCU* ctu)
+{
+    Frame* pic = ctu->m_pic;
+    Slice* slice = ctu->m_slice;
+    uint32_t cuAddr = ctu->getAddr();
+
+    m_log->cntDepthPredCtu++;
+
+    TComDataCU* sources[6];
+    int numSources = 0;
+    if (slice->m_numRefIdx[0] > 0)
+        sources[numSources++] = slice->m_refPicList[0][0]->getCU(cuAddr);
+    if (slice->m_numRefIdx[1] > 0)
+        sources[numSources++] = slice->m_refPicList[1][0]->getCU(cuAddr);
+    int numColocated = numSources;
+    if (ctu->getCULeft())
+        sources[numSources++] = ctu->getCULeft();
+    if (ctu->getCUAbove())
+        sources[numSources++] = ctu->getCUAbove();
+    if (ctu->getCUAboveLeft())
+        sources[numSources++] = ctu->getCUAboveLeft();
+    if (ctu->getCUAboveRight())
+        sources[numSources++] = ctu->getCUAboveRight();
+
+    // a single source is too weak a predictor
+    if (numSources < 2)
+        return;
+
+    /* Scan the 16x16 lowres blocks covered by this CTU */
+    Lowres& lowres = pic->m_lowres;
+    double* qpoffs = m_param->rc.aqMode ? lowres.qpAqOffset : NULL;
+    double minOffset = 0, maxOffset = 0;
+    int maxBlockCols = (pic->getPicYuvOrg()->getWidth() + (16 - 1)) / 16;
+    int maxBlockRows = (pic->getPicYuvOrg()->getHeight() + (16 - 1)) / 16;
+    int noOfBlocks = g_maxCUSize / 16;
+    int block_y = (cuAddr / pic->getFrameWidthInCU()) * noOfBlocks;
+    int block_x = (cuAddr % pic->getFrameWidthInCU()) * noOfBlocks;
+    bool bFirst = true;
+
+    for (int h = 0; h < noOfBlocks && block_y + h < maxBlockRows; h++)
+    {
+        for (int w = 0; w < noOfBlocks && block_x + w < maxBlockCols; w++)
+        {
+            int idx = block_x + w + (block_y + h) * maxBlockCols;
+            if (lowres.lowresCostForRc &&
+                lowres.intraCost[idx] < (lowres.lowresCostForRc[idx] & LOWRES_COST_MASK))
+                return;
+            if (qpoffs)
+            {
+                if (bFirst || qpoffs[idx] < minOffset)
+                    minOffset = qpoffs[idx];
+                if (bFirst || qpoffs[idx] > maxOffset)
+                    maxOffset = qpoffs[idx];
+                bFirst = false;
+            }
+        }
+    }
+
+    /* The safe mode spans the depths of all sources, the tight mode only those
+     * of the co-located CTUs */
+    int numUsed = m_param->depthPrediction == 2 ? numColocated : numSources;
+    uint32_t minDepth = g_maxCUDepth, maxDepth = 0;
+    for (int s = 0; s < numUsed; s++)
+    {
+        for (uint32_t i = 0; i < ctu->m_numPartitions; i += 4)
+        {
+            uint32_t d = sources[s]->getDepth(i);
+            minDepth = X265_MIN(minDepth, d);
+            maxDepth = X265_MAX(maxDepth, d);
+        }
+    }
+
+    // an AQ offset spread of 4 QP marks CTUs mixing flat and detailed areas
+    if (maxOffset - minOffset > 4.0)
+        maxDepth = g_maxCUDepth;
+
+    m_predMinDepth = X265_MIN(minDepth, g_maxCUDepth);
+    m_predMaxDepth = X265_MAX(maxDepth, m_predMinDepth);
+    if (m_predMinDepth || m_predMaxDepth < g_maxCUDepth)
+        m_log->cntDepthPredRestricted++;
+}
 
-    pixel* srcY = fencYuv->getLumaAddr();
-    pixel* dstY = cu->getLumaOrigYuv();
-    uint32_t srcStride = fencYuv->getStride();
+/* Restrict the CU depths of this CTU to the range of the seed depths scaled
+ * from the analysis of another resolution, and seed its motion searches with
+ * the scaled MVs */
+void Analysis::seedCTU(TComDataCU* ctu, const AnalysisFrameData& frame)
+{
+    uint32_t offset = ctu->getAddr() * ctu->m_numPartitions;
+    uint32_t minDepth = g_maxCUDepth, maxDepth = 0;
 
-    /* TODO: square block copy primitive */
-    for (uint32_t y = 0; y < height; y++)
+    for (uint32_t i = 0; i < ctu->m_numPartitions; i++)
     {
-        for (uint32_t x = 0; x < width; x++)
-            dstY[x] = srcY[x];
+        if (ctu->getCUPelX() + g_zscanToPelX[i] >= (uint32_t)m_param->sourceWidth ||
+            ctu->getCUPelY() + g_zscanToPelY[i] >= (uint32_t)m_param->sourceHeight)
+            continue;
 
-        dstY += width;
-        srcY += srcStride;
+        uint32_t d = frame.depth[offset + i];
+        minDepth = X265_MIN(minDepth, d);
+        maxDepth = X265_MAX(maxDepth, d);
     }
 
-    pixel* srcCb = fencYuv->getChromaAddr(1);
-    pixel* srcCr = fencYuv->getChromaAddr(2);
+    /* the depths were rounded down where the scaled CU sizes fall between two
+     * CU sizes of this encode */
+    m_predMinDepth = X265_MIN(minDepth, g_maxCUDepth);
+    m_predMaxDepth = X265_MIN(X265_MAX(maxDepth + frame.depthSpread, m_predMinDepth), g_maxCUDepth);
 
-    pixel* dstCb = cu->getChromaOrigYuv(1);
-    pixel* dstCr = cu->getChromaOrigYuv(2);
+    /* the seeds of a list are only used when its references are the frames
+     * the saving encode searched */
+    Slice* slice = ctu->m_slice;
+    for (int l = 0; l < 2; l++)
+    {
+        bool bSameRefs = true;
+        int numRefIdx = X265_MIN(slice->m_numRefIdx[l], frame.record->numRefIdx[l]);
+        for (int ref = 0; ref < numRefIdx; ref++)
+            bSameRefs &= frame.record->refPoc[l][ref] == slice->m_refPOCList[l][ref];
 
-    uint32_t srcStrideC = fencYuv->getCStride();
-    uint32_t widthC  = width  >> cu->getHorzChromaShift();
-    uint32_t heightC = height >> cu->getVertChromaShift();
+        m_seedMv[l] = bSameRefs ? frame.mv[l] + offset : NULL;
+        m_seedRefIdx[l] = bSameRefs ? frame.refIdx[l] + offset : NULL;
+    }
+}
 
-    /* TODO: block copy primitives */
-    for (uint32_t y = 0; y < heightC; y++)
+/* Returns false if a sample of the source differs by more than one from the
+ * reference source. Otherwise adds the squared errors of the source and of
+ * the reference source against the reference reconstruction to sse[0] and
+ * sse[1] */
+static bool isStaticBlock(const pixel* fenc, intptr_t fencStride, const pixel* org, const pixel* rec, intptr_t refStride,
+                          int width, int height, uint64_t sse[2])
+{
+    for (int y = 0; y < height; y++, fenc += fencStride, org += refStride, rec += refStride)
     {
-        for (uint32_t x = 0; x < widthC; x++)
+        for (int x = 0; x < width; x++)
         {
-            dstCb[x] = srcCb[x];
-            dstCr[x] = srcCr[x];
+            if (abs(fenc[x] - org[x]) > 1)
+                return false;
+
+            int diffFenc = fenc[x] - rec[x];
+            int diffOrg = org[x] - rec[x];
+            sse[0] += diffFenc * diffFenc;
+            sse[1] += diffOrg * diffOrg;
         }
+    }
+
+    return true;
+}
 
-        dstCb += widthC;
-        dstCr += widthC;
-        srcCb += srcStrideC;
-        srcCr += srcStrideC;
+/* Code the CTU as a zero-motion merge skip if its source matches the source
+ * of the co-located block in the nearest reference(s) and a merge candidate
+ * with zero motion towards those references exists. The skip must also not
+ * be further from the reference reconstruction than the reference source
+ * was, so a chain of skipped frames never drifts from the distortion of the
+ * last coded one (a slow fade is coded, not skipped). Returns false, leaving
+ * the CTU untouched, if full analysis is required */
+bool Analysis::checkStaticSkip(TComDataCU* ctu)
+{
+    CU* cuData = ctu->m_cuLocalData;
+    if (!(cuData->flags & CU::PRESENT) || (cuData->flags & CU::SPLIT_MANDATORY) || m_param->bLossless)
+        return false;
+
+    Frame* pic = ctu->m_pic;
+    Slice* slice = ctu->m_slice;
+    uint32_t cuAddr = ctu->getAddr();
+    TComPicYuv* fenc = pic->getPicYuvOrg();
+    int cuWidth = g_maxCUSize >> CHROMA_H_SHIFT(m_param->internalCsp);
+    int cuHeight = g_maxCUSize >> CHROMA_V_SHIFT(m_param->internalCsp);
+
+    bool bStatic[2] = { false, false };
+    for (int l = 0; l < 2; l++)
+    {
+        if (slice->m_numRefIdx[l] <= 0 || slice->m_weightPredTable[l][0][0].bPresentFlag)
+            continue;
+
+        TComPicYuv* org = slice->m_refPicList[l][0]->getPicYuvOrg();
+        TComPicYuv* rec = slice->m_refPicList[l][0]->getPicYuvRec();
+        X265_CHECK(org->getStride() == rec->getStride() && org->getCStride() == rec->getCStride(),
+                   "reference source and reconstruction strides differ\n");
+
+        uint64_t sse[2] = { 0, 0 };
+        bStatic[l] = isStaticBlock(fenc->getLumaAddr(cuAddr), fenc->getStride(), org->getLumaAddr(cuAddr),
+                                   rec->getLumaAddr(cuAddr), rec->getStride(), g_maxCUSize, g_maxCUSize, sse) &&
+                     isStaticBlock(fenc->getCbAddr(cuAddr), fenc->getCStride(), org->getCbAddr(cuAddr),
+                                   rec->getCbAddr(cuAddr), rec->getCStride(), cuWidth, cuHeight, sse) &&
+                     isStaticBlock(fenc->getCrAddr(cuAddr), fenc->getCStride(), org->getCrAddr(cuAddr),
+                                   rec->getCrAddr(cuAddr), rec->getCStride(), cuWidth, cuHeight, sse) &&
+                     sse[0] <= sse[1];
+    }
+
+    if (!bStatic[0] && !bStatic[1])
+        return false;
+
+    TComDataCU* cu = m_bestCU[0];
+    TComMvField mvFieldNeighbours[MRG_MAX_NUM_CANDS][2]; // double length for mv of both lists
+    uint8_t interDirNeighbours[MRG_MAX_NUM_CANDS];
+    uint32_t maxNumMergeCand = slice->m_maxNumMergeCand;
+
+    cu->setPartSizeSubParts(SIZE_2Nx2N, 0, 0);
+    cu->setCUTransquantBypassSubParts(false, 0, 0);
+    cu->getInterMergeCandidates(0, 0, mvFieldNeighbours, interDirNeighbours, maxNumMergeCand);
+
+    /* the first candidate predicting with zero motion from static references */
+    int staticCand = -1;
+    for (uint32_t mergeCand = 0; mergeCand < maxNumMergeCand && staticCand < 0; mergeCand++)
+    {
+        bool bMatch = true;
+        for (int l = 0; l < 2; l++)
+        {
+            if (interDirNeighbours[mergeCand] & (1 << l))
+                bMatch &= bStatic[l] && !mvFieldNeighbours[mergeCand][l].refIdx && !mvFieldNeighbours[mergeCand][l].mv.word;
+        }
+
+        if (bMatch)
+            staticCand = mergeCand;
     }
+
+    if (staticCand < 0)
+        return false;
+
+    cu->setPredModeSubParts(MODE_INTER, 0, 0);
+    cu->setMergeFlag(0, true);
+    cu->setMergeIndex(0, staticCand);
+    cu->setInterDirSubParts(interDirNeighbours[staticCand], 0, 0, 0);
+    cu->getCUMvField(REF_PIC_LIST_0)->setAllMvField(mvFieldNeighbours[staticCand][0], SIZE_2Nx2N, 0, 0);
+    cu->getCUMvField(REF_PIC_LIST_1)->setAllMvField(mvFieldNeighbours[staticCand][1], SIZE_2Nx2N, 0, 0);
+
+    m_origYuv[0]->copyFromPicYuv(fenc, cuAddr, 0);
+    prepMotionCompensation(cu, cuData, 0);
+    motionCompensation(m_bestPredYuv[0], true, true);
+    encodeResAndCalcRdSkipCU(cu, m_origYuv[0], m_bestPredYuv[0], m_bestRecoYuv[0]);
+    checkDQP(cu);
+
+    cu->copyToPic(0);
+    m_bestRecoYuv[0]->copyToPicYuv(pic->getPicYuvRec(), cuAddr, 0);
+
+    return true;
 }
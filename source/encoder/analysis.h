@@ -43,6 +43,8 @@
 namespace x265 {
 // private namespace
 
+struct AnalysisFrameData;
+
 struct StatisticLog
 {
     uint64_t cntInter[4];
@@ -59,6 +61,16 @@ struct StatisticLog
     uint32_t qTreeIntraCnt[4];
     uint32_t qTreeSkipCnt[4];
 
+    /* depth prediction: CTUs analyzed with it enabled, CTUs whose depth range
+     * was restricted, and the CU evaluations and splits it skipped per depth */
+    uint64_t cntDepthPredCtu;
+    uint64_t cntDepthPredRestricted;
+    uint64_t cntDepthPredSkipCu[4];
+    uint64_t cntDepthPredSkipSplit[4];
+
+    /* static skip: CTUs coded as zero-motion skip without analysis */
+    uint64_t cntStaticSkipCtu;
+
     StatisticLog()
     {
         memset(this, 0, sizeof(StatisticLog));
@@ -99,6 +111,9 @@ public:
 
     bool         m_bEncodeDQP;
 
+    uint32_t     m_predMinDepth;         // predicted CU depth range of the current CTU
+    uint32_t     m_predMaxDepth;
+
     StatisticLog  m_sliceTypeLog[3];
     StatisticLog* m_log;
 
@@ -137,8 +152,12 @@ protected:
     /* Warning: The interface for these functions will undergo significant changes as a major refactor is under progress */
     void compressIntraCU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu);
     void checkIntra(TComDataCU*& outTempCU, PartSize partSize, CU *cu, uint8_t* sharedModes);
-    void compressSharedIntraCTU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu, uint8_t* sharedDepth,
-                                char* sharedPartSizes, uint8_t* sharedModes, uint32_t &zOrder);
+    void compressSharedCTU(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu,
+                           const AnalysisFrameData& shared, uint32_t &zOrder);
+    bool getSharedCTU(TComDataCU* ctu, const AnalysisFrameData& frame, AnalysisFrameData& shared);
+    void checkSharedInter(TComDataCU*& outTempCU, CU* cu, const AnalysisFrameData& shared, uint32_t zOrder);
+    void saveSharedCTU(TComDataCU* ctu, AnalysisFrameData* frame);
+    void seedCTU(TComDataCU* ctu, const AnalysisFrameData& frame);
     void compressInterCU_rd0_4(TComDataCU*& outBestCU, TComDataCU*& outTempCU, TComDataCU* parentCU, uint32_t depth, CU *cu,
                                int bInsidePicture, uint32_t partitionIndex, uint32_t minDepth);
     void compressInterCU_rd5_6(TComDataCU*& outBestCU, TComDataCU*& outTempCU, uint32_t depth, CU *cu,
@@ -158,6 +177,8 @@ protected:
     void deriveTestModeAMP(TComDataCU* bestCU, PartSize parentSize, bool &bTestAMP_Hor, bool &bTestAMP_Ver,
                            bool &bTestMergeAMP_Hor, bool &bTestMergeAMP_Ver);
     void fillOrigYUVBuffer(TComDataCU* outCU, TComYuv* origYuv);
+    void predictDepthRange(TComDataCU* ctu);
+    bool checkStaticSkip(TComDataCU* ctu);
 };
 
 struct ThreadLocalData
@@ -0,0 +1,427 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "frame.h"
+#include "analysisfile.h"
+
+#include "TLibCommon/TComRom.h"
+
+#include <math.h>
+
+using namespace x265;
+
+namespace {
+/* bytes of per-partition data in a frame record */
+inline uint64_t elementSize()
+{
+    return 2 * sizeof(MV) + 2 * sizeof(int8_t) + 8 * sizeof(uint8_t);
+}
+
+/* v * num / den, rounded to nearest */
+inline int scaleComponent(int v, int num, int den)
+{
+    int64_t t = (int64_t)v * num;
+    return (int)(t >= 0 ? (t + den / 2) / den : -((-t + den / 2) / den));
+}
+}
+
+AnalysisFile::AnalysisFile()
+{
+    m_param = NULL;
+    m_numElements = 0;
+    m_recordSize = 0;
+    m_map = NULL;
+    m_mapSize = 0;
+    m_readIndex = NULL;
+    m_readIndexCount = 0;
+    m_bScaled = false;
+    m_srcWidth = m_srcHeight = 0;
+    m_srcLog2CUSize = 0;
+    m_srcWidthInCU = 0;
+    m_srcNumElements = 0;
+    m_srcRecordSize = 0;
+    m_depthOffset = 0;
+    m_file = NULL;
+    m_index = NULL;
+    m_indexSize = m_indexCount = 0;
+    m_writePos = 0;
+    m_bWriteError = false;
+    m_bThreadActive = false;
+    m_bExit = false;
+    m_queueHead = m_queueTail = NULL;
+}
+
+bool AnalysisFile::openWrite(x265_param *param)
+{
+    m_param = param;
+    const char *fileName = param->analysisFileName;
+
+    uint32_t widthInCU = (param->sourceWidth  + g_maxCUSize - 1) >> g_maxLog2CUSize;
+    uint32_t heightInCU = (param->sourceHeight + g_maxCUSize - 1) >> g_maxLog2CUSize;
+    m_numElements = widthInCU * heightInCU * NUM_CU_PARTITIONS;
+    m_recordSize = (sizeof(AnalysisFrameRecord) + m_numElements * elementSize() + 7) & ~(uint64_t)7;
+
+    m_file = fopen(fileName, "wb");
+    if (!m_file)
+    {
+        x265_log(param, X265_LOG_ERROR, "failed to open analysis file %s\n", fileName);
+        return false;
+    }
+    /* the header is completed with the index position when closing */
+    if (!writeHeader(0, 0))
+    {
+        x265_log(param, X265_LOG_ERROR, "failed to write analysis file %s\n", fileName);
+        return false;
+    }
+    m_writePos = sizeof(AnalysisFileHeader);
+
+    m_bThreadActive = start();
+    if (!m_bThreadActive)
+    {
+        x265_log(param, X265_LOG_ERROR, "failed to start the analysis file writer\n");
+        return false;
+    }
+    return true;
+}
+
+bool AnalysisFile::openRead(x265_param *param)
+{
+    m_param = param;
+    const char *fileName = param->analysisFileName;
+
+    uint32_t widthInCU = (param->sourceWidth  + g_maxCUSize - 1) >> g_maxLog2CUSize;
+    uint32_t heightInCU = (param->sourceHeight + g_maxCUSize - 1) >> g_maxLog2CUSize;
+    m_numElements = widthInCU * heightInCU * NUM_CU_PARTITIONS;
+    m_recordSize = (sizeof(AnalysisFrameRecord) + m_numElements * elementSize() + 7) & ~(uint64_t)7;
+
+    m_map = x265_map_file(fileName, &m_mapSize);
+    if (!m_map)
+    {
+        x265_log(param, X265_LOG_ERROR, "failed to open analysis file %s\n", fileName);
+        return false;
+    }
+
+    const AnalysisFileHeader *header = (const AnalysisFileHeader*)m_map;
+    if (m_mapSize < sizeof(AnalysisFileHeader) ||
+        memcmp(header->magic, X265_ANALYSIS_MAGIC, sizeof(header->magic)) ||
+        header->version != X265_ANALYSIS_VERSION ||
+        header->headerSize != sizeof(AnalysisFileHeader) ||
+        header->indexOffset > m_mapSize ||
+        (m_mapSize - header->indexOffset) / sizeof(uint64_t) < header->numEntries)
+    {
+        x265_log(param, X265_LOG_ERROR, "unsupported or damaged analysis file %s\n", fileName);
+        return false;
+    }
+    /* the file may have been written at another resolution or CTU size */
+    m_srcWidth = header->sourceWidth;
+    m_srcHeight = header->sourceHeight;
+    m_srcLog2CUSize = 0;
+    while (m_srcLog2CUSize < 7 && (1u << m_srcLog2CUSize) < header->maxCUSize)
+        m_srcLog2CUSize++;
+    m_srcWidthInCU = (m_srcWidth + header->maxCUSize - 1) >> m_srcLog2CUSize;
+    uint32_t srcHeightInCU = (m_srcHeight + header->maxCUSize - 1) >> m_srcLog2CUSize;
+    m_srcNumElements = m_srcWidthInCU * srcHeightInCU * header->numPartitions;
+    m_srcRecordSize = (sizeof(AnalysisFrameRecord) + m_srcNumElements * elementSize() + 7) & ~(uint64_t)7;
+    if (m_srcWidth <= 0 || m_srcHeight <= 0 || m_srcLog2CUSize < 4 || m_srcLog2CUSize > 6 ||
+        (1u << m_srcLog2CUSize) != header->maxCUSize ||
+        header->numPartitions != 1u << ((m_srcLog2CUSize - 2) * 2) ||
+        header->numCUsInFrame != m_srcWidthInCU * srcHeightInCU || header->recordSize != m_srcRecordSize)
+    {
+        x265_log(param, X265_LOG_ERROR, "unsupported or damaged analysis file %s\n", fileName);
+        return false;
+    }
+
+    m_bScaled = m_srcWidth != param->sourceWidth || m_srcHeight != param->sourceHeight ||
+                header->maxCUSize != param->maxCUSize;
+    if (m_bScaled)
+    {
+        /* a CU of the file covers the area of a CU this many depths deeper
+         * (scaling down) or shallower (scaling up) in this encode */
+        double depthOffset = (double)g_maxLog2CUSize - m_srcLog2CUSize + log((double)m_srcWidth / param->sourceWidth) / log(2.0);
+        m_depthOffset = (int)floor(depthOffset * 256 + 0.5);
+        x265_log(param, X265_LOG_INFO, "analysis: scaling analysis of %dx%d with CTU size %u to %dx%d with CTU size %u, used as search seeds\n",
+                 m_srcWidth, m_srcHeight, header->maxCUSize, param->sourceWidth, param->sourceHeight, param->maxCUSize);
+    }
+
+    m_readIndex = (const uint64_t*)(m_map + header->indexOffset);
+    m_readIndexCount = header->numEntries;
+    return true;
+}
+
+void AnalysisFile::close()
+{
+    if (m_bThreadActive)
+    {
+        m_bExit = true;
+        m_queueEvent.trigger();
+        stop();
+        m_bThreadActive = false;
+    }
+
+    if (m_file)
+    {
+        /* append the index and complete the header */
+        bool bError = m_bWriteError;
+        bError = bError || (m_indexCount &&
+                 fwrite(m_index, sizeof(uint64_t), m_indexCount, m_file) != (size_t)m_indexCount);
+        bError = bError || fseek(m_file, 0, SEEK_SET) || !writeHeader(m_indexCount, m_writePos);
+        if (bError)
+            x265_log(m_param, X265_LOG_ERROR, "failed to write analysis file\n");
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    /* frames queued after the writer exited */
+    while (m_queueHead)
+    {
+        AnalysisFrameData *next = m_queueHead->next;
+        X265_FREE(m_queueHead);
+        m_queueHead = next;
+    }
+    m_queueTail = NULL;
+
+    X265_FREE(m_index);
+    m_index = NULL;
+    x265_unmap_file(m_map, m_mapSize);
+    m_map = NULL;
+    m_readIndex = NULL;
+}
+
+void AnalysisFile::setupFrame(AnalysisFrameData *frame, AnalysisFrameRecord *record, uint32_t n)
+{
+    uint8_t *p = (uint8_t*)(record + 1);
+
+    frame->record = record;
+    frame->mv[0] = (MV*)p;             p += n * sizeof(MV);
+    frame->mv[1] = (MV*)p;             p += n * sizeof(MV);
+    frame->refIdx[0] = (int8_t*)p;     p += n;
+    frame->refIdx[1] = (int8_t*)p;     p += n;
+    frame->depth = p;                  p += n;
+    frame->partSize = p;               p += n;
+    frame->predMode = p;               p += n;
+    frame->lumaIntraDir = p;           p += n;
+    frame->mergeFlag = p;              p += n;
+    frame->interDir = p;               p += n;
+    frame->mvpIdx[0] = p;              p += n;
+    frame->mvpIdx[1] = p;
+    frame->bSeed = false;
+    frame->depthSpread = 0;
+    frame->next = NULL;
+}
+
+AnalysisFrameData* AnalysisFile::allocFrame(int poc, int sliceType)
+{
+    /* the record follows the frame data in the same allocation */
+    size_t frameSize = (sizeof(AnalysisFrameData) + 7) & ~7;
+    uint8_t *buf = X265_MALLOC(uint8_t, frameSize + m_recordSize);
+    if (!buf)
+        return NULL;
+
+    AnalysisFrameData *frame = (AnalysisFrameData*)buf;
+    AnalysisFrameRecord *record = (AnalysisFrameRecord*)(buf + frameSize);
+    setupFrame(frame, record, m_numElements);
+    memset(record, 0, (size_t)m_recordSize);
+    record->poc = poc;
+    record->sliceType = sliceType;
+    return frame;
+}
+
+AnalysisFrameData* AnalysisFile::readFrame(int poc)
+{
+    if (!m_map || poc < 0 || (uint32_t)poc >= m_readIndexCount)
+        return NULL;
+
+    uint64_t offset = m_readIndex[poc];
+    if (!offset || offset + m_srcRecordSize > m_mapSize)
+        return NULL;
+
+    AnalysisFrameRecord *record = (AnalysisFrameRecord*)(m_map + offset);
+    if (record->poc != poc)
+        return NULL;
+
+    if (m_bScaled)
+    {
+        AnalysisFrameData src;
+        setupFrame(&src, record, m_srcNumElements);
+        AnalysisFrameData *frame = allocFrame(poc, record->sliceType);
+        if (frame)
+        {
+            memcpy(frame->record->numRefIdx, record->numRefIdx, sizeof(record->numRefIdx));
+            memcpy(frame->record->refPoc, record->refPoc, sizeof(record->refPoc));
+            scaleFrame(frame, &src);
+        }
+        return frame;
+    }
+
+    AnalysisFrameData *frame = X265_MALLOC(AnalysisFrameData, 1);
+    if (frame)
+        setupFrame(frame, record, m_numElements);
+    return frame;
+}
+
+/* Map the analysis of the file's resolution onto the CTU grid of this
+ * encode: each 4x4 unit takes the decisions of the unit of the file which
+ * covers its scaled center. Depths are converted to the CU size of the same
+ * area, MVs are scaled, and references are kept for inter units only */
+void AnalysisFile::scaleFrame(AnalysisFrameData *dst, const AnalysisFrameData *src)
+{
+    int width = m_param->sourceWidth;
+    int height = m_param->sourceHeight;
+    uint32_t widthInCU = (width + g_maxCUSize - 1) >> g_maxLog2CUSize;
+    uint32_t numCUs = m_numElements / NUM_CU_PARTITIONS;
+    uint32_t srcMask = (1 << m_srcLog2CUSize) - 1;
+    uint32_t srcNumPartitions = 1 << ((m_srcLog2CUSize - 2) * 2);
+
+    dst->bSeed = true;
+    dst->depthSpread = (m_depthOffset & 255) ? 1 : 0;
+
+    uint32_t i = 0;
+    for (uint32_t addr = 0; addr < numCUs; addr++)
+    {
+        int ctuX = (addr % widthInCU) << g_maxLog2CUSize;
+        int ctuY = (addr / widthInCU) << g_maxLog2CUSize;
+        for (uint32_t z = 0; z < NUM_CU_PARTITIONS; z++, i++)
+        {
+            dst->refIdx[0][i] = dst->refIdx[1][i] = -1;
+
+            int x = ctuX + g_zscanToPelX[z] + 2;
+            int y = ctuY + g_zscanToPelY[z] + 2;
+            if (x >= width || y >= height)
+                continue;
+
+            int sx = X265_MIN((int)((int64_t)x * m_srcWidth / width), m_srcWidth - 1);
+            int sy = X265_MIN((int)((int64_t)y * m_srcHeight / height), m_srcHeight - 1);
+
+            /* z-order index of the 4x4 unit within its CTU of the file */
+            uint32_t ux = (sx & srcMask) >> 2, uy = (sy & srcMask) >> 2, srcZ = 0;
+            for (uint32_t b = 0; b < m_srcLog2CUSize - 2; b++)
+                srcZ |= (((ux >> b) & 1) << (2 * b)) | (((uy >> b) & 1) << (2 * b + 1));
+            uint32_t j = ((sy >> m_srcLog2CUSize) * m_srcWidthInCU + (sx >> m_srcLog2CUSize)) * srcNumPartitions + srcZ;
+
+            int depth = (src->depth[j] * 256 + m_depthOffset) >> 8;
+            dst->depth[i] = (uint8_t)X265_MIN(X265_MAX(depth, 0), (int)g_maxCUDepth);
+            dst->predMode[i] = src->predMode[j];
+            dst->partSize[i] = src->partSize[j];
+            dst->lumaIntraDir[i] = src->lumaIntraDir[j];
+            dst->interDir[i] = src->interDir[j];
+
+            if (src->predMode[j] != MODE_INTER)
+                continue;
+            for (int l = 0; l < 2; l++)
+            {
+                if (!(src->interDir[j] & (1 << l)) || src->refIdx[l][j] < 0)
+                    continue;
+                int mvx = scaleComponent(src->mv[l][j].x, width, m_srcWidth);
+                int mvy = scaleComponent(src->mv[l][j].y, height, m_srcHeight);
+                dst->mv[l][i] = MV((int16_t)Clip3(-32768, 32767, mvx), (int16_t)Clip3(-32768, 32767, mvy));
+                dst->refIdx[l][i] = src->refIdx[l][j];
+            }
+        }
+    }
+}
+
+void AnalysisFile::writeFrame(AnalysisFrameData *frame)
+{
+    frame->next = NULL;
+    m_queueLock.acquire();
+    if (m_queueTail)
+        m_queueTail->next = frame;
+    else
+        m_queueHead = frame;
+    m_queueTail = frame;
+    m_queueLock.release();
+    m_queueEvent.trigger();
+}
+
+void AnalysisFile::threadMain()
+{
+    for (;;)
+    {
+        m_queueLock.acquire();
+        AnalysisFrameData *frame = m_queueHead;
+        m_queueHead = m_queueTail = NULL;
+        m_queueLock.release();
+
+        if (!frame)
+        {
+            if (m_bExit)
+                break;
+            m_queueEvent.wait();
+            continue;
+        }
+
+        while (frame)
+        {
+            AnalysisFrameData *next = frame->next;
+            if (!m_bWriteError && !writeRecord(frame))
+            {
+                x265_log(m_param, X265_LOG_ERROR, "failed to write analysis file\n");
+                m_bWriteError = true;
+            }
+            X265_FREE(frame);
+            frame = next;
+        }
+    }
+}
+
+bool AnalysisFile::writeHeader(uint32_t numEntries, uint64_t indexOffset)
+{
+    AnalysisFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, X265_ANALYSIS_MAGIC, sizeof(header.magic));
+    header.version = X265_ANALYSIS_VERSION;
+    header.headerSize = sizeof(AnalysisFileHeader);
+    header.sourceWidth = m_param->sourceWidth;
+    header.sourceHeight = m_param->sourceHeight;
+    header.maxCUSize = m_param->maxCUSize;
+    header.numPartitions = NUM_CU_PARTITIONS;
+    header.numCUsInFrame = m_numElements / NUM_CU_PARTITIONS;
+    header.numEntries = numEntries;
+    header.recordSize = m_recordSize;
+    header.indexOffset = indexOffset;
+    return fwrite(&header, sizeof(header), 1, m_file) == 1;
+}
+
+bool AnalysisFile::writeRecord(AnalysisFrameData *frame)
+{
+    int poc = frame->record->poc;
+    if (poc >= m_indexSize)
+    {
+        int newSize = X265_MAX(poc + 1, m_indexSize * 2 + 256);
+        uint64_t *index = X265_MALLOC(uint64_t, newSize);
+        if (!index)
+            return false;
+        memset(index, 0, newSize * sizeof(uint64_t));
+        if (m_index)
+            memcpy(index, m_index, m_indexSize * sizeof(uint64_t));
+        X265_FREE(m_index);
+        m_index = index;
+        m_indexSize = newSize;
+    }
+    m_index[poc] = m_writePos;
+    m_indexCount = X265_MAX(m_indexCount, poc + 1);
+
+    if (fwrite(frame->record, 1, (size_t)m_recordSize, m_file) != (size_t)m_recordSize)
+        return false;
+    m_writePos += m_recordSize;
+    return true;
+}
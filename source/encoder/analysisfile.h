@@ -0,0 +1,159 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ANALYSISFILE_H
+#define X265_ANALYSISFILE_H
+
+#include "common.h"
+#include "threading.h"
+#include "mv.h"
+
+namespace x265 {
+// private namespace
+
+/* Analysis save/load file layout. The file holds a header, one record per
+ * frame in encode order and finally an index of record offsets in display
+ * order. A record is the frame's POC, slice type and reference lists
+ * followed by the final CU decisions of every 4x4 partition of the frame
+ * (CTUs in raster order, partitions in z-order) as one array per field.
+ * All records of a file have the same size and are 8 byte aligned, they are
+ * written by a background thread while encoding and read through a memory
+ * map. All fields are in host byte order. */
+
+#define X265_ANALYSIS_MAGIC   "x265anls"
+#define X265_ANALYSIS_VERSION 2
+
+struct AnalysisFileHeader
+{
+    char     magic[8];      /* X265_ANALYSIS_MAGIC, not NUL terminated */
+    uint32_t version;       /* X265_ANALYSIS_VERSION */
+    uint32_t headerSize;    /* sizeof(AnalysisFileHeader) */
+    int32_t  sourceWidth;
+    int32_t  sourceHeight;
+    uint32_t maxCUSize;
+    uint32_t numPartitions; /* 4x4 partitions per CTU */
+    uint32_t numCUsInFrame; /* CTUs per frame */
+    uint32_t numEntries;    /* frames covered by the index */
+    uint64_t recordSize;    /* bytes per frame record */
+    uint64_t indexOffset;   /* numEntries uint64_t record offsets, 0 for a frame without a record */
+};
+
+struct AnalysisFrameRecord
+{
+    int32_t  poc;
+    int32_t  sliceType;     /* X265_TYPE_* decided by the lookahead of the writer */
+    int32_t  numRefIdx[2];
+    int32_t  refPoc[2][MAX_NUM_REF]; /* motion is only reused towards the same POC */
+
+    /* followed by, numCUsInFrame * numPartitions entries each:
+     * MV mv[2], int8_t refIdx[2], uint8_t depth, partSize, predMode,
+     * lumaIntraDir, mergeFlag, interDir, mvpIdx[2] (merge index in mvpIdx[0]) */
+};
+
+/* Per-frame view of a record, into the map when loading or into the buffer
+ * the frame's analysis is collected in when saving */
+struct AnalysisFrameData
+{
+    AnalysisFrameRecord* record;
+    MV*                  mv[2];
+    int8_t*              refIdx[2];
+    uint8_t*             depth;
+    uint8_t*             partSize;
+    uint8_t*             predMode;
+    uint8_t*             lumaIntraDir;
+    uint8_t*             mergeFlag;
+    uint8_t*             interDir;
+    uint8_t*             mvpIdx[2];
+
+    /* the analysis was scaled from another resolution, its depths, MVs and
+     * references are only seeds for the analysis of this frame */
+    bool                 bSeed;
+    uint8_t              depthSpread;  /* seed depths may be up to this much above depth[] */
+
+    AnalysisFrameData*   next;  /* write queue */
+};
+
+class AnalysisFile : public Thread
+{
+public:
+
+    AnalysisFile();
+
+    bool openWrite(x265_param *param);
+    bool openRead(x265_param *param);
+    void close();
+
+    /* allocate the save buffer of a frame, released by writeFrame() */
+    AnalysisFrameData* allocFrame(int poc, int sliceType);
+
+    /* queue a completed frame for the writer thread, which takes ownership */
+    void writeFrame(AnalysisFrameData *frame);
+
+    /* returns the analysis of the given frame or NULL if the file has none,
+     * the caller releases it with X265_FREE(). The analysis of a file written
+     * at another resolution is scaled to this one and marked as seed */
+    AnalysisFrameData* readFrame(int poc);
+
+protected:
+
+    x265_param*          m_param;
+    uint32_t             m_numElements;  /* partitions per frame */
+    uint64_t             m_recordSize;
+
+    /* load */
+    const uint8_t*       m_map;
+    size_t               m_mapSize;
+    const uint64_t*      m_readIndex;
+    uint32_t             m_readIndexCount;
+
+    /* geometry of the file, which differs from the encoder's when scaling */
+    bool                 m_bScaled;
+    int                  m_srcWidth;
+    int                  m_srcHeight;
+    uint32_t             m_srcLog2CUSize;
+    uint32_t             m_srcWidthInCU;
+    uint32_t             m_srcNumElements;
+    uint64_t             m_srcRecordSize;
+    int                  m_depthOffset;   /* CU depth difference of equal area in 1/256 */
+
+    /* save */
+    FILE*                m_file;
+    uint64_t*            m_index;
+    int                  m_indexSize;
+    int                  m_indexCount;
+    uint64_t             m_writePos;
+    bool                 m_bWriteError;
+    bool                 m_bThreadActive;
+    volatile bool        m_bExit;
+    Lock                 m_queueLock;
+    Event                m_queueEvent;
+    AnalysisFrameData*   m_queueHead;
+    AnalysisFrameData*   m_queueTail;
+
+    void threadMain();
+    void setupFrame(AnalysisFrameData *frame, AnalysisFrameRecord *record, uint32_t numElements);
+    void scaleFrame(AnalysisFrameData *dst, const AnalysisFrameData *src);
+    bool writeHeader(uint32_t numEntries, uint64_t indexOffset);
+    bool writeRecord(AnalysisFrameData *frame);
+};
+}
+
+#endif // ifndef X265_ANALYSISFILE_H
@@ -35,7 +35,9 @@
 #include "slicetype.h"
 #include "frameencoder.h"
 #include "ratecontrol.h"
+#include "analysisfile.h"
 #include "dpb.h"
+#include "picturecopy.h"
 #include "nal.h"
 
 #include "x265.h"
@@ -50,6 +52,8 @@ static const char *summaryCSVHeader =
     "I count, I ave-QP, I kpbs, I-PSNR Y, I-PSNR U, I-PSNR V, I-SSIM (dB), "
     "P count, P ave-QP, P kpbs, P-PSNR Y, P-PSNR U, P-PSNR V, P-SSIM (dB), "
     "B count, B ave-QP, B kpbs, B-PSNR Y, B-PSNR U, B-PSNR V, B-SSIM (dB), "
+    "Lookahead wait, Ref wait, Row time, Row wall time, Filter time, Entropy time, API wait, "
+    "Pool threads, Pool busy time, Pool idle time, Pool jobs, Pool misses, "
     "Version\n";
 
 using namespace x265;
@@ -64,15 +68,37 @@ Encoder::Encoder()
     m_numChromaWPFrames = 0;
     m_numLumaWPBiFrames = 0;
     m_numChromaWPBiFrames = 0;
+    m_numVbvRestarts = 0;
+    m_vbvRestartCost = 0;
+    m_numRefLagFrames = 0;
+    m_totalRefLagRows = 0;
+    m_totalCompressTime = 0;
+    m_totalLookaheadWaitTime = 0;
+    m_totalRefWaitTime = 0;
+    m_totalRowTime = 0;
+    m_totalRowWallTime = 0;
+    m_totalFilterTime = 0;
+    m_totalEntropyTime = 0;
+    m_totalApiWaitTime = 0;
+    m_workerStartStats = NULL;
     m_lookahead = NULL;
     m_frameEncoder = NULL;
     m_rateControl = NULL;
     m_dpb = NULL;
+    m_pictureCopy = NULL;
+    m_analysisFile = NULL;
     m_exportedPic = NULL;
     m_numDelayedPic = 0;
     m_outputCount = 0;
     m_csvfpt = NULL;
     m_param = NULL;
+    m_effortLevel = 0;
+    m_framesSinceEffortChange = 0;
+    m_speedOutputCount = 0;
+    m_speedCost = 0;
+    m_speedLastOutput = 0;
+    m_speedLastReturn = 0;
+    m_speedIdleTime = 0;
 }
 
 void Encoder::create()
@@ -117,10 +143,37 @@ void Encoder::create()
     for (int i = 0; i < m_param->frameNumThreads; i++)
         m_frameEncoder[i].m_tld = &m_threadLocalData[i];
 
+    /* the pool may already have been busy for other encoders */
+    m_workerStartStats = new WorkerStats[poolThreadCount];
+    for (int i = 0; i < poolThreadCount; i++)
+        m_threadPool->getWorkerStats(i, m_workerStartStats[i]);
+
     m_lookahead = new Lookahead(m_param, m_threadPool, this);
     m_dpb = new DPB(m_param);
+    m_pictureCopy = new PictureCopy(m_threadPool);
+    m_pictureCopy->init(m_param->sourceHeight);
     m_rateControl = new RateControl(m_param);
 
+    if (m_param->analysisFileName)
+    {
+        /* the caller keeps ownership of its string, destroy() frees this copy */
+        m_param->analysisFileName = strdup(m_param->analysisFileName);
+        if (!m_param->analysisFileName)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "unable to allocate the analysis file name\n");
+            m_aborted = true;
+        }
+    }
+
+    if (m_param->analysisMode && m_param->analysisFileName)
+    {
+        m_analysisFile = new AnalysisFile;
+        bool ok = m_param->analysisMode == X265_ANALYSIS_SAVE ?
+                  m_analysisFile->openWrite(m_param) : m_analysisFile->openRead(m_param);
+        if (!ok)
+            m_aborted = true;
+    }
+
     initSPS(&m_sps);
     initPPS(&m_pps);
 
@@ -145,8 +198,14 @@ void Encoder::create()
                     fprintf(m_csvfpt, "Encode Order, Type, POC, QP, Bits, ");
                     if (m_param->rc.rateControlMode == X265_RC_CRF)
                         fprintf(m_csvfpt, "RateFactor, ");
+                    if (m_param->targetFps > 0)
+                        fprintf(m_csvfpt, "Effort, ");
                     fprintf(m_csvfpt, "Y PSNR, U PSNR, V PSNR, YUV PSNR, SSIM, SSIM (dB), "
-                                      "Encoding time, Elapsed time, List 0, List 1\n");
+                                      "Encoding time, Elapsed time, Row wall time, Lookahead wait, Ref wait, "
+                                      "Filter time, Entropy time, API wait, ");
+                    if (m_param->frameNumThreads > 1)
+                        fprintf(m_csvfpt, "Ref Lag Rows, ");
+                    fprintf(m_csvfpt, "List 0, List 1\n");
                 }
                 else
                     fputs(summaryCSVHeader, m_csvfpt);
@@ -182,6 +241,12 @@ void Encoder::destroy()
 
     delete [] m_threadLocalData;
 
+    if (m_analysisFile)
+    {
+        m_analysisFile->close(); // flushes the frames queued for writing
+        delete m_analysisFile;
+    }
+
     if (m_lookahead)
     {
         m_lookahead->destroy();
@@ -189,16 +254,20 @@ void Encoder::destroy()
     }
 
     delete m_dpb;
+    delete m_pictureCopy;
     if (m_rateControl)
     {
         m_rateControl->destroy();
         delete m_rateControl;
     }
+    delete [] m_workerStartStats;
+
     // thread pool release should always happen last
     if (m_threadPool)
         m_threadPool->release();
 
     free(m_param->rc.statFileName); // alloc'd by strdup
+    free((char*)m_param->analysisFileName); // the copy made by create()
     X265_FREE(m_param);
     if (m_csvfpt)
         fclose(m_csvfpt);
@@ -223,8 +292,13 @@ void Encoder::init()
         m_rateControl->initHRD(&m_sps);
     if (!m_rateControl->init(&m_sps))
         m_aborted = true;
-    m_lookahead->init();
+    if (!m_lookahead->init())
+    {
+        x265_log(m_param, X265_LOG_ERROR, "Unable to initialize lookahead, aborting\n");
+        m_aborted = true;
+    }
     m_encodeStartTime = x265_mdate();
+    m_speedLastOutput = m_speedLastReturn = m_encodeStartTime;
 }
 
 void Encoder::updateVbvPlan(RateControl* rc)
@@ -234,7 +308,15 @@ void Encoder::updateVbvPlan(RateControl* rc)
         FrameEncoder *encoder = &m_frameEncoder[i];
         if (encoder->m_rce.isActive && encoder->m_rce.poc != rc->m_curSlice->m_poc)
         {
-            int64_t bits = (int64_t) X265_MAX(encoder->m_rce.frameSizeEstimated, encoder->m_rce.frameSizePlanned);
+            /* in low-latency mode, use the actual size of a frame whose rows
+             * are all coded, else the size predicted by its coded rows, which
+             * unlike frameSizeEstimated is published without a lock */
+            int64_t bits;
+            if (m_param->rc.bLowLatency && encoder->m_inFlightBits)
+                bits = encoder->m_bInFlightCoded ? encoder->m_inFlightBits :
+                       X265_MAX((int64_t)encoder->m_inFlightBits, (int64_t)encoder->m_rce.frameSizePlanned);
+            else
+                bits = (int64_t) X265_MAX(encoder->m_rce.frameSizeEstimated, encoder->m_rce.frameSizePlanned);
             rc->m_bufferFill -= bits;
             rc->m_bufferFill = X265_MAX(rc->m_bufferFill, 0);
             rc->m_bufferFill += encoder->m_rce.bufferRate;
@@ -261,6 +343,9 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
     if (m_aborted)
         return -1;
 
+    if (m_param->targetFps > 0)
+        m_speedIdleTime += x265_mdate() - m_speedLastReturn;
+
     if (m_exportedPic)
     {
         ATOMIC_DEC(&m_exportedPic->m_countRefEncoders);
@@ -302,7 +387,7 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
         /* Copy input picture into a TComPic, send to lookahead */
         pic->m_POC = ++m_pocLast;
         pic->reinit(m_param);
-        pic->getPicYuvOrg()->copyFromPicture(*pic_in, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
+        m_pictureCopy->copy(*pic->getPicYuvOrg(), *pic_in, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
         pic->m_userData = pic_in->userData;
         pic->m_pts = pic_in->pts;
         pic->m_forceqp = pic_in->forceqp;
@@ -328,12 +413,22 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             else
                 m_rateControl->calcAdaptiveQuantFrame(pic);
         }
-        if (pic_in->analysisData.intraData)
+        int sliceType = pic_in->sliceType;
+        if (m_analysisFile && m_param->analysisMode == X265_ANALYSIS_LOAD)
+        {
+            /* reuse the frame types of the encode which saved the analysis,
+             * so the stored motion refers to the same reference frames */
+            X265_FREE(pic->m_analysis);
+            pic->m_analysis = m_analysisFile->readFrame(pic->m_POC);
+            if (pic->m_analysis)
+                sliceType = pic->m_analysis->record->sliceType;
+        }
+        else if (pic_in->analysisData.intraData)
         {
             pic->m_intraData = pic_in->analysisData.intraData;
             pic->m_interData = pic_in->analysisData.interData;
         }
-        m_lookahead->addPicture(pic, pic_in->sliceType);
+        m_lookahead->addPicture(pic, sliceType);
         m_numDelayedPic++;
     }
     else
@@ -346,7 +441,9 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
     // getEncodedPicture() should block until the FrameEncoder has completed
     // encoding the frame.  This is how back-pressure through the API is
     // accomplished when the encoder is full.
+    int64_t waitStartTime = x265_mdate();
     Frame *out = curEncoder->getEncodedPicture(m_nalList);
+    curEncoder->m_apiWaitTime = x265_mdate() - waitStartTime;
 
     if (out)
     {
@@ -383,7 +480,15 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             pic_out->stride[2] = recpic->getCStride() * sizeof(pixel);
         }
 
-        if (m_param->analysisMode)
+        if (m_analysisFile)
+        {
+            if (out->m_analysis && m_param->analysisMode == X265_ANALYSIS_SAVE)
+                m_analysisFile->writeFrame(out->m_analysis);
+            else
+                X265_FREE(out->m_analysis);
+            out->m_analysis = NULL;
+        }
+        else if (m_param->analysisMode && pic_out)
         {
             pic_out->analysisData.interData = out->m_interData;
             pic_out->analysisData.intraData = out->m_intraData;
@@ -416,10 +521,27 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             if (bChroma)
                 m_numChromaWPBiFrames++;
         }
+        m_numVbvRestarts += curEncoder->m_vbvRestarts;
+        m_vbvRestartCost += curEncoder->m_vbvRestartCost;
+        if (!slice->isIntra())
+        {
+            m_numRefLagFrames++;
+            m_totalRefLagRows += curEncoder->m_refLagRows;
+        }
+        m_totalCompressTime += curEncoder->m_elapsedCompressTime;
+        m_totalLookaheadWaitTime += (double)curEncoder->m_lookaheadWaitTime / 1000000;
+        m_totalRefWaitTime += (double)curEncoder->m_refWaitTime / 1000000;
+        m_totalRowTime += curEncoder->m_frameTime;
+        m_totalRowWallTime += (double)curEncoder->m_rowWallTime / 1000000;
+        m_totalFilterTime += (double)curEncoder->m_filterTime / 1000000;
+        m_totalEntropyTime += (double)curEncoder->m_entropyTime / 1000000;
+        m_totalApiWaitTime += (double)curEncoder->m_apiWaitTime / 1000000;
         if (m_aborted)
             return -1;
 
         finishFrameStats(out, curEncoder, curEncoder->m_accessUnitBits);
+        if (m_param->targetFps > 0)
+            updateSpeedControl();
         // Allow this frame to be recycled if no frame encoders are using it for reference
         if (!pic_out)
         {
@@ -436,7 +558,9 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
 
     // pop a single frame from decided list, then provide to frame encoder
     // curEncoder is guaranteed to be idle at this point
+    waitStartTime = x265_mdate();
     Frame* fenc = m_lookahead->getDecidedPicture();
+    int64_t lookaheadWaitTime = x265_mdate() - waitStartTime;
     if (fenc)
     {
         // give this picture a TComPicSym instance before encoding
@@ -468,11 +592,46 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
         else
             fenc->m_dts = fenc->m_reorderedPts;
 
+        // select the analysis effort for this frame
+        curEncoder->m_frameParam = *m_param;
+        curEncoder->m_effortLevel = 0;
+        if (m_param->targetFps > 0)
+        {
+            applyEffort(&curEncoder->m_frameParam, m_effortLevel);
+            curEncoder->m_effortLevel = m_effortLevel;
+        }
+        fenc->m_picSym->m_slice->m_maxNumMergeCand = curEncoder->m_frameParam.maxNumMergeCand;
+
         // determine references, setup RPS, etc
         m_dpb->prepareEncode(fenc);
 
         if (m_param->rc.rateControlMode != X265_RC_CQP)
+        {
+            waitStartTime = x265_mdate();
             m_lookahead->getEstimatedPictureCost(fenc);
+            lookaheadWaitTime += x265_mdate() - waitStartTime;
+        }
+        curEncoder->m_lookaheadWaitTime = lookaheadWaitTime;
+
+        // collect the CU decisions of this frame for the analysis file
+        if (m_analysisFile && m_param->analysisMode == X265_ANALYSIS_SAVE)
+        {
+            X265_FREE(fenc->m_analysis);
+            fenc->m_analysis = m_analysisFile->allocFrame(fenc->m_POC, fenc->m_lowres.sliceType);
+            if (!fenc->m_analysis)
+                x265_log(m_param, X265_LOG_WARNING, "unable to allocate analysis of frame %d, not saved\n", fenc->m_POC);
+            else
+            {
+                Slice* slice = fenc->m_picSym->m_slice;
+                AnalysisFrameRecord* record = fenc->m_analysis->record;
+                for (int l = 0; l < 2; l++)
+                {
+                    record->numRefIdx[l] = slice->m_numRefIdx[l];
+                    for (int ref = 0; ref < slice->m_numRefIdx[l]; ref++)
+                        record->refPoc[l][ref] = slice->m_refPOCList[l][ref];
+                }
+            }
+        }
 
         // Allow FrameEncoder::compressFrame() to start in a worker thread
         curEncoder->startCompressFrame(fenc);
@@ -480,9 +639,90 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
     else if (m_encodedFrameNum)
         m_rateControl->setFinalFrameCount(m_encodedFrameNum);
 
+    if (m_param->targetFps > 0)
+        m_speedLastReturn = x265_mdate();
+
     return ret;
 }
 
+/* Analysis effort levels used by speed control. Each level caps the
+ * configured values, so the controller can only make the encode faster than
+ * the user's settings; level 0 is the configured effort */
+static const struct EffortLevel
+{
+    int rdLevel;
+    int subpelRefine;
+    int searchRange;
+    uint32_t maxNumMergeCand;
+    int bEnableRectInter;
+    int bEnableAMP;
+    int bEnableEarlySkip;
+} s_effortLevels[] =
+{
+    { 6,              X265_MAX_SUBPEL_LEVEL, 32768, 5, 1, 1, 0 },
+    { 4,              3,                     92,    4, 1, 0, 0 },
+    { 3,              2,                     57,    3, 1, 0, 1 },
+    { 3,              2,                     44,    3, 0, 0, 1 },
+    { 2,              1,                     32,    2, 0, 0, 1 },
+    { 2,              1,                     24,    2, 0, 0, 1 },
+};
+
+#define NUM_EFFORT_LEVELS (int)(sizeof(s_effortLevels) / sizeof(s_effortLevels[0]))
+
+void Encoder::applyEffort(x265_param* p, int level) const
+{
+    const EffortLevel& e = s_effortLevels[level];
+
+    p->rdLevel = X265_MIN(p->rdLevel, e.rdLevel);
+    p->subpelRefine = X265_MIN(p->subpelRefine, e.subpelRefine);
+    p->searchRange = X265_MIN(p->searchRange, e.searchRange);
+    p->maxNumMergeCand = X265_MIN(p->maxNumMergeCand, e.maxNumMergeCand);
+    p->bEnableRectInter &= e.bEnableRectInter;
+    p->bEnableAMP &= e.bEnableAMP & p->bEnableRectInter;
+    p->bEnableEarlySkip |= e.bEnableEarlySkip;
+}
+
+/* Called after each frame is output. Estimates the encoder time spent per
+ * frame and moves the effort level towards the configured target speed.  The
+ * time the caller spends outside of encode() (reading or waiting for input)
+ * is excluded, so a live source which delivers frames at the target rate is
+ * not mistaken for a slow encoder */
+void Encoder::updateSpeedControl()
+{
+    int64_t now = x265_mdate();
+    double cost = (double)X265_MAX(now - m_speedLastOutput - m_speedIdleTime, 0) / 1000000;
+    m_speedLastOutput = now;
+    m_speedIdleTime = 0;
+
+    if (++m_speedOutputCount <= m_param->frameNumThreads)
+    {
+        /* the frame encoder pipeline is still filling */
+        m_speedCost = cost;
+        return;
+    }
+    m_speedCost = 0.8 * m_speedCost + 0.2 * cost;
+
+    /* a new effort level takes frameNumThreads frames to be reflected in the
+     * output timings, do not react again before then */
+    if (++m_framesSinceEffortChange <= m_param->frameNumThreads)
+        return;
+
+    double target = 1.0 / m_param->targetFps;
+    int level = m_effortLevel;
+    if (m_speedCost > target * 1.05 && level < NUM_EFFORT_LEVELS - 1)
+        level++;
+    else if (m_speedCost < target * 0.8 && level > 0)
+        level--;
+
+    if (level != m_effortLevel)
+    {
+        x265_log(m_param, X265_LOG_DEBUG, "speed control: %.2f fps, effort level %d -> %d\n",
+                 1.0 / X265_MAX(m_speedCost, 1e-6), m_effortLevel, level);
+        m_effortLevel = level;
+        m_framesSinceEffortChange = 0;
+    }
+}
+
 void EncStats::addPsnr(double psnrY, double psnrU, double psnrV)
 {
     m_psnrSumY += psnrY;
@@ -589,6 +829,45 @@ void Encoder::printSummary()
             (float)100.0 * m_numLumaWPBiFrames / m_analyzeB.m_numPics,
             (float)100.0 * m_numChromaWPBiFrames / m_analyzeB.m_numPics);
     }
+    if (m_param->rc.vbvBufferSize && m_analyzeAll.m_numPics)
+    {
+        uint32_t widthInCU = (m_param->sourceWidth + g_maxCUSize - 1) / g_maxCUSize;
+        uint32_t heightInCU = (m_param->sourceHeight + g_maxCUSize - 1) / g_maxCUSize;
+        uint64_t numCtus = (uint64_t)m_analyzeAll.m_numPics * widthInCU * heightInCU;
+        x265_log(m_param, X265_LOG_INFO, "VBV row restarts: %d, %.2f%% of CTUs re-encoded\n",
+                 m_numVbvRestarts, 100.0 * m_vbvRestartCost / numCtus);
+    }
+    if (m_param->frameNumThreads > 1 && m_numRefLagFrames && m_totalCompressTime > 0)
+    {
+        x265_log(m_param, X265_LOG_INFO, "Frame threads: reference lag %.1f rows, %.1f%% of frame time blocked on references\n",
+                 (double)m_totalRefLagRows / m_numRefLagFrames, 100.0 * m_totalRefWaitTime / m_totalCompressTime);
+    }
+    if (m_analyzeAll.m_numPics)
+    {
+        double scale = 1000.0 / m_analyzeAll.m_numPics;
+        x265_log(m_param, X265_LOG_INFO, "frame ms : lookahead wait %.1f, ref wait %.1f, rows %.1f (wall %.1f), filter %.1f, entropy %.1f, API wait %.1f\n",
+                 m_totalLookaheadWaitTime * scale, m_totalRefWaitTime * scale, m_totalRowTime * scale, m_totalRowWallTime * scale,
+                 m_totalFilterTime * scale, m_totalEntropyTime * scale, m_totalApiWaitTime * scale);
+    }
+    if (m_threadPool)
+    {
+        x265_stats stats;
+        fetchStats(&stats, sizeof(stats));
+        double poolTime = stats.elapsedEncodeTime * stats.poolNumThreads;
+        if (poolTime > 0)
+            x265_log(m_param, X265_LOG_INFO, "thread pool: %u threads, %.1f%% busy, "X265_LL " jobs, "X265_LL " job search misses\n",
+                     stats.poolNumThreads, 100.0 * stats.poolBusyTime / poolTime, stats.poolNumJobs, stats.poolNumMisses);
+        if (poolTime > 0 && m_param->logLevel >= X265_LOG_DEBUG)
+        {
+            for (uint32_t i = 0; i < stats.poolNumThreads; i++)
+            {
+                WorkerStats worker;
+                getWorkerStats(i, worker);
+                x265_log(m_param, X265_LOG_DEBUG, "worker %u: busy %.3lfs, idle %.3lfs, "X265_LL " jobs, "X265_LL " misses\n",
+                         i, (double)worker.busyTime / 1000000, (double)worker.idleTime / 1000000, worker.numJobs, worker.numMisses);
+            }
+        }
+    }
     int pWithB = 0;
     for (int i = 0; i <= m_param->bframes; i++)
         pWithB += m_lookahead->m_histogram[i];
@@ -645,6 +924,14 @@ void Encoder::printSummary()
                     finalLog.cntTotalCu[depth] += enclog.cntTotalCu[depth];
                     finalLog.cntInter[depth] += enclog.cntInter[depth];
                     finalLog.cntSkipCu[depth] += enclog.cntSkipCu[depth];
+                    finalLog.cntDepthPredSkipCu[depth] += enclog.cntDepthPredSkipCu[depth];
+                    finalLog.cntDepthPredSkipSplit[depth] += enclog.cntDepthPredSkipSplit[depth];
+                    if (depth == 0)
+                    {
+                        finalLog.cntDepthPredCtu += enclog.cntDepthPredCtu;
+                        finalLog.cntDepthPredRestricted += enclog.cntDepthPredRestricted;
+                        finalLog.cntStaticSkipCtu += enclog.cntStaticSkipCtu;
+                    }
                 }
             }
 
@@ -754,6 +1041,31 @@ void Encoder::printSummary()
             if (stats[0])
                 x265_log(m_param, X265_LOG_INFO, "%c%-2d:%s\n", slicechars[sliceType], cuSize, stats);
         }
+
+        if (finalLog.cntDepthPredCtu)
+        {
+            /* CTUs with a restricted depth range, then per CU size the number of
+             * unsplit evaluations and of splits skipped by depth prediction */
+            char stats[256] = { 0 };
+            int len = sprintf(stats, " restricted "X265_LL "%%, skipped CU/split",
+                              (finalLog.cntDepthPredRestricted * 100) / finalLog.cntDepthPredCtu);
+            for (uint32_t depth = 0; depth <= g_maxCUDepth; depth++)
+                len += sprintf(stats + len, " %d:"X265_LL "/"X265_LL, g_maxCUSize >> depth,
+                               finalLog.cntDepthPredSkipCu[depth], finalLog.cntDepthPredSkipSplit[depth]);
+            const char slicechars[] = "BPI";
+            x265_log(m_param, X265_LOG_INFO, "%c depth-pred:%s\n", slicechars[sliceType], stats);
+        }
+
+        if (m_param->bEnableStaticSkip && sliceType != I_SLICE)
+        {
+            const char slicechars[] = "BPI";
+            uint32_t widthInCU = (m_param->sourceWidth + g_maxCUSize - 1) / g_maxCUSize;
+            uint32_t heightInCU = (m_param->sourceHeight + g_maxCUSize - 1) / g_maxCUSize;
+            int numPics = sliceType == P_SLICE ? m_analyzeP.m_numPics : m_analyzeB.m_numPics;
+            uint64_t numCtus = (uint64_t)numPics * widthInCU * heightInCU;
+            x265_log(m_param, X265_LOG_INFO, "%c static-skip: "X265_LL " of "X265_LL " CTUs\n",
+                     slicechars[sliceType], finalLog.cntStaticSkipCtu, numCtus);
+        }
     }
 }
 
@@ -787,6 +1099,39 @@ void Encoder::fetchStats(x265_stats *stats, size_t statsSizeBytes)
     /* If new statistics are added to x265_stats, we must check here whether the
      * structure provided by the user is the new structure or an older one (for
      * future safety) */
+    if (statsSizeBytes >= sizeof(x265_stats))
+    {
+        stats->lookaheadWaitTime = m_totalLookaheadWaitTime;
+        stats->refWaitTime = m_totalRefWaitTime;
+        stats->rowEncodeTime = m_totalRowTime;
+        stats->rowEncodeWallTime = m_totalRowWallTime;
+        stats->filterTime = m_totalFilterTime;
+        stats->entropyTime = m_totalEntropyTime;
+        stats->apiWaitTime = m_totalApiWaitTime;
+
+        stats->poolNumThreads = m_threadPool ? m_threadPool->getThreadCount() : 0;
+        stats->poolBusyTime = stats->poolIdleTime = 0;
+        stats->poolNumJobs = stats->poolNumMisses = 0;
+        for (uint32_t i = 0; i < stats->poolNumThreads; i++)
+        {
+            WorkerStats worker;
+            getWorkerStats(i, worker);
+            stats->poolBusyTime += (double)worker.busyTime / 1000000;
+            stats->poolIdleTime += (double)worker.idleTime / 1000000;
+            stats->poolNumJobs += worker.numJobs;
+            stats->poolNumMisses += worker.numMisses;
+        }
+    }
+}
+
+/* activity of a pool worker since the encoder was created */
+void Encoder::getWorkerStats(int id, WorkerStats& stats)
+{
+    m_threadPool->getWorkerStats(id, stats);
+    stats.busyTime -= m_workerStartStats[id].busyTime;
+    stats.idleTime -= m_workerStartStats[id].idleTime;
+    stats.numJobs -= m_workerStartStats[id].numJobs;
+    stats.numMisses -= m_workerStartStats[id].numMisses;
 }
 
 void Encoder::writeLog(int argc, char **argv)
@@ -836,6 +1181,11 @@ void Encoder::writeLog(int argc, char **argv)
         fputs(statsCSVString(m_analyzeI, buffer), m_csvfpt);
         fputs(statsCSVString(m_analyzeP, buffer), m_csvfpt);
         fputs(statsCSVString(m_analyzeB, buffer), m_csvfpt);
+        fprintf(m_csvfpt, "%.3lf, %.3lf, %.3lf, %.3lf, %.3lf, %.3lf, %.3lf,",
+                stats.lookaheadWaitTime, stats.refWaitTime, stats.rowEncodeTime, stats.rowEncodeWallTime,
+                stats.filterTime, stats.entropyTime, stats.apiWaitTime);
+        fprintf(m_csvfpt, " %u, %.3lf, %.3lf, "X265_LL ", "X265_LL ",",
+                stats.poolNumThreads, stats.poolBusyTime, stats.poolIdleTime, stats.poolNumJobs, stats.poolNumMisses);
         fprintf(m_csvfpt, " %s\n", x265_version_str);
     }
 }
@@ -946,6 +1296,8 @@ void Encoder::finishFrameStats(Frame* pic, FrameEncoder *curEncoder, uint64_t bi
         p = sprintf(buf, "POC:%d %c QP %2.2lf(%d) %10d bits", poc, c, pic->m_avgQpAq, slice->m_sliceQp, (int)bits);
         if (m_param->rc.rateControlMode == X265_RC_CRF)
             p += sprintf(buf + p, " RF:%.3lf", pic->m_rateFactor);
+        if (m_param->targetFps > 0)
+            p += sprintf(buf + p, " Effort:%d", curEncoder->m_effortLevel);
         if (m_param->bEnablePsnr)
             p += sprintf(buf + p, " [Y:%6.2lf U:%6.2lf V:%6.2lf]", psnrY, psnrU, psnrV);
         if (m_param->bEnableSsim)
@@ -973,6 +1325,8 @@ void Encoder::finishFrameStats(Frame* pic, FrameEncoder *curEncoder, uint64_t bi
             fprintf(m_csvfpt, "%d, %c-SLICE, %4d, %2.2lf, %10d,", m_outputCount++, c, poc, pic->m_avgQpAq, (int)bits);
             if (m_param->rc.rateControlMode == X265_RC_CRF)
                 fprintf(m_csvfpt, "%.3lf,", pic->m_rateFactor);
+            if (m_param->targetFps > 0)
+                fprintf(m_csvfpt, " %d,", curEncoder->m_effortLevel);
             double psnr = (psnrY * 6 + psnrU + psnrV) / 8;
             if (m_param->bEnablePsnr)
                 fprintf(m_csvfpt, "%.3lf, %.3lf, %.3lf, %.3lf,", psnrY, psnrU, psnrV, psnr);
@@ -983,6 +1337,17 @@ void Encoder::finishFrameStats(Frame* pic, FrameEncoder *curEncoder, uint64_t bi
             else
                 fprintf(m_csvfpt, " -, -,");
             fprintf(m_csvfpt, " %.3lf, %.3lf", curEncoder->m_frameTime, curEncoder->m_elapsedCompressTime);
+            fprintf(m_csvfpt, ", %.3lf, %.3lf, %.3lf, %.3lf, %.3lf, %.3lf",
+                    (double)curEncoder->m_rowWallTime / 1000000, (double)curEncoder->m_lookaheadWaitTime / 1000000,
+                    (double)curEncoder->m_refWaitTime / 1000000, (double)curEncoder->m_filterTime / 1000000,
+                    (double)curEncoder->m_entropyTime / 1000000, (double)curEncoder->m_apiWaitTime / 1000000);
+            if (m_param->frameNumThreads > 1)
+            {
+                if (slice->isIntra())
+                    fprintf(m_csvfpt, ", -");
+                else
+                    fprintf(m_csvfpt, ", %d", curEncoder->m_refLagRows);
+            }
             if (!slice->isIntra())
             {
                 int numLists = slice->isInterP() ? 1 : 2;
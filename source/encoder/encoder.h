@@ -68,8 +68,11 @@ struct EncStats
 class FrameEncoder;
 class DPB;
 class Lookahead;
+class PictureCopy;
 class RateControl;
 class ThreadPool;
+class AnalysisFile;
+struct WorkerStats;
 struct ThreadLocalData;
 
 class Encoder : public x265_encoder
@@ -88,6 +91,8 @@ private:
     ThreadPool*        m_threadPool;
     FrameEncoder*      m_frameEncoder;
     DPB*               m_dpb;
+    PictureCopy*       m_pictureCopy;      // converts the input pictures, see Encoder::encode
+    AnalysisFile*      m_analysisFile;     // param.analysisFileName, when analysis is saved or loaded
 
     Frame*             m_exportedPic;
 
@@ -107,6 +112,34 @@ private:
     int                m_numChromaWPFrames;  // number of P frames with weighted chroma reference
     int                m_numLumaWPBiFrames;  // number of B frames with weighted luma reference
     int                m_numChromaWPBiFrames; // number of B frames with weighted chroma reference
+    int                m_numVbvRestarts;      // number of VBV row restarts
+    int64_t            m_vbvRestartCost;      // number of CTUs discarded by VBV row restarts
+
+    // frame parallelism
+    int                m_numRefLagFrames;     // number of inter frames
+    int64_t            m_totalRefLagRows;     // sum of the reference lag rows of inter frames
+
+    // time spent by the stages of all frames, in seconds. See FrameEncoder
+    double             m_totalCompressTime;   // sum of the elapsed compress times of all frames
+    double             m_totalLookaheadWaitTime;
+    double             m_totalRefWaitTime;
+    double             m_totalRowTime;        // sum of the CTU row encode times
+    double             m_totalRowWallTime;
+    double             m_totalFilterTime;
+    double             m_totalEntropyTime;
+    double             m_totalApiWaitTime;
+
+    // activity of the pool workers when the encoder was created
+    WorkerStats*       m_workerStartStats;
+
+    // speed control (--target-fps)
+    int                m_effortLevel;        // 0 is the configured analysis effort, higher is faster
+    int                m_framesSinceEffortChange;
+    int                m_speedOutputCount;   // frames output since the encoder was opened
+    double             m_speedCost;          // smoothed encoder seconds per output frame
+    int64_t            m_speedLastOutput;    // time of previous frame output
+    int64_t            m_speedLastReturn;    // time encode() last returned to the caller
+    int64_t            m_speedIdleTime;      // time spent outside of encode() since last output
 
 public:
 
@@ -142,6 +175,8 @@ public:
 
     void fetchStats(x265_stats* stats, size_t statsSizeBytes);
 
+    void getWorkerStats(int id, WorkerStats& stats);
+
     void writeLog(int argc, char **argv);
 
     void printSummary();
@@ -162,6 +197,9 @@ protected:
     void initPPS(PPS *pps);
 
     void finishFrameStats(Frame* pic, FrameEncoder *curEncoder, uint64_t bits);
+
+    void updateSpeedControl();
+    void applyEffort(x265_param* p, int level) const;
 };
 }
 
@@ -34,8 +34,6 @@
 #include "nal.h"
 
 namespace x265 {
-void weightAnalyse(Slice& slice, x265_param& param);
-
 FrameEncoder::FrameEncoder()
     : WaveFront(NULL)
     , m_threadActive(true)
@@ -47,9 +45,21 @@ FrameEncoder::FrameEncoder()
     m_totalTime = 0;
     m_bAllRowsStop = false;
     m_vbvResetTriggerRow = -1;
+    m_vbvRestarts = 0;
+    m_vbvRestartCost = 0;
+    m_inFlightBits = 0;
+    m_bInFlightCoded = false;
+    m_lookaheadWaitTime = 0;
+    m_refWaitTime = 0;
+    m_rowWallTime = 0;
+    m_filterTime = 0;
+    m_entropyTime = 0;
+    m_apiWaitTime = 0;
     m_outStreams = NULL;
     m_substreamSizes = NULL;
     m_nr = NULL;
+    m_effortLevel = 0;
+    memset(&m_frameParam, 0, sizeof(m_frameParam));
     memset(&m_frameStats, 0, sizeof(m_frameStats));
     memset(&m_rce, 0, sizeof(RateControlEntry));
 }
@@ -79,6 +89,18 @@ void FrameEncoder::destroy()
     stop();
 }
 
+/* reference pixels needed below the fpel reach of the motion search */
+static const int s_refLagMargin = 1 +            /* diamond search range check lag */
+                                  2 +            /* subpel refine */
+                                  NTAPS_LUMA / 2; /* subpel filter half-length */
+
+/* number of reference rows which must be reconstructed ahead of a CTU row
+ * whose downward motion search reaches lagPixels below it */
+static int refLagRows(int lagPixels)
+{
+    return 1 + ((lagPixels + s_refLagMargin + g_maxCUSize - 1) / g_maxCUSize);
+}
+
 bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
 {
     m_top = top;
@@ -92,11 +114,8 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
     m_rows = new CTURow[m_numRows];
     bool ok = !!m_numRows;
 
-    int range  = m_param->searchRange; /* fpel search */
-        range += 1;                    /* diamond search range check lag */
-        range += 2;                    /* subpel refine */
-        range += NTAPS_LUMA / 2;       /* subpel filter half-length */
-    m_refLagRows = 1 + ((range + g_maxCUSize - 1) / g_maxCUSize);
+    m_refLagRows = refLagRows(m_param->searchRange);
+    m_refLagPixels = m_param->frameNumThreads > 1 ? m_param->searchRange : m_param->sourceHeight;
 
     // NOTE: 2 times of numRows because both Encoder and Filter in same queue
     if (!WaveFront::init(m_numRows * 2))
@@ -173,7 +192,19 @@ void FrameEncoder::compressFrame()
     bool bUseWeightP = slice->m_sliceType == P_SLICE && slice->m_pps->bUseWeightPred;
     bool bUseWeightB = slice->m_sliceType == B_SLICE && slice->m_pps->bUseWeightedBiPred;
     if (bUseWeightP || bUseWeightB)
-        weightAnalyse(*slice, *m_param);
+    {
+        /* use the weights analysed by the lookahead if it anticipated the
+         * nearest reference of each list */
+        int numPredDir = slice->isInterP() ? 1 : 2;
+        bool bAnalysed = m_frame->m_weightState == Frame::WEIGHTS_DONE && m_frame->m_bWeightsValid;
+        for (int l = 0; l < numPredDir && bAnalysed; l++)
+            bAnalysed = m_frame->m_weightRefPoc[l] == slice->m_refPicList[l][0]->getPOC();
+
+        if (bAnalysed)
+            setWeights(*slice, m_frame->m_weights, *m_param);
+        else
+            weightAnalyse(*slice, *m_param);
+    }
     else
         slice->disableWeights();
 
@@ -192,6 +223,8 @@ void FrameEncoder::compressFrame()
 
     /* Get the QP for this frame from rate control. This call may block until
      * frames ahead of it in encode order have called rateControlEnd() */
+    m_inFlightBits = 0;
+    m_bInFlightCoded = false;
     int qp = m_top->m_rateControl->rateControlStart(m_frame, &m_rce, m_top);
     m_rce.newQp = qp;
 
@@ -298,11 +331,25 @@ void FrameEncoder::compressFrame()
         m_nalList.serialize(NAL_UNIT_PREFIX_SEI, m_bs);
     }
 
+    /* When frame parallelism is active, only 'refLagPixels' of reference frames
+     * below each CTU row are guaranteed available for motion reference */
+    m_refLagPixels = m_param->sourceHeight;
+    m_refLagRows = refLagRows(m_param->searchRange);
+    if (m_param->frameNumThreads > 1)
+    {
+        int lag = m_param->bDynamicRefLag && numPredDir ? estimateRefLag(slice) : m_param->searchRange;
+        m_refLagRows = refLagRows(lag);
+
+        /* the motion search may reach as far as the waited for rows allow */
+        m_refLagPixels = X265_MIN((m_refLagRows - 1) * (int)g_maxCUSize - s_refLagMargin, m_param->searchRange);
+    }
+
     // Analyze CTU rows, most of the hard work is done here
     // frame is compressed in a wave-front pattern if WPP is enabled. Loop filter runs as a
     // wave-front behind the CU compression and reconstruction
     compressCTURows();
 
+    int64_t entropyStartTime = x265_mdate();
     if (m_param->rc.bStatWrite)
     {
         int totalI = 0, totalP = 0, totalSkip = 0;
@@ -385,8 +432,12 @@ void FrameEncoder::compressFrame()
         }
     }
     m_accessUnitBits = bytes << 3;
+    m_inFlightBits = (int32_t)m_accessUnitBits;
+    m_bInFlightCoded = true;
 
-    m_elapsedCompressTime = (double)(x265_mdate() - startCompressTime) / 1000000;
+    int64_t endCompressTime = x265_mdate();
+    m_entropyTime = endCompressTime - entropyStartTime;
+    m_elapsedCompressTime = (double)(endCompressTime - startCompressTime) / 1000000;
     /* rateControlEnd may also block for earlier frames to call rateControlUpdateStats */
     if (m_top->m_rateControl->rateControlEnd(m_frame, m_accessUnitBits, &m_rce, &m_frameStats) < 0)
         m_top->m_aborted = true;
@@ -473,6 +524,69 @@ void FrameEncoder::encodeSlice()
         m_entropyCoder.finishSlice();
 }
 
+/* The lookahead measured the motion of the frame against references at up to
+ * bframes + 1 frames distance, in quarter pels of the half resolution frame
+ * (two units per full resolution pixel). The vertical motion per frame of
+ * distance of the nearest measured reference of each direction is scaled to
+ * the distance of every reference of the slice, plus a margin for the motion
+ * detail lost at the lower resolution. A few lowres CUs with outlying motion
+ * vectors are ignored, their motion search is clamped to the lag like every
+ * other. When the lookahead has not measured the frame, or its vertical
+ * motion is too large, the full search range is returned */
+int FrameEncoder::estimateRefLag(Slice* slice)
+{
+    Lowres& lowres = m_frame->m_lowres;
+    int cuCount = ((lowres.width + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS) *
+                  ((lowres.lines + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS);
+    const int maxBin = 127;
+
+    /* mvY[list] / dist[list] is the vertical motion per frame */
+    int mvY[2] = { 0, 0 };
+    int dist[2] = { 0, 0 };
+    for (int list = 0; list < 2; list++)
+    {
+        for (int i = 0; i < lowres.bframes + 1 && !dist[list]; i++)
+        {
+            const MV* mvs = lowres.lowresMvs[list][i];
+            if (mvs[0].x == 0x7FFF)
+                continue;
+            dist[list] = i + 1;
+
+            int histogram[maxBin + 1];
+            memset(histogram, 0, sizeof(histogram));
+            for (int cu = 0; cu < cuCount; cu++)
+                histogram[X265_MIN(abs(mvs[cu].y), maxBin)]++;
+
+            int outliers = cuCount >> 6;
+            int bin = maxBin;
+            while (bin > 0 && outliers >= histogram[bin])
+                outliers -= histogram[bin--];
+            if (bin == maxBin)
+                return m_param->searchRange;
+            mvY[list] = bin;
+        }
+    }
+
+    if (!dist[0] && !dist[1])
+        return m_param->searchRange;
+
+    int lag = 0;
+    for (int l = 0; l < (slice->isInterB() ? 2 : 1); l++)
+    {
+        for (int ref = 0; ref < slice->m_numRefIdx[l]; ref++)
+        {
+            int refDist = abs(slice->m_poc - slice->m_refPOCList[l][ref]);
+            int list = slice->m_refPOCList[l][ref] < slice->m_poc ? 0 : 1;
+            if (!dist[list])
+                list = !list;
+            int reach = (mvY[list] * refDist + 2 * dist[list] - 1) / (2 * dist[list]);
+            lag = X265_MAX(lag, reach);
+        }
+    }
+
+    return X265_MIN(lag + 2 * X265_LOWRES_CU_SIZE, m_param->searchRange);
+}
+
 void FrameEncoder::compressCTURows()
 {
     PPAScopeEvent(FrameEncoder_compressRows);
@@ -480,6 +594,11 @@ void FrameEncoder::compressCTURows()
 
     m_bAllRowsStop = false;
     m_vbvResetTriggerRow = -1;
+    m_vbvRestarts = 0;
+    m_vbvRestartCost = 0;
+    m_refWaitTime = 0;
+    m_filterTime = 0;
+    int64_t startTime = x265_mdate();
 
     m_SSDY = m_SSDU = m_SSDV = 0;
     m_ssim = 0;
@@ -506,8 +625,13 @@ void FrameEncoder::compressCTURows()
                     Frame *refpic = slice->m_refPicList[l][ref];
 
                     int reconRowCount = refpic->m_reconRowCount.get();
-                    while ((reconRowCount != m_numRows) && (reconRowCount < row + m_refLagRows))
-                        reconRowCount = refpic->m_reconRowCount.waitForChange(reconRowCount);
+                    if ((reconRowCount != m_numRows) && (reconRowCount < row + m_refLagRows))
+                    {
+                        int64_t waitStart = x265_mdate();
+                        while ((reconRowCount != m_numRows) && (reconRowCount < row + m_refLagRows))
+                            reconRowCount = refpic->m_reconRowCount.waitForChange(reconRowCount);
+                        m_refWaitTime += x265_mdate() - waitStart;
+                    }
 
                     if ((bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted)
                         m_mref[l][ref].applyWeight(row + m_refLagRows, m_numRows);
@@ -541,8 +665,13 @@ void FrameEncoder::compressCTURows()
                         Frame *refpic = slice->m_refPicList[list][ref];
 
                         int reconRowCount = refpic->m_reconRowCount.get();
-                        while ((reconRowCount != m_numRows) && (reconRowCount < i + m_refLagRows))
-                            reconRowCount = refpic->m_reconRowCount.waitForChange(reconRowCount);
+                        if ((reconRowCount != m_numRows) && (reconRowCount < i + m_refLagRows))
+                        {
+                            int64_t waitStart = x265_mdate();
+                            while ((reconRowCount != m_numRows) && (reconRowCount < i + m_refLagRows))
+                                reconRowCount = refpic->m_reconRowCount.waitForChange(reconRowCount);
+                            m_refWaitTime += x265_mdate() - waitStart;
+                        }
 
                         if ((bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted)
                             m_mref[list][ref].applyWeight(i + m_refLagRows, m_numRows);
@@ -557,6 +686,7 @@ void FrameEncoder::compressCTURows()
                 processRow((i - m_filterRowDelay) * 2 + 1, -1);
         }
     }
+    m_rowWallTime = x265_mdate() - startTime;
     m_frameTime = (double)m_totalTime / 1000000;
     m_totalTime = 0;
 }
@@ -572,7 +702,10 @@ void FrameEncoder::processRow(int row, int threadId)
         processRowEncoder(realRow, tld);
     else
     {
+        /* filter rows run one at a time, each enqueues the next */
+        int64_t startTime = x265_mdate();
         processRowFilter(realRow);
+        m_filterTime += x265_mdate() - startTime;
 
         // NOTE: Active next row
         if (realRow != m_numRows - 1)
@@ -620,6 +753,12 @@ void FrameEncoder::processRowEncoder(int row, ThreadLocalData& tld)
     tld.analysis.m_log = &tld.analysis.m_sliceTypeLog[m_frame->m_picSym->m_slice->m_sliceType];
     tld.analysis.m_rdEntropyCoders = curRow.rdEntropyCoders;
     tld.analysis.setQP(slice, slice->m_sliceQp);
+    tld.analysis.m_refLagPixels = m_refLagPixels;
+    if (m_param->targetFps > 0)
+    {
+        /* analyze with the effort selected by speed control for this frame */
+        tld.analysis.setEffort(&m_frameParam);
+    }
 
     int64_t startTime = x265_mdate();
     assert(m_frame->getPicSym()->getFrameWidthInCU() == m_numCols);
@@ -723,16 +862,29 @@ void FrameEncoder::processRowEncoder(int row, ThreadLocalData& tld)
             if (row == col && row)
             {
                 x265_emms();
+
+                /* a restart discards the CTUs coded so far in this row and the rows below it */
+                uint32_t restartCost = 0;
+                for (int r = row; r < m_numRows; r++)
+                    restartCost += m_rows[r].completed;
+
                 double qpBase = cu->m_baseQp;
-                int reEncode = m_top->m_rateControl->rowDiagonalVbvRateControl(m_frame, row, &m_rce, qpBase);
+                int reEncode = m_top->m_rateControl->rowDiagonalVbvRateControl(m_frame, row, &m_rce, qpBase, restartCost);
                 qpBase = Clip3((double)QP_MIN, (double)QP_MAX_MAX, qpBase);
                 m_frame->m_rowDiagQp[row] = qpBase;
                 m_frame->m_rowDiagQScale[row] =  x265_qp2qScale(qpBase);
 
+                /* publish the size prediction of this frame to the frames
+                 * which start their rate control while it is in flight */
+                if (m_param->rc.bLowLatency)
+                    m_inFlightBits = (int32_t)m_rce.frameSizeEstimated;
+
                 if (reEncode < 0)
                 {
-                    x265_log(m_param, X265_LOG_DEBUG, "POC %d row %d - encode restart required for VBV, to %.2f from %.2f\n",
-                             m_frame->getPOC(), row, qpBase, cu->m_baseQp);
+                    x265_log(m_param, X265_LOG_DEBUG, "POC %d row %d - encode restart required for VBV, to %.2f from %.2f, discarding %d CTUs\n",
+                             m_frame->getPOC(), row, qpBase, cu->m_baseQp, restartCost);
+                    ATOMIC_INC(&m_vbvRestarts);
+                    ATOMIC_ADD(&m_vbvRestartCost, (int32_t)restartCost);
 
                     // prevent the WaveFront::findJob() method from providing new jobs
                     m_vbvResetTriggerRow = row;
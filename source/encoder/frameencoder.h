@@ -112,7 +112,8 @@ public:
 
     int                      m_numRows;
     uint32_t                 m_numCols;
-    int                      m_refLagRows;
+    int                      m_refLagRows;          // reference rows which must be reconstructed ahead of each row
+    int                      m_refLagPixels;        // reach of the downward motion search of the current frame
     CTURow*                  m_rows;
     RateControlEntry         m_rce;
     SEIDecodedPictureHash    m_seiReconPictureDigest;
@@ -127,13 +128,27 @@ public:
     uint32_t                 m_checksum[3];
     double                   m_elapsedCompressTime; // elapsed time spent in worker threads
     double                   m_frameTime;           // wall time from frame start to finish
+
+    /* time spent by the stages of the current frame, in microseconds */
+    int64_t                  m_lookaheadWaitTime;   // API thread blocked on the slice decision of the frame
+    int64_t                  m_refWaitTime;         // time compressCTURows() was blocked on reference rows
+    int64_t                  m_rowWallTime;         // wall time of compressCTURows()
+    int64_t                  m_filterTime;          // time spent in loop filter rows
+    int64_t                  m_entropyTime;         // slice entropy coding and NAL serialization
+    int64_t                  m_apiWaitTime;         // API thread blocked in getEncodedPicture() for the frame
     FrameStats               m_frameStats;          // stats of current frame for multipass encodes
     volatile bool            m_bAllRowsStop;
     volatile int             m_vbvResetTriggerRow;
+    volatile int32_t         m_vbvRestarts;         // VBV row restarts of the current frame
+    volatile int32_t         m_vbvRestartCost;      // CTUs discarded by the VBV row restarts of the current frame
+    volatile int32_t         m_inFlightBits;        // --rc-low-latency: predicted size of the frame being encoded, 0 until known
+    volatile bool            m_bInFlightCoded;      // m_inFlightBits is the actual size of the frame
     uint64_t                 m_accessUnitBits;
 
     Encoder*                 m_top;
     x265_param*              m_param;
+    x265_param               m_frameParam;          // copy of m_param with the speed control effort of this frame applied
+    int                      m_effortLevel;         // speed control effort level of this frame
     Frame*                   m_frame;
 
     MotionReference          m_mref[2][MAX_NUM_REF + 1];
@@ -160,6 +175,10 @@ protected:
     /* called by compressFrame to perform wave-front compression analysis */
     void compressCTURows();
 
+    /* called by compressFrame to estimate the reach of the motion of the
+     * frame from the lookahead motion vectors (--dynamic-ref-lag) */
+    int estimateRefLag(Slice* slice);
+
     /* called by compressFrame to generate final per-row bitstreams */
     void encodeSlice();
 
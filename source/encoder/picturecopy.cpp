@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "threading.h"
+#include "TLibCommon/TComPicYuv.h"
+#include "picturecopy.h"
+
+using namespace x265;
+
+/* rows per band, a multiple of the chroma subsampling. Pictures of fewer
+ * bands are copied by the calling thread alone */
+static const int s_bandRows = 64;
+static const int s_minParallelBands = 4;
+
+PictureCopy::PictureCopy(ThreadPool *p)
+    : WaveFront(p)
+{
+    m_numBands = 0;
+    m_bandsCompleted = 0;
+    m_dst = NULL;
+    m_pic = NULL;
+    m_padx = m_pady = 0;
+}
+
+void PictureCopy::init(int sourceHeight)
+{
+    m_numBands = (sourceHeight + s_bandRows - 1) / s_bandRows;
+
+    if (m_numBands < s_minParallelBands || !WaveFront::init(m_numBands))
+        m_pool = NULL;
+    else
+        WaveFront::enableAllRows();
+}
+
+void PictureCopy::copy(TComPicYuv& dst, const x265_picture& pic, int padx, int pady)
+{
+    if (!m_pool)
+    {
+        dst.copyFromPicture(pic, padx, pady);
+        return;
+    }
+
+    m_dst = &dst;
+    m_pic = &pic;
+    m_padx = padx;
+    m_pady = pady;
+    m_bandsCompleted = 0;
+
+    WaveFront::enqueue();
+
+    // the bands have no dependencies on each other
+    for (int band = 0; band < m_numBands; band++)
+        enqueueRow(band);
+    for (int i = 1; i < s_minParallelBands; i++)
+        m_pool->pokeIdleThread();
+
+    while (m_bandsCompleted < m_numBands)
+        WaveFront::findJob(-1);
+
+    WaveFront::dequeue();
+
+    dst.extendPictureBottom(padx, pady);
+}
+
+void PictureCopy::processRow(int band, int /*threadId*/)
+{
+    /* the bands cover the padded height of the frame, the input picture may
+     * have fewer rows */
+    int height = m_dst->getHeight() - m_pady;
+    int row = band * s_bandRows;
+
+    if (row < height)
+        m_dst->copyPictureRows(*m_pic, m_padx, m_pady, row, X265_MIN(s_bandRows, height - row));
+
+    x265_emms();
+    ATOMIC_INC(&m_bandsCompleted);
+}
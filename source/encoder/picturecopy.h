@@ -0,0 +1,58 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_PICTURECOPY_H
+#define X265_PICTURECOPY_H
+
+#include "common.h"
+#include "wavefront.h"
+
+namespace x265 {
+// private namespace
+
+class TComPicYuv;
+
+/* PictureCopy copies the input pictures into the source buffers of the
+ * frames, ie: TComPicYuv::copyFromPicture(). Large pictures are converted in
+ * bands of rows which are split between the workers of the pool and the
+ * calling thread, the bottom of the picture is extended once all bands are
+ * complete */
+class PictureCopy : public WaveFront
+{
+public:
+
+    PictureCopy(ThreadPool *p);
+    void init(int sourceHeight);
+
+    int                    m_numBands;
+    volatile int           m_bandsCompleted;
+
+    TComPicYuv            *m_dst;
+    const x265_picture    *m_pic;
+    int                    m_padx;
+    int                    m_pady;
+
+    void     copy(TComPicYuv& dst, const x265_picture& pic, int padx, int pady);
+    void     processRow(int row, int threadId);
+};
+}
+
+#endif // ifndef X265_PICTURECOPY_H
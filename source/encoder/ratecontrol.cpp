@@ -31,6 +31,7 @@
 #include "slicetype.h"
 #include "ratecontrol.h"
 #include "sei.h"
+#include "statsfile.h"
 
 #define BR_SHIFT  6
 #define CPB_SHIFT 4
@@ -142,6 +143,21 @@ inline void copyRceData(RateControlEntry* rce, RateControlEntry* rce2Pass)
     rce->sliceType = rce2Pass->sliceType;
 }
 
+/* set slice type and reference status from a 1st pass frame type character */
+inline bool setFrameType(RateControlEntry* rce, char picType)
+{
+    rce->keptAsRef = picType != 'b' && picType != 'p';
+    if (picType == 'I' || picType == 'i')
+        rce->sliceType = I_SLICE;
+    else if (picType == 'P' || picType == 'p')
+        rce->sliceType = P_SLICE;
+    else if (picType == 'B' || picType == 'b')
+        rce->sliceType = B_SLICE;
+    else
+        return false;
+    return true;
+}
+
 }  // end anonymous namespace
 /* Compute variance to derive AC energy of each block */
 static inline uint32_t acEnergyVar(Frame *pic, uint64_t sum_ssd, int shift, int i)
@@ -320,6 +336,7 @@ RateControl::RateControl(x265_param *p)
     m_bTerminated = false;
     m_finalFrameCount = 0;
     m_numEntries = 0;
+    m_segmentStart = m_segmentEnd = 0;
     if (m_param->rc.rateControlMode == X265_RC_CRF)
     {
         m_param->rc.qp = (int)m_param->rc.rfConstant;
@@ -355,6 +372,11 @@ RateControl::RateControl(x265_param *p)
     m_statFileOut = NULL;
     m_cutreeStatFileOut = m_cutreeStatFileIn = NULL;
     m_rce2Pass = NULL;
+    m_statsMap = NULL;
+    m_statsMapSize = 0;
+    m_statsWritePos = 0;
+    m_statsIndex = NULL;
+    m_statsIndexSize = m_statsIndexCount = 0;
 
     // vbv initialization
     m_param->rc.vbvBufferSize = Clip3(0, 2000000, m_param->rc.vbvBufferSize);
@@ -434,6 +456,7 @@ RateControl::RateControl(x265_param *p)
 
     for (int i = 0; i < 2; i++)
         m_cuTreeStats.qpBuffer[i] = NULL;
+    m_cuTreeStats.writeBuffer = NULL;
 }
 
 bool RateControl::init(const SPS *sps)
@@ -502,23 +525,67 @@ bool RateControl::init(const SPS *sps)
         {
             m_expectedBitsSum = 0;
             char *p, *statsIn, *statsBuf;
-            /* read 1st pass stats */
-            statsIn = statsBuf = x265_slurp_file(fileName);
-            if (!statsBuf)
-                return false;
-            if (m_param->rc.cuTree)
+            const StatsFileHeader *binHeader = NULL;
+            /* binary stats are memory mapped, text stats are read in full */
+            bool bBinary = false;
+            FILE *fh = fopen(fileName, "rb");
+            if (fh)
             {
-                char *tmpFile = strcatFilename(fileName, ".cutree");
-                if (!tmpFile)
+                char magic[sizeof(binHeader->magic)];
+                bBinary = fread(magic, 1, sizeof(magic), fh) == sizeof(magic) && !memcmp(magic, X265_STATS_MAGIC, sizeof(magic));
+                fclose(fh);
+            }
+            if (bBinary)
+            {
+                m_statsMap = x265_map_file(fileName, &m_statsMapSize);
+                if (!m_statsMap)
                     return false;
-                m_cutreeStatFileIn = fopen(tmpFile, "rb");
-                X265_FREE(tmpFile);
-                if (!m_cutreeStatFileIn)
+                binHeader = (const StatsFileHeader*)m_statsMap;
+                if (m_statsMapSize < sizeof(StatsFileHeader) ||
+                    binHeader->version != X265_STATS_VERSION ||
+                    binHeader->headerSize != sizeof(StatsFileHeader) ||
+                    binHeader->recordSize != sizeof(StatsFileRecord) ||
+                    binHeader->optionsOffset >= m_statsMapSize ||
+                    binHeader->indexOffset > m_statsMapSize ||
+                    (m_statsMapSize - binHeader->indexOffset) / sizeof(uint64_t) < binHeader->numEntries ||
+                    !memchr(m_statsMap + binHeader->optionsOffset, 0, (size_t)(m_statsMapSize - binHeader->optionsOffset)))
                 {
-                    x265_log(m_param, X265_LOG_ERROR, "can't open stats file %s\n", tmpFile);
+                    x265_log(m_param, X265_LOG_ERROR, "unsupported or damaged binary stats file %s\n", fileName);
                     return false;
                 }
+                if (m_param->rc.cuTree && binHeader->numCuTree != (uint32_t)m_ncu)
+                {
+                    x265_log(m_param, X265_LOG_ERROR, "binary stats file has no CU-tree stats for this frame size\n");
+                    return false;
+                }
+                /* present the options like the header line of text stats */
+                const char *opts = (const char*)m_statsMap + binHeader->optionsOffset;
+                statsBuf = X265_MALLOC(char, strlen(opts) + 11);
+                if (!statsBuf)
+                    return false;
+                sprintf(statsBuf, "#options: %s", opts);
             }
+            else
+            {
+                /* read 1st pass stats */
+                statsBuf = x265_slurp_file(fileName);
+                if (!statsBuf)
+                    return false;
+                if (m_param->rc.cuTree)
+                {
+                    char *tmpFile = strcatFilename(fileName, ".cutree");
+                    if (!tmpFile)
+                        return false;
+                    m_cutreeStatFileIn = fopen(tmpFile, "rb");
+                    X265_FREE(tmpFile);
+                    if (!m_cutreeStatFileIn)
+                    {
+                        x265_log(m_param, X265_LOG_ERROR, "can't open stats file %s\n", tmpFile);
+                        return false;
+                    }
+                }
+            }
+            statsIn = statsBuf;
 
             /* check whether 1st pass options were compatible with current options */
             if (strncmp(statsBuf, "#options:", 9))
@@ -532,13 +599,16 @@ bool RateControl::init(const SPS *sps)
                 bool bErr = false;
                 char *opts = statsBuf;
                 statsIn = strchr(statsBuf, '\n');
-                if (!statsIn)
+                if (!statsIn && !bBinary)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "Malformed stats file\n");
                     return false;
                 }
-                *statsIn = '\0';
-                statsIn++;
+                if (statsIn)
+                {
+                    *statsIn = '\0';
+                    statsIn++;
+                }
                 if (sscanf(opts, "#options: %dx%d", &i, &j) != 2)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "Resolution specified in stats file not valid\n");
@@ -577,10 +647,23 @@ bool RateControl::init(const SPS *sps)
                     m_param->lookaheadDepth = i;
             }
             /* find number of pics */
-            p = statsIn;
             int numEntries;
-            for (numEntries = -1; p; numEntries++)
-                p = strchr(p + 1, ';');
+            if (bBinary)
+            {
+                if (binHeader->firstFrame)
+                {
+                    x265_log(m_param, X265_LOG_ERROR, "stats file begins at frame %d, merge the stats of all segments first\n",
+                             binHeader->firstFrame);
+                    return false;
+                }
+                numEntries = (int)binHeader->numEntries;
+            }
+            else
+            {
+                p = statsIn;
+                for (numEntries = -1; p; numEntries++)
+                    p = strchr(p + 1, ';');
+            }
             if (!numEntries)
             {
                 x265_log(m_param, X265_LOG_ERROR, "empty stats file\n");
@@ -588,17 +671,27 @@ bool RateControl::init(const SPS *sps)
             }
             m_numEntries = numEntries;
 
-            if (m_param->totalFrames < m_numEntries && m_param->totalFrames > 0)
+            /* a segment of a title encodes a frame range of the title-wide stats */
+            m_segmentStart = m_param->rc.segmentStart;
+            if (m_segmentStart >= m_numEntries)
+            {
+                x265_log(m_param, X265_LOG_ERROR, "segment start %d is beyond the %d frames of the 1st pass\n",
+                         m_segmentStart, m_numEntries);
+                return false;
+            }
+            int availFrames = m_numEntries - m_segmentStart;
+            if (m_param->totalFrames < availFrames && m_param->totalFrames > 0 && !m_segmentStart)
             {
                 x265_log(m_param, X265_LOG_WARNING, "2nd pass has fewer frames than 1st pass (%d vs %d)\n",
                          m_param->totalFrames, m_numEntries);
             }
-            if (m_param->totalFrames > m_numEntries)
+            if (m_param->totalFrames > availFrames)
             {
                 x265_log(m_param, X265_LOG_ERROR, "2nd pass has more frames than 1st pass (%d vs %d)\n",
-                         m_param->totalFrames, m_numEntries);
+                         m_param->totalFrames, availFrames);
                 return false;
             }
+            m_segmentEnd = m_param->totalFrames > 0 ? m_segmentStart + m_param->totalFrames : m_numEntries;
 
             m_rce2Pass = X265_MALLOC(RateControlEntry, m_numEntries);
             if (!m_rce2Pass)
@@ -618,7 +711,28 @@ bool RateControl::init(const SPS *sps)
             /* read stats */
             p = statsIn;
             double totalQpAq = 0;
-            for (int i = 0; i < m_numEntries; i++)
+            for (int i = 0; i < m_numEntries && bBinary; i++)
+            {
+                /* frames without a record remain skipped p frames */
+                const StatsFileRecord *rec = statsRecord(i);
+                if (!rec)
+                    continue;
+                RateControlEntry *rce = &m_rce2Pass[i];
+                if (!setFrameType(rce, rec->type))
+                {
+                    x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at frame %d\n", i);
+                    return false;
+                }
+                rce->coeffBits = rec->coeffBits;
+                rce->mvBits = rec->mvBits;
+                rce->miscBits = rec->miscBits;
+                rce->iCuCount = rec->iCuCount;
+                rce->pCuCount = rec->pCuCount;
+                rce->skipCuCount = rec->skipCuCount;
+                rce->qScale = x265_qp2qScale(rec->qpRc);
+                totalQpAq += rec->qpAq;
+            }
+            for (int i = 0; i < m_numEntries && !bBinary; i++)
             {
                 RateControlEntry *rce;
                 int frameNumber;
@@ -640,16 +754,7 @@ bool RateControl::init(const SPS *sps)
                        &picType, &qpRc, &qpAq, &rce->coeffBits,
                        &rce->mvBits, &rce->miscBits, &rce->iCuCount, &rce->pCuCount,
                        &rce->skipCuCount);
-                rce->keptAsRef = true;
-                if (picType == 'b' || picType == 'p')
-                    rce->keptAsRef = false;
-                if (picType == 'I' || picType == 'i')
-                    rce->sliceType = I_SLICE;
-                else if (picType == 'P' || picType == 'p')
-                    rce->sliceType = P_SLICE;
-                else if (picType == 'B' || picType == 'b')
-                    rce->sliceType = B_SLICE;
-                else
+                if (!setFrameType(rce, picType))
                     e = -1;
                 if (e < 10)
                 {
@@ -662,6 +767,22 @@ bool RateControl::init(const SPS *sps)
             }
             X265_FREE(statsBuf);
 
+            /* skip the CU-tree records of the frames preceding this segment;
+             * one record was written for each referenced frame */
+            if (m_cutreeStatFileIn && m_segmentStart)
+            {
+                long recordSize = (long)(1 + m_ncu * sizeof(uint16_t));
+                for (int i = 0; i < m_segmentStart; i++)
+                {
+                    if (m_rce2Pass[i].keptAsRef && fseek(m_cutreeStatFileIn, recordSize, SEEK_CUR))
+                    {
+                        x265_log(m_param, X265_LOG_ERROR, "Incomplete CU-tree stats file.\n");
+                        return false;
+                    }
+                }
+            }
+
+            /* the bit allocation is always planned over the whole title */
             if (m_param->rc.rateControlMode == X265_RC_ABR)
             {
                 if (!initPass2())
@@ -685,10 +806,32 @@ bool RateControl::init(const SPS *sps)
                 return false;
             }
             p = x265_param2string(m_param);
-            if (p)
+            if (m_param->rc.bBinaryStats)
+            {
+                /* the header is rewritten with the index once the encode completes */
+                if (!p || !writeStatsHeader(0, 0))
+                {
+                    X265_FREE(p);
+                    x265_log(m_param, X265_LOG_ERROR, "can't write stats file header\n");
+                    return false;
+                }
+                static const char pad[8] = { 0 };
+                size_t optsSize = strlen(p) + 1;
+                size_t padSize = (8 - optsSize % 8) % 8;
+                if (fwrite(p, 1, optsSize, m_statFileOut) != optsSize || fwrite(pad, 1, padSize, m_statFileOut) != padSize)
+                {
+                    X265_FREE(p);
+                    x265_log(m_param, X265_LOG_ERROR, "can't write stats file header\n");
+                    return false;
+                }
+                m_statsWritePos = sizeof(StatsFileHeader) + optsSize + padSize;
+            }
+            else if (p)
                 fprintf(m_statFileOut, "#options: %s\n", p);
             X265_FREE(p);
-            if (m_param->rc.cuTree && !m_param->rc.bStatRead)
+            /* a pass reading text stats leaves their .cutree file in place,
+             * one reading binary stats must write it for the next pass */
+            if (m_param->rc.cuTree && !m_param->rc.bBinaryStats && (!m_param->rc.bStatRead || m_statsMap))
             {
                 statFileTmpname = strcatFilename(fileName, ".cutree.temp");
                 if (!statFileTmpname)
@@ -708,6 +851,9 @@ bool RateControl::init(const SPS *sps)
             if (m_param->bBPyramid && m_param->rc.bStatRead)
                 m_cuTreeStats.qpBuffer[1] = X265_MALLOC(uint16_t, m_ncu * sizeof(uint16_t));
             m_cuTreeStats.qpBufPos = -1;
+            /* the read buffers may hold frames the lookahead has not used yet */
+            if (m_param->rc.bStatWrite)
+                m_cuTreeStats.writeBuffer = X265_MALLOC(uint16_t, m_ncu);
         }
     }
     return true;
@@ -1004,7 +1150,7 @@ int RateControl::rateControlSliceType(int frameNum)
 {
     if (m_param->rc.bStatRead)
     {
-        if (frameNum >= m_numEntries)
+        if (frameNum + m_segmentStart >= m_numEntries)
         {
             /* We could try to initialize everything required for ABR and
              * adaptive B-frames, but that would be complicated.
@@ -1030,9 +1176,10 @@ int RateControl::rateControlSliceType(int frameNum)
                 m_param->bframes = 1;
             return X265_TYPE_AUTO;
         }
-        int frameType = m_rce2Pass[frameNum].sliceType == I_SLICE ? (frameNum > 0 && m_param->bOpenGOP ? X265_TYPE_I : X265_TYPE_IDR)
-                            : m_rce2Pass[frameNum].sliceType == P_SLICE ? X265_TYPE_P
-                            : (m_rce2Pass[frameNum].sliceType == B_SLICE && m_rce2Pass[frameNum].keptAsRef? X265_TYPE_BREF : X265_TYPE_B);
+        RateControlEntry *rce = &m_rce2Pass[frameNum + m_segmentStart];
+        int frameType = rce->sliceType == I_SLICE ? (frameNum > 0 && m_param->bOpenGOP ? X265_TYPE_I : X265_TYPE_IDR)
+                            : rce->sliceType == P_SLICE ? X265_TYPE_P
+                            : (rce->sliceType == B_SLICE && rce->keptAsRef? X265_TYPE_BREF : X265_TYPE_B);
         return frameType;
     }
     else
@@ -1060,8 +1207,8 @@ int RateControl::rateControlStart(Frame* pic, RateControlEntry* rce, Encoder* en
     rce->poc = m_curSlice->m_poc;
     if (m_param->rc.bStatRead)
     {
-        X265_CHECK(rce->poc >= 0 && rce->poc < m_numEntries, "bad encode ordinal\n");
-        copyRceData(rce, &m_rce2Pass[rce->poc]);
+        X265_CHECK(rce->poc >= 0 && rce->poc + m_segmentStart < m_numEntries, "bad encode ordinal\n");
+        copyRceData(rce, &m_rce2Pass[rce->poc + m_segmentStart]);
     }
     rce->isActive = true;
     if (m_sliceType == B_SLICE)
@@ -1292,9 +1439,24 @@ bool RateControl::fixUnderflow(int t0, int t1, double adjustment, double qscaleM
 
 bool RateControl::cuTreeReadFor2Pass(Frame* frame)
 {
-    uint8_t sliceTypeActual = (uint8_t)m_rce2Pass[frame->m_POC].sliceType;
+    RateControlEntry *rce = &m_rce2Pass[frame->m_POC + m_segmentStart];
+    uint8_t sliceTypeActual = (uint8_t)rce->sliceType;
 
-    if (m_rce2Pass[frame->m_POC].keptAsRef)
+    if (rce->keptAsRef && m_statsMap)
+    {
+        /* binary stats keep the CU-tree data with the record of each frame */
+        const StatsFileRecord *rec = statsRecord(frame->m_POC + m_segmentStart);
+        if (!rec || !rec->bHasCuTree)
+            goto fail;
+        const uint16_t *qpBuffer = (const uint16_t*)(rec + 1);
+        for (int i = 0; i < m_ncu; i++)
+        {
+            int16_t qpFix8 = qpBuffer[i];
+            frame->m_lowres.qpCuTreeOffset[i] = (double)(qpFix8) / 256.0;
+            frame->m_lowres.invQscaleFactor[i] = x265_exp2fix8(frame->m_lowres.qpCuTreeOffset[i]);
+        }
+    }
+    else if (rce->keptAsRef)
     {
         uint8_t type;
         if (m_cuTreeStats.qpBufPos < 0)
@@ -1421,22 +1583,27 @@ double RateControl::rateEstimateQscale(Frame* pic, RateControlEntry *rce)
                 else
                     m_predictedBits += (int64_t)(m_param->frameNumThreads * m_bitrate / m_fps);
             }
+            /* Expected bits are planned title-wide; measure them from the
+             * start of this segment since m_totalBits only covers it */
+            int segmentFrames = m_segmentEnd - m_segmentStart;
+            uint64_t startBits = m_rce2Pass[m_segmentStart].expectedBits;
+            uint64_t expectedBits = rce->expectedBits - startBits;
             /* Adjust ABR buffer based on distance to the end of the video. */
-            if (m_numEntries > rce->encodeOrder)
+            if (segmentFrames > rce->encodeOrder)
             {
-                uint64_t finalBits = m_rce2Pass[m_numEntries - 1].expectedBits;
-                double videoPos = (double)rce->expectedBits / finalBits;
-                double scaleFactor = sqrt((1 - videoPos) * m_numEntries);
+                uint64_t finalBits = m_rce2Pass[m_segmentEnd - 1].expectedBits - startBits;
+                double videoPos = finalBits ? (double)expectedBits / finalBits : 1.0;
+                double scaleFactor = sqrt((1 - videoPos) * segmentFrames);
                 abrBuffer *= 0.5 * X265_MAX(scaleFactor, 0.5);
             }
-            diff = m_predictedBits - (int64_t)rce->expectedBits;
+            diff = m_predictedBits - (int64_t)expectedBits;
             q = rce->newQScale;
             q /= Clip3(0.5, 2.0, (double)(abrBuffer - diff) / abrBuffer);
             if (m_expectedBitsSum > 0)
             {
                 /* Adjust quant based on the difference between
                  * achieved and expected bitrate so far */
-                double curTime = (double)rce->encodeOrder / m_numEntries;
+                double curTime = (double)rce->encodeOrder / segmentFrames;
                 double w = Clip3(0.0, 1.0, curTime * 100);
                 q *= pow((double)m_totalBits / m_expectedBitsSum, w);
             }
@@ -1879,7 +2046,7 @@ double RateControl::predictRowsSizeSum(Frame* pic, RateControlEntry* rce, double
     return totalSatdBits + encodedBitsSoFar;
 }
 
-int RateControl::rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControlEntry* rce, double& qpVbv)
+int RateControl::rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControlEntry* rce, double& qpVbv, uint32_t restartCost)
 {
     double qScaleVbv = x265_qp2qScale(qpVbv);
     uint64_t rowSatdCost = pic->m_rowDiagSatd[row];
@@ -1905,7 +2072,17 @@ int RateControl::rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControl
         }
     }
 
-    int canReencodeRow = 1;
+    /* Without WPP the rows share one entropy coder and substream, which
+     * cannot be rewound, so rows are never re-encoded */
+    int canReencodeRow = m_param->bEnableWavefront;
+
+    /* restartCost is the number of CTUs a re-encode of this row would
+     * discard. In low-latency mode, the restarts which only correct the QP
+     * of the row are refused when they cost more than half a CTU row, the
+     * new QP then applies from the next CTU. Restarts which prevent a VBV
+     * underflow (or MinCR violation) are always taken */
+    int canRequantRow = canReencodeRow &&
+                        (!m_param->rc.bLowLatency || restartCost <= pic->getPicSym()->getFrameWidthInCU() / 2);
     /* tweak quality based on difference from predicted size */
     double prevRowQp = qpVbv;
     double qpAbsoluteMax = QP_MAX_MAX;
@@ -1969,18 +2146,20 @@ int RateControl::rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControl
         }
 
         /* avoid VBV underflow or MinCr violation */
+        bool bUnderflow = false;
         while ((qpVbv < qpAbsoluteMax)
                && ((rce->bufferFill - accFrameBits < m_bufferRate * maxFrameError) ||
                    (rce->frameSizeMaximum - accFrameBits < rce->frameSizeMaximum * maxFrameError)))
         {
             qpVbv += stepSize;
             accFrameBits = predictRowsSizeSum(pic, rce, qpVbv, encodedBitsSoFar);
+            bUnderflow = true;
         }
 
         rce->frameSizeEstimated = accFrameBits;
 
         /* If the current row was large enough to cause a large QP jump, try re-encoding it. */
-        if (qpVbv > qpMax && prevRowQp < qpMax && canReencodeRow)
+        if (qpVbv > qpMax && prevRowQp < qpMax && (canRequantRow || (bUnderflow && canReencodeRow)))
         {
             /* Bump QP to halfway in between... close enough. */
             qpVbv = Clip3(prevRowQp + 1.0f, qpMax, (prevRowQp + qpVbv) * 0.5);
@@ -1989,7 +2168,7 @@ int RateControl::rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControl
 
         if (m_param->rc.rfConstantMin)
         {
-            if (qpVbv < qpMin && prevRowQp > qpMin && canReencodeRow)
+            if (qpVbv < qpMin && prevRowQp > qpMin && canRequantRow)
             {
                 qpVbv = Clip3(qpMin, prevRowQp, (prevRowQp + qpVbv) * 0.5);
                 return -1;
@@ -2141,9 +2320,14 @@ int RateControl::rateControlEnd(Frame* pic, int64_t bits, RateControlEntry* rce,
         char cType = rce->sliceType == I_SLICE ? (rce->poc > 0 && m_param->bOpenGOP ? 'i' : 'I')
             : rce->sliceType == P_SLICE ? 'P'
             : IS_REFERENCED(slice) ? 'B' : 'b';
-        if (fprintf(m_statFileOut,
+        if (m_param->rc.bBinaryStats)
+        {
+            if (!writeStatsRecord(pic, rce, stats, cType))
+                goto writeFailure;
+        }
+        else if (fprintf(m_statFileOut,
                     "in:%d out:%d type:%c q:%.2f q-aq:%.2f tex:%d mv:%d misc:%d icu:%.2f pcu:%.2f scu:%.2f ;\n",
-                    rce->poc, rce->encodeOrder,
+                    rce->poc + m_param->rc.segmentStart, rce->encodeOrder + m_param->rc.segmentStart,
                     cType, pic->m_avgQpRc, pic->m_avgQpAq,
                     stats->coeffBits,
                     stats->mvBits,
@@ -2152,15 +2336,16 @@ int RateControl::rateControlEnd(Frame* pic, int64_t bits, RateControlEntry* rce,
                     stats->percentInter * m_ncu,
                     stats->percentSkip  * m_ncu) < 0)
             goto writeFailure;
-        /* Don't re-write the data in multi-pass mode. */
-        if (m_param->rc.cuTree && IS_REFERENCED(slice) && !m_param->rc.bStatRead)
+        /* the CU-tree data of the frame, found by the lookahead or loaded
+         * from the binary stats of the previous pass */
+        if (m_cutreeStatFileOut && IS_REFERENCED(slice))
         {
             uint8_t sliceType = (uint8_t)rce->sliceType;
             for (int i = 0; i < m_ncu; i++)
-                    m_cuTreeStats.qpBuffer[0][i] = (uint16_t)(pic->m_lowres.qpCuTreeOffset[i] * 256.0);
+                    m_cuTreeStats.writeBuffer[i] = (uint16_t)(pic->m_lowres.qpCuTreeOffset[i] * 256.0);
             if (fwrite(&sliceType, 1, 1, m_cutreeStatFileOut) < 1)
                 goto writeFailure;
-            if (fwrite(m_cuTreeStats.qpBuffer[0], sizeof(uint16_t), m_ncu, m_cutreeStatFileOut) < (size_t)m_ncu)
+            if (fwrite(m_cuTreeStats.writeBuffer, sizeof(uint16_t), m_ncu, m_cutreeStatFileOut) < (size_t)m_ncu)
                 goto writeFailure;
         }
     }
@@ -2257,6 +2442,119 @@ writeFailure:
     return 1;
 }
 
+/* binary stats record of a frame of the mapped previous pass, or NULL */
+const StatsFileRecord* RateControl::statsRecord(int frameNumber) const
+{
+    const StatsFileHeader *header = (const StatsFileHeader*)m_statsMap;
+    if (frameNumber < 0 || (uint32_t)frameNumber >= header->numEntries)
+        return NULL;
+
+    const uint64_t *index = (const uint64_t*)(m_statsMap + header->indexOffset);
+    uint64_t offset = index[frameNumber];
+    if (!offset || offset > m_statsMapSize || m_statsMapSize - offset < sizeof(StatsFileRecord))
+        return NULL;
+
+    const StatsFileRecord *rec = (const StatsFileRecord*)(m_statsMap + offset);
+    if (rec->bHasCuTree && m_statsMapSize - offset - sizeof(StatsFileRecord) < header->numCuTree * sizeof(uint16_t))
+        return NULL;
+    return rec;
+}
+
+bool RateControl::writeStatsHeader(uint32_t numEntries, uint64_t indexOffset)
+{
+    StatsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, X265_STATS_MAGIC, sizeof(header.magic));
+    header.version = X265_STATS_VERSION;
+    header.headerSize = sizeof(StatsFileHeader);
+    header.recordSize = sizeof(StatsFileRecord);
+    header.numCuTree = m_param->rc.cuTree ? m_ncu : 0;
+    header.numEntries = numEntries;
+    header.firstFrame = m_param->rc.segmentStart;
+    header.optionsOffset = sizeof(StatsFileHeader);
+    header.indexOffset = indexOffset;
+    return fwrite(&header, sizeof(header), 1, m_statFileOut) == 1;
+}
+
+/* round to the two decimals printed in text stats, so a pass reading binary
+ * stats makes the same decisions as one reading the text stats of the same
+ * encode, and the stats converters of x265-segment are lossless */
+static double statsPrecision(double value)
+{
+    char buf[64];
+    sprintf(buf, "%.2f", value);
+    return strtod(buf, NULL);
+}
+
+/* append the binary stats record of a frame, records are kept 8 byte aligned */
+bool RateControl::writeStatsRecord(Frame* pic, RateControlEntry* rce, FrameStats* stats, char cType)
+{
+    StatsFileRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.frameNumber = rce->poc + m_param->rc.segmentStart;
+    rec.encodeOrder = rce->encodeOrder + m_param->rc.segmentStart;
+    rec.qpRc = statsPrecision(pic->m_avgQpRc);
+    rec.qpAq = statsPrecision(pic->m_avgQpAq);
+    rec.iCuCount = statsPrecision(stats->percentIntra * m_ncu);
+    rec.pCuCount = statsPrecision(stats->percentInter * m_ncu);
+    rec.skipCuCount = statsPrecision(stats->percentSkip * m_ncu);
+    rec.coeffBits = stats->coeffBits;
+    rec.mvBits = stats->mvBits;
+    rec.miscBits = stats->miscBits;
+    rec.type = cType;
+
+    const uint16_t *cuTree = NULL;
+    if (m_param->rc.cuTree && IS_REFERENCED(pic->m_picSym->m_slice))
+    {
+        if (!m_statsMap)
+        {
+            /* found by the lookahead, or loaded from the .cutree file of
+             * text stats read from the previous pass */
+            for (int i = 0; i < m_ncu; i++)
+                m_cuTreeStats.writeBuffer[i] = (uint16_t)(pic->m_lowres.qpCuTreeOffset[i] * 256.0);
+            cuTree = m_cuTreeStats.writeBuffer;
+        }
+        else
+        {
+            /* carry the CU-tree data of the previous pass over */
+            const StatsFileRecord *prev = statsRecord(rce->poc + m_segmentStart);
+            if (prev && prev->bHasCuTree)
+                cuTree = (const uint16_t*)(prev + 1);
+        }
+    }
+    rec.bHasCuTree = !!cuTree;
+
+    if (rce->poc >= m_statsIndexSize)
+    {
+        int newSize = X265_MAX(rce->poc + 1, m_statsIndexSize * 2 + 256);
+        uint64_t *index = X265_MALLOC(uint64_t, newSize);
+        if (!index)
+            return false;
+        memset(index, 0, newSize * sizeof(uint64_t));
+        if (m_statsIndex)
+            memcpy(index, m_statsIndex, m_statsIndexSize * sizeof(uint64_t));
+        X265_FREE(m_statsIndex);
+        m_statsIndex = index;
+        m_statsIndexSize = newSize;
+    }
+    m_statsIndex[rce->poc] = m_statsWritePos;
+    m_statsIndexCount = X265_MAX(m_statsIndexCount, rce->poc + 1);
+
+    if (fwrite(&rec, sizeof(rec), 1, m_statFileOut) != 1)
+        return false;
+    m_statsWritePos += sizeof(rec);
+    if (cuTree)
+    {
+        static const uint16_t pad[4] = { 0 };
+        size_t padSize = (4 - m_ncu % 4) % 4;
+        if (fwrite(cuTree, sizeof(uint16_t), m_ncu, m_statFileOut) != (size_t)m_ncu ||
+            fwrite(pad, sizeof(uint16_t), padSize, m_statFileOut) != padSize)
+            return false;
+        m_statsWritePos += (m_ncu + padSize) * sizeof(uint16_t);
+    }
+    return true;
+}
+
 #if defined(_MSC_VER)
 #pragma warning(disable: 4996) // POSIX function names are just fine, thank you
 #endif
@@ -2286,8 +2584,21 @@ void RateControl::destroy()
     if (!fileName)
         fileName = s_defaultStatFileName;
 
+    /* the previous pass may be overwritten by this one, so unmap it first */
+    x265_unmap_file(m_statsMap, m_statsMapSize);
+    m_statsMap = NULL;
+
     if (m_statFileOut)
     {
+        if (m_param->rc.bBinaryStats)
+        {
+            /* append the index and complete the header */
+            bool bError = m_statsIndexCount &&
+                fwrite(m_statsIndex, sizeof(uint64_t), m_statsIndexCount, m_statFileOut) != (size_t)m_statsIndexCount;
+            bError = bError || fseek(m_statFileOut, 0, SEEK_SET) || !writeStatsHeader(m_statsIndexCount, m_statsWritePos);
+            if (bError)
+                x265_log(m_param, X265_LOG_ERROR, "failed to write the index of the stats file\n");
+        }
         fclose(m_statFileOut);
         char *tmpFileName = strcatFilename(fileName, ".temp");
         int bError = 1;
@@ -2328,7 +2639,9 @@ void RateControl::destroy()
         fclose(m_cutreeStatFileIn);
 
     X265_FREE(m_rce2Pass);
+    X265_FREE(m_statsIndex);
     for (int i = 0; i < 2; i++)
         X265_FREE(m_cuTreeStats.qpBuffer[i]);
+    X265_FREE(m_cuTreeStats.writeBuffer);
 }
 
@@ -33,6 +33,7 @@ class Encoder;
 class Frame;
 struct SPS;
 class SEIBufferingPeriod;
+struct StatsFileRecord;
 #define BASE_FRAME_DURATION 0.04
 
 /* Arbitrary limitations as a sanity check. */
@@ -201,6 +202,14 @@ public:
     FILE*    m_cutreeStatFileOut;
     FILE*    m_cutreeStatFileIn;
     int      m_numEntries;
+    int      m_segmentStart;      /* stats entry of the first frame of this segment */
+    int      m_segmentEnd;        /* stats entry following the last frame of this segment */
+    const uint8_t *m_statsMap;    /* memory mapped binary stats of the previous pass */
+    size_t   m_statsMapSize;
+    uint64_t m_statsWritePos;     /* binary stats: file offset of the next record */
+    uint64_t *m_statsIndex;       /* binary stats: record offset of each written frame */
+    int      m_statsIndexSize;
+    int      m_statsIndexCount;
     RateControlEntry *m_rce2Pass;
     double   m_lastAccumPNorm;
     int64_t  m_predictedBits;
@@ -210,6 +219,7 @@ public:
         uint16_t *qpBuffer[2]; /* Global buffers for converting MB-tree quantizer data. */
         int qpBufPos;          /* In order to handle pyramid reordering, QP buffer acts as a stack.
                                 * This value is the current position (0 or 1). */
+        uint16_t *writeBuffer; /* CU-tree data of the frame being written to the stats */
     } m_cuTreeStats;
 
     RateControl(x265_param *p);
@@ -222,7 +232,7 @@ public:
     void calcAdaptiveQuantFrame(Frame *pic);
     void rateControlUpdateStats(RateControlEntry* rce);
     int rateControlEnd(Frame* pic, int64_t bits, RateControlEntry* rce, FrameStats* stats);
-    int rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControlEntry* rce, double& qpVbv);
+    int rowDiagonalVbvRateControl(Frame* pic, uint32_t row, RateControlEntry* rce, double& qpVbv, uint32_t restartCost);
     void hrdFullness(SEIBufferingPeriod* sei);
     bool init(const SPS* sps);
     void initHRD(SPS* sps);
@@ -256,6 +266,9 @@ protected:
     double getDiffLimitedQScale(RateControlEntry *rce, double q);
     double countExpectedBits();
     bool vbv2Pass(uint64_t allAvailableBits);
+    const StatsFileRecord* statsRecord(int frameNumber) const;
+    bool writeStatsHeader(uint32_t numEntries, uint64_t indexOffset);
+    bool writeStatsRecord(Frame* pic, RateControlEntry* rce, FrameStats* stats, char cType);
     bool findUnderflow(double *fills, int *t0, int *t1, int over);
     bool fixUnderflow(int t0, int t1, double adjustment, double qscaleMin, double qscaleMax);
 };
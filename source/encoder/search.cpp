@@ -30,6 +30,7 @@
 #include "search.h"
 #include "entropy.h"
 #include "rdcost.h"
+#include "slicetype.h"
 
 using namespace x265;
 
@@ -48,6 +49,14 @@ Search::Search()
     m_numLayers = 0;
     m_param = NULL;
     m_rdEntropyCoders = NULL;
+    m_meCache = NULL;
+    m_meCacheRefs = 0;
+    m_ctuCacheStamp = 0;
+    m_mergeCacheNext = 0;
+    clearCTUCache();
+    m_seedMv[0] = m_seedMv[1] = NULL;
+    m_seedRefIdx[0] = m_seedRefIdx[1] = NULL;
+    m_seedSearchRange = 0;
 }
 
 Search::~Search()
@@ -60,6 +69,7 @@ Search::~Search()
 
     X265_FREE(m_qtTempCbf[0]);
     X265_FREE(m_qtTempTransformSkipFlag[0]);
+    X265_FREE(m_meCache);
     m_predTempYuv.destroy();
     m_bidirPredYuv[0].destroy();
     m_bidirPredYuv[1].destroy();
@@ -85,9 +95,14 @@ bool Search::initSearch(x265_param *param, ScalingList& scalingList)
     ok &= m_bidirPredYuv[1].create(MAX_CU_SIZE, MAX_CU_SIZE, m_param->internalCsp);
 
     /* When frame parallelism is active, only 'refLagPixels' of reference frames will be guaranteed
-     * available for motion reference.  See refLagRows in FrameEncoder::compressCTURows() */
+     * available for motion reference.  See refLagRows in FrameEncoder::compressCTURows(). The
+     * frame encoders set the lag of their frame before each row is analysed */
     m_refLagPixels = m_bFrameParallel ? param->searchRange : param->sourceHeight;
 
+    /* scaled seeds are off by the rounding of the scaling and the motion
+     * detail lost at the lower of the two resolutions */
+    m_seedSearchRange = X265_MIN(X265_MAX(param->searchRange >> 2, 4), param->searchRange);
+
     m_qtTempShortYuv = new ShortYuv[m_numLayers];
     uint32_t sizeL = 1 << (g_maxLog2CUSize * 2);
     uint32_t sizeC = sizeL >> (CHROMA_H_SHIFT(m_csp) + CHROMA_V_SHIFT(m_csp));
@@ -107,18 +122,117 @@ bool Search::initSearch(x265_param *param, ScalingList& scalingList)
     m_qtTempTransformSkipFlag[1] = m_qtTempTransformSkipFlag[0] + numPartitions;
     m_qtTempTransformSkipFlag[2] = m_qtTempTransformSkipFlag[0] + numPartitions * 2;
 
+    /* one entry per 4x4 unit of a maximum sized CTU, for each list and ref */
+    m_meCacheRefs = X265_MIN(X265_MAX(param->maxNumReferences, 1), MAX_NUM_REF);
+    CHECKED_MALLOC(m_meCache, MECacheEntry, 2 * m_meCacheRefs * MAX_NUM_PARTITIONS);
+    clearCTUCache();
+
     return ok;
 
 fail:
     return false;
 }
 
+void Search::setEffort(x265_param *param)
+{
+    m_param = param;
+    m_bEnableRDOQ = param->rdLevel >= 4;
+    m_quant.setRDOQ(m_bEnableRDOQ);
+    m_me.setSubpelRefine(param->subpelRefine);
+}
+
 void Search::setQP(Slice *slice, int qp)
 {
     m_me.setQP(qp);
     m_rdCost.setQP(slice, qp);
 }
 
+void Search::resetCTUCache()
+{
+    /* stamp 0 is never valid; on wrap-around clear all stale entries */
+    if (!++m_ctuCacheStamp)
+    {
+        clearCTUCache();
+        m_ctuCacheStamp = 1;
+    }
+    m_mergeCacheNext = 0;
+}
+
+/* entries are only valid if their stamp matches the current CTU stamp, so
+ * zeroing the stamps invalidates all of them */
+void Search::clearCTUCache()
+{
+    if (m_meCache)
+    {
+        int numEntries = 2 * m_meCacheRefs * MAX_NUM_PARTITIONS;
+        for (int i = 0; i < numEntries; i++)
+            m_meCache[i].stamp = 0;
+    }
+    for (int i = 0; i < MERGE_CACHE_SIZE; i++)
+        m_mergeCache[i].stamp = 0;
+    for (int i = 0; i <= MAX_LOG2_CU_SIZE; i++)
+        m_intraModeCosts[i].stamp = 0;
+}
+
+/* append the MVs previously found for pixels of this PU (top-left, center and
+ * bottom-right 4x4 units) to the MV candidate list, skipping duplicates */
+int Search::getCachedPredictors(int list, int ref, uint32_t puOffset, int width, int height, MV* mvc, int numMvc) const
+{
+    if (ref >= m_meCacheRefs)
+        return numMvc;
+
+    int unitX = g_zscanToPelX[puOffset] >> 2;
+    int unitY = g_zscanToPelY[puOffset] >> 2;
+    int unitW = width >> 2;
+    int unitH = height >> 2;
+
+    const int probeX[3] = { unitX, unitX + (unitW >> 1), unitX + unitW - 1 };
+    const int probeY[3] = { unitY, unitY + (unitH >> 1), unitY + unitH - 1 };
+
+    for (int i = 0; i < 3; i++)
+    {
+        const MECacheEntry* e = meCacheEntry(list, ref, probeX[i], probeY[i]);
+        if (e->stamp != m_ctuCacheStamp)
+            continue;
+
+        bool bDuplicate = false;
+        for (int j = 0; j < numMvc && !bDuplicate; j++)
+            bDuplicate = mvc[j] == e->mv;
+
+        if (!bDuplicate)
+            mvc[numMvc++] = e->mv;
+    }
+
+    return numMvc;
+}
+
+void Search::storeMotionResult(int list, int ref, uint32_t puOffset, int width, int height, MV mvp, MV mv, uint32_t cost)
+{
+    if (ref >= m_meCacheRefs)
+        return;
+
+    int unitX = g_zscanToPelX[puOffset] >> 2;
+    int unitY = g_zscanToPelY[puOffset] >> 2;
+    int unitW = width >> 2;
+    int unitH = height >> 2;
+
+    for (int y = unitY; y < unitY + unitH; y++)
+    {
+        MECacheEntry* e = meCacheEntry(list, ref, unitX, y);
+        for (int x = 0; x < unitW; x++, e++)
+        {
+            e->mv = mv;
+            e->mvp = mvp;
+            e->cost = cost;
+            e->stamp = m_ctuCacheStamp;
+            e->x = (uint8_t)unitX;
+            e->y = (uint8_t)unitY;
+            e->width = (uint8_t)unitW;
+            e->height = (uint8_t)unitH;
+        }
+    }
+}
+
 void Search::xEncSubdivCbfQTChroma(TComDataCU* cu, uint32_t trDepth, uint32_t absPartIdx, uint32_t absPartIdxStep, uint32_t width, uint32_t height)
 {
     uint32_t fullDepth  = cu->getDepth(0) + trDepth;
@@ -298,7 +412,8 @@ uint32_t Search::xGetIntraBitsChroma(TComDataCU* cu, uint32_t absPartIdx, uint32
 uint32_t Search::xIntraCodingLumaBlk(TComDataCU* cu, CU* cuData, uint32_t absPartIdx, uint32_t log2TrSize, TComYuv* fencYuv, TComYuv* predYuv,
                                      ShortYuv* resiYuv, int16_t* reconQt, uint32_t reconQtStride, coeff_t* coeff, uint32_t& cbf)
 {
-    uint32_t stride       = fencYuv->getStride();
+    uint32_t stride       = predYuv->getStride();
+    uint32_t fencStride   = fencYuv->getStride();
     pixel*   fenc         = fencYuv->getLumaAddr(absPartIdx);
     pixel*   pred         = predYuv->getLumaAddr(absPartIdx);
     int16_t* residual     = resiYuv->getLumaAddr(absPartIdx);
@@ -316,20 +431,20 @@ uint32_t Search::xIntraCodingLumaBlk(TComDataCU* cu, CU* cuData, uint32_t absPar
     X265_CHECK(!((intptr_t)residual & (tuSize - 1)), "residual alignment check fail\n");
 #endif
     // get residual signal
-    primitives.calcresidual[sizeIdx](fenc, pred, residual, stride);
+    primitives.luma_sub_ps[sizeIdx](residual, stride, fenc, pred, fencStride, stride);
 
     // transform and quantization
     if (m_bEnableRDOQ)
         m_entropyCoder.estBit(m_entropyCoder.m_estBitsSbac, log2TrSize, true);
 
-    uint32_t numSig = m_quant.transformNxN(cu, fenc, stride, residual, stride, coeff, log2TrSize, TEXT_LUMA, absPartIdx, useTransformSkip);
+    uint32_t numSig = m_quant.transformNxN(cu, fenc, fencStride, residual, stride, coeff, log2TrSize, TEXT_LUMA, absPartIdx, useTransformSkip);
     if (numSig)
     {
         X265_CHECK(log2TrSize <= 5, "log2TrSize is too large %d\n", log2TrSize);
         m_quant.invtransformNxN(cu->getCUTransquantBypass(absPartIdx), residual, stride, coeff, log2TrSize, TEXT_LUMA, true, useTransformSkip, numSig);
         primitives.calcrecon[sizeIdx](pred, residual, reconQt, reconIPred, stride, reconQtStride, reconIPredStride);
         cbf = 1;
-        return primitives.sse_sp[part](reconQt, reconQtStride, fenc, stride);
+        return primitives.sse_sp[part](reconQt, reconQtStride, fenc, fencStride);
     }
     else
     {
@@ -340,7 +455,7 @@ uint32_t Search::xIntraCodingLumaBlk(TComDataCU* cu, CU* cuData, uint32_t absPar
         primitives.square_copy_ps[sizeIdx](reconQt,    reconQtStride,    pred, stride);
         primitives.square_copy_pp[sizeIdx](reconIPred, reconIPredStride, pred, stride);
         cbf = 0;
-        return primitives.sse_pp[part](pred, stride, fenc, stride);
+        return primitives.sse_pp[part](pred, stride, fenc, fencStride);
     }
 }
 
@@ -348,7 +463,8 @@ uint32_t Search::xIntraCodingChromaBlk(TComDataCU* cu, CU* cuData, uint32_t absP
                                        uint32_t reconQtStride, coeff_t* coeff, uint32_t& cbf, uint32_t chromaId, uint32_t log2TrSizeC)
 {
     TextType ttype        = (TextType)chromaId;
-    uint32_t stride       = fencYuv->getCStride();
+    uint32_t stride       = predYuv->getCStride();
+    uint32_t fencStride   = fencYuv->getCStride();
     pixel*   fenc         = fencYuv->getChromaAddr(chromaId, absPartIdx);
     pixel*   pred         = predYuv->getChromaAddr(chromaId, absPartIdx);
     int16_t* residual     = resiYuv->getChromaAddr(chromaId, absPartIdx);
@@ -367,13 +483,13 @@ uint32_t Search::xIntraCodingChromaBlk(TComDataCU* cu, CU* cuData, uint32_t absP
     X265_CHECK(!((intptr_t)pred & (tuSize - 1)), "pred alignment check fail\n");
     X265_CHECK(!((intptr_t)residual & (tuSize - 1)), "residual alignment check fail\n");
 #endif
-    primitives.calcresidual[sizeIdxC](fenc, pred, residual, stride);
+    primitives.luma_sub_ps[sizeIdxC](residual, stride, fenc, pred, fencStride, stride);
 
     // init rate estimation arrays for RDOQ
     if (m_bEnableRDOQ)
         m_entropyCoder.estBit(m_entropyCoder.m_estBitsSbac, log2TrSizeC, false);
 
-    uint32_t numSig = m_quant.transformNxN(cu, fenc, stride, residual, stride, coeff, log2TrSizeC, ttype, absPartIdx, useTransformSkipC);
+    uint32_t numSig = m_quant.transformNxN(cu, fenc, fencStride, residual, stride, coeff, log2TrSizeC, ttype, absPartIdx, useTransformSkipC);
 
     if (numSig)
     {
@@ -381,7 +497,7 @@ uint32_t Search::xIntraCodingChromaBlk(TComDataCU* cu, CU* cuData, uint32_t absP
         m_quant.invtransformNxN(cu->getCUTransquantBypass(absPartIdx), residual, stride, coeff, log2TrSizeC, ttype, true, useTransformSkipC, numSig);
         primitives.calcrecon[sizeIdxC](pred, residual, reconQt, reconIPred, stride, reconQtStride, reconIPredStride);
         cbf = 1;
-        dist = primitives.sse_sp[part](reconQt, reconQtStride, fenc, stride);
+        dist = primitives.sse_sp[part](reconQt, reconQtStride, fenc, fencStride);
     }
     else
     {
@@ -392,7 +508,7 @@ uint32_t Search::xIntraCodingChromaBlk(TComDataCU* cu, CU* cuData, uint32_t absP
         primitives.square_copy_ps[sizeIdxC](reconQt,    reconQtStride,    pred, stride);
         primitives.square_copy_pp[sizeIdxC](reconIPred, reconIPredStride, pred, stride);
         cbf = 0;
-        dist = primitives.sse_pp[part](pred, stride, fenc, stride);
+        dist = primitives.sse_pp[part](pred, stride, fenc, fencStride);
     }
 
     X265_CHECK(ttype == TEXT_CHROMA_U || ttype == TEXT_CHROMA_V, "invalid ttype\n");
@@ -456,7 +572,7 @@ uint32_t Search::xRecurIntraCodingQT(TComDataCU* cu, CU* cuData, uint32_t trDept
         if ((cu->m_slice->m_pps->bTransquantBypassEnabled) && cu->getCUTransquantBypass(0) != checkTQbypass)
             checkTQbypass = cu->getCUTransquantBypass(0) && !m_param->bLossless;
 
-        uint32_t stride = fencYuv->getStride();
+        uint32_t stride = predYuv->getStride();
         pixel*   pred   = predYuv->getLumaAddr(absPartIdx);
 
         // init availability pattern
@@ -685,7 +801,8 @@ void Search::residualTransformQuantIntra(TComDataCU* cu, CU* cuData, uint32_t tr
 
         // code luma block with given intra prediction mode and store Cbf
         uint32_t lumaPredMode = cu->getLumaIntraDir(absPartIdx);
-        uint32_t stride       = fencYuv->getStride();
+        uint32_t stride       = predYuv->getStride();
+        uint32_t fencStride   = fencYuv->getStride();
         pixel*   fenc         = fencYuv->getLumaAddr(absPartIdx);
         pixel*   pred         = predYuv->getLumaAddr(absPartIdx);
         int16_t* residual     = resiYuv->getLumaAddr(absPartIdx);
@@ -713,8 +830,8 @@ void Search::residualTransformQuantIntra(TComDataCU* cu, CU* cuData, uint32_t tr
         X265_CHECK(!((intptr_t)residual & (tuSize - 1)), "residual alignment failure\n");
 #endif
         int sizeIdx = log2TrSize - 2;
-        primitives.calcresidual[sizeIdx](fenc, pred, residual, stride);
-        uint32_t numSig = m_quant.transformNxN(cu, fenc, stride, residual, stride, coeff, log2TrSize, TEXT_LUMA, absPartIdx, useTransformSkip);
+        primitives.luma_sub_ps[sizeIdx](residual, stride, fenc, pred, fencStride, stride);
+        uint32_t numSig = m_quant.transformNxN(cu, fenc, fencStride, residual, stride, coeff, log2TrSize, TEXT_LUMA, absPartIdx, useTransformSkip);
 
         // set coded block flag
         cu->setCbfSubParts((!!numSig) << trDepth, TEXT_LUMA, absPartIdx, fullDepth);
@@ -873,7 +990,7 @@ uint32_t Search::xRecurIntraChromaCodingQT(TComDataCU* cu, CU* cuData, uint32_t
 
         uint32_t qtLayer = log2TrSize - 2;
         uint32_t tuSize = 1 << log2TrSizeC;
-        uint32_t stride = fencYuv->getCStride();
+        uint32_t stride = predYuv->getCStride();
         const bool splitIntoSubTUs = (m_csp == X265_CSP_I422);
 
         bool checkTransformSkip = (cu->m_slice->m_pps->bTransformSkipEnabled &&
@@ -1121,7 +1238,8 @@ void Search::residualQTIntraChroma(TComDataCU* cu, CU* cuData, uint32_t trDepth,
         }
 
         uint32_t tuSize = 1 << log2TrSizeC;
-        uint32_t stride = fencYuv->getCStride();
+        uint32_t stride = predYuv->getCStride();
+        uint32_t fencStride = fencYuv->getCStride();
         const bool splitIntoSubTUs = (m_csp == X265_CSP_I422);
         const int sizeIdxC = log2TrSizeC - 2;
 
@@ -1165,9 +1283,9 @@ void Search::residualQTIntraChroma(TComDataCU* cu, CU* cuData, uint32_t trDepth,
                 X265_CHECK(!((intptr_t)fenc & (tuSize - 1)), "fenc alignment failure\n");
                 X265_CHECK(!((intptr_t)pred & (tuSize - 1)), "pred alignment failure\n");
                 X265_CHECK(!((intptr_t)residual & (tuSize - 1)), "residual alignment failure\n");
-                primitives.calcresidual[sizeIdxC](fenc, pred, residual, stride);
+                primitives.luma_sub_ps[sizeIdxC](residual, stride, fenc, pred, fencStride, stride);
 
-                uint32_t numSig = m_quant.transformNxN(cu, fenc, stride, residual, stride, coeff, log2TrSizeC, ttype, absPartIdxC, useTransformSkipC);
+                uint32_t numSig = m_quant.transformNxN(cu, fenc, fencStride, residual, stride, coeff, log2TrSizeC, ttype, absPartIdxC, useTransformSkipC);
 
                 cu->setCbfPartRange((!!numSig) << trDepth, ttype, absPartIdxC, tuIterator.absPartIdxStep);
 
@@ -1252,6 +1370,7 @@ void Search::estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYu
         pixel _left[4 * 32 + 1];
         int scaleTuSize = tuSize;
         int scaleStride = stride;
+        int fencStride = fencYuv->getStride();
         int costShift = 0;
 
         if (tuSize > 32)
@@ -1260,7 +1379,7 @@ void Search::estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYu
             pixel *leftScale   = _left + 2 * 32;
 
             // origin is 64x64, we scale to 32x32 and setup required parameters
-            primitives.scale2D_64to32(bufScale, fenc, stride);
+            primitives.scale2D_64to32(bufScale, fenc, fencStride);
             fenc = bufScale;
 
             // reserve space in case primitives need to store data in above
@@ -1271,6 +1390,7 @@ void Search::estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYu
 
             scaleTuSize = 32;
             scaleStride = 32;
+            fencStride = 32;
             costShift = 2;
             sizeIdx = 5 - 2; // log2(scaleTuSize) - 2
 
@@ -1290,42 +1410,62 @@ void Search::estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYu
         pixelcmp_t sa8d = primitives.sa8d[sizeIdx];
         uint64_t modeCosts[35];
         uint64_t bcost;
+        uint32_t bits, sad;
 
-        // DC
-        primitives.intra_pred[DC_IDX][sizeIdx](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
-        uint32_t bits = (mpms & ((uint64_t)1 << DC_IDX)) ? getIntraModeBits(cu, DC_IDX, partOffset, depth) : rbits;
-        uint32_t sad  = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
-        modeCosts[DC_IDX] = bcost = m_rdCost.calcRdSADCost(sad, bits);
+        /* with --fast-intra-modes, measure only the modes suggested by the
+         * enclosing PU of twice this size */
+        uint32_t zOrder = cuData->encodeIdx + partOffset;
+        uint64_t modeMask = 0;
+        if (m_param->bEnableFastIntraModes)
+            modeMask = getIntraModeSubset(cu, zOrder, log2TrSize, mpms, isInterLikely(cu, zOrder, log2TrSize));
 
-        // PLANAR
-        pixel *abovePlanar = above;
-        pixel *leftPlanar  = left;
-        if (tuSize >= 8 && tuSize <= 32)
+        if (modeMask)
         {
-            abovePlanar = aboveFiltered;
-            leftPlanar  = leftFiltered;
+            uint32_t bmode = estIntraModeSubset(cu, partOffset, depth, modeMask, mpms, rbits, fenc, fencStride, left, above,
+                                                leftFiltered, aboveFiltered, scaleTuSize, costShift, modeCosts, sad, bits);
+            bcost = modeCosts[bmode];
         }
-        primitives.intra_pred[PLANAR_IDX][sizeIdx](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
-        bits = (mpms & ((uint64_t)1 << PLANAR_IDX)) ? getIntraModeBits(cu, PLANAR_IDX, partOffset, depth) : rbits;
-        sad  = sa8d(fenc, scaleStride, tmp, scaleStride) << costShift;
-        modeCosts[PLANAR_IDX] = m_rdCost.calcRdSADCost(sad, bits);
-        COPY1_IF_LT(bcost, modeCosts[PLANAR_IDX]);
+        else
+        {
+            // DC
+            primitives.intra_pred[DC_IDX][sizeIdx](tmp, scaleStride, left, above, 0, (scaleTuSize <= 16));
+            bits = (mpms & ((uint64_t)1 << DC_IDX)) ? getIntraModeBits(cu, DC_IDX, partOffset, depth) : rbits;
+            sad  = sa8d(fenc, fencStride, tmp, scaleStride) << costShift;
+            modeCosts[DC_IDX] = bcost = m_rdCost.calcRdSADCost(sad, bits);
+
+            // PLANAR
+            pixel *abovePlanar = above;
+            pixel *leftPlanar  = left;
+            if (tuSize >= 8 && tuSize <= 32)
+            {
+                abovePlanar = aboveFiltered;
+                leftPlanar  = leftFiltered;
+            }
+            primitives.intra_pred[PLANAR_IDX][sizeIdx](tmp, scaleStride, leftPlanar, abovePlanar, 0, 0);
+            bits = (mpms & ((uint64_t)1 << PLANAR_IDX)) ? getIntraModeBits(cu, PLANAR_IDX, partOffset, depth) : rbits;
+            sad  = sa8d(fenc, fencStride, tmp, scaleStride) << costShift;
+            modeCosts[PLANAR_IDX] = m_rdCost.calcRdSADCost(sad, bits);
+            COPY1_IF_LT(bcost, modeCosts[PLANAR_IDX]);
 
-        // angular predictions
-        primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
+            // angular predictions
+            primitives.intra_pred_allangs[sizeIdx](tmp, above, left, aboveFiltered, leftFiltered, (scaleTuSize <= 16));
 
-        primitives.transpose[sizeIdx](buf_trans, fenc, scaleStride);
-        for (int mode = 2; mode < 35; mode++)
-        {
-            bool modeHor = (mode < 18);
-            pixel *cmp = (modeHor ? buf_trans : fenc);
-            intptr_t srcStride = (modeHor ? scaleTuSize : scaleStride);
-            bits = (mpms & ((uint64_t)1 << mode)) ? getIntraModeBits(cu, mode, partOffset, depth) : rbits;
-            sad = sa8d(cmp, srcStride, &tmp[(mode - 2) * (scaleTuSize * scaleTuSize)], scaleTuSize) << costShift;
-            modeCosts[mode] = m_rdCost.calcRdSADCost(sad, bits);
-            COPY1_IF_LT(bcost, modeCosts[mode]);
+            primitives.transpose[sizeIdx](buf_trans, fenc, fencStride);
+            for (int mode = 2; mode < 35; mode++)
+            {
+                bool modeHor = (mode < 18);
+                pixel *cmp = (modeHor ? buf_trans : fenc);
+                intptr_t srcStride = (modeHor ? scaleTuSize : fencStride);
+                bits = (mpms & ((uint64_t)1 << mode)) ? getIntraModeBits(cu, mode, partOffset, depth) : rbits;
+                sad = sa8d(cmp, srcStride, &tmp[(mode - 2) * (scaleTuSize * scaleTuSize)], scaleTuSize) << costShift;
+                modeCosts[mode] = m_rdCost.calcRdSADCost(sad, bits);
+                COPY1_IF_LT(bcost, modeCosts[mode]);
+            }
         }
 
+        if (m_param->bEnableFastIntraModes)
+            storeIntraModeCosts(zOrder, log2TrSize, modeCosts);
+
         /* Find the top maxCandCount candidate modes with cost within 25% of best
          * or among the most probable modes. maxCandCount is derived from the
          * rdLevel and depth. In general we want to try more modes at slower RD
@@ -1336,16 +1476,28 @@ void Search::estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYu
         for (int i = 0; i < maxCandCount; i++)
             candCostList[i] = MAX_INT64;
 
+        /* without the forced MPMs, a best cost below 8 must still make
+         * its mode a candidate */
         uint64_t paddedBcost = bcost + (bcost >> 3); // 1.12%
+        bool bFastModes = !!m_param->bEnableFastIntraModes;
         for (int mode = 0; mode < 35; mode++)
-            if (modeCosts[mode] < paddedBcost || (mpms & ((uint64_t)1 << mode)))
+            if (modeCosts[mode] < paddedBcost || (bFastModes && modeCosts[mode] == bcost) ||
+                (!bFastModes && (mpms & ((uint64_t)1 << mode))))
                 updateCandList(mode, modeCosts[mode], maxCandCount, rdModeList, candCostList);
 
-        /* measure best candidates using simple RDO (no TU splits) */
+        /* measure best candidates using simple RDO (no TU splits). With
+         * --fast-intra-modes this is skipped when the SATD costs leave a
+         * single candidate */
         uint32_t bmode = 0;
         uint64_t cost;
+        int numRdCands = maxCandCount;
+        if (m_param->bEnableFastIntraModes && candCostList[1] == MAX_INT64)
+        {
+            numRdCands = 0;
+            bmode = rdModeList[0];
+        }
         bcost = MAX_INT64;
-        for (int i = 0; i < maxCandCount; i++)
+        for (int i = 0; i < numRdCands; i++)
         {
             if (candCostList[i] == MAX_INT64)
                 break;
@@ -1489,8 +1641,8 @@ void Search::getBestIntraModeChroma(TComDataCU* cu, CU* cuData, TComYuv* fencYuv
             pixel* chromaPred = TComPattern::getAdiChromaBuf(chromaId, scaleTuSize, m_predBuf);
 
             // get prediction signal
-            predIntraChromaAng(chromaPred, chromaPredMode, pred, fencYuv->getCStride(), log2TrSizeC, m_csp);
-            cost += sa8d(fenc, fencYuv->getCStride(), pred, fencYuv->getCStride()) << costShift;
+            predIntraChromaAng(chromaPred, chromaPredMode, pred, predYuv->getCStride(), log2TrSizeC, m_csp);
+            cost += sa8d(fenc, fencYuv->getCStride(), pred, predYuv->getCStride()) << costShift;
         }
 
         if (cost < bestCost)
@@ -1632,23 +1784,54 @@ uint32_t Search::mergeEstimation(TComDataCU* cu, CU* cuData, int puIdx, MergeDat
         }
     }
 
+    uint32_t puOffset = cuData->encodeIdx + m.absPartIdx;
     uint32_t outCost = MAX_UINT;
     for (uint32_t mergeCand = 0; mergeCand < m.maxNumMergeCand; ++mergeCand)
     {
         /* Prevent TMVP candidates from using unavailable reference pixels */
         if (m_bFrameParallel &&
-            (m.mvFieldNeighbours[mergeCand][0].mv.y >= (m_param->searchRange + 1) * 4 ||
-             m.mvFieldNeighbours[mergeCand][1].mv.y >= (m_param->searchRange + 1) * 4))
+            (m.mvFieldNeighbours[mergeCand][0].mv.y >= (m_refLagPixels + 1) * 4 ||
+             m.mvFieldNeighbours[mergeCand][1].mv.y >= (m_refLagPixels + 1) * 4))
             continue;
 
-        cu->getCUMvField(REF_PIC_LIST_0)->m_mv[m.absPartIdx] = m.mvFieldNeighbours[mergeCand][0].mv;
-        cu->getCUMvField(REF_PIC_LIST_0)->m_refIdx[m.absPartIdx] = (char)m.mvFieldNeighbours[mergeCand][0].refIdx;
-        cu->getCUMvField(REF_PIC_LIST_1)->m_mv[m.absPartIdx] = m.mvFieldNeighbours[mergeCand][1].mv;
-        cu->getCUMvField(REF_PIC_LIST_1)->m_refIdx[m.absPartIdx] = (char)m.mvFieldNeighbours[mergeCand][1].refIdx;
+        const TComMvField* cand = m.mvFieldNeighbours[mergeCand];
+        uint32_t costCand = MAX_UINT;
+
+        /* look for an earlier evaluation of this candidate on the same PU */
+        for (int i = 0; i < MERGE_CACHE_SIZE; i++)
+        {
+            const MergeCacheEntry& e = m_mergeCache[i];
+            if (e.stamp == m_ctuCacheStamp && e.puOffset == puOffset && e.width == m.width && e.height == m.height &&
+                e.mvField[0].mv == cand[0].mv && e.mvField[0].refIdx == cand[0].refIdx &&
+                e.mvField[1].mv == cand[1].mv && e.mvField[1].refIdx == cand[1].refIdx)
+            {
+                costCand = e.satd;
+                break;
+            }
+        }
+
+        if (costCand == MAX_UINT)
+        {
+            cu->getCUMvField(REF_PIC_LIST_0)->m_mv[m.absPartIdx] = cand[0].mv;
+            cu->getCUMvField(REF_PIC_LIST_0)->m_refIdx[m.absPartIdx] = (char)cand[0].refIdx;
+            cu->getCUMvField(REF_PIC_LIST_1)->m_mv[m.absPartIdx] = cand[1].mv;
+            cu->getCUMvField(REF_PIC_LIST_1)->m_refIdx[m.absPartIdx] = (char)cand[1].refIdx;
+
+            prepMotionCompensation(cu, cuData, puIdx);
+            motionCompensation(&m_predTempYuv, true, false);
+            costCand = m_me.bufSATD(m_predTempYuv.getLumaAddr(m.absPartIdx), m_predTempYuv.getStride());
+
+            MergeCacheEntry& e = m_mergeCache[m_mergeCacheNext];
+            m_mergeCacheNext = (m_mergeCacheNext + 1) & (MERGE_CACHE_SIZE - 1);
+            e.mvField[0] = cand[0];
+            e.mvField[1] = cand[1];
+            e.satd = costCand;
+            e.stamp = m_ctuCacheStamp;
+            e.puOffset = puOffset;
+            e.width = m.width;
+            e.height = m.height;
+        }
 
-        prepMotionCompensation(cu, cuData, puIdx);
-        motionCompensation(&m_predTempYuv, true, false);
-        uint32_t costCand = m_me.bufSATD(m_predTempYuv.getLumaAddr(m.absPartIdx), m_predTempYuv.getStride());
         uint32_t bitsCand = getTUBits(mergeCand, m.maxNumMergeCand);
         costCand = costCand + m_rdCost.getCost(bitsCand);
         if (costCand < outCost)
@@ -1666,12 +1849,29 @@ uint32_t Search::mergeEstimation(TComDataCU* cu, CU* cuData, int puIdx, MergeDat
     return outCost;
 }
 
+/* returns the seed MV of the center 4x4 unit of this PU if its seed refers
+ * to the given reference */
+bool Search::getSeedPredictor(int list, int ref, uint32_t puOffset, int width, int height, MV& mv) const
+{
+    if (!m_seedMv[list])
+        return false;
+
+    int unitX = (g_zscanToPelX[puOffset] + (width >> 1)) >> 2;
+    int unitY = (g_zscanToPelY[puOffset] + (height >> 1)) >> 2;
+    uint32_t idx = g_rasterToZscan[unitY * (g_maxCUSize >> 2) + unitX];
+    if (m_seedRefIdx[list][idx] != ref)
+        return false;
+
+    mv = m_seedMv[list][idx];
+    return true;
+}
+
 /* search of the best candidate for inter prediction
  * returns true if predYuv was filled with a motion compensated prediction */
 bool Search::predInterSearch(TComDataCU* cu, CU* cuData, TComYuv* predYuv, bool bMergeOnly, bool bChroma)
 {
     MV amvpCand[2][MAX_NUM_REF][AMVP_NUM_CANDS];
-    MV mvc[(MD_ABOVE_LEFT + 1) * 2 + 1];
+    MV mvc[(MD_ABOVE_LEFT + 1) * 2 + 1 + 3 + 1]; // AMVP neighbours plus up to 3 cached motion results and a seed
 
     Slice *slice        = cu->m_slice;
     TComPicYuv *fenc    = slice->m_pic->getPicYuvOrg();
@@ -1695,7 +1895,8 @@ bool Search::predInterSearch(TComDataCU* cu, CU* cuData, TComYuv* predYuv, bool
 
         prepMotionCompensation(cu, cuData, partIdx);
 
-        pixel* pu = fenc->getLumaAddr(cu->getAddr(), cuData->encodeIdx + partAddr);
+        uint32_t puOffset = cuData->encodeIdx + partAddr;
+        pixel* pu = fenc->getLumaAddr(cu->getAddr(), puOffset);
         m_me.setSourcePU(pu - fenc->getLumaAddr(), roiWidth, roiHeight);
 
         uint32_t mrgCost = MAX_UINT;
@@ -1750,6 +1951,12 @@ bool Search::predInterSearch(TComDataCU* cu, CU* cuData, TComYuv* predYuv, bool
                 bits += getTUBits(ref, numRefIdx[l]);
 
                 int numMvc = cu->fillMvpCand(partIdx, partAddr, l, ref, amvpCand[l][ref], mvc);
+                numMvc = getCachedPredictors(l, ref, puOffset, roiWidth, roiHeight, mvc, numMvc);
+
+                MV seedMv;
+                bool bSeeded = getSeedPredictor(l, ref, puOffset, roiWidth, roiHeight, seedMv);
+                if (bSeeded)
+                    mvc[numMvc++] = seedMv;
 
                 // Pick the best possible MVP from AMVP candidates based on least residual
                 uint32_t bestCost = MAX_INT;
@@ -1760,8 +1967,8 @@ bool Search::predInterSearch(TComDataCU* cu, CU* cuData, TComYuv* predYuv, bool
                 {
                     MV mvCand = amvpCand[l][ref][i];
 
-                    // NOTE: skip mvCand if Y is > merange and -FN>1
-                    if (m_bFrameParallel && (mvCand.y >= (merange + 1) * 4))
+                    // NOTE: skip mvCand if Y is > refLagPixels and -FN>1
+                    if (m_bFrameParallel && (mvCand.y >= (m_refLagPixels + 1) * 4))
                         continue;
 
                     cu->clipMv(mvCand);
@@ -1778,8 +1985,30 @@ bool Search::predInterSearch(TComDataCU* cu, CU* cuData, TComYuv* predYuv, bool
 
                 MV mvmin, mvmax, outmv, mvp = amvpCand[l][ref][mvpIdx];
 
-                setSearchRange(cu, mvp, merange, mvmin, mvmax);
-                int satdCost = m_me.motionEstimate(&slice->m_mref[l][ref], mvmin, mvmax, mvp, numMvc, mvc, merange, outmv);
+                int satdCost;
+
+                /* an identical search (same block, ref and predictor) was already
+                 * performed for another partition shape of this CTU */
+                const MECacheEntry* hit = ref < m_meCacheRefs ? meCacheEntry(l, ref, g_zscanToPelX[puOffset] >> 2, g_zscanToPelY[puOffset] >> 2) : NULL;
+                if (hit && hit->stamp == m_ctuCacheStamp && hit->mvp == mvp &&
+                    hit->x == g_zscanToPelX[puOffset] >> 2 && hit->y == g_zscanToPelY[puOffset] >> 2 &&
+                    hit->width == roiWidth >> 2 && hit->height == roiHeight >> 2)
+                {
+                    outmv = hit->mv;
+                    satdCost = hit->cost;
+                }
+                else
+                {
+                    if (bSeeded)
+                    {
+                        merange = m_seedSearchRange;
+                        setSearchRange(cu, seedMv, merange, mvmin, mvmax);
+                    }
+                    else
+                        setSearchRange(cu, mvp, merange, mvmin, mvmax);
+                    satdCost = m_me.motionEstimate(&slice->m_mref[l][ref], mvmin, mvmax, mvp, numMvc, mvc, merange, outmv);
+                    storeMotionResult(l, ref, puOffset, roiWidth, roiHeight, mvp, outmv, satdCost);
+                }
 
                 /* Get total cost of partition, but only include MV bit cost once */
                 bits += m_me.bitcost(outmv);
@@ -2575,7 +2804,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                 uint32_t zorder = cuData->encodeIdx + absPartIdx;
                 pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getLumaAddr(cu->getAddr(), zorder);
                 uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getStride();
-                uint32_t stride = fencYuv->getStride();
+                uint32_t stride = predYuv->getStride();
                 //===== reconstruction =====
                 primitives.luma_add_ps[sizeIdx](reconIPred, reconIPredStride, pred, curResiY, stride, strideResiY);
                 int size = log2TrSize - 2;
@@ -2674,7 +2903,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                         uint32_t zorder = cuData->encodeIdx + absPartIdxC;
                         pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getCbAddr(cu->getAddr(), zorder);
                         uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getCStride();
-                        uint32_t stride = fencYuv->getCStride();
+                        uint32_t stride = predYuv->getCStride();
                         //===== reconstruction =====
                         int size = log2TrSizeC - 2;
                         primitives.luma_add_ps[size](reconIPred, reconIPredStride, pred, curResiU, stride, strideResiC);
@@ -2756,7 +2985,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                         uint32_t zorder = cuData->encodeIdx + absPartIdxC;
                         pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getCrAddr(cu->getAddr(), zorder);
                         uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getCStride();
-                        uint32_t stride = fencYuv->getCStride();
+                        uint32_t stride = predYuv->getCStride();
                         //===== reconstruction =====
                         int size = log2TrSizeC - 2;
                         primitives.luma_add_ps[size](reconIPred, reconIPredStride, pred, curResiV, stride, strideResiC);
@@ -2862,7 +3091,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                     uint32_t zorder = cuData->encodeIdx + absPartIdx;
                     pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getLumaAddr(cu->getAddr(), zorder);
                     uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getStride();
-                    uint32_t stride = fencYuv->getStride();
+                    uint32_t stride = predYuv->getStride();
                     //===== reconstruction =====
                     int size = log2TrSize - 2;
                     primitives.luma_add_ps[size](reconIPred, reconIPredStride, pred, tsResiY, stride, trSize);
@@ -2950,7 +3179,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                         uint32_t zorder = cuData->encodeIdx + absPartIdxC;
                         pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getCbAddr(cu->getAddr(), zorder);
                         uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getCStride();
-                        uint32_t stride = fencYuv->getCStride();
+                        uint32_t stride = predYuv->getCStride();
                         //===== reconstruction =====
                         int size = log2TrSizeC - 2;
                         primitives.luma_add_ps[size](reconIPred, reconIPredStride, pred, tsResiU, stride, trSizeC);
@@ -2991,7 +3220,7 @@ uint32_t Search::xEstimateResidualQT(TComDataCU* cu, CU* cuData, uint32_t absPar
                         uint32_t zorder = cuData->encodeIdx + absPartIdxC;
                         pixel*   reconIPred = cu->m_pic->getPicYuvRec()->getCrAddr(cu->getAddr(), zorder);
                         uint32_t reconIPredStride = cu->m_pic->getPicYuvRec()->getCStride();
-                        uint32_t stride = fencYuv->getCStride();
+                        uint32_t stride = predYuv->getCStride();
                         //===== reconstruction =====
                         int size = log2TrSizeC - 2;
                         primitives.luma_add_ps[size](reconIPred, reconIPredStride, pred, tsResiV, stride, trSizeC);
@@ -3459,6 +3688,127 @@ void Search::updateCandList(uint32_t mode, uint64_t cost, int maxCandCount, uint
     }
 }
 
+/* Derive the intra modes worth measuring for a PU from the SATD costs measured
+ * for the enclosing PU of twice its size: DC, planar and the most probable
+ * modes, plus the angles within 25% of the best enclosing cost and their two
+ * nearest neighbors on either side. When the lookahead found inter prediction
+ * clearly cheaper only the best enclosing angle is kept. Returns 0 if no
+ * enclosing PU was measured in this CTU */
+uint64_t Search::getIntraModeSubset(TComDataCU* cu, uint32_t zOrder, uint32_t log2Size, uint64_t mpms, bool bInterLikely)
+{
+    if (log2Size >= MAX_LOG2_CU_SIZE || cu->getLog2CUSize(0) < log2Size)
+        return 0;
+
+    const IntraModeCosts& parent = m_intraModeCosts[log2Size + 1];
+    if (parent.stamp != m_ctuCacheStamp || zOrder < parent.zOrder || zOrder >= parent.zOrder + parent.numParts)
+        return 0;
+
+    uint64_t bcost = MAX_INT64, bangleCost = MAX_INT64;
+    uint32_t bangle = 0;
+    for (uint32_t mode = 0; mode < 35; mode++)
+    {
+        COPY1_IF_LT(bcost, parent.cost[mode]);
+        if (mode >= 2)
+            COPY2_IF_LT(bangleCost, parent.cost[mode], bangle, mode);
+    }
+
+    if (bcost == MAX_INT64)
+        return 0;
+
+    uint64_t modeMask = ((uint64_t)1 << DC_IDX) | ((uint64_t)1 << PLANAR_IDX) | mpms;
+    if (bangle)
+        modeMask |= (uint64_t)1 << bangle;
+    if (bInterLikely)
+        return modeMask;
+
+    uint64_t threshold = bcost + (bcost >> 2);
+    for (uint32_t mode = 2; mode < 35; mode++)
+    {
+        if (parent.cost[mode] <= threshold)
+        {
+            uint32_t lo = X265_MAX(mode, 4) - 2;
+            uint32_t hi = X265_MIN(mode + 2, 34);
+            for (uint32_t m = lo; m <= hi; m++)
+                modeMask |= (uint64_t)1 << m;
+        }
+    }
+
+    return modeMask;
+}
+
+/* Returns true if the lookahead found the lowres inter cost of the 16x16
+ * blocks covering this PU less than half their intra cost */
+bool Search::isInterLikely(TComDataCU* cu, uint32_t zOrder, uint32_t log2Size) const
+{
+    const Lowres& lowres = cu->m_pic->m_lowres;
+    if (cu->m_slice->isIntra() || !lowres.lowresCostForRc)
+        return false;
+
+    int maxBlockCols = (cu->m_pic->getPicYuvOrg()->getWidth() + (16 - 1)) / 16;
+    int maxBlockRows = (cu->m_pic->getPicYuvOrg()->getHeight() + (16 - 1)) / 16;
+    int x0 = (cu->getCUPelX() + g_zscanToPelX[zOrder]) / 16;
+    int y0 = (cu->getCUPelY() + g_zscanToPelY[zOrder]) / 16;
+    int blocks = X265_MAX(1 << log2Size >> 4, 1);
+
+    int64_t intraCost = 0, interCost = 0;
+    for (int y = y0; y < y0 + blocks && y < maxBlockRows; y++)
+    {
+        for (int x = x0; x < x0 + blocks && x < maxBlockCols; x++)
+        {
+            int idx = y * maxBlockCols + x;
+            intraCost += lowres.intraCost[idx];
+            interCost += lowres.lowresCostForRc[idx] & LOWRES_COST_MASK;
+        }
+    }
+
+    return intraCost > 2 * interCost;
+}
+
+void Search::storeIntraModeCosts(uint32_t zOrder, uint32_t log2Size, const uint64_t* modeCosts)
+{
+    IntraModeCosts& e = m_intraModeCosts[log2Size];
+    memcpy(e.cost, modeCosts, sizeof(e.cost));
+    e.stamp = m_ctuCacheStamp;
+    e.zOrder = zOrder;
+    e.numParts = 1 << ((log2Size - 2) * 2);
+}
+
+/* Measure the SATD costs of the intra modes in modeMask, predicting each one
+ * individually; the other modes are set to MAX_INT64. Returns the best mode */
+uint32_t Search::estIntraModeSubset(TComDataCU* cu, uint32_t partOffset, uint32_t depth, uint64_t modeMask, uint64_t mpms, uint32_t rbits,
+                                    pixel* fenc, intptr_t fencStride, pixel* left, pixel* above, pixel* leftFiltered, pixel* aboveFiltered,
+                                    int scaleTuSize, int costShift, uint64_t* modeCosts, uint32_t& bestSad, uint32_t& bestBits)
+{
+    ALIGN_VAR_32(pixel, pred[32 * 32]);
+    int sizeIdx = g_log2Size[scaleTuSize] - 2;
+    pixelcmp_t sa8d = primitives.sa8d[sizeIdx];
+    uint64_t bcost = MAX_INT64;
+    uint32_t bmode = DC_IDX;
+
+    for (uint32_t mode = 0; mode < 35; mode++)
+    {
+        modeCosts[mode] = MAX_INT64;
+        if (!(modeMask & ((uint64_t)1 << mode)))
+            continue;
+
+        bool bUseFiltered = !!(g_intraFilterFlags[mode] & scaleTuSize);
+        primitives.intra_pred[mode][sizeIdx](pred, scaleTuSize, bUseFiltered ? leftFiltered : left, bUseFiltered ? aboveFiltered : above,
+                                             mode, scaleTuSize <= 16);
+        uint32_t bits = (mpms & ((uint64_t)1 << mode)) ? getIntraModeBits(cu, mode, partOffset, depth) : rbits;
+        uint32_t sad = sa8d(fenc, fencStride, pred, scaleTuSize) << costShift;
+        modeCosts[mode] = m_rdCost.calcRdSADCost(sad, bits);
+        if (modeCosts[mode] < bcost)
+        {
+            bcost = modeCosts[mode];
+            bmode = mode;
+            bestSad = sad;
+            bestBits = bits;
+        }
+    }
+
+    return bmode;
+}
+
 /* add inter-prediction syntax elements for a CU block */
 uint32_t Search::getInterSymbolBits(TComDataCU* cu, uint32_t depthRange[2])
 {
@@ -76,12 +76,26 @@ public:
     int             m_numLayers;
     int             m_refLagPixels;
 
+    /* MVs and reference indices scaled from the analysis of another
+     * resolution for the 4x4 units of the current CTU in z-order, NULL when
+     * there are none. A PU with a seed for the searched reference is only
+     * searched within m_seedSearchRange of it */
+    const MV*       m_seedMv[2];
+    const int8_t*   m_seedRefIdx[2];
+    int             m_seedSearchRange;
+
     Search();
     ~Search();
 
     bool     initSearch(x265_param *param, ScalingList& scalingList);
     void     setQP(Slice* slice, int qp);
 
+    // analyze with the options of param, which may be a per-frame copy with a lowered effort
+    void     setEffort(x265_param *param);
+
+    // invalidate motion search, merge and intra mode results cached for the previous CTU
+    void     resetCTUCache();
+
     void     estIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYuv* predYuv, ShortYuv* resiYuv, TComYuv* reconYuv, uint32_t depthRange[2]);
     void     sharedEstIntraPredQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYuv* predYuv, ShortYuv* resiYuv, TComYuv* reconYuv, uint32_t depthRange[2], uint8_t* sharedModes);
     void     estIntraPredChromaQT(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYuv* predYuv, ShortYuv* resiYuv, TComYuv* reconYuv);
@@ -170,6 +184,52 @@ protected:
         int bits;
     };
 
+    /* Motion search results are cached per CTU so the searches of overlapping
+     * partitions (parent/child CUs, rect and AMP shapes) can be seeded with the
+     * MVs already found for the same pixels, and exact repeats skipped. Entries
+     * are indexed by [list][ref][4x4 unit within the CTU] and are only valid if
+     * their stamp matches the current CTU stamp */
+    struct MECacheEntry
+    {
+        MV       mv;       // best MV of the last search which covered this unit
+        MV       mvp;      // MV predictor of that search
+        uint32_t cost;     // satd + mvcost of that search
+        uint32_t stamp;
+        uint8_t  x, y;     // top-left 4x4 unit of the searched block
+        uint8_t  width;    // block dimensions in 4x4 units
+        uint8_t  height;
+    };
+
+    /* SATD costs of merge candidates, reused when a later partition shape
+     * evaluates the same candidate for the same PU */
+    struct MergeCacheEntry
+    {
+        TComMvField mvField[2];
+        uint32_t    satd;
+        uint32_t    stamp;
+        uint32_t    puOffset; // CTU relative z-order index of the PU
+        int         width;
+        int         height;
+    };
+
+    enum { MERGE_CACHE_SIZE = 64 };
+
+    MECacheEntry*   m_meCache;
+    int             m_meCacheRefs;
+    uint32_t        m_ctuCacheStamp;
+    MergeCacheEntry m_mergeCache[MERGE_CACHE_SIZE];
+    int             m_mergeCacheNext;
+
+    MECacheEntry*   meCacheEntry(int list, int ref, int unitX, int unitY) const
+    {
+        return m_meCache + ((list * m_meCacheRefs + ref) << 8) + (unitY << 4) + unitX;
+    }
+
+    void     clearCTUCache();
+    int      getCachedPredictors(int list, int ref, uint32_t puOffset, int width, int height, MV* mvc, int numMvc) const;
+    bool     getSeedPredictor(int list, int ref, uint32_t puOffset, int width, int height, MV& mv) const;
+    void     storeMotionResult(int list, int ref, uint32_t puOffset, int width, int height, MV mvp, MV mv, uint32_t cost);
+
     /* inter/ME helper functions */
     void     checkBestMVP(MV* amvpCand, MV cMv, MV& mvPred, int& mvpIdx, uint32_t& outBits, uint32_t& outCost) const;
     void     getBlkBits(PartSize cuMode, bool bPSlice, int partIdx, uint32_t lastMode, uint32_t blockBit[3]) const;
@@ -177,9 +237,28 @@ protected:
     uint32_t getInterSymbolBits(TComDataCU* cu, uint32_t depthRange[2]);
     uint32_t mergeEstimation(TComDataCU* cu, CU* cuData, int partIdx, MergeData& m);
 
+    /* SATD costs of the intra modes measured for the last luma PU of each
+     * size, used to restrict the modes measured in its sub-blocks when
+     * --fast-intra-modes is enabled. Untested modes hold MAX_INT64 */
+    struct IntraModeCosts
+    {
+        uint64_t    cost[35];
+        uint32_t    stamp;
+        uint32_t    zOrder;   // first 4x4 unit of the PU within the CTU
+        uint32_t    numParts; // number of 4x4 units covered by the PU
+    };
+
+    IntraModeCosts  m_intraModeCosts[MAX_LOG2_CU_SIZE + 1]; // indexed by log2 PU size
+
     /* intra helper functions */
     enum { MAX_RD_INTRA_MODES = 16 };
     void     updateCandList(uint32_t mode, uint64_t cost, int maxCandCount, uint32_t* candModeList, uint64_t* candCostList);
+    bool     isInterLikely(TComDataCU* cu, uint32_t zOrder, uint32_t log2Size) const;
+    uint64_t getIntraModeSubset(TComDataCU* cu, uint32_t zOrder, uint32_t log2Size, uint64_t mpms, bool bInterLikely);
+    void     storeIntraModeCosts(uint32_t zOrder, uint32_t log2Size, const uint64_t* modeCosts);
+    uint32_t estIntraModeSubset(TComDataCU* cu, uint32_t partOffset, uint32_t depth, uint64_t modeMask, uint64_t mpms, uint32_t rbits,
+                                pixel* fenc, intptr_t fencStride, pixel* left, pixel* above, pixel* leftFiltered, pixel* aboveFiltered,
+                                int scaleTuSize, int costShift, uint64_t* modeCosts, uint32_t& bestSad, uint32_t& bestBits);
     void     getBestIntraModeChroma(TComDataCU* cu, CU* cuData, TComYuv* fencYuv, TComYuv* predYuv);
 };
 }
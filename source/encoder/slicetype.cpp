@@ -58,6 +58,8 @@ static inline void median_mv(MV &dst, MV a, MV b, MV c)
 Lookahead::Lookahead(x265_param *param, ThreadPool* pool, Encoder* enc)
     : JobProvider(pool)
     , m_est(pool)
+    , m_qest(pool)
+    , m_propagate(pool)
 {
     m_bReady = 0;
     m_param = param;
@@ -66,16 +68,21 @@ Lookahead::Lookahead(x265_param *param, ThreadPool* pool, Encoder* enc)
     m_lastNonB = NULL;
     m_bFilling = true;
     m_bFlushed = false;
+    m_weightQueueHead = m_weightQueueTail = NULL;
+    m_lastNonBPic = NULL;
+    m_decideEst = &m_est;
     m_widthInCU = ((m_param->sourceWidth / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
     m_heightInCU = ((m_param->sourceHeight / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
-    m_scratch = (int*)x265_malloc(m_widthInCU * sizeof(int));
     memset(m_histogram, 0, sizeof(m_histogram));
 }
 
 Lookahead::~Lookahead() { }
 
-void Lookahead::init()
+bool Lookahead::init()
 {
+    if (!m_propagate.init(m_widthInCU, m_heightInCU))
+        return false;
+
     if (m_pool && m_pool->getThreadCount() >= 4 &&
         ((m_param->bFrameAdaptive && m_param->bframes) ||
          m_param->rc.cuTree || m_param->scenecutThreshold ||
@@ -83,6 +90,7 @@ void Lookahead::init()
         m_pool = m_pool; /* allow use of worker thread */
     else
         m_pool = NULL; /* disable use of worker thread */
+    return true;
 }
 
 void Lookahead::destroy()
@@ -91,6 +99,10 @@ void Lookahead::destroy()
         // flush will dequeue, if it is necessary
         JobProvider::flush();
 
+    // an aborted encode may leave weightp analysis in progress
+    for (Frame* pic = m_outputQueue.first(); pic; pic = pic->m_next)
+        finishWeightAnalysis(pic);
+
     // these two queues will be empty unless the encode was aborted
     while (!m_inputQueue.empty())
     {
@@ -105,8 +117,6 @@ void Lookahead::destroy()
         pic->destroy();
         delete pic;
     }
-
-    x265_free(m_scratch);
 }
 
 /* Called by API thread */
@@ -115,6 +125,7 @@ void Lookahead::addPicture(Frame *pic, int sliceType)
     TComPicYuv *orig = pic->getPicYuvOrg();
 
     pic->m_lowres.init(orig, pic->getPOC(), sliceType);
+    pic->m_weightState = Frame::WEIGHTS_NONE;
 
     m_inputQueueLock.acquire();
     m_inputQueue.pushBack(*pic);
@@ -187,6 +198,9 @@ Frame* Lookahead::getDecidedPicture()
 
     Frame *fenc = m_outputQueue.popFront();
     m_outputQueueLock.release();
+
+    if (fenc)
+        finishWeightAnalysis(fenc);
     return fenc;
 }
 
@@ -199,8 +213,138 @@ bool Lookahead::findJob(int)
         slicetypeDecide();
         return true;
     }
+
+    if (m_weightQueueHead)
+    {
+        m_weightLock.acquire();
+        Frame *pic = m_weightQueueHead;
+        if (pic)
+        {
+            m_weightQueueHead = pic->m_weightNext;
+            if (!m_weightQueueHead)
+                m_weightQueueTail = NULL;
+            pic->m_weightState = Frame::WEIGHTS_ACTIVE;
+        }
+        m_weightLock.release();
+
+        if (pic)
+        {
+            weightAnalysis(pic);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Called by slicetypeDecide() once the frame types of a mini-GOP are decided
+ * and its lowres motion searched. Queues the weightp analysis of each frame
+ * against the nearest references in display order, which the DPB will make
+ * the first reference of each list, so it can run on worker threads before
+ * the frame reaches a frame encoder */
+void Lookahead::queueWeightAnalysis(Frame **list, int bframes, Frame *prevNonB)
+{
+    if (!m_param->bEnableWeightedPred && !m_param->bEnableWeightedBiPred)
+        return;
+
+    Frame *nonB = list[bframes];
+    int bref = -1;
+    for (int i = 0; i < bframes; i++)
+    {
+        if (list[i]->m_lowres.sliceType == X265_TYPE_BREF)
+            bref = i;
+    }
+
+    for (int i = 0; i <= bframes; i++)
+    {
+        Frame *pic = list[i];
+        int type = pic->m_lowres.sliceType;
+
+        pic->m_weightRef[0] = pic->m_weightRef[1] = NULL;
+        if (type == X265_TYPE_P && m_param->bEnableWeightedPred)
+            pic->m_weightRef[0] = prevNonB;
+        else if (IS_X265_TYPE_B(type) && m_param->bEnableWeightedBiPred)
+        {
+            pic->m_weightRef[0] = bref >= 0 && i > bref ? list[bref] : prevNonB;
+            pic->m_weightRef[1] = bref >= 0 && i < bref ? list[bref] : nonB;
+        }
+        if (!pic->m_weightRef[0])
+            continue;
+
+        for (int l = 0; l < 2; l++)
+        {
+            Frame *ref = pic->m_weightRef[l];
+            pic->m_weightRefPoc[l] = ref ? ref->getPOC() : -1;
+
+            /* extended here, where no analysis using the reference can run */
+            if (ref)
+                extendWeightRef(*ref);
+        }
+
+        pic->m_weightNext = NULL;
+        pic->m_weightState = Frame::WEIGHTS_QUEUED;
+
+        m_weightLock.acquire();
+        if (m_weightQueueTail)
+            m_weightQueueTail->m_weightNext = pic;
+        else
+            m_weightQueueHead = pic;
+        m_weightQueueTail = pic;
+        m_weightLock.release();
+    }
+
+    if (m_pool && m_weightQueueHead)
+        m_pool->pokeIdleThread();
+}
+
+void Lookahead::weightAnalysis(Frame *pic)
+{
+    int numPredDir = pic->m_weightRef[1] ? 2 : 1;
+
+    pic->m_bWeightsValid = weightAnalyse(*pic, pic->m_weightRef, numPredDir, *m_param, pic->m_weights);
+    pic->m_weightState = Frame::WEIGHTS_DONE;
+    pic->m_weightsDone.trigger();
+}
+
+/* Called before a frame leaves the lookahead. Performs its weightp analysis
+ * if no worker thread has started it, else waits for the worker */
+void Lookahead::finishWeightAnalysis(Frame *pic)
+{
+    if (pic->m_weightState == Frame::WEIGHTS_NONE || pic->m_weightState == Frame::WEIGHTS_DONE)
+        return;
+
+    bool bRun = false;
+    m_weightLock.acquire();
+    if (pic->m_weightState == Frame::WEIGHTS_QUEUED)
+    {
+        /* unlink from the queue */
+        Frame *prev = NULL;
+        for (Frame *f = m_weightQueueHead; f; prev = f, f = f->m_weightNext)
+        {
+            if (f == pic)
+            {
+                if (prev)
+                    prev->m_weightNext = pic->m_weightNext;
+                else
+                    m_weightQueueHead = pic->m_weightNext;
+                if (m_weightQueueTail == pic)
+                    m_weightQueueTail = prev;
+                break;
+            }
+        }
+
+        pic->m_weightState = Frame::WEIGHTS_ACTIVE;
+        bRun = true;
+    }
+    m_weightLock.release();
+
+    if (bRun)
+        weightAnalysis(pic);
     else
-        return false;
+    {
+        while (pic->m_weightState != Frame::WEIGHTS_DONE)
+            pic->m_weightsDone.wait();
+    }
 }
 
 /* Called by rate-control to calculate the estimated SATD cost for a given
@@ -250,6 +394,10 @@ void Lookahead::getEstimatedPictureCost(Frame *pic)
     else
         pic->m_lowres.satdCost = pic->m_lowres.costEst[b - p0][p1 - b];
 
+    /* expose the lowres block costs of the chosen references to analysis */
+    if (pic->m_lowres.costEst[b - p0][p1 - b] >= 0)
+        pic->m_lowres.lowresCostForRc = pic->m_lowres.lowresCosts[b - p0][p1 - b];
+
     if (m_param->rc.vbvBufferSize && m_param->rc.vbvMaxBitrate)
     {
         /* aggregate lowres row satds to CTU resolution */
@@ -325,7 +473,11 @@ void Lookahead::slicetypeDecide()
     m_inputQueueLock.release();
 
     if (!m_est.m_rows && list[0])
-        m_est.init(m_param, list[0]);
+    {
+        m_est.init(m_param, list[0], false);
+        if (m_param->bLookaheadQres)
+            m_qest.init(m_param, list[0], true);
+    }
 
     if (m_param->rc.bStatRead)
     {
@@ -416,7 +568,9 @@ void Lookahead::slicetypeDecide()
     if (bframes)
         list[bframes - 1]->m_lowres.bLastMiniGopBFrame = true;
     list[bframes]->m_lowres.leadingBframes = bframes;
+    Frame *prevNonB = m_lastNonBPic;
     m_lastNonB = &list[bframes]->m_lowres;
+    m_lastNonBPic = list[bframes];
     m_histogram[bframes]++;
 
     /* insert a bref into the sequence */
@@ -461,6 +615,8 @@ void Lookahead::slicetypeDecide()
         }
     }
 
+    queueWeightAnalysis(list, bframes, prevNonB);
+
     m_inputQueueLock.acquire();
 
     /* dequeue all frames from inputQueue that are about to be enqueued
@@ -607,7 +763,6 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
 {
     int numFrames, origNumFrames, keyintLimit, framecnt;
     int maxSearch = X265_MIN(m_param->lookaheadDepth, X265_LOOKAHEAD_MAX);
-    int cuCount = NUM_CUS;
     int resetStart;
     bool bIsVbvLookahead = m_param->rc.vbvBufferSize && m_param->lookaheadDepth;
 
@@ -622,7 +777,23 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
     if (!framecnt)
     {
         if (m_param->rc.cuTree)
-            cuTree(frames, 0, bKeyframe);
+        {
+            /* The frame types were forced by the user or by an analysis file.
+             * Propagate over the forced frames up to the next keyframe, as long
+             * as their B-frame runs fit the lowres cost arrays */
+            int numForced = 0;
+            for (int j = 1, numB = 0; j <= maxSearch && frames[j] && frames[j]->sliceType != X265_TYPE_AUTO; j++)
+            {
+                if (j > 1 && IS_X265_TYPE_I(frames[j]->sliceType))
+                    break;
+                numB = IS_X265_TYPE_B(frames[j]->sliceType) ? numB + 1 : 0;
+                if (numB > m_param->bframes)
+                    break;
+                numForced = j;
+            }
+
+            cuTree(frames, X265_MIN(numForced, m_param->keyframeMax), bKeyframe);
+        }
         return;
     }
 
@@ -641,9 +812,37 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
         return;
     }
 
+    /* With --lookahead-qres the slice types are decided on the quarter
+     * resolution copies of the frames. cuTree and the VBV lookahead then
+     * estimate only the chosen frame pairs at lowres */
+    Lowres *qframes[X265_LOOKAHEAD_MAX];
+    Lowres **decideFrames = frames;
+    m_decideEst = &m_est;
+    if (m_param->bLookaheadQres)
+    {
+        for (int j = 0; j <= framecnt; j++)
+        {
+            Lowres *qres = frames[j]->qres;
+            qres->sliceType = frames[j]->sliceType;
+            for (int i = 0; i < 3; i++)
+            {
+                /* a quarter of the samples, the weightp means must not change */
+                qres->wp_sum[i] = frames[j]->wp_sum[i] >> 2;
+                qres->wp_ssd[i] = frames[j]->wp_ssd[i] >> 2;
+            }
+
+            qframes[j] = qres;
+        }
+
+        qframes[framecnt + 1] = NULL;
+        decideFrames = qframes;
+        m_decideEst = &m_qest;
+    }
+
+    int cuCount = m_decideEst->scoredCUCount();
     int numBFrames = 0;
     int numAnalyzed = numFrames;
-    if (m_param->scenecutThreshold && scenecut(frames, 0, 1, true, origNumFrames, maxSearch))
+    if (m_param->scenecutThreshold && scenecut(decideFrames, 0, 1, true, origNumFrames, maxSearch))
     {
         frames[1]->sliceType = X265_TYPE_I;
         return;
@@ -661,7 +860,7 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
                 /* Perform the frametype analysis. */
                 for (int j = 2; j <= numFrames; j++)
                 {
-                    slicetypePath(frames, j, best_paths);
+                    slicetypePath(decideFrames, j, best_paths);
                 }
 
                 numBFrames = (int)strspn(best_paths[best_path_index], "B");
@@ -669,10 +868,10 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
                 /* Load the results of the analysis into the frame types. */
                 for (int j = 1; j < numFrames; j++)
                 {
-                    frames[j]->sliceType = best_paths[best_path_index][j - 1] == 'B' ? X265_TYPE_B : X265_TYPE_P;
+                    decideFrames[j]->sliceType = best_paths[best_path_index][j - 1] == 'B' ? X265_TYPE_B : X265_TYPE_P;
                 }
             }
-            frames[numFrames]->sliceType = X265_TYPE_P;
+            decideFrames[numFrames]->sliceType = X265_TYPE_P;
         }
         else if (m_param->bFrameAdaptive == X265_B_ADAPT_FAST)
         {
@@ -680,22 +879,22 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
 
             for (int i = 0; i <= numFrames - 2; )
             {
-                cost2p1 = m_est.estimateFrameCost(frames, i + 0, i + 2, i + 2, 1);
-                if (frames[i + 2]->intraMbs[2] > cuCount / 2)
+                cost2p1 = m_decideEst->estimateFrameCost(decideFrames, i + 0, i + 2, i + 2, 1);
+                if (decideFrames[i + 2]->intraMbs[2] > cuCount / 2)
                 {
-                    frames[i + 1]->sliceType = X265_TYPE_P;
-                    frames[i + 2]->sliceType = X265_TYPE_P;
+                    decideFrames[i + 1]->sliceType = X265_TYPE_P;
+                    decideFrames[i + 2]->sliceType = X265_TYPE_P;
                     i += 2;
                     continue;
                 }
 
-                cost1b1 = m_est.estimateFrameCost(frames, i + 0, i + 2, i + 1, 0);
-                cost1p0 = m_est.estimateFrameCost(frames, i + 0, i + 1, i + 1, 0);
-                cost2p0 = m_est.estimateFrameCost(frames, i + 1, i + 2, i + 2, 0);
+                cost1b1 = m_decideEst->estimateFrameCost(decideFrames, i + 0, i + 2, i + 1, 0);
+                cost1p0 = m_decideEst->estimateFrameCost(decideFrames, i + 0, i + 1, i + 1, 0);
+                cost2p0 = m_decideEst->estimateFrameCost(decideFrames, i + 1, i + 2, i + 2, 0);
 
                 if (cost1p0 + cost2p0 < cost1b1 + cost2p1)
                 {
-                    frames[i + 1]->sliceType = X265_TYPE_P;
+                    decideFrames[i + 1]->sliceType = X265_TYPE_P;
                     i += 1;
                     continue;
                 }
@@ -703,24 +902,24 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
 // arbitrary and untuned
 #define INTER_THRESH 300
 #define P_SENS_BIAS (50 - m_param->bFrameBias)
-                frames[i + 1]->sliceType = X265_TYPE_B;
+                decideFrames[i + 1]->sliceType = X265_TYPE_B;
 
                 int j;
                 for (j = i + 2; j <= X265_MIN(i + m_param->bframes, numFrames - 1); j++)
                 {
                     int64_t pthresh = X265_MAX(INTER_THRESH - P_SENS_BIAS * (j - i - 1), INTER_THRESH / 10);
-                    int64_t pcost = m_est.estimateFrameCost(frames, i + 0, j + 1, j + 1, 1);
-                    if (pcost > pthresh * cuCount || frames[j + 1]->intraMbs[j - i + 1] > cuCount / 3)
+                    int64_t pcost = m_decideEst->estimateFrameCost(decideFrames, i + 0, j + 1, j + 1, 1);
+                    if (pcost > pthresh * cuCount || decideFrames[j + 1]->intraMbs[j - i + 1] > cuCount / 3)
                         break;
-                    frames[j]->sliceType = X265_TYPE_B;
+                    decideFrames[j]->sliceType = X265_TYPE_B;
                 }
 
-                frames[j]->sliceType = X265_TYPE_P;
+                decideFrames[j]->sliceType = X265_TYPE_P;
                 i = j;
             }
-            frames[numFrames]->sliceType = X265_TYPE_P;
+            decideFrames[numFrames]->sliceType = X265_TYPE_P;
             numBFrames = 0;
-            while (numBFrames < numFrames && frames[numBFrames + 1]->sliceType == X265_TYPE_B)
+            while (numBFrames < numFrames && decideFrames[numBFrames + 1]->sliceType == X265_TYPE_B)
             {
                 numBFrames++;
             }
@@ -730,23 +929,29 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
             numBFrames = X265_MIN(numFrames - 1, m_param->bframes);
             for (int j = 1; j < numFrames; j++)
             {
-                frames[j]->sliceType = (j % (numBFrames + 1)) ? X265_TYPE_B : X265_TYPE_P;
+                decideFrames[j]->sliceType = (j % (numBFrames + 1)) ? X265_TYPE_B : X265_TYPE_P;
             }
 
-            frames[numFrames]->sliceType = X265_TYPE_P;
+            decideFrames[numFrames]->sliceType = X265_TYPE_P;
         }
         /* Check scenecut on the first minigop. */
         for (int j = 1; j < numBFrames + 1; j++)
         {
-            if (m_param->scenecutThreshold && scenecut(frames, j, j + 1, false, origNumFrames, maxSearch))
+            if (m_param->scenecutThreshold && scenecut(decideFrames, j, j + 1, false, origNumFrames, maxSearch))
             {
-                frames[j]->sliceType = X265_TYPE_P;
+                decideFrames[j]->sliceType = X265_TYPE_P;
                 numAnalyzed = j;
                 break;
             }
         }
 
         resetStart = bKeyframe ? 1 : X265_MIN(numBFrames + 2, numAnalyzed + 1);
+
+        if (decideFrames != frames)
+        {
+            for (int j = 1; j <= numFrames; j++)
+                frames[j]->sliceType = decideFrames[j]->sliceType;
+        }
     }
     else
     {
@@ -828,7 +1033,7 @@ bool Lookahead::scenecutInternal(Lowres **frames, int p0, int p1, bool bRealScen
 {
     Lowres *frame = frames[p1];
 
-    m_est.estimateFrameCost(frames, p0, p1, p1, 0);
+    m_decideEst->estimateFrameCost(frames, p0, p1, p1, 0);
 
     int64_t icost = frame->costEst[0][0];
     int64_t pcost = frame->costEst[p1 - p0][0];
@@ -857,7 +1062,7 @@ bool Lookahead::scenecutInternal(Lowres **frames, int p0, int p1, bool bRealScen
     if (res && bRealScenecut)
     {
         int imb = frame->intraMbs[p1 - p0];
-        int pmb = NUM_CUS - imb;
+        int pmb = m_decideEst->scoredCUCount() - imb;
         x265_log(m_param, X265_LOG_DEBUG, "scene cut at %d Icost:%d Pcost:%d ratio:%.4f bias:%.4f gop:%d (imb:%d pmb:%d)\n",
                  frame->frameNum, icost, pcost, 1. - (double)pcost / icost, bias, gopSize, imb, pmb);
     }
@@ -910,7 +1115,7 @@ int64_t Lookahead::slicetypePathCost(Lowres **frames, char *path, int64_t thresh
         }
 
         /* Add the cost of the P-frame found above */
-        cost += m_est.estimateFrameCost(frames, cur_p, next_p, next_p, 0);
+        cost += m_decideEst->estimateFrameCost(frames, cur_p, next_p, next_p, 0);
         /* Early terminate if the cost we have found is larger than the best path cost so far */
         if (cost > threshold)
             break;
@@ -918,22 +1123,22 @@ int64_t Lookahead::slicetypePathCost(Lowres **frames, char *path, int64_t thresh
         if (m_param->bBPyramid && next_p - cur_p > 2)
         {
             int middle = cur_p + (next_p - cur_p) / 2;
-            cost += m_est.estimateFrameCost(frames, cur_p, next_p, middle, 0);
+            cost += m_decideEst->estimateFrameCost(frames, cur_p, next_p, middle, 0);
             for (int next_b = loc; next_b < middle && cost < threshold; next_b++)
             {
-                cost += m_est.estimateFrameCost(frames, cur_p, middle, next_b, 0);
+                cost += m_decideEst->estimateFrameCost(frames, cur_p, middle, next_b, 0);
             }
 
             for (int next_b = middle + 1; next_b < next_p && cost < threshold; next_b++)
             {
-                cost += m_est.estimateFrameCost(frames, middle, next_p, next_b, 0);
+                cost += m_decideEst->estimateFrameCost(frames, middle, next_p, next_b, 0);
             }
         }
         else
         {
             for (int next_b = loc; next_b < next_p && cost < threshold; next_b++)
             {
-                cost += m_est.estimateFrameCost(frames, cur_p, next_p, next_b, 0);
+                cost += m_decideEst->estimateFrameCost(frames, cur_p, next_p, next_b, 0);
             }
         }
 
@@ -965,7 +1170,7 @@ void Lookahead::cuTree(Lowres **frames, int numframes, bool bIntra)
     if (bIntra)
         m_est.estimateFrameCost(frames, 0, 0, 0, 0);
 
-    while (i > 0 && frames[i]->sliceType == X265_TYPE_B)
+    while (i > 0 && IS_X265_TYPE_B(frames[i]->sliceType))
     {
         i--;
     }
@@ -996,7 +1201,7 @@ void Lookahead::cuTree(Lowres **frames, int numframes, bool bIntra)
     while (i-- > idx)
     {
         curnonb = i;
-        while (frames[curnonb]->sliceType == X265_TYPE_B && curnonb > 0)
+        while (IS_X265_TYPE_B(frames[curnonb]->sliceType) && curnonb > 0)
         {
             curnonb--;
         }
@@ -1053,99 +1258,13 @@ void Lookahead::cuTree(Lowres **frames, int numframes, bool bIntra)
 
 void Lookahead::estimateCUPropagate(Lowres **frames, double averageDuration, int p0, int p1, int b, int referenced)
 {
-    uint16_t *refCosts[2] = { frames[p0]->propagateCost, frames[p1]->propagateCost };
     int32_t distScaleFactor = (((b - p0) << 8) + ((p1 - p0) >> 1)) / (p1 - p0);
     int32_t bipredWeight = m_param->bEnableWeightedBiPred ? 64 - (distScaleFactor >> 2) : 32;
-    MV *mvs[2] = { frames[b]->lowresMvs[0][b - p0 - 1], frames[b]->lowresMvs[1][p1 - b - 1] };
-    int32_t bipredWeights[2] = { bipredWeight, 64 - bipredWeight };
-
-    memset(m_scratch, 0, m_widthInCU * sizeof(int));
-
-    uint16_t *propagateCost = frames[b]->propagateCost;
 
     x265_emms();
     double fpsFactor = CLIP_DURATION((double)m_param->fpsDenom / m_param->fpsNum) / CLIP_DURATION(averageDuration);
 
-    /* For non-refferd frames the source costs are always zero, so just memset one row and re-use it. */
-    if (!referenced)
-        memset(frames[b]->propagateCost, 0, m_widthInCU * sizeof(uint16_t));
-
-    int32_t StrideInCU = m_widthInCU;
-    for (uint16_t blocky = 0; blocky < m_heightInCU; blocky++)
-    {
-        int cuIndex = blocky * StrideInCU;
-        primitives.propagateCost(m_scratch, propagateCost,
-                                 frames[b]->intraCost + cuIndex, frames[b]->lowresCosts[b - p0][p1 - b] + cuIndex,
-                                 frames[b]->invQscaleFactor + cuIndex, &fpsFactor, m_widthInCU);
-
-        if (referenced)
-            propagateCost += m_widthInCU;
-        for (uint16_t blockx = 0; blockx < m_widthInCU; blockx++, cuIndex++)
-        {
-            int32_t propagate_amount = m_scratch[blockx];
-            /* Don't propagate for an intra block. */
-            if (propagate_amount > 0)
-            {
-                /* Access width-2 bitfield. */
-                int32_t lists_used = frames[b]->lowresCosts[b - p0][p1 - b][cuIndex] >> LOWRES_COST_SHIFT;
-                /* Follow the MVs to the previous frame(s). */
-                for (uint16_t list = 0; list < 2; list++)
-                {
-                    if ((lists_used >> list) & 1)
-                    {
-#define CLIP_ADD(s, x) (s) = (uint16_t)X265_MIN((s) + (x), (1 << 16) - 1)
-                        int32_t listamount = propagate_amount;
-                        /* Apply bipred weighting. */
-                        if (lists_used == 3)
-                            listamount = (listamount * bipredWeights[list] + 32) >> 6;
-
-                        /* Early termination for simple case of mv0. */
-                        if (!mvs[list][cuIndex].word)
-                        {
-                            CLIP_ADD(refCosts[list][cuIndex], listamount);
-                            continue;
-                        }
-
-                        int32_t x = mvs[list][cuIndex].x;
-                        int32_t y = mvs[list][cuIndex].y;
-                        int32_t cux = (x >> 5) + blockx;
-                        int32_t cuy = (y >> 5) + blocky;
-                        int32_t idx0 = cux + cuy * StrideInCU;
-                        int32_t idx1 = idx0 + 1;
-                        int32_t idx2 = idx0 + StrideInCU;
-                        int32_t idx3 = idx0 + StrideInCU + 1;
-                        x &= 31;
-                        y &= 31;
-                        int32_t idx0weight = (32 - y) * (32 - x);
-                        int32_t idx1weight = (32 - y) * x;
-                        int32_t idx2weight = y * (32 - x);
-                        int32_t idx3weight = y * x;
-
-                        /* We could just clip the MVs, but pixels that lie outside the frame probably shouldn't
-                         * be counted. */
-                        if (cux < m_widthInCU - 1 && cuy < m_heightInCU - 1 && cux >= 0 && cuy >= 0)
-                        {
-                            CLIP_ADD(refCosts[list][idx0], (listamount * idx0weight + 512) >> 10);
-                            CLIP_ADD(refCosts[list][idx1], (listamount * idx1weight + 512) >> 10);
-                            CLIP_ADD(refCosts[list][idx2], (listamount * idx2weight + 512) >> 10);
-                            CLIP_ADD(refCosts[list][idx3], (listamount * idx3weight + 512) >> 10);
-                        }
-                        else /* Check offsets individually */
-                        {
-                            if (cux < m_widthInCU && cuy < m_heightInCU && cux >= 0 && cuy >= 0)
-                                CLIP_ADD(refCosts[list][idx0], (listamount * idx0weight + 512) >> 10);
-                            if (cux + 1 < m_widthInCU && cuy < m_heightInCU && cux + 1 >= 0 && cuy >= 0)
-                                CLIP_ADD(refCosts[list][idx1], (listamount * idx1weight + 512) >> 10);
-                            if (cux < m_widthInCU && cuy + 1 < m_heightInCU && cux >= 0 && cuy + 1 >= 0)
-                                CLIP_ADD(refCosts[list][idx2], (listamount * idx2weight + 512) >> 10);
-                            if (cux + 1 < m_widthInCU && cuy + 1 < m_heightInCU && cux + 1 >= 0 && cuy + 1 >= 0)
-                                CLIP_ADD(refCosts[list][idx3], (listamount * idx3weight + 512) >> 10);
-                        }
-                    }
-                }
-            }
-        }
-    }
+    m_propagate.propagate(frames, fpsFactor, bipredWeight, p0, p1, b, !!referenced);
 
     if (m_param->rc.vbvBufferSize && m_param->lookaheadDepth && referenced)
         cuTreeFinish(frames[b], averageDuration, b == p1 ? b - p0 : 0);
@@ -1208,6 +1327,163 @@ int64_t Lookahead::frameCostRecalculate(Lowres** frames, int p0, int p1, int b)
     return score;
 }
 
+CostPropagate::CostPropagate(ThreadPool *p)
+    : WaveFront(p)
+{
+    m_widthInCU = m_heightInCU = 0;
+    m_amounts = NULL;
+    m_lists[0] = m_lists[1] = NULL;
+    m_rowsCompleted = 0;
+    m_fenc = NULL;
+    m_lowresCosts = NULL;
+    m_mvs[0] = m_mvs[1] = NULL;
+    m_listWeight[0] = m_listWeight[1] = 32;
+    m_bListUsed[0] = m_bListUsed[1] = false;
+    m_bReferenced = false;
+    m_fpsFactor = 0;
+}
+
+CostPropagate::~CostPropagate()
+{
+    x265_free(m_amounts);
+    x265_free(m_lists[0]);
+    x265_free(m_lists[1]);
+}
+
+bool CostPropagate::init(int widthInCU, int heightInCU)
+{
+    m_widthInCU = widthInCU;
+    m_heightInCU = heightInCU;
+
+    int cuCount = m_widthInCU * m_heightInCU;
+    CHECKED_MALLOC(m_amounts, int, cuCount);
+    CHECKED_MALLOC(m_lists[0], int32_t, 6 * cuCount);
+    CHECKED_MALLOC(m_lists[1], int32_t, 6 * cuCount);
+
+    /* without the row bitmaps the rows are processed serially */
+    if (!WaveFront::init(m_heightInCU))
+        m_pool = NULL;
+    else
+        WaveFront::enableAllRows();
+    return true;
+
+fail:
+    return false;
+}
+
+void CostPropagate::propagate(Lowres **frames, double fpsFactor, int bipredWeight, int p0, int p1, int b, bool bReferenced)
+{
+    m_fenc = frames[b];
+    m_lowresCosts = frames[b]->lowresCosts[b - p0][p1 - b];
+    m_bListUsed[0] = b != p0;
+    m_bListUsed[1] = b != p1;
+    m_mvs[0] = m_bListUsed[0] ? frames[b]->lowresMvs[0][b - p0 - 1] : NULL;
+    m_mvs[1] = m_bListUsed[1] ? frames[b]->lowresMvs[1][p1 - b - 1] : NULL;
+    m_listWeight[0] = bipredWeight;
+    m_listWeight[1] = 64 - bipredWeight;
+    m_bReferenced = bReferenced;
+    m_fpsFactor = fpsFactor;
+
+    /* For non-referenced frames the source costs are always zero, so just memset one row and re-use it. */
+    if (!bReferenced)
+        memset(frames[b]->propagateCost, 0, m_widthInCU * sizeof(uint16_t));
+
+    m_rowsCompleted = 0;
+
+    if (m_pool)
+    {
+        WaveFront::enqueue();
+
+        // the rows have no dependencies on each other
+        for (int row = 0; row < m_heightInCU; row++)
+            enqueueRow(row);
+
+        while (m_rowsCompleted < m_heightInCU)
+            WaveFront::findJob(-1);
+
+        WaveFront::dequeue();
+    }
+    else
+    {
+        for (int row = 0; row < m_heightInCU; row++)
+            processRow(row, -1);
+    }
+
+    if (m_bListUsed[0])
+        accumulate(frames[p0]->propagateCost, 0);
+    if (m_bListUsed[1])
+        accumulate(frames[p1]->propagateCost, 1);
+}
+
+void CostPropagate::processRow(int row, int /*threadId*/)
+{
+    int cuIndex = row * m_widthInCU;
+    uint16_t *propagateIn = m_fenc->propagateCost + (m_bReferenced ? cuIndex : 0);
+
+    primitives.propagateCost(m_amounts + cuIndex, propagateIn, m_fenc->intraCost + cuIndex, m_lowresCosts + cuIndex,
+                             m_fenc->invQscaleFactor + cuIndex, &m_fpsFactor, m_widthInCU);
+
+    /* Follow the MVs to the previous frame(s). */
+    for (int list = 0; list < 2; list++)
+    {
+        if (m_bListUsed[list])
+            primitives.propagateList(m_lists[list] + 6 * cuIndex, m_amounts + cuIndex, m_lowresCosts + cuIndex,
+                                     (int16_t(*)[2])(m_mvs[list] + cuIndex), m_listWeight[list], list, row, m_widthInCU);
+    }
+
+    x265_emms();
+    ATOMIC_INC(&m_rowsCompleted);
+}
+
+/* Add the amounts of each row to the propagate costs of the reference of the
+ * list. The additions saturate at the uint16_t range, so they are done by a
+ * single thread in raster order */
+void CostPropagate::accumulate(uint16_t *refCosts, int list)
+{
+#define CLIP_ADD(s, x) (s) = (uint16_t)X265_MIN((s) + (x), (1 << 16) - 1)
+    int stride = m_widthInCU;
+
+    for (int row = 0; row < m_heightInCU; row++)
+    {
+        const int32_t *posX = m_lists[list] + 6 * row * stride;
+        const int32_t *posY = posX + stride;
+        const int32_t *amount0 = posX + 2 * stride, *amount1 = posX + 3 * stride;
+        const int32_t *amount2 = posX + 4 * stride, *amount3 = posX + 5 * stride;
+
+        for (int i = 0; i < stride; i++)
+        {
+            if (!(amount0[i] | amount1[i] | amount2[i] | amount3[i]))
+                continue;
+
+            int32_t cux = posX[i];
+            int32_t cuy = posY[i];
+            int32_t idx0 = cux + cuy * stride;
+
+            /* We could just clip the MVs, but pixels that lie outside the frame probably shouldn't
+             * be counted. */
+            if (cux < m_widthInCU - 1 && cuy < m_heightInCU - 1 && cux >= 0 && cuy >= 0)
+            {
+                CLIP_ADD(refCosts[idx0], amount0[i]);
+                CLIP_ADD(refCosts[idx0 + 1], amount1[i]);
+                CLIP_ADD(refCosts[idx0 + stride], amount2[i]);
+                CLIP_ADD(refCosts[idx0 + stride + 1], amount3[i]);
+            }
+            else /* Check offsets individually */
+            {
+                if (cux < m_widthInCU && cuy < m_heightInCU && cux >= 0 && cuy >= 0)
+                    CLIP_ADD(refCosts[idx0], amount0[i]);
+                if (cux + 1 < m_widthInCU && cuy < m_heightInCU && cux + 1 >= 0 && cuy >= 0)
+                    CLIP_ADD(refCosts[idx0 + 1], amount1[i]);
+                if (cux < m_widthInCU && cuy + 1 < m_heightInCU && cux >= 0 && cuy + 1 >= 0)
+                    CLIP_ADD(refCosts[idx0 + stride], amount2[i]);
+                if (cux + 1 < m_widthInCU && cuy + 1 < m_heightInCU && cux + 1 >= 0 && cuy + 1 >= 0)
+                    CLIP_ADD(refCosts[idx0 + stride + 1], amount3[i]);
+            }
+        }
+    }
+#undef CLIP_ADD
+}
+
 CostEstimate::CostEstimate(ThreadPool *p)
     : WaveFront(p)
 {
@@ -1231,11 +1507,12 @@ CostEstimate::~CostEstimate()
     delete[] m_rows;
 }
 
-void CostEstimate::init(x265_param *_param, Frame *pic)
+void CostEstimate::init(x265_param *_param, Frame *pic, bool bQres)
 {
     m_param = _param;
-    m_widthInCU = ((m_param->sourceWidth / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
-    m_heightInCU = ((m_param->sourceHeight / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
+    Lowres& lowres = bQres ? *pic->m_lowres.qres : pic->m_lowres;
+    m_widthInCU = lowres.width >> X265_LOWRES_CU_BITS;
+    m_heightInCU = lowres.lines >> X265_LOWRES_CU_BITS;
 
     m_rows = new EstimateRow[m_heightInCU];
     for (int i = 0; i < m_heightInCU; i++)
@@ -1257,23 +1534,30 @@ void CostEstimate::init(x265_param *_param, Frame *pic)
     if (m_param->bEnableWeightedPred)
     {
         TComPicYuv *orig = pic->getPicYuvOrg();
-        m_paddedLines = pic->m_lowres.lines + 2 * orig->getLumaMarginY();
-        int padoffset = pic->m_lowres.lumaStride * orig->getLumaMarginY() + orig->getLumaMarginX();
+        m_paddedLines = lowres.lines + 2 * orig->getLumaMarginY();
+        int padoffset = lowres.lumaStride * orig->getLumaMarginY() + orig->getLumaMarginX();
 
         /* allocate weighted lowres buffers */
         for (int i = 0; i < 4; i++)
         {
-            m_wbuffer[i] = (pixel*)x265_malloc(sizeof(pixel) * (pic->m_lowres.lumaStride * m_paddedLines));
+            m_wbuffer[i] = (pixel*)x265_malloc(sizeof(pixel) * (lowres.lumaStride * m_paddedLines));
             m_weightedRef.lowresPlane[i] = m_wbuffer[i] + padoffset;
         }
 
         m_weightedRef.fpelPlane = m_weightedRef.lowresPlane[0];
-        m_weightedRef.lumaStride = pic->m_lowres.lumaStride;
+        m_weightedRef.lumaStride = lowres.lumaStride;
         m_weightedRef.isLowres = true;
         m_weightedRef.isWeighted = false;
     }
 }
 
+/* number of CUs which contribute to the frame costs, the edge CUs of
+ * frames larger than 2x2 CUs are not scored */
+int CostEstimate::scoredCUCount() const
+{
+    return NUM_CUS;
+}
+
 int64_t CostEstimate::estimateFrameCost(Lowres **frames, int p0, int p1, int b, bool bIntraPenalty)
 {
     int64_t score = 0;
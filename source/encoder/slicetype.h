@@ -45,6 +45,17 @@ class Frame;
         (w).bPresentFlag = b; \
     }
 
+class Slice;
+
+/* weighted prediction analysis (weightPrediction.cpp). The first form
+ * estimates the weights of the nearest reference of each list, the second
+ * analyses and sets the weights of a slice. extendWeightRef() prepares the
+ * chroma planes of a reference for motion compensation by the analysis */
+bool weightAnalyse(Frame& frame, Frame* refs[2], int numPredDir, x265_param& param, WeightParam wp[2][3]);
+void weightAnalyse(Slice& slice, x265_param& param);
+void setWeights(Slice& slice, WeightParam wp[2][3], x265_param& param);
+void extendWeightRef(Frame& ref);
+
 class EstimateRow
 {
 public:
@@ -95,7 +106,7 @@ class CostEstimate : public WaveFront
 public:
     CostEstimate(ThreadPool *p);
     ~CostEstimate();
-    void init(x265_param *, Frame *);
+    void init(x265_param *, Frame *, bool bQres);
 
     x265_param      *m_param;
     EstimateRow     *m_rows;
@@ -115,6 +126,7 @@ public:
 
     void     processRow(int row, int threadId);
     int64_t  estimateFrameCost(Lowres **frames, int p0, int p1, int b, bool bIntraPenalty);
+    int      scoredCUCount() const;
 
 protected:
 
@@ -122,22 +134,59 @@ protected:
     uint32_t weightCostLuma(Lowres **frames, int b, int p0, WeightParam *w);
 };
 
+/* CostPropagate runs the cuTree propagation of a single frame, ie:
+ * estimateCUPropagate(). The rows of the frame compute their propagate
+ * amounts and split them between the CUs of the references into per-row
+ * buffers, in parallel when there is a thread pool, then the buffers are
+ * accumulated into the propagate costs of the references in row order */
+class CostPropagate : public WaveFront
+{
+public:
+    CostPropagate(ThreadPool *p);
+    ~CostPropagate();
+    bool init(int widthInCU, int heightInCU);
+
+    int              m_widthInCU;
+    int              m_heightInCU;
+
+    int             *m_amounts;         // propagate amount of each CU
+    int32_t         *m_lists[2];        // per list, six rows of m_widthInCU entries per CU row, see propagateList
+    volatile int     m_rowsCompleted;
+
+    Lowres          *m_fenc;
+    uint16_t        *m_lowresCosts;
+    MV              *m_mvs[2];
+    int              m_listWeight[2];
+    bool             m_bListUsed[2];
+    bool             m_bReferenced;
+    double           m_fpsFactor;
+
+    void     propagate(Lowres **frames, double fpsFactor, int bipredWeight, int p0, int p1, int b, bool bReferenced);
+    void     processRow(int row, int threadId);
+
+protected:
+
+    void     accumulate(uint16_t *refCosts, int list);
+};
+
 class Lookahead : public JobProvider
 {
 public:
 
     Lookahead(x265_param *param, ThreadPool *pool, Encoder* enc);
     ~Lookahead();
-    void init();
+    bool init();
     void destroy();
 
     CostEstimate     m_est;             // Frame cost estimator
+    CostEstimate     m_qest;            // Quarter resolution frame cost estimator (--lookahead-qres)
+    CostEstimate    *m_decideEst;       // estimator of the slice type decisions, m_est or m_qest
+    CostPropagate    m_propagate;       // cuTree propagation of a frame
     PicList          m_inputQueue;      // input pictures in order received
     PicList          m_outputQueue;     // pictures to be encoded, in encode order
 
     x265_param      *m_param;
     Lowres          *m_lastNonB;
-    int             *m_scratch;         // temp buffer
 
     int              m_widthInCU;       // width of lowres frame in downscale CUs
     int              m_heightInCU;      // height of lowres frame in downscale CUs
@@ -156,6 +205,13 @@ protected:
     Lock  m_outputQueueLock;
     Lock  m_decideLock;
     Event m_outputAvailable;
+
+    /* frames waiting for weightp analysis by a worker thread, linked by
+     * Frame::m_weightNext. Protected by m_weightLock */
+    Lock    m_weightLock;
+    Frame*  m_weightQueueHead;
+    Frame*  m_weightQueueTail;
+    Frame*  m_lastNonBPic;      // frame of m_lastNonB
     volatile int  m_bReady;
     volatile bool m_bFilling;
     volatile bool m_bFlushed;
@@ -182,6 +238,11 @@ protected:
 
     /* called by getEstimatedPictureCost() to finalize cuTree costs */
     int64_t frameCostRecalculate(Lowres **frames, int p0, int p1, int b);
+
+    /* weightp analysis of decided frames, ahead of their frame encoders */
+    void queueWeightAnalysis(Frame **list, int bframes, Frame *prevNonB);
+    void finishWeightAnalysis(Frame *pic);
+    void weightAnalysis(Frame *pic);
 };
 }
 
@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_STATSFILE_H
+#define X265_STATSFILE_H
+
+#include <stdint.h>
+
+namespace x265 {
+// private namespace
+
+/* Binary multipass stats file layout, shared by the rate control and the
+ * x265-segment tool. The file holds a header, the NUL terminated options
+ * string of the pass which wrote it, one record per frame in encode order
+ * (each record of a referenced frame followed by its CU-tree qp offsets when
+ * CU-tree was enabled), and finally an index of record offsets in display
+ * order. The file is read through a memory map, so records are only paged in
+ * when a frame looks them up. All fields are in host byte order. */
+
+#define X265_STATS_MAGIC   "x265stat"
+#define X265_STATS_VERSION 1
+
+struct StatsFileHeader
+{
+    char     magic[8];      /* X265_STATS_MAGIC, not NUL terminated */
+    uint32_t version;       /* X265_STATS_VERSION */
+    uint32_t headerSize;    /* sizeof(StatsFileHeader) */
+    uint32_t recordSize;    /* sizeof(StatsFileRecord) */
+    uint32_t numCuTree;     /* qp offsets (int16_t, 8.8 fixed point) following a record with CU-tree data */
+    uint32_t numEntries;    /* frames covered by the index */
+    int32_t  firstFrame;    /* frame number of index entry 0 */
+    uint64_t optionsOffset; /* NUL terminated x265_param2string() of the writer */
+    uint64_t indexOffset;   /* numEntries uint64_t record offsets, 0 for a frame without a record */
+};
+
+struct StatsFileRecord
+{
+    int32_t  frameNumber;   /* display order, "in:" in text stats */
+    int32_t  encodeOrder;   /* "out:" in text stats */
+    double   qpRc;          /* qpRc to skipCuCount are rounded to the two decimals of text stats */
+    double   qpAq;
+    double   iCuCount;
+    double   pCuCount;
+    double   skipCuCount;
+    int32_t  coeffBits;
+    int32_t  mvBits;
+    int32_t  miscBits;
+    char     type;          /* I, i, P, B or b as in text stats */
+    uint8_t  bHasCuTree;
+    uint16_t reserved;
+};
+}
+
+#endif // ifndef X265_STATSFILE_H
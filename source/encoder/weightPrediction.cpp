@@ -220,17 +220,36 @@ uint32_t weightCost(pixel *         fenc,
 }
 
 namespace x265 {
-void weightAnalyse(Slice& slice, x265_param& param)
+/* reference chroma planes must be extended prior to being used as motion
+ * compensation sources */
+void extendWeightRef(Frame& ref)
+{
+    if (ref.m_bChromaPlanesExtended)
+        return;
+
+    ref.m_bChromaPlanesExtended = true;
+    TComPicYuv *refyuv = ref.getPicYuvOrg();
+    int hshift = CHROMA_H_SHIFT(refyuv->m_picCsp);
+    int vshift = CHROMA_V_SHIFT(refyuv->m_picCsp);
+    int stride = refyuv->getCStride();
+    int width = refyuv->getWidth() >> hshift;
+    int height = refyuv->getHeight() >> vshift;
+    int marginX = refyuv->getChromaMarginX();
+    int marginY = refyuv->getChromaMarginY();
+    extendPicBorder(refyuv->getCbAddr(), stride, width, height, marginX, marginY);
+    extendPicBorder(refyuv->getCrAddr(), stride, width, height, marginX, marginY);
+}
+
+bool weightAnalyse(Frame& frame, Frame* refs[2], int numPredDir, x265_param& param, WeightParam wp[2][3])
 {
-    WeightParam wp[2][MAX_NUM_REF][3];
-    TComPicYuv *fencYuv = slice.m_pic->getPicYuvOrg();
-    Lowres& fenc        = slice.m_pic->m_lowres;
+    TComPicYuv *fencYuv = frame.getPicYuvOrg();
+    Lowres& fenc        = frame.m_lowres;
 
     Cache cache;
 
     memset(&cache, 0, sizeof(cache));
     cache.intraCost = fenc.intraCost;
-    cache.numPredDir = slice.isInterP() ? 1 : 2;
+    cache.numPredDir = numPredDir;
     cache.lowresWidthInCU = fenc.width >> 3;
     cache.lowresHeightInCU = fenc.lines >> 3;
     cache.csp = fencYuv->m_picCsp;
@@ -240,14 +259,11 @@ void weightAnalyse(Slice& slice, x265_param& param)
     /* Use single allocation for motion compensated ref and weight buffers */
     pixel *mcbuf = X265_MALLOC(pixel, 2 * fencYuv->getStride() * fencYuv->getHeight());
     if (!mcbuf)
-    {
-        slice.disableWeights();
-        return;
-    }
+        return false;
     pixel *weightTemp = mcbuf + fencYuv->getStride() * fencYuv->getHeight();
 
     int lambda = (int)x265_lambda_tab[X265_LOOKAHEAD_QP];
-    int curPoc = slice.m_poc;
+    int curPoc = frame.getPOC();
     const float epsilon = 1.f / 128.f;
 
     int chromaDenom, lumaDenom, denom;
@@ -260,8 +276,8 @@ void weightAnalyse(Slice& slice, x265_param& param)
 
     for (int list = 0; list < cache.numPredDir; list++)
     {
-        WeightParam *weights = wp[list][0];
-        Frame *refPic = slice.m_refPicList[list][0];
+        WeightParam *weights = wp[list];
+        Frame *refPic = refs[list];
         Lowres& refLowres = refPic->m_lowres;
         int diffPoc = abs(curPoc - refPic->getPOC());
 
@@ -327,22 +343,7 @@ void weightAnalyse(Slice& slice, x265_param& param)
 
                 /* test whether this motion search was performed by lookahead */
                 if (mvs[0].x != 0x7FFF)
-                {
-                    /* reference chroma planes must be extended prior to being
-                     * used as motion compensation sources */
-                    if (!refPic->m_bChromaPlanesExtended)
-                    {
-                        refPic->m_bChromaPlanesExtended = true;
-                        TComPicYuv *refyuv = refPic->getPicYuvOrg();
-                        int stride = refyuv->getCStride();
-                        int width = refyuv->getWidth() >> cache.hshift;
-                        int height = refyuv->getHeight() >> cache.vshift;
-                        int marginX = refyuv->getChromaMarginX();
-                        int marginY = refyuv->getChromaMarginY();
-                        extendPicBorder(refyuv->getCbAddr(), stride, width, height, marginX, marginY);
-                        extendPicBorder(refyuv->getCrAddr(), stride, width, height, marginX, marginY);
-                    }
-                }
+                    extendWeightRef(*refPic);
                 else
                     mvs = 0;
             }
@@ -401,9 +402,8 @@ void weightAnalyse(Slice& slice, x265_param& param)
                 break;
 
             default:
-                slice.disableWeights();
                 X265_FREE(mcbuf);
-                return;
+                return false;
             }
 
             uint32_t origscore = weightCost(orig, fref, weightTemp, stride, cache, width, height, NULL, !plane);
@@ -490,20 +490,31 @@ void weightAnalyse(Slice& slice, x265_param& param)
 
         lumaDenom = weights[0].log2WeightDenom;
         chromaDenom = weights[1].log2WeightDenom;
+    }
 
-        /* reset weight states */
+    X265_FREE(mcbuf);
+    return true;
+}
+
+/* Apply the weights estimated for the nearest reference of each list to the
+ * slice, the other references are not weighted */
+void setWeights(Slice& slice, WeightParam wp[2][3], x265_param& param)
+{
+    int numPredDir = slice.isInterP() ? 1 : 2;
+    for (int list = 0; list < numPredDir; list++)
+    {
+        int lumaDenom = wp[list][0].log2WeightDenom;
+        int chromaDenom = wp[list][1].log2WeightDenom;
+
+        memcpy(slice.m_weightPredTable[list][0], wp[list], sizeof(WeightParam) * 3);
         for (int ref = 1; ref < slice.m_numRefIdx[list]; ref++)
         {
-            SET_WEIGHT(wp[list][ref][0], false, 1 << lumaDenom, lumaDenom, 0);
-            SET_WEIGHT(wp[list][ref][1], false, 1 << chromaDenom, chromaDenom, 0);
-            SET_WEIGHT(wp[list][ref][2], false, 1 << chromaDenom, chromaDenom, 0);
+            SET_WEIGHT(slice.m_weightPredTable[list][ref][0], false, 1 << lumaDenom, lumaDenom, 0);
+            SET_WEIGHT(slice.m_weightPredTable[list][ref][1], false, 1 << chromaDenom, chromaDenom, 0);
+            SET_WEIGHT(slice.m_weightPredTable[list][ref][2], false, 1 << chromaDenom, chromaDenom, 0);
         }
     }
 
-    X265_FREE(mcbuf);
-
-    memcpy(slice.m_weightPredTable, wp, sizeof(WeightParam) * 2 * MAX_NUM_REF * 3);
-
     if (param.logLevel >= X265_LOG_FULL)
     {
         char buf[1024];
@@ -511,10 +522,9 @@ void weightAnalyse(Slice& slice, x265_param& param)
         bool bWeighted = false;
 
         p = sprintf(buf, "poc: %d weights:", slice.m_poc);
-        int numPredDir = slice.isInterP() ? 1 : 2;
         for (int list = 0; list < numPredDir; list++)
         {
-            WeightParam* w = &wp[list][0][0];
+            WeightParam* w = wp[list];
             if (w[0].bPresentFlag || w[1].bPresentFlag || w[2].bPresentFlag)
             {
                 bWeighted = true;
@@ -537,4 +547,16 @@ void weightAnalyse(Slice& slice, x265_param& param)
         }
     }
 }
+
+void weightAnalyse(Slice& slice, x265_param& param)
+{
+    WeightParam wp[2][3];
+    Frame* refs[2] = { slice.m_refPicList[0][0], slice.isInterB() ? slice.m_refPicList[1][0] : NULL };
+    int numPredDir = slice.isInterP() ? 1 : 2;
+
+    if (weightAnalyse(*slice.m_pic, refs, numPredDir, param, wp))
+        setWeights(slice, wp, param);
+    else
+        slice.disableWeights();
+}
 }
@@ -24,9 +24,61 @@
 #include "input.h"
 #include "yuv.h"
 #include "y4m.h"
+#include "common.h"
+
+#if !_WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace x265;
 
+bool InputMap::open(const char *filename)
+{
+    addr = x265_map_file(filename, &size);
+    return !!addr;
+}
+
+void InputMap::close()
+{
+    x265_unmap_file(addr, size);
+    addr = NULL;
+    size = 0;
+}
+
+void InputMap::prefetch(uint64_t offset, uint64_t len)
+{
+#if !_WIN32
+    if (offset >= size)
+        return;
+    len = X265_MIN(len, size - offset);
+
+    /* round outwards to whole pages */
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = offset & ~(page - 1);
+    madvise((void*)(addr + start), (size_t)(offset + len - start), MADV_WILLNEED);
+#else
+    (void)offset;
+    (void)len;
+#endif
+}
+
+void InputMap::discard(uint64_t offset, uint64_t len)
+{
+#if !_WIN32
+    /* round inwards to whole pages, the neighbouring pictures may share the
+     * boundary pages */
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = (offset + page - 1) & ~(page - 1);
+    uint64_t end = X265_MIN(offset + len, (uint64_t)size) & ~(page - 1);
+    if (end > start)
+        madvise((void*)(addr + start), (size_t)(end - start), MADV_DONTNEED);
+#else
+    (void)offset;
+    (void)len;
+#endif
+}
+
 Input* Input::open(InputFileInfo& info, bool bForceY4m)
 {
     const char * s = strrchr(info.filename, '.');
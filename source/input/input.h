@@ -32,6 +32,7 @@
 #define MAX_FRAME_RATE 300
 
 #include "x265.h"
+#include <cstddef>
 
 namespace x265 {
 // private x265 namespace
@@ -51,9 +52,32 @@ struct InputFileInfo
 
     /* user supplied */
     int skipFrames;
+    int queueSize;    // pictures read ahead of the encoder, 0 for the default
+    bool bMemoryMap;  // map a file input into memory instead of reading it
     const char *filename;
 };
 
+/* A file input mapped into memory. Pictures are handed to the encoder in
+ * place, the pages ahead of the reader are prefetched and the pages of
+ * pictures already consumed are released */
+struct InputMap
+{
+    const uint8_t* addr;
+    size_t         size;
+
+    InputMap() : addr(NULL), size(0) {}
+
+    bool open(const char *filename);
+
+    void close();
+
+    /* hint that [offset, offset + len) will be read soon */
+    void prefetch(uint64_t offset, uint64_t len);
+
+    /* hint that [offset, offset + len) will not be read again */
+    void discard(uint64_t offset, uint64_t len);
+};
+
 class Input
 {
 protected:
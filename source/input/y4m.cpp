@@ -43,8 +43,9 @@ static const char header[] = "FRAME";
 
 Y4MInput::Y4MInput(InputFileInfo& info)
 {
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        buf[i] = NULL;
+    queueSize = info.queueSize ? X265_MAX(info.queueSize, 3) : QUEUE_SIZE;
+    buf = NULL;
+    mapPos = 0;
 
     readCount.set(0);
     writeCount.set(0);
@@ -81,16 +82,6 @@ Y4MInput::Y4MInput(InputFileInfo& info)
         }
 
         threadActive = true;
-        for (int q = 0; q < QUEUE_SIZE; q++)
-        {
-            buf[q] = X265_MALLOC(char, framesize);
-            if (!buf[q])
-            {
-                x265_log(NULL, X265_LOG_ERROR, "y4m: buffer allocation failure, aborting");
-                threadActive = false;
-                break;
-            }
-        }
     }
     if (!threadActive)
     {
@@ -141,6 +132,37 @@ Y4MInput::Y4MInput(InputFileInfo& info)
 #endif // if defined(_MSC_VER) && _MSC_VER < 1700
     }
 
+    if (info.bMemoryMap && ifs != &cin)
+    {
+        /* pictures are read in place, no reader thread or buffers needed */
+        istream::pos_type cur = ifs->tellg();
+        if (cur >= 0 && map.open(info.filename))
+        {
+            mapPos = (uint64_t)cur;
+            int skipped = 0;
+            while (skipped < info.skipFrames && mapFrame())
+                skipped++;
+            map.prefetch(mapPos, (uint64_t)estFrameSize * queueSize);
+            return;
+        }
+        x265_log(NULL, X265_LOG_WARNING, "y4m: reading input file instead\n");
+    }
+
+    buf = X265_MALLOC(char*, queueSize);
+    if (buf)
+        memset(buf, 0, sizeof(char*) * queueSize);
+    for (int q = 0; q < queueSize; q++)
+    {
+        if (buf)
+            buf[q] = X265_MALLOC(char, framesize);
+        if (!buf || !buf[q])
+        {
+            x265_log(NULL, X265_LOG_ERROR, "y4m: buffer allocation failure, aborting");
+            threadActive = false;
+            return;
+        }
+    }
+
     if (info.skipFrames)
     {
 #if X86_64
@@ -156,9 +178,13 @@ Y4MInput::~Y4MInput()
 {
     if (ifs && ifs != &cin)
         delete ifs;
-
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        X265_FREE(buf[i]);
+    map.close();
+    if (buf)
+    {
+        for (int i = 0; i < queueSize; i++)
+            X265_FREE(buf[i]);
+        X265_FREE(buf);
+    }
 }
 
 void Y4MInput::release()
@@ -368,7 +394,7 @@ bool Y4MInput::parseHeader()
 void Y4MInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.addr)
         start();
 #endif
 }
@@ -412,14 +438,14 @@ bool Y4MInput::populateFrameQueue()
     /* wait for room in the ring buffer */
     int written = writeCount.get();
     int read = readCount.get();
-    while (written - read > QUEUE_SIZE - 2)
+    while (written - read > queueSize - 2)
     {
         read = readCount.waitForChange(read);
         if (!threadActive)
             return false;
     }
 
-    ifs->read(buf[written % QUEUE_SIZE], framesize);
+    ifs->read(buf[written % queueSize], framesize);
     if (ifs->good())
     {
         writeCount.incr();
@@ -429,38 +455,83 @@ bool Y4MInput::populateFrameQueue()
         return false;
 }
 
+/* Parse the FRAME header at mapPos, returns the picture which follows it and
+ * advances mapPos to the next header */
+const char* Y4MInput::mapFrame()
+{
+    const char* data = (const char*)map.addr;
+    uint64_t pos = mapPos;
+
+    if (pos + strlen(header) > map.size)
+        return NULL;
+    if (memcmp(data + pos, header, strlen(header)))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "y4m: frame header missing\n");
+        return NULL;
+    }
+
+    /* consume bytes up to line feed */
+    pos += strlen(header);
+    while (pos < map.size && data[pos] != '\n')
+        pos++;
+    pos++;
+
+    if (pos + framesize > map.size)
+        return NULL;
+
+    mapPos = pos + framesize;
+    return data + pos;
+}
+
 bool Y4MInput::readPicture(x265_picture& pic)
 {
-    int read = readCount.get();
-    int written = writeCount.get();
+    const char* planes;
+
+    if (map.addr)
+    {
+        uint64_t prevPos = mapPos;
+        planes = mapFrame();
+        if (!planes)
+            return false;
+
+        /* the encoder has copied the previous picture */
+        if (prevPos >= framesize)
+            map.discard(prevPos - framesize, framesize);
+        map.prefetch(mapPos + (mapPos - prevPos) * (queueSize - 2), mapPos - prevPos);
+    }
+    else
+    {
+        int read = readCount.get();
+        int written = writeCount.get();
 
 #if ENABLE_THREADING
 
-    /* only wait if the read thread is still active */
-    while (threadActive && read == written)
-        written = writeCount.waitForChange(written);
+        /* only wait if the read thread is still active */
+        while (threadActive && read == written)
+            written = writeCount.waitForChange(written);
 
 #else
 
-    populateFrameQueue();
+        populateFrameQueue();
 
 #endif // if ENABLE_THREADING
 
-    if (read < written)
-    {
-        int pixelbytes = depth > 8 ? 2 : 1;
-        pic.bitDepth = depth;
-        pic.colorSpace = colorSpace;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        if (read >= written)
+            return false;
+
+        planes = buf[read % queueSize];
         readCount.incr();
-        return true;
     }
-    else
-        return false;
+
+    int pixelbytes = depth > 8 ? 2 : 1;
+    pic.bitDepth = depth;
+    pic.colorSpace = colorSpace;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = (char*)planes;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+    return true;
 }
 
@@ -61,12 +61,20 @@ protected:
 
     ThreadSafeInteger writeCount;
 
-    char* buf[QUEUE_SIZE];
+    int queueSize;
+
+    char** buf;
 
     std::istream *ifs;
 
+    InputMap map;
+
+    uint64_t mapPos; //< offset of the next FRAME header in the mapped file
+
     bool parseHeader();
 
+    const char* mapFrame();
+
     void threadMain();
 
     bool populateFrameQueue();
@@ -79,7 +87,7 @@ public:
 
     void release();
 
-    bool isEof() const            { return ifs && ifs->eof();  }
+    bool isEof() const            { return map.addr ? mapPos + framesize > map.size : ifs && ifs->eof(); }
 
     bool isFail()                 { return !(ifs && !ifs->fail() && threadActive); }
 
@@ -41,8 +41,9 @@ using namespace std;
 
 YUVInput::YUVInput(InputFileInfo& info)
 {
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        buf[i] = NULL;
+    queueSize = info.queueSize ? X265_MAX(info.queueSize, 3) : QUEUE_SIZE;
+    buf = NULL;
+    mapPos = 0;
 
     readCount.set(0);
     writeCount.set(0);
@@ -88,17 +89,6 @@ YUVInput::YUVInput(InputFileInfo& info)
         return;
     }
 
-    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
-    {
-        buf[i] = X265_MALLOC(char, framesize);
-        if (buf[i] == NULL)
-        {
-            x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
-            threadActive = false;
-            return;
-        }
-    }
-
     info.frameCount = -1;
 
     /* try to estimate frame count, if this is not stdin */
@@ -130,6 +120,33 @@ YUVInput::YUVInput(InputFileInfo& info)
 #endif // if defined(_MSC_VER) && _MSC_VER < 1700
     }
 
+    if (info.bMemoryMap && ifs != &cin)
+    {
+        /* pictures are read in place, no reader thread or buffers needed */
+        if (map.open(info.filename))
+        {
+            mapPos = (uint64_t)framesize * info.skipFrames;
+            map.prefetch(mapPos, (uint64_t)framesize * queueSize);
+            return;
+        }
+        x265_log(NULL, X265_LOG_WARNING, "yuv: reading input file instead\n");
+    }
+
+    buf = X265_MALLOC(char*, queueSize);
+    if (buf)
+        memset(buf, 0, sizeof(char*) * queueSize);
+    for (int i = 0; i < queueSize; i++)
+    {
+        if (buf)
+            buf[i] = X265_MALLOC(char, framesize);
+        if (!buf || !buf[i])
+        {
+            x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
+            threadActive = false;
+            return;
+        }
+    }
+
     if (info.skipFrames)
     {
 #if X86_64
@@ -145,8 +162,13 @@ YUVInput::~YUVInput()
 {
     if (ifs && ifs != &cin)
         delete ifs;
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        X265_FREE(buf[i]);
+    map.close();
+    if (buf)
+    {
+        for (int i = 0; i < queueSize; i++)
+            X265_FREE(buf[i]);
+        X265_FREE(buf);
+    }
 }
 
 void YUVInput::release()
@@ -160,7 +182,7 @@ void YUVInput::release()
 void YUVInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.addr)
         start();
 #endif
 }
@@ -185,7 +207,7 @@ bool YUVInput::populateFrameQueue()
     /* wait for room in the ring buffer */
     int written = writeCount.get();
     int read = readCount.get();
-    while (written - read > QUEUE_SIZE - 2)
+    while (written - read > queueSize - 2)
     {
         read = readCount.waitForChange(read);
         if (!threadActive)
@@ -193,7 +215,7 @@ bool YUVInput::populateFrameQueue()
             return false;
     }
 
-    ifs->read(buf[written % QUEUE_SIZE], framesize);
+    ifs->read(buf[written % queueSize], framesize);
     if (ifs->good())
     {
         writeCount.incr();
@@ -205,35 +227,53 @@ bool YUVInput::populateFrameQueue()
 
 bool YUVInput::readPicture(x265_picture& pic)
 {
-    int read = readCount.get();
-    int written = writeCount.get();
+    const char* planes;
+
+    if (map.addr)
+    {
+        if (mapPos + framesize > map.size)
+            return false;
+
+        /* the encoder has copied the previous picture */
+        if (mapPos >= framesize)
+            map.discard(mapPos - framesize, framesize);
+        map.prefetch(mapPos + (uint64_t)framesize * (queueSize - 1), framesize);
+
+        planes = (const char*)map.addr + mapPos;
+        mapPos += framesize;
+    }
+    else
+    {
+        int read = readCount.get();
+        int written = writeCount.get();
 
 #if ENABLE_THREADING
 
-    /* only wait if the read thread is still active */
-    while (threadActive && read == written)
-        written = writeCount.waitForChange(written);
+        /* only wait if the read thread is still active */
+        while (threadActive && read == written)
+            written = writeCount.waitForChange(written);
 
 #else
 
-    populateFrameQueue();
+        populateFrameQueue();
 
 #endif // if ENABLE_THREADING
 
-    if (read < written)
-    {
-        uint32_t pixelbytes = depth > 8 ? 2 : 1;
-        pic.colorSpace = colorSpace;
-        pic.bitDepth = depth;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        if (read >= written)
+            return false;
+
+        planes = buf[read % queueSize];
         readCount.incr();
-        return true;
     }
-    else
-        return false;
+
+    uint32_t pixelbytes = depth > 8 ? 2 : 1;
+    pic.colorSpace = colorSpace;
+    pic.bitDepth = depth;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = (char*)planes;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+    return true;
 }
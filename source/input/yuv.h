@@ -53,10 +53,16 @@ protected:
 
     ThreadSafeInteger writeCount;
 
-    char* buf[QUEUE_SIZE];
+    int queueSize;
+
+    char** buf;
 
     std::istream *ifs;
 
+    InputMap map;
+
+    uint64_t mapPos; //< offset of the next picture in the mapped file
+
     int guessFrameCount();
 
     void threadMain();
@@ -71,7 +77,7 @@ public:
 
     void release();
 
-    bool isEof() const                            { return ifs && ifs->eof();  }
+    bool isEof() const                            { return map.addr ? mapPos + framesize > map.size : ifs && ifs->eof(); }
 
     bool isFail()                                 { return !(ifs && !ifs->fail() && threadActive); }
 
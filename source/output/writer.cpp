@@ -0,0 +1,411 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "writer.h"
+
+#include <fcntl.h>
+#include <errno.h>
+
+#if _WIN32
+#include <io.h>
+#include <sys/stat.h>
+static int openFile(const char *name, int flags) { return _open(name, flags | _O_BINARY, _S_IREAD | _S_IWRITE); }
+static int writeFile(int fd, const char *data, size_t size) { return _write(fd, data, (unsigned int)size); }
+static void closeFile(int fd) { _close(fd); }
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+static int openFile(const char *name, int flags) { return open(name, flags, 0666); }
+static int writeFile(int fd, const char *data, size_t size) { return (int)write(fd, data, size); }
+static void closeFile(int fd) { close(fd); }
+#endif
+
+using namespace x265;
+
+/* the O_DIRECT staging buffer, its address, size and the sizes of the writes
+ * must be multiples of the logical block size of the device */
+static const size_t s_directAlign = 4096;
+static const size_t s_directSize = 1 << 20;
+
+/* maximum number of jobs given to a single writev() */
+static const int s_maxBatch = 64;
+
+OutputWriter::OutputWriter()
+{
+    queueSize = WRITER_QUEUE_SIZE;
+    jobs = NULL;
+    fd = -1;
+    recon = NULL;
+    width = height = 0;
+    bDirectIO = false;
+    direct = NULL;
+    directUsed = 0;
+    totalBytes = 0;
+    bError = false;
+    threadActive = false;
+}
+
+OutputWriter::~OutputWriter()
+{
+    close();
+
+    if (jobs)
+    {
+        for (int i = 0; i < queueSize; i++)
+            X265_FREE(jobs[i].buf);
+        delete [] jobs;
+    }
+    free(direct);
+}
+
+bool OutputWriter::open(const char *fname, Output *reconOutput, int w, int h, int queue, bool bDirect)
+{
+    recon = reconOutput;
+    width = w;
+    height = h;
+    queueSize = queue ? X265_MAX(queue, 2) : WRITER_QUEUE_SIZE;
+
+    jobs = new Job[queueSize];
+    memset(jobs, 0, sizeof(Job) * queueSize);
+
+#ifdef O_DIRECT
+    if (bDirect)
+    {
+        fd = openFile(fname, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT);
+        if (fd >= 0 && !posix_memalign((void**)&direct, s_directAlign, s_directSize))
+            bDirectIO = true;
+        else
+        {
+            x265_log(NULL, X265_LOG_WARNING, "O_DIRECT output not supported for <%s>, using buffered writes\n", fname);
+            if (fd >= 0)
+                closeFile(fd);
+            fd = -1;
+        }
+    }
+#else
+    if (bDirect)
+        x265_log(NULL, X265_LOG_WARNING, "O_DIRECT output not supported on this platform\n");
+#endif
+    if (fd < 0)
+        fd = openFile(fname, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+        return false;
+
+#if ENABLE_THREADING
+    threadActive = start();
+#endif
+
+    return true;
+}
+
+bool OutputWriter::close()
+{
+    if (fd < 0)
+        return !bError;
+
+    if (threadActive)
+    {
+        Job& job = getJob(0);
+        job.bEnd = true;
+        pushJob();
+        stop();
+        threadActive = false;
+    }
+
+    if (bDirectIO)
+        flushDirect(true);
+
+    closeFile(fd);
+    fd = -1;
+
+    return !bError;
+}
+
+/* wait for room in the ring, returns the next free job with at least size
+ * bytes of buffer */
+OutputWriter::Job& OutputWriter::getJob(size_t size)
+{
+    int written = writeCount.get();
+    int read = readCount.get();
+
+    while (written - read >= queueSize)
+        read = readCount.waitForChange(read);
+
+    Job& job = jobs[written % queueSize];
+    job.size = 0;
+    job.bPicture = false;
+    job.bEnd = false;
+    if (!reserve(job, size))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "output: buffer allocation failure, output dropped\n");
+        bError = true;
+    }
+
+    return job;
+}
+
+bool OutputWriter::reserve(Job& job, size_t size)
+{
+    if (job.capacity >= size)
+        return true;
+
+    X265_FREE(job.buf);
+    job.buf = X265_MALLOC(char, size);
+    job.capacity = job.buf ? size : 0;
+    return !!job.buf;
+}
+
+void OutputWriter::pushJob()
+{
+    if (threadActive)
+        writeCount.incr();
+    else
+    {
+        /* no writer thread, write it now */
+        writeJobs(writeCount.get(), 1);
+        writeCount.incr();
+        readCount.incr();
+    }
+}
+
+void OutputWriter::writeNALs(const x265_nal *nal, uint32_t nalcount)
+{
+    size_t size = 0;
+    for (uint32_t i = 0; i < nalcount; i++)
+        size += nal[i].sizeBytes;
+
+    Job& job = getJob(size);
+    if (job.capacity < size)
+        return;
+
+    for (uint32_t i = 0; i < nalcount; i++)
+    {
+        memcpy(job.buf + job.size, nal[i].payload, nal[i].sizeBytes);
+        job.size += nal[i].sizeBytes;
+    }
+
+    pushJob();
+}
+
+void OutputWriter::writePicture(const x265_picture& pic)
+{
+    const x265_cli_csp& csp = x265_cli_csps[pic.colorSpace];
+    int pixelbytes = pic.bitDepth > 8 ? 2 : 1;
+
+    size_t size = 0;
+    for (int i = 0; i < csp.planes; i++)
+        size += (size_t)((width >> csp.width[i]) * pixelbytes) * (height >> csp.height[i]);
+
+    Job& job = getJob(size);
+    if (job.capacity < size)
+        return;
+
+    /* the copy is packed, the strides are the widths of the planes */
+    job.pic = pic;
+    job.bPicture = true;
+    for (int i = 0; i < csp.planes; i++)
+    {
+        int rowBytes = (width >> csp.width[i]) * pixelbytes;
+        const char *src = (const char*)pic.planes[i];
+        char *dst = job.buf + job.size;
+
+        for (int y = 0; y < height >> csp.height[i]; y++)
+            memcpy(dst + y * rowBytes, src + y * pic.stride[i], rowBytes);
+
+        job.pic.planes[i] = dst;
+        job.pic.stride[i] = rowBytes;
+        job.size += (size_t)rowBytes * (height >> csp.height[i]);
+    }
+
+    pushJob();
+}
+
+void OutputWriter::threadMain()
+{
+    int read = readCount.get();
+
+    for (;;)
+    {
+        int written = writeCount.get();
+        while (read == written)
+            written = writeCount.waitForChange(written);
+
+        int count = 0;
+        bool bEnd = false;
+        while (read + count < written && !bEnd)
+        {
+            bEnd = jobs[(read + count) % queueSize].bEnd;
+            count++;
+        }
+
+        writeJobs(read, count);
+        read += count;
+        readCount.set(read);
+
+        if (bEnd)
+            break;
+    }
+}
+
+/* write count jobs of the ring, starting at the job first. The NALs of
+ * consecutive jobs are written together */
+void OutputWriter::writeJobs(int first, int count)
+{
+#if !_WIN32
+    struct iovec iov[s_maxBatch];
+#endif
+    int numIov = 0;
+
+    for (int i = 0; i <= count; i++)
+    {
+        Job* job = i < count ? &jobs[(first + i) % queueSize] : NULL;
+
+        if (job && !job->bPicture && !job->bEnd && job->size)
+        {
+            totalBytes += job->size;
+            if (bDirectIO)
+            {
+                bError |= !writeData(job->buf, job->size);
+                continue;
+            }
+#if _WIN32
+            bError |= !writeData(job->buf, job->size);
+            continue;
+#else
+            iov[numIov].iov_base = job->buf;
+            iov[numIov].iov_len = job->size;
+            if (++numIov < s_maxBatch && i + 1 < count)
+                continue;
+#endif
+        }
+
+#if !_WIN32
+        /* a picture, the end of the jobs or a full batch */
+        struct iovec *vec = iov;
+        while (numIov)
+        {
+            ssize_t ret = writev(fd, vec, numIov);
+            if (ret < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                x265_log(NULL, X265_LOG_ERROR, "output: bitstream write failed: %s\n", strerror(errno));
+                bError = true;
+                break;
+            }
+
+            /* partial writes resume within the iovec they stopped at */
+            while (numIov && (size_t)ret >= vec->iov_len)
+            {
+                ret -= vec->iov_len;
+                vec++;
+                numIov--;
+            }
+            if (numIov)
+            {
+                vec->iov_base = (char*)vec->iov_base + ret;
+                vec->iov_len -= ret;
+            }
+        }
+        numIov = 0;
+#endif
+
+        if (job && job->bPicture && recon)
+            recon->writePicture(job->pic);
+    }
+}
+
+bool OutputWriter::writeData(const char *data, size_t size)
+{
+    if (bDirectIO)
+    {
+        while (size)
+        {
+            size_t len = X265_MIN(size, s_directSize - directUsed);
+            memcpy(direct + directUsed, data, len);
+            directUsed += len;
+            data += len;
+            size -= len;
+
+            if (directUsed == s_directSize && !flushDirect(false))
+                return false;
+        }
+
+        return true;
+    }
+
+    while (size)
+    {
+        int ret = writeFile(fd, data, X265_MIN(size, (size_t)1 << 30));
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            x265_log(NULL, X265_LOG_ERROR, "output: bitstream write failed: %s\n", strerror(errno));
+            return false;
+        }
+        data += ret;
+        size -= ret;
+    }
+
+    return true;
+}
+
+/* write the staging buffer. The final write is padded to the alignment and
+ * the padding is truncated from the file */
+bool OutputWriter::flushDirect(bool bFinal)
+{
+#if !_WIN32
+    size_t size = directUsed;
+    if (bFinal)
+    {
+        size = (directUsed + s_directAlign - 1) & ~(s_directAlign - 1);
+        memset(direct + directUsed, 0, size - directUsed);
+    }
+
+    for (size_t done = 0; done < size;)
+    {
+        int ret = writeFile(fd, direct + done, size - done);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            x265_log(NULL, X265_LOG_ERROR, "output: bitstream write failed: %s\n", strerror(errno));
+            bError = true;
+            return false;
+        }
+        done += ret;
+    }
+
+    directUsed = 0;
+    if (bFinal && ftruncate(fd, (off_t)totalBytes))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "output: unable to truncate bitstream: %s\n", strerror(errno));
+        bError = true;
+        return false;
+    }
+#else
+    (void)bFinal;
+#endif
+
+    return true;
+}
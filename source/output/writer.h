@@ -0,0 +1,102 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_WRITER_H
+#define X265_WRITER_H
+
+#include "output.h"
+#include "threading.h"
+
+#define WRITER_QUEUE_SIZE 8
+
+namespace x265 {
+// private x265 namespace
+
+/* OutputWriter writes the bitstream and the reconstructed pictures of the
+ * CLI on a thread of its own, so the encoder is not stalled by the disk. The
+ * NALs and pictures returned by the encoder are only valid until the next
+ * encode call, so they are copied into a ring of jobs; the caller only waits
+ * when the ring is full. The NALs of consecutive jobs are written with a
+ * single writev() */
+class OutputWriter : public Thread
+{
+protected:
+
+    struct Job
+    {
+        char*        buf;
+        size_t       size;       // bytes used in buf
+        size_t       capacity;
+        bool         bPicture;   // pic refers to buf, else buf holds NALs
+        bool         bEnd;       // no more jobs follow
+        x265_picture pic;
+    };
+
+    int        queueSize;
+    Job*       jobs;
+
+    int        fd;
+    Output*    recon;
+    int        width;
+    int        height;
+
+    /* O_DIRECT output goes through an aligned staging buffer, the file is
+     * truncated to its real size when closed */
+    bool       bDirectIO;
+    char*      direct;
+    size_t     directUsed;
+    uint64_t   totalBytes;
+
+    bool       bError;
+    bool       threadActive;
+
+    ThreadSafeInteger readCount;
+    ThreadSafeInteger writeCount;
+
+    Job&  getJob(size_t size);
+    void  pushJob();
+    bool  reserve(Job& job, size_t size);
+    void  writeJobs(int first, int count);
+    bool  writeData(const char *data, size_t size);
+    bool  flushDirect(bool bFinal);
+
+    void  threadMain();
+
+public:
+
+    OutputWriter();
+
+    virtual ~OutputWriter();
+
+    bool open(const char *fname, Output *recon, int width, int height, int queueSize, bool bDirectIO);
+
+    /* returns false if any write failed */
+    bool close();
+
+    bool isFail() const { return bError; }
+
+    void writeNALs(const x265_nal *nal, uint32_t nalcount);
+
+    void writePicture(const x265_picture& pic);
+};
+}
+
+#endif // ifndef X265_WRITER_H
@@ -35,7 +35,6 @@ Y4MOutput::Y4MOutput(const char *filename, int w, int h, uint32_t fpsNum, uint32
     , frameSize(0)
 {
     ofs.open(filename, ios::binary | ios::out);
-    buf = new char[width];
 
     const char *cf = (csp >= X265_CSP_I444) ? "444" : (csp >= X265_CSP_I422) ? "422" : "420";
 
@@ -49,6 +48,8 @@ Y4MOutput::Y4MOutput(const char *filename, int w, int h, uint32_t fpsNum, uint32
     {
         frameSize += (uint32_t)((width >> x265_cli_csps[colorSpace].width[i]) * (height >> x265_cli_csps[colorSpace].height[i]));
     }
+
+    buf = new char[frameSize];
 }
 
 Y4MOutput::~Y4MOutput()
@@ -83,31 +84,44 @@ bool Y4MOutput::writePicture(const x265_picture& pic)
     // encoder gave us short pixels, downshift, then write
     X265_CHECK(pic.bitDepth > 8, "invalid bit depth\n");
     int shift = pic.bitDepth - 8;
+    char *dst = buf;
     for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
     {
         uint16_t *src = (uint16_t*)pic.planes[i];
+        int planeWidth = width >> x265_cli_csps[colorSpace].width[i];
         for (int h = 0; h < height >> x265_cli_csps[colorSpace].height[i]; h++)
         {
-            for (int w = 0; w < width >> x265_cli_csps[colorSpace].width[i]; w++)
+            for (int w = 0; w < planeWidth; w++)
             {
-                buf[w] = (char)(src[w] >> shift);
+                dst[w] = (char)(src[w] >> shift);
             }
 
-            ofs.write(buf, width >> x265_cli_csps[colorSpace].width[i]);
+            dst += planeWidth;
             src += pic.stride[i] / sizeof(*src);
         }
     }
 
+    ofs.write(buf, frameSize);
+
 #else // if HIGH_BIT_DEPTH
 
     X265_CHECK(pic.bitDepth == 8, "invalid bit depth\n");
     for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
     {
         char *src = (char*)pic.planes[i];
-        for (int h = 0; h < height >> x265_cli_csps[colorSpace].height[i]; h++)
+        int planeWidth = width >> x265_cli_csps[colorSpace].width[i];
+        int rows = height >> x265_cli_csps[colorSpace].height[i];
+
+        /* planes with contiguous rows are written at once */
+        if (pic.stride[i] == planeWidth)
+            ofs.write(src, (std::streamsize)planeWidth * rows);
+        else
         {
-            ofs.write(src, width >> x265_cli_csps[colorSpace].width[i]);
-            src += pic.stride[i] / sizeof(*src);
+            for (int h = 0; h < rows; h++)
+            {
+                ofs.write(src, planeWidth);
+                src += pic.stride[i] / sizeof(*src);
+            }
         }
     }
 
@@ -36,12 +36,13 @@ YUVOutput::YUVOutput(const char *filename, int w, int h, uint32_t d, int csp)
     , frameSize(0)
 {
     ofs.open(filename, ios::binary | ios::out);
-    buf = new char[width];
 
     for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
     {
         frameSize += (uint32_t)((width >> x265_cli_csps[colorSpace].width[i]) * (height >> x265_cli_csps[colorSpace].height[i]));
     }
+
+    buf = new char[frameSize];
 }
 
 YUVOutput::~YUVOutput()
@@ -50,6 +51,25 @@ YUVOutput::~YUVOutput()
     delete [] buf;
 }
 
+/* write a plane of the picture, at once when its rows are contiguous */
+void YUVOutput::writePlane(const x265_picture& pic, int plane, int pixelbytes)
+{
+    const char *src = (const char*)pic.planes[plane];
+    int rowBytes = (width >> x265_cli_csps[colorSpace].width[plane]) * pixelbytes;
+    int rows = height >> x265_cli_csps[colorSpace].height[plane];
+
+    if (pic.stride[plane] == rowBytes)
+        ofs.write(src, (std::streamsize)rowBytes * rows);
+    else
+    {
+        for (int h = 0; h < rows; h++)
+        {
+            ofs.write(src, rowBytes);
+            src += pic.stride[plane];
+        }
+    }
+}
+
 bool YUVOutput::writePicture(const x265_picture& pic)
 {
     uint64_t fileOffset = pic.poc;
@@ -61,47 +81,38 @@ bool YUVOutput::writePicture(const x265_picture& pic)
 #if HIGH_BIT_DEPTH
     if (depth == 8)
     {
+        /* down-shift the whole picture, then write it at once */
         int shift = pic.bitDepth - 8;
-        ofs.seekp((std::streamoff)fileOffset);
+        char *dst = buf;
         for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
         {
             uint16_t *src = (uint16_t*)pic.planes[i];
+            int planeWidth = width >> x265_cli_csps[colorSpace].width[i];
             for (int h = 0; h < height >> x265_cli_csps[colorSpace].height[i]; h++)
             {
-                for (int w = 0; w < width >> x265_cli_csps[colorSpace].width[i]; w++)
+                for (int w = 0; w < planeWidth; w++)
                 {
-                    buf[w] = (char)(src[w] >> shift);
+                    dst[w] = (char)(src[w] >> shift);
                 }
 
-                ofs.write(buf, width >> x265_cli_csps[colorSpace].width[i]);
+                dst += planeWidth;
                 src += pic.stride[i] / sizeof(*src);
             }
         }
+
+        ofs.seekp((std::streamoff)fileOffset);
+        ofs.write(buf, frameSize);
     }
     else
     {
         ofs.seekp((std::streamoff)(fileOffset * 2));
         for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
-        {
-            uint16_t *src = (uint16_t*)pic.planes[i];
-            for (int h = 0; h < height >> x265_cli_csps[colorSpace].height[i]; h++)
-            {
-                ofs.write((const char*)src, (width * 2) >> x265_cli_csps[colorSpace].width[i]);
-                src += pic.stride[i] / sizeof(*src);
-            }
-        }
+            writePlane(pic, i, 2);
     }
 #else // if HIGH_BIT_DEPTH
     ofs.seekp((std::streamoff)fileOffset);
     for (int i = 0; i < x265_cli_csps[colorSpace].planes; i++)
-    {
-        char *src = (char*)pic.planes[i];
-        for (int h = 0; h < height >> x265_cli_csps[colorSpace].height[i]; h++)
-        {
-            ofs.write(src, width >> x265_cli_csps[colorSpace].width[i]);
-            src += pic.stride[i] / sizeof(*src);
-        }
-    }
+        writePlane(pic, i, 1);
 
 #endif // if HIGH_BIT_DEPTH
 
@@ -50,6 +50,8 @@ protected:
 
     std::ofstream ofs;
 
+    void writePlane(const x265_picture& pic, int plane, int pixelbytes);
+
 public:
 
     YUVOutput(const char *filename, int width, int height, uint32_t bitdepth, int csp);
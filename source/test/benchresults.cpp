@@ -0,0 +1,362 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "benchresults.h"
+
+#include <ctype.h>
+
+namespace {
+/* the console names are padded for alignment, the recorded names are not */
+void normalizeName(char *dst, const char *src, size_t size)
+{
+    size_t len = 0;
+    bool bSkip = true; // skip leading spaces and spaces after '[' or a space
+
+    for (; *src && len + 1 < size; src++)
+    {
+        if (*src == ' ' || *src == '\t')
+        {
+            if (!bSkip)
+                dst[len++] = ' ';
+            bSkip = true;
+            continue;
+        }
+        if (*src == '[' && len && dst[len - 1] == ' ')
+            len--;
+        dst[len++] = *src;
+        bSkip = *src == '[';
+    }
+
+    while (len && dst[len - 1] == ' ')
+        len--;
+    dst[len] = 0;
+}
+
+/* pixels of the last WxH block size in a primitive name, or 0 */
+int namePixels(const char *name)
+{
+    int pixels = 0;
+
+    for (const char *p = name; *p; p++)
+    {
+        if (*p != 'x' || p == name || !isdigit(p[-1]) || !isdigit(p[1]))
+            continue;
+
+        const char *w = p;
+        while (w > name && isdigit(w[-1]))
+            w--;
+        pixels = atoi(w) * atoi(p + 1);
+    }
+
+    return pixels;
+}
+
+bool jsonString(const char *line, const char *key, char *value, size_t size)
+{
+    char pattern[64];
+    sprintf(pattern, "\"%s\": \"", key);
+    const char *p = strstr(line, pattern);
+    if (!p)
+        return false;
+
+    p += strlen(pattern);
+    size_t len = 0;
+    while (*p && *p != '"' && len + 1 < size)
+        value[len++] = *p++;
+    value[len] = 0;
+    return true;
+}
+
+bool jsonNumber(const char *line, const char *key, double& value)
+{
+    char pattern[64];
+    sprintf(pattern, "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    if (!p)
+        return false;
+
+    value = atof(p + strlen(pattern));
+    return true;
+}
+}
+
+BenchResults::BenchResults()
+{
+    m_entries = NULL;
+    m_numEntries = m_maxEntries = 0;
+    m_ref = m_opt = NULL;
+    m_numIsa = 0;
+}
+
+BenchResults::~BenchResults()
+{
+    free(m_entries);
+    for (int i = 0; i < m_numIsa; i++)
+        delete m_isa[i];
+}
+
+void BenchResults::setPrimitives(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
+{
+    m_ref = &ref;
+    m_opt = &opt;
+}
+
+/* the primitives of one ISA level are set up the same way as for the
+ * correctness tests, with the aliases of the full setup */
+void BenchResults::addIsa(const char *name, int cpuFlag)
+{
+    if (m_numIsa == MAX_BENCH_ISA)
+        return;
+
+    Isa *isa = new Isa;
+    memset(isa, 0, sizeof(Isa));
+    strncpy(isa->name, name, sizeof(isa->name) - 1);
+    Setup_Instrinsic_Primitives(isa->vec, cpuFlag);
+    Setup_Alias_Primitives(isa->vec);
+    Setup_Assembly_Primitives(isa->asmp, cpuFlag);
+    Setup_Alias_Primitives(isa->asmp);
+    m_isa[m_numIsa++] = isa;
+}
+
+BenchResults::Entry* BenchResults::append()
+{
+    if (m_numEntries == m_maxEntries)
+    {
+        int size = m_maxEntries ? m_maxEntries * 2 : 256;
+        Entry *entries = (Entry*)realloc(m_entries, size * sizeof(Entry));
+        if (!entries)
+            return NULL;
+        m_entries = entries;
+        m_maxEntries = size;
+    }
+
+    Entry *entry = &m_entries[m_numEntries++];
+    memset(entry, 0, sizeof(Entry));
+    return entry;
+}
+
+const BenchResults::Entry* BenchResults::find(const char *name) const
+{
+    for (int i = 0; i < m_numEntries; i++)
+        if (!strcmp(m_entries[i].name, name))
+            return &m_entries[i];
+
+    return NULL;
+}
+
+/* the winning primitive is at the same offset of the table of its ISA. Later
+ * ISA levels override earlier ones, so they are searched first */
+void BenchResults::findIsa(const void *func, size_t size, Entry& entry) const
+{
+    strcpy(entry.isa, "?");
+    strcpy(entry.impl, "?");
+    if (!m_opt || (const char*)func < (const char*)m_opt ||
+        (const char*)func + size > (const char*)(m_opt + 1))
+        return;
+
+    size_t offset = (const char*)func - (const char*)m_opt;
+    for (int i = m_numIsa - 1; i >= 0; i--)
+    {
+        if (!memcmp((const char*)&m_isa[i]->asmp + offset, func, size))
+        {
+            strcpy(entry.isa, m_isa[i]->name);
+            strcpy(entry.impl, "asm");
+            return;
+        }
+        if (!memcmp((const char*)&m_isa[i]->vec + offset, func, size))
+        {
+            strcpy(entry.isa, m_isa[i]->name);
+            strcpy(entry.impl, "vec");
+            return;
+        }
+    }
+
+    if (m_ref && !memcmp((const char*)m_ref + offset, func, size))
+    {
+        strcpy(entry.isa, "C");
+        strcpy(entry.impl, "c");
+    }
+}
+
+void BenchResults::add(const char *name, const void *func, size_t size, double cycles, double refCycles)
+{
+    Entry *entry = append();
+    if (!entry)
+        return;
+
+    normalizeName(entry->name, name, sizeof(entry->name));
+    findIsa(func, size, *entry);
+    entry->cycles = cycles;
+    entry->refCycles = refCycles;
+    entry->pixels = namePixels(entry->name);
+}
+
+bool BenchResults::writeJSON(const char *fname) const
+{
+    FILE *fh = fopen(fname, "w");
+    if (!fh)
+        return false;
+
+    fprintf(fh, "{\n  \"build\": \"%s\",\n  \"bitDepth\": %d,\n  \"isa\": [", x265_build_info_str, X265_DEPTH);
+    for (int i = 0; i < m_numIsa; i++)
+        fprintf(fh, "%s\"%s\"", i ? ", " : "", m_isa[i]->name);
+    fprintf(fh, "],\n  \"results\": [\n");
+
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        const Entry& e = m_entries[i];
+        fprintf(fh, "    {\"name\": \"%s\", \"isa\": \"%s\", \"impl\": \"%s\", \"cycles\": %.2f, \"refCycles\": %.2f, ",
+                e.name, e.isa, e.impl, e.cycles, e.refCycles);
+        if (e.pixels)
+            fprintf(fh, "\"cyclesPerPixel\": %.4f, ", e.cycles / e.pixels);
+        else
+            fprintf(fh, "\"cyclesPerPixel\": null, ");
+        fprintf(fh, "\"speedup\": %.2f}%s\n", e.cycles > 0 ? e.refCycles / e.cycles : 0, i + 1 < m_numEntries ? "," : "");
+    }
+
+    fprintf(fh, "  ]\n}\n");
+    bool bOk = !ferror(fh);
+    fclose(fh);
+    return bOk;
+}
+
+bool BenchResults::writeCSV(const char *fname) const
+{
+    FILE *fh = fopen(fname, "w");
+    if (!fh)
+        return false;
+
+    fprintf(fh, "Primitive, ISA, Impl, Cycles, C Cycles, Cycles/Pixel, Speedup\n");
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        const Entry& e = m_entries[i];
+        fprintf(fh, "%s, %s, %s, %.2f, %.2f, ", e.name, e.isa, e.impl, e.cycles, e.refCycles);
+        if (e.pixels)
+            fprintf(fh, "%.4f, ", e.cycles / e.pixels);
+        else
+            fprintf(fh, "-, ");
+        fprintf(fh, "%.2f\n", e.cycles > 0 ? e.refCycles / e.cycles : 0);
+    }
+
+    bool bOk = !ferror(fh);
+    fclose(fh);
+    return bOk;
+}
+
+bool BenchResults::load(const char *fname)
+{
+    FILE *fh = fopen(fname, "r");
+    if (!fh)
+        return false;
+
+    char line[1024];
+    bool bJSON = false;
+    bool bFirst = true;
+    while (fgets(line, sizeof(line), fh))
+    {
+        if (bFirst)
+        {
+            /* JSON starts with a brace, CSV with its column titles */
+            bJSON = line[0] == '{';
+            bFirst = false;
+            continue;
+        }
+
+        Entry e;
+        memset(&e, 0, sizeof(e));
+        if (bJSON)
+        {
+            if (!jsonString(line, "name", e.name, sizeof(e.name)) ||
+                !jsonNumber(line, "cycles", e.cycles) ||
+                !jsonNumber(line, "refCycles", e.refCycles))
+                continue;
+            jsonString(line, "isa", e.isa, sizeof(e.isa));
+            jsonString(line, "impl", e.impl, sizeof(e.impl));
+        }
+        else
+        {
+            /* the names contain no commas */
+            char *fields[5];
+            int count = 0;
+            for (char *tok = strtok(line, ","); tok && count < 5; tok = strtok(NULL, ","))
+            {
+                while (*tok == ' ')
+                    tok++;
+                fields[count++] = tok;
+            }
+            if (count < 5)
+                continue;
+            strncpy(e.name, fields[0], sizeof(e.name) - 1);
+            strncpy(e.isa, fields[1], sizeof(e.isa) - 1);
+            strncpy(e.impl, fields[2], sizeof(e.impl) - 1);
+            e.cycles = atof(fields[3]);
+            e.refCycles = atof(fields[4]);
+        }
+        e.pixels = namePixels(e.name);
+
+        Entry *entry = append();
+        if (entry)
+            *entry = e;
+    }
+
+    fclose(fh);
+    return true;
+}
+
+int BenchResults::compare(const BenchResults& before, const BenchResults& after, double threshold)
+{
+    int slower = 0, faster = 0, missing = 0;
+
+    printf("%-32s %10s %10s %8s  %s\n", "primitive", "before", "after", "change", "isa");
+    for (int i = 0; i < after.m_numEntries; i++)
+    {
+        const Entry& a = after.m_entries[i];
+        const Entry *b = before.find(a.name);
+        if (!b)
+        {
+            missing++;
+            continue;
+        }
+        if (b->cycles <= 0)
+            continue;
+
+        double change = 100.0 * (a.cycles / b->cycles - 1);
+        bool bSlower = change > threshold;
+        bool bIsaChange = strcmp(a.isa, b->isa) || strcmp(a.impl, b->impl);
+        if (change < -threshold)
+            faster++;
+        if (!bSlower && !bIsaChange)
+            continue;
+
+        printf("%-32s %10.2f %10.2f %+7.1f%%  %s %s", a.name, b->cycles, a.cycles, change, a.isa, a.impl);
+        if (bIsaChange)
+            printf(" (was %s %s)", b->isa, b->impl);
+        printf("%s\n", bSlower ? "  SLOWER" : "");
+        slower += bSlower;
+    }
+
+    printf("\n%d primitives slower, %d faster by more than %.1f%%", slower, faster, threshold);
+    if (missing)
+        printf(", %d not in the baseline", missing);
+    printf("\n");
+
+    return slower;
+}
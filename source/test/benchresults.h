@@ -0,0 +1,95 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef _BENCHRESULTS_H_
+#define _BENCHRESULTS_H_ 1
+
+#include "common.h"
+#include "primitives.h"
+
+#define MAX_BENCH_ISA 8
+
+using namespace x265;
+
+/* Machine readable TestBench results. Every measured primitive is recorded
+ * with its cycles, the cycles of the C reference, the cycles per pixel of
+ * its block size and the ISA level whose primitive won the setup. Results
+ * are written as JSON (one primitive per line) or CSV, and two result files
+ * can be compared to find the primitives which became slower between two
+ * builds or two hosts */
+class BenchResults
+{
+public:
+
+    struct Entry
+    {
+        char   name[64];
+        char   isa[16];      // ISA level of the winning primitive, or C
+        char   impl[8];      // asm, vec (intrinsic) or c
+        double cycles;
+        double refCycles;
+        int    pixels;       // pixels of the block size, 0 if it has none
+    };
+
+    BenchResults();
+
+    ~BenchResults();
+
+    /* the tables the ISA of each optimized primitive is searched in */
+    void setPrimitives(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+    void addIsa(const char *name, int cpuFlag);
+
+    void add(const char *name, const void *func, size_t size, double cycles, double refCycles);
+
+    bool writeJSON(const char *fname) const;
+    bool writeCSV(const char *fname) const;
+
+    /* read a file written by writeJSON() or writeCSV() */
+    bool load(const char *fname);
+
+    /* print the primitives of after which are more than threshold percent
+     * slower than in before, returns their number */
+    static int compare(const BenchResults& before, const BenchResults& after, double threshold);
+
+protected:
+
+    struct Isa
+    {
+        char              name[16];
+        EncoderPrimitives vec;
+        EncoderPrimitives asmp;
+    };
+
+    Entry*  m_entries;
+    int     m_numEntries;
+    int     m_maxEntries;
+
+    const EncoderPrimitives* m_ref;
+    const EncoderPrimitives* m_opt;
+    Isa*    m_isa[MAX_BENCH_ISA];
+    int     m_numIsa;
+
+    Entry*  append();
+    const Entry* find(const char *name) const;
+    void    findIsa(const void *func, size_t size, Entry& entry) const;
+};
+
+#endif // ifndef _BENCHRESULTS_H_
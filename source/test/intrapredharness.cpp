@@ -255,19 +255,19 @@ void IntraPredHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderP
         const int size = (1 << (i + 2));
         if (opt.intra_pred[1][i])
         {
-            printf("intra_dc_%dx%d[f=0]", size, size);
+            HEADER("intra_dc_%dx%d[f=0]", size, size);
             REPORT_SPEEDUP(opt.intra_pred[1][i], ref.intra_pred[1][i],
                            pixel_out_vec, FENC_STRIDE, pixel_buff + srcStride, pixel_buff, 0, 0);
             if (size <= 16)
             {
-                printf("intra_dc_%dx%d[f=1]", size, size);
+                HEADER("intra_dc_%dx%d[f=1]", size, size);
                 REPORT_SPEEDUP(opt.intra_pred[1][i], ref.intra_pred[1][i],
                                pixel_out_vec, FENC_STRIDE, pixel_buff + srcStride, pixel_buff, 0, 1);
             }
         }
         if (opt.intra_pred[0][i])
         {
-            printf("intra_planar %2dx%d", size, size);
+            HEADER("intra_planar %2dx%d", size, size);
             REPORT_SPEEDUP(opt.intra_pred[0][i], ref.intra_pred[0][i],
                            pixel_out_vec, FENC_STRIDE, pixel_buff + srcStride, pixel_buff, 0, 0);
         }
@@ -277,7 +277,7 @@ void IntraPredHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderP
             pixel * refAbove = pixel_buff + srcStride;
             pixel * refLeft = refAbove + 3 * size;
             refLeft[0] = refAbove[0];
-            printf("intra_allangs%dx%d", size, size);
+            HEADER("intra_allangs%dx%d", size, size);
             REPORT_SPEEDUP(opt.intra_pred_allangs[i], ref.intra_pred_allangs[i],
                            pixel_out_33_vec, refAbove, refLeft, refAbove, refLeft, bFilter);
         }
@@ -295,7 +295,7 @@ void IntraPredHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderP
                 pixel * refAbove = pixel_buff + srcStride;
                 pixel * refLeft = refAbove + 3 * width;
                 refLeft[0] = refAbove[0];
-                printf("intra_ang%dx%d[%2d]", width, width, pmode);
+                HEADER("intra_ang%dx%d[%2d]", width, width, pmode);
                 REPORT_SPEEDUP(opt.intra_pred[pmode][ii - 2], ref.intra_pred[pmode][ii - 2],
                                pixel_out_vec, FENC_STRIDE, refAbove, refLeft, pmode, bFilter);
             }
@@ -661,7 +661,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
     if (opt.luma_p2s)
     {
-        printf("luma_p2s\t");
+        HEADER0("luma_p2s");
         REPORT_SPEEDUP(opt.luma_p2s, ref.luma_p2s,
                        pixel_buff, srcStride, IPF_vec_output_s, width, height);
     }
@@ -670,14 +670,14 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
     {
         if (opt.luma_hpp[value])
         {
-            printf("luma_hpp[%s]\t", lumaPartStr[value]);
+            HEADER("luma_hpp[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_hpp[value], ref.luma_hpp[value],
                            pixel_buff + srcStride, srcStride, IPF_vec_output_p, dstStride, 1);
         }
 
         if (opt.luma_hps[value])
         {
-            printf("luma_hps[%s]\t", lumaPartStr[value]);
+            HEADER("luma_hps[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_hps[value], ref.luma_hps[value],
                            pixel_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                            IPF_vec_output_s, dstStride, 1, 1);
@@ -685,7 +685,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
         if (opt.luma_vpp[value])
         {
-            printf("luma_vpp[%s]\t", lumaPartStr[value]);
+            HEADER("luma_vpp[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_vpp[value], ref.luma_vpp[value],
                            pixel_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                            IPF_vec_output_p, dstStride, 1);
@@ -693,7 +693,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
         if (opt.luma_vps[value])
         {
-            printf("luma_vps[%s]\t", lumaPartStr[value]);
+            HEADER("luma_vps[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_vps[value], ref.luma_vps[value],
                            pixel_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                            IPF_vec_output_s, dstStride, 1);
@@ -701,7 +701,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
         if (opt.luma_vsp[value])
         {
-            printf("luma_vsp[%s]\t", lumaPartStr[value]);
+            HEADER("luma_vsp[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_vsp[value], ref.luma_vsp[value],
                            short_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                            IPF_vec_output_p, dstStride, 1);
@@ -709,7 +709,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
         if (opt.luma_vss[value])
         {
-            printf("luma_vss[%s]\t", lumaPartStr[value]);
+            HEADER("luma_vss[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_vss[value], ref.luma_vss[value],
                            short_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                            IPF_vec_output_s, dstStride, 1);
@@ -717,7 +717,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
 
         if (opt.luma_hvpp[value])
         {
-            printf("luma_hv [%s]\t", lumaPartStr[value]);
+            HEADER("luma_hvpp[%s]", lumaPartStr[value]);
             REPORT_SPEEDUP(opt.luma_hvpp[value], ref.luma_hvpp[value],
                            pixel_buff + 3 * srcStride, srcStride, IPF_vec_output_p, srcStride, 1, 3);
         }
@@ -728,7 +728,7 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
         printf("= Color Space %s =\n", x265_source_csp_names[csp]);
         if (opt.chroma_p2s[csp])
         {
-            printf("chroma_p2s\t");
+            HEADER("chroma_p2s[%s]", x265_source_csp_names[csp]);
             REPORT_SPEEDUP(opt.chroma_p2s[csp], ref.chroma_p2s[csp],
                            pixel_buff, srcStride, IPF_vec_output_s, width, height);
         }
@@ -736,40 +736,40 @@ void IPFilterHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPr
         {
             if (opt.chroma[csp].filter_hpp[value])
             {
-                printf("chroma_hpp[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_hpp[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_hpp[value], ref.chroma[csp].filter_hpp[value],
                                pixel_buff + srcStride, srcStride, IPF_vec_output_p, dstStride, 1);
             }
             if (opt.chroma[csp].filter_hps[value])
             {
-                printf("chroma_hps[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_hps[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_hps[value], ref.chroma[csp].filter_hps[value],
                                pixel_buff + srcStride, srcStride, IPF_vec_output_s, dstStride, 1, 1);
             }
             if (opt.chroma[csp].filter_vpp[value])
             {
-                printf("chroma_vpp[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_vpp[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_vpp[value], ref.chroma[csp].filter_vpp[value],
                                pixel_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                                IPF_vec_output_p, dstStride, 1);
             }
             if (opt.chroma[csp].filter_vps[value])
             {
-                printf("chroma_vps[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_vps[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_vps[value], ref.chroma[csp].filter_vps[value],
                                pixel_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                                IPF_vec_output_s, dstStride, 1);
             }
             if (opt.chroma[csp].filter_vsp[value])
             {
-                printf("chroma_vsp[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_vsp[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_vsp[value], ref.chroma[csp].filter_vsp[value],
                                short_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                                IPF_vec_output_p, dstStride, 1);
             }
             if (opt.chroma[csp].filter_vss[value])
             {
-                printf("chroma_vss[%s]", chromaPartStr[csp][value]);
+                HEADER("[%s] chroma_vss[%s]", x265_source_csp_names[csp], chromaPartStr[csp][value]);
                 REPORT_SPEEDUP(opt.chroma[csp].filter_vss[value], ref.chroma[csp].filter_vss[value],
                                short_buff + maxVerticalfilterHalfDistance * srcStride, srcStride,
                                IPF_vec_output_s, dstStride, 1);
@@ -38,18 +38,18 @@ struct DctConf
 
 const DctConf dctInfo[] =
 {
-    { "dst4x4\t",    4 },
-    { "dct4x4\t",    4 },
-    { "dct8x8\t",    8 },
+    { "dst4x4",      4 },
+    { "dct4x4",      4 },
+    { "dct8x8",      8 },
     { "dct16x16",   16 },
     { "dct32x32",   32 },
 };
 
 const DctConf idctInfo[] =
 {
-    { "idst4x4\t",    4 },
-    { "idct4x4\t",    4 },
-    { "idct8x8\t",    8 },
+    { "idst4x4",      4 },
+    { "idct4x4",      4 },
+    { "idct8x8",      8 },
     { "idct16x16",   16 },
     { "idct32x32",   32 },
 };
@@ -454,7 +454,7 @@ void MBDstHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
     {
         if (opt.dct[value])
         {
-            printf("%s\t", dctInfo[value].name);
+            HEADER("%s", dctInfo[value].name);
             REPORT_SPEEDUP(opt.dct[value], ref.dct[value], mbuf1, mintbuf3, dctInfo[value].width);
         }
     }
@@ -463,32 +463,32 @@ void MBDstHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
     {
         if (opt.idct[value])
         {
-            printf("%s\t", idctInfo[value].name);
+            HEADER("%s", idctInfo[value].name);
             REPORT_SPEEDUP(opt.idct[value], ref.idct[value], mbufidct, mshortbuf2, idctInfo[value].width);
         }
     }
 
     if (opt.dequant_normal)
     {
-        printf("dequant_normal\t");
+        HEADER0("dequant_normal");
         REPORT_SPEEDUP(opt.dequant_normal, ref.dequant_normal, short_test_buff[0], mintbuf3, 32 * 32, 70, 1);
     }
 
     if (opt.dequant_scaling)
     {
-        printf("dequant_scaling\t");
+        HEADER0("dequant_scaling");
         REPORT_SPEEDUP(opt.dequant_scaling, ref.dequant_scaling, short_test_buff[0], mintbuf3, mintbuf4, 32 * 32, 5, 1);
     }
 
     if (opt.quant)
     {
-        printf("quant\t\t");
+        HEADER0("quant");
         REPORT_SPEEDUP(opt.quant, ref.quant, int_test_buff[0], int_test_buff[1], mintbuf3, mshortbuf2, 23, 23785, 32 * 32);
     }
 
     if (opt.nquant)
     {
-        printf("nquant\t\t");
+        HEADER0("nquant");
         REPORT_SPEEDUP(opt.nquant, ref.nquant, int_test_buff[0], int_test_buff[1], mshortbuf2, 23, 23785, 32 * 32);
     }
 
@@ -496,14 +496,14 @@ void MBDstHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
     {
         for (int i = 4; i <= 32; i <<= 1)
         {
-            printf("count_nonzero[%dx%d]", i, i);
+            HEADER("count_nonzero[%dx%d]", i, i);
             REPORT_SPEEDUP(opt.count_nonzero, ref.count_nonzero, mbuf1, i * i)
         }
     }
 
     if (opt.denoiseDct)
     {
-        printf("denoiseDct\t");
+        HEADER0("denoiseDct");
         REPORT_SPEEDUP(opt.denoiseDct, ref.denoiseDct, int_denoise_test_buff1[0], mubuf1, mushortbuf1, 32 * 32);
     }
 
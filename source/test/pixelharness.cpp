@@ -1047,6 +1047,73 @@ bool PixelHarness::check_planecopy_cp(planecopy_cp_t ref, planecopy_cp_t opt)
     return true;
 }
 
+bool PixelHarness::check_cutree_propagate_cost(cutree_propagate_cost ref, cutree_propagate_cost opt)
+{
+    ALIGN_VAR_16(int, ref_dest[64]);
+    ALIGN_VAR_16(int, opt_dest[64]);
+    uint16_t propagateIn[64], interCosts[64];
+    int32_t intraCosts[64], invQscales[64];
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int len = 1 + rand() % 64;
+        double fpsFactor = 128 + rand() % 256;
+
+        for (int x = 0; x < len; x++)
+        {
+            propagateIn[x] = (uint16_t)rand();
+            interCosts[x] = (uint16_t)rand();
+            intraCosts[x] = 1 + rand() % 16383;
+            invQscales[x] = 64 + rand() % 1024;
+        }
+
+        checked(opt, opt_dest, propagateIn, intraCosts, interCosts, invQscales, &fpsFactor, len);
+        ref(ref_dest, propagateIn, intraCosts, interCosts, invQscales, &fpsFactor, len);
+
+        if (memcmp(ref_dest, opt_dest, len * sizeof(int)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_cutree_propagate_list(cutree_propagate_list ref, cutree_propagate_list opt)
+{
+    ALIGN_VAR_16(int32_t, ref_dest[6 * 64]);
+    ALIGN_VAR_16(int32_t, opt_dest[6 * 64]);
+    int propagateAmount[64];
+    uint16_t lowresCosts[64];
+    int16_t mvs[64][2];
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int len = 1 + rand() % 64;
+        int list = rand() & 1;
+        int listWeight = rand() % 65;
+        int cuy = rand() % 64;
+
+        for (int x = 0; x < len; x++)
+        {
+            propagateAmount[x] = (rand() % 65536) - 4096;
+            lowresCosts[x] = (uint16_t)rand();
+            mvs[x][0] = (int16_t)((rand() % 2048) - 1024);
+            mvs[x][1] = (int16_t)((rand() % 2048) - 1024);
+        }
+
+        checked(opt, opt_dest, propagateAmount, lowresCosts, mvs, listWeight, list, cuy, len);
+        ref(ref_dest, propagateAmount, lowresCosts, mvs, listWeight, list, cuy, len);
+
+        if (memcmp(ref_dest, opt_dest, 6 * len * sizeof(int32_t)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool PixelHarness::testPartition(int part, const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
     if (opt.satd[part])
@@ -1499,6 +1566,24 @@ bool PixelHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.propagateCost)
+    {
+        if (!check_cutree_propagate_cost(ref.propagateCost, opt.propagateCost))
+        {
+            printf("propagateCost failed\n");
+            return false;
+        }
+    }
+
+    if (opt.propagateList)
+    {
+        if (!check_cutree_propagate_list(ref.propagateList, opt.propagateList))
+        {
+            printf("propagateList failed\n");
+            return false;
+        }
+    }
+
     if (opt.copy_shr)
     {
         if (!check_copy_shr_t(ref.copy_shr, opt.copy_shr))
@@ -1515,8 +1600,6 @@ void PixelHarness::measurePartition(int part, const EncoderPrimitives& ref, cons
 {
     ALIGN_VAR_16(int, cres[16]);
     pixel *fref = pbuf2 + 2 * INCR;
-    char header[128];
-#define HEADER(str, ...) sprintf(header, str, __VA_ARGS__); printf("%22s", header);
 
     if (opt.satd[part])
     {
@@ -1654,17 +1737,10 @@ void PixelHarness::measurePartition(int part, const EncoderPrimitives& ref, cons
             }
         }
     }
-
-#undef HEADER
 }
 
 void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
-    char header[128];
-
-#define HEADER(str, ...) sprintf(header, str, __VA_ARGS__); printf("%22s", header);
-#define HEADER0(str) printf("%22s", str);
-
     for (int size = 4; size <= 64; size *= 2)
     {
         int part = partitionFromSizes(size, size); // 2Nx2N
@@ -1832,6 +1908,19 @@ void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
         REPORT_SPEEDUP(opt.planecopy_cp, ref.planecopy_cp, uchar_test_buff[0], 64, pbuf1, 64, 64, 64, 2);
     }
 
+    if (opt.propagateCost)
+    {
+        HEADER0("propagateCost");
+        double fps = 256;
+        REPORT_SPEEDUP(opt.propagateCost, ref.propagateCost, ibuf1, ushort_test_buff[0], int_test_buff[0], ushort_test_buff[0], int_test_buff[0], &fps, 80);
+    }
+
+    if (opt.propagateList)
+    {
+        HEADER0("propagateList");
+        REPORT_SPEEDUP(opt.propagateList, ref.propagateList, ibuf1, int_test_buff[0], ushort_test_buff[0], (int16_t(*)[2])short_test_buff[0], 32, 0, 8, 80);
+    }
+
     if (opt.copy_shr)
     {
         HEADER0("copy_shr");
@@ -29,6 +29,7 @@
 #include "mbdstharness.h"
 #include "ipfilterharness.h"
 #include "intrapredharness.h"
+#include "benchresults.h"
 #include "param.h"
 #include "cpu.h"
 
@@ -78,14 +79,29 @@ const char* const* chromaPartStr[X265_CSP_COUNT] =
     lumaPartStr
 };
 
+char g_primitiveName[128];
+
+BenchResults results;
+
+void reportCycles(const void *func, size_t size, float cycles, float refCycles)
+{
+    results.add(g_primitiveName, func, size, cycles, refCycles);
+}
+
 void do_help()
 {
     printf("x265 optimized primitive testbench\n\n");
-    printf("usage: TestBench [--cpuid CPU] [--testbench BENCH] [--help]\n\n");
+    printf("usage: TestBench [--cpuid CPU] [--testbench BENCH] [--json FILE] [--csv FILE]\n");
+    printf("                 [--diff FILE [--against FILE]] [--threshold PERCENT] [--help]\n\n");
     printf("       CPU is comma separated SIMD arch list, example: SSE4,AVX\n");
     printf("       BENCH is one of (pixel,transforms,interp,intrapred)\n\n");
     printf("By default, the test bench will test all benches on detected CPU architectures\n");
-    printf("Options and testbench name may be truncated.\n");
+    printf("Options and testbench name may be truncated.\n\n");
+    printf("--json and --csv write the cycles, cycles per pixel and winning ISA of every\n");
+    printf("measured primitive. --diff compares the results with a previous JSON or CSV\n");
+    printf("file and reports the primitives which are more than --threshold percent\n");
+    printf("slower (default 5). With --against, two result files are compared and\n");
+    printf("nothing is measured. The exit code is 1 if any primitive is slower.\n");
 }
 
 PixelHarness  HPixel;
@@ -97,6 +113,11 @@ int main(int argc, char *argv[])
 {
     int cpuid = x265::cpu_detect();
     const char *testname = 0;
+    const char *jsonname = 0;
+    const char *csvname = 0;
+    const char *diffname = 0;
+    const char *againstname = 0;
+    double threshold = 5;
 
     if (!(argc & 1))
     {
@@ -128,6 +149,16 @@ int main(int argc, char *argv[])
             testname = value;
             printf("Testing only harnesses that match name <%s>\n", testname);
         }
+        else if (!strncmp(name, "json", strlen(name)))
+            jsonname = value;
+        else if (!strncmp(name, "csv", strlen(name)))
+            csvname = value;
+        else if (!strncmp(name, "diff", strlen(name)))
+            diffname = value;
+        else if (!strncmp(name, "against", strlen(name)))
+            againstname = value;
+        else if (!strncmp(name, "threshold", strlen(name)))
+            threshold = atof(value);
         else
         {
             printf("** invalid long argument: %s\n\n", name);
@@ -136,6 +167,27 @@ int main(int argc, char *argv[])
         }
     }
 
+    BenchResults baseline;
+    if (diffname && !baseline.load(diffname))
+    {
+        printf("Unable to read results file %s\n", diffname);
+        return 1;
+    }
+    if (againstname)
+    {
+        if (!diffname)
+        {
+            printf("--against requires --diff\n");
+            return 1;
+        }
+        if (!results.load(againstname))
+        {
+            printf("Unable to read results file %s\n", againstname);
+            return 1;
+        }
+        return BenchResults::compare(baseline, results, threshold) ? 1 : 0;
+    }
+
     int seed = (int)time(NULL);
     const char *bpp[] = { "8bpp", "16bpp" };
     printf("Using random seed %X %s\n", seed, bpp[HIGH_BIT_DEPTH]);
@@ -178,6 +230,8 @@ int main(int argc, char *argv[])
         else
             continue;
 
+        results.addIsa(test_arch[i].name, test_arch[i].flag);
+
         EncoderPrimitives vecprim;
         memset(&vecprim, 0, sizeof(vecprim));
         Setup_Instrinsic_Primitives(vecprim, test_arch[i].flag);
@@ -220,6 +274,7 @@ int main(int argc, char *argv[])
      * global primitive table, so set up those pointers. This is a
      * bit ugly, but I don't see a better solution */
     memcpy(&primitives, &optprim, sizeof(EncoderPrimitives));
+    results.setPrimitives(cprim, optprim);
 
     printf("\nTest performance improvement with full optimizations\n");
 
@@ -232,5 +287,13 @@ int main(int argc, char *argv[])
     }
 
     printf("\n");
+
+    if (jsonname && !results.writeJSON(jsonname))
+        printf("Unable to write results file %s\n", jsonname);
+    if (csvname && !results.writeCSV(csvname))
+        printf("Unable to write results file %s\n", csvname);
+    if (diffname)
+        return BenchResults::compare(baseline, results, threshold) ? 1 : 0;
+
     return 0;
 }
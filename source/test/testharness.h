@@ -47,6 +47,17 @@ using namespace x265;
 extern const char* lumaPartStr[NUM_LUMA_PARTITIONS];
 extern const char* const* chromaPartStr[X265_CSP_COUNT];
 
+/* name of the primitive being measured, printed by HEADER and recorded with
+ * its cycle counts by REPORT_SPEEDUP */
+extern char g_primitiveName[128];
+
+#define HEADER(str, ...) sprintf(g_primitiveName, str, __VA_ARGS__); printf("%22s", g_primitiveName);
+#define HEADER0(str) strcpy(g_primitiveName, str); printf("%22s", str);
+
+/* record the cycles of one primitive for the --json and --csv output. func
+ * is the address of its entry in the optimized primitive table */
+void reportCycles(const void *func, size_t size, float cycles, float refCycles);
+
 class TestHarness
 {
 public:
@@ -86,7 +97,8 @@ static inline uint32_t __rdtsc(void)
 
 // Adapted from checkasm.c, runs each optimized primitive four times, measures rdtsc
 // and discards invalid times.  Repeats 1000 times to get a good average.  Then measures
-// the C reference with fewer runs and reports X factor and average cycles.
+// the C reference with fewer runs and reports X factor and average cycles (in tenths
+// of a cycle on the console, in cycles to reportCycles)
 #define REPORT_SPEEDUP(RUNOPT, RUNREF, ...) \
     { \
         uint32_t cycles = 0; int runs = 0; \
@@ -116,6 +128,7 @@ static inline uint32_t __rdtsc(void)
         float refperf = (10.0f * refcycles / refruns) / 4; \
         printf("\t%3.2fx ", refperf / optperf); \
         printf("\t %-8.2lf \t %-8.2lf\n", optperf, refperf); \
+        reportCycles(&(RUNOPT), sizeof(RUNOPT), optperf / 10, refperf / 10); \
     }
 
 extern "C" {
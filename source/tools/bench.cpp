@@ -0,0 +1,702 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+/* x265-bench: whole encoder benchmark on synthetic content.
+ *
+ * Deterministic 8bit 4:2:0 sequences are generated in memory, so the runs
+ * are reproducible on any machine and need no input files. Every content
+ * type at every resolution is encoded with every preset and thread
+ * configuration through the public API. The fps, the time spent by the
+ * stages of the encoder and the bitrate and PSNR of each run are written as
+ * JSON, one result per line.
+ *
+ * Content types:
+ *   gradient  smooth gradients moving diagonally
+ *   noise     a moving gradient with uniform noise
+ *   scenecut  block patterns which change every 12 frames
+ *   pan       a detailed texture panning right and down
+ *   screen    static text-like screen content with a line being typed
+ *
+ * With --baseline the results are compared against a previous JSON output
+ * and the exit code is 1 if any run is slower, larger or of lower quality
+ * than the thresholds allow. */
+
+#include "x265.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+namespace {
+
+enum Content
+{
+    CONTENT_GRADIENT,
+    CONTENT_NOISE,
+    CONTENT_SCENECUT,
+    CONTENT_PAN,
+    CONTENT_SCREEN,
+    CONTENT_COUNT
+};
+
+const char * const contentNames[] = { "gradient", "noise", "scenecut", "pan", "screen", 0 };
+
+struct Options
+{
+    const char* contents;
+    const char* resolutions;
+    const char* presets;
+    const char* threads;        // pool threads:frame threads pairs
+    const char* jsonFile;
+    const char* baselineFile;
+    int         frames;
+    int         ctuSize;        // one CTU size is allowed per process
+    int         repeat;         // the fastest of repeated runs is reported
+    double      maxSlowdown;    // percent of fps
+    double      maxBitrateGain; // percent of bitrate
+    double      maxPsnrDrop;    // dB
+};
+
+struct Result
+{
+    char     name[128];
+    char     content[16];
+    char     preset[16];
+    int      width;
+    int      height;
+    int      poolThreads;
+    int      frameThreads;
+    int      frames;
+    double   fps;
+    double   bitrate;
+    double   psnr;
+
+    /* milliseconds per frame, see x265_stats */
+    double   lookaheadWait;
+    double   refWait;
+    double   rowEncode;
+    double   rowEncodeWall;
+    double   filter;
+    double   entropy;
+    double   apiWait;
+    double   poolBusy;          // percent
+};
+
+int64_t benchTime()
+{
+#if _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (int64_t)(count.QuadPart * 1000000 / freq.QuadPart);
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t hash3(int x, int y, int z)
+{
+    return hash((uint32_t)x * 0x9E3779B1u ^ hash((uint32_t)y * 0x85EBCA77u ^ hash((uint32_t)z)));
+}
+
+uint8_t clip(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/* value noise at 16 pixel scale with fine detail, the texture of pan */
+int texture(int x, int y)
+{
+    int gx = x >> 4, gy = y >> 4;
+    int fx = x & 15, fy = y & 15;
+    int a = hash3(gx, gy, 0) & 255, b = hash3(gx + 1, gy, 0) & 255;
+    int c = hash3(gx, gy + 1, 0) & 255, d = hash3(gx + 1, gy + 1, 0) & 255;
+    int top = a * (16 - fx) + b * fx;
+    int bottom = c * (16 - fx) + d * fx;
+    int smooth = (top * (16 - fy) + bottom * fy) >> 8;
+
+    return smooth + (int)(hash3(x, y, 1) & 31) - 16;
+}
+
+/* 4x6 glyph cells scaled 2x, a character every 10 pixels on 16 pixel lines */
+bool screenText(int x, int y, int typed)
+{
+    int line = y / 16, col = x / 10;
+    int cx = (x % 10) / 2, cy = (y % 16 - 2) / 2;
+
+    if (cx >= 4 || cy < 0 || cy >= 6)
+        return false;
+    uint32_t h = hash3(line, col, 2);
+    if ((h & 7) == 0)
+        return false; // space
+    if (line >= 6 && line * 64 + col >= typed)
+        return false; // not typed yet
+    return !!((h >> (8 + cy * 4 + cx)) & 1);
+}
+
+void generateFrame(Content content, int frame, int width, int height, uint8_t* planes[3])
+{
+    int cw = width >> 1, ch = height >> 1;
+    uint8_t *luma = planes[0], *cb = planes[1], *cr = planes[2];
+
+    switch (content)
+    {
+    case CONTENT_GRADIENT:
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                luma[y * width + x] = (uint8_t)(((x + 2 * frame) * 192 / width + (y + frame) * 64 / height) & 255);
+        for (int y = 0; y < ch; y++)
+            for (int x = 0; x < cw; x++)
+            {
+                cb[y * cw + x] = (uint8_t)(64 + ((x + frame) * 128 / cw & 127));
+                cr[y * cw + x] = (uint8_t)(64 + ((y + frame) * 128 / ch & 127));
+            }
+        break;
+
+    case CONTENT_NOISE:
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                luma[y * width + x] = clip(64 + (x + frame) * 128 / width + (int)(hash3(x, y, frame) & 63) - 32);
+        for (int y = 0; y < ch; y++)
+            for (int x = 0; x < cw; x++)
+            {
+                cb[y * cw + x] = clip(128 + (int)(hash3(x, y, frame + 1000) & 15) - 8);
+                cr[y * cw + x] = clip(128 + (int)(hash3(x, y, frame + 2000) & 15) - 8);
+            }
+        break;
+
+    case CONTENT_SCENECUT:
+    {
+        int scene = frame / 12;
+        uint32_t h = hash(scene);
+        int block = 8 << (h % 3);
+        int base = 32 + (h >> 8) % 128;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+            {
+                int check = (((x + frame) / block + y / block) & 1) * 64;
+                luma[y * width + x] = clip(base + check + (x + y) * 32 / (width + height));
+            }
+        for (int y = 0; y < ch; y++)
+            for (int x = 0; x < cw; x++)
+            {
+                cb[y * cw + x] = (uint8_t)(96 + ((h >> 16) & 63));
+                cr[y * cw + x] = (uint8_t)(96 + ((h >> 24) & 63) + (x * 16 / cw));
+            }
+        break;
+    }
+
+    case CONTENT_PAN:
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                luma[y * width + x] = clip(texture(x + 3 * frame, y + frame));
+        for (int y = 0; y < ch; y++)
+            for (int x = 0; x < cw; x++)
+            {
+                int t = texture(2 * x + 3 * frame + 4096, 2 * y + frame);
+                cb[y * cw + x] = clip(128 + (t - 128) / 4);
+                cr[y * cw + x] = clip(128 - (t - 128) / 4);
+            }
+        break;
+
+    case CONTENT_SCREEN:
+    default:
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+            {
+                uint8_t v = y < 24 ? 60 : 235;
+                if (y >= 32 && x >= 8 && screenText(x - 8, y - 32, frame * 4))
+                    v = 16;
+                luma[y * width + x] = v;
+            }
+        for (int y = 0; y < ch; y++)
+            for (int x = 0; x < cw; x++)
+            {
+                cb[y * cw + x] = y < 12 ? 160 : 128;
+                cr[y * cw + x] = y < 12 ? 100 : 128;
+            }
+        break;
+    }
+}
+
+/* returns the next item of a comma separated list in item, or false */
+bool nextItem(const char*& list, char* item, size_t size)
+{
+    if (!list || !*list)
+        return false;
+
+    const char* end = strchr(list, ',');
+    size_t len = end ? (size_t)(end - list) : strlen(list);
+    if (len >= size)
+        len = size - 1;
+    memcpy(item, list, len);
+    item[len] = 0;
+    list = end ? end + 1 : list + strlen(list);
+    return true;
+}
+
+/* weighted YUV PSNR of a reconstructed picture against its 8bit source, at
+ * the bit depth of the reconstruction */
+double picturePsnr(const x265_picture& recon, const uint8_t* src, int width, int height)
+{
+    int shift = recon.bitDepth - 8;
+    double maxval = (double)(255 << shift);
+    double psnr = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int w = i ? width >> 1 : width;
+        int h = i ? height >> 1 : height;
+        uint64_t ssd = 0;
+
+        for (int y = 0; y < h; y++)
+        {
+            const char* row = (const char*)recon.planes[i] + y * recon.stride[i];
+            for (int x = 0; x < w; x++)
+            {
+                int r = shift ? ((const uint16_t*)row)[x] : ((const uint8_t*)row)[x];
+                int d = (src[y * w + x] << shift) - r;
+                ssd += d * d;
+            }
+        }
+        src += w * h;
+
+        double p = ssd ? 10.0 * log10(maxval * maxval * w * h / (double)ssd) : 99.99;
+        psnr += p * (i ? 1 : 6);
+    }
+
+    return psnr / 8;
+}
+
+bool runEncode(const Options& opt, const char* preset, int poolThreads, int frameThreads,
+               int width, int height, uint8_t* const* frames, Result& res)
+{
+    x265_param* param = x265_param_alloc();
+    if (!param || x265_param_default_preset(param, preset, NULL) < 0)
+    {
+        fprintf(stderr, "x265-bench [error]: unknown preset %s\n", preset);
+        x265_param_free(param);
+        return false;
+    }
+
+    char value[16];
+    sprintf(value, "%d", poolThreads);
+    x265_param_parse(param, "threads", value);
+    sprintf(value, "%d", frameThreads);
+    x265_param_parse(param, "frame-threads", value);
+    param->maxCUSize = opt.ctuSize;
+    param->sourceWidth = width;
+    param->sourceHeight = height;
+    param->fpsNum = 30;
+    param->fpsDenom = 1;
+    param->internalCsp = X265_CSP_I420;
+    param->totalFrames = opt.frames;
+    param->logLevel = X265_LOG_ERROR;
+
+    x265_encoder* encoder = x265_encoder_open(param);
+    if (!encoder)
+    {
+        fprintf(stderr, "x265-bench [error]: unable to open encoder\n");
+        x265_param_free(param);
+        return false;
+    }
+
+    x265_picture* pic = x265_picture_alloc();
+    x265_picture_init(param, pic);
+    pic->bitDepth = 8;
+    pic->stride[0] = width;
+    pic->stride[1] = pic->stride[2] = width >> 1;
+
+    x265_picture* recon = x265_picture_alloc();
+    x265_picture_init(param, recon);
+
+    /* the encoder does not measure PSNR below X265_LOG_INFO, the recon
+     * pictures are measured here and the time spent is not counted */
+    double psnrSum = 0;
+    int64_t psnrTime = 0;
+
+    x265_nal* nal;
+    uint32_t numNal;
+    int ret = 0;
+    int64_t start = benchTime();
+    for (int i = 0; ret >= 0; i++)
+    {
+        x265_picture* in = NULL;
+        if (i < opt.frames)
+        {
+            pic->planes[0] = frames[i];
+            pic->planes[1] = frames[i] + width * height;
+            pic->planes[2] = frames[i] + width * height + (width >> 1) * (height >> 1);
+            pic->pts = i;
+            in = pic;
+        }
+        ret = x265_encoder_encode(encoder, &nal, &numNal, in, recon);
+
+        if (ret > 0)
+        {
+            int64_t psnrStart = benchTime();
+            psnrSum += picturePsnr(*recon, frames[recon->pts], width, height);
+            psnrTime += benchTime() - psnrStart;
+        }
+        else if (!ret && !in)
+            break; // the encoder is flushed
+    }
+    int64_t elapsed = benchTime() - start - psnrTime;
+
+    x265_stats stats;
+    x265_encoder_get_stats(encoder, &stats, sizeof(stats));
+    x265_encoder_close(encoder);
+    x265_picture_free(pic);
+    x265_picture_free(recon);
+    x265_param_free(param);
+
+    if (ret < 0)
+    {
+        fprintf(stderr, "x265-bench [error]: encode failed\n");
+        return false;
+    }
+
+    double fps = opt.frames * 1000000.0 / (elapsed ? elapsed : 1);
+    if (fps <= res.fps)
+        return true; // a faster repeat was already recorded
+
+    double msPerFrame = 1000.0 / (stats.encodedPictureCount ? stats.encodedPictureCount : 1);
+    res.fps = fps;
+    res.frames = stats.encodedPictureCount;
+    res.bitrate = stats.bitrate;
+    res.psnr = stats.encodedPictureCount ? psnrSum / stats.encodedPictureCount : 0;
+    res.lookaheadWait = stats.lookaheadWaitTime * msPerFrame;
+    res.refWait = stats.refWaitTime * msPerFrame;
+    res.rowEncode = stats.rowEncodeTime * msPerFrame;
+    res.rowEncodeWall = stats.rowEncodeWallTime * msPerFrame;
+    res.filter = stats.filterTime * msPerFrame;
+    res.entropy = stats.entropyTime * msPerFrame;
+    res.apiWait = stats.apiWaitTime * msPerFrame;
+    double poolTime = stats.poolBusyTime + stats.poolIdleTime;
+    res.poolBusy = poolTime > 0 ? 100.0 * stats.poolBusyTime / poolTime : 0;
+    return true;
+}
+
+void writeResult(FILE* fh, const Result& r, bool bLast)
+{
+    fprintf(fh, "    {\"name\": \"%s\", \"content\": \"%s\", \"width\": %d, \"height\": %d, \"preset\": \"%s\", "
+                "\"threads\": %d, \"frameThreads\": %d, \"frames\": %d, \"fps\": %.3f, \"bitrate\": %.3f, \"psnr\": %.4f, "
+                "\"lookaheadWaitMs\": %.3f, \"refWaitMs\": %.3f, \"rowEncodeMs\": %.3f, \"rowEncodeWallMs\": %.3f, "
+                "\"filterMs\": %.3f, \"entropyMs\": %.3f, \"apiWaitMs\": %.3f, \"poolBusy\": %.1f}%s\n",
+            r.name, r.content, r.width, r.height, r.preset, r.poolThreads, r.frameThreads, r.frames, r.fps, r.bitrate, r.psnr,
+            r.lookaheadWait, r.refWait, r.rowEncode, r.rowEncodeWall, r.filter, r.entropy, r.apiWait, r.poolBusy,
+            bLast ? "" : ",");
+}
+
+bool jsonNumber(const char* line, const char* key, double& value)
+{
+    char pattern[64];
+    sprintf(pattern, "\"%s\": ", key);
+    const char* p = strstr(line, pattern);
+    if (!p)
+        return false;
+    value = strtod(p + strlen(pattern), NULL);
+    return true;
+}
+
+/* compare against the results of a previous run, returns the number of
+ * regressions or -1 if the baseline cannot be read. Results are matched by
+ * name, one result per line */
+int compareBaseline(const Options& opt, const Result* results, int numResults)
+{
+    FILE* fh = fopen(opt.baselineFile, "rb");
+    if (!fh)
+    {
+        fprintf(stderr, "x265-bench [error]: unable to open baseline %s\n", opt.baselineFile);
+        return -1;
+    }
+
+    int regressions = 0, matched = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), fh))
+    {
+        const char* p = strstr(line, "\"name\": \"");
+        if (!p)
+            continue;
+        p += strlen("\"name\": \"");
+        const char* end = strchr(p, '"');
+        if (!end)
+            continue;
+
+        const Result* r = NULL;
+        for (int i = 0; i < numResults && !r; i++)
+            if (strlen(results[i].name) == (size_t)(end - p) && !strncmp(results[i].name, p, end - p))
+                r = &results[i];
+        if (!r)
+            continue;
+        matched++;
+
+        double fps, bitrate, psnr;
+        if (!jsonNumber(line, "fps", fps) || !jsonNumber(line, "bitrate", bitrate) || !jsonNumber(line, "psnr", psnr))
+            continue;
+
+        bool bSlower = r->fps < fps * (1 - opt.maxSlowdown / 100);
+        bool bLarger = r->bitrate > bitrate * (1 + opt.maxBitrateGain / 100);
+        bool bWorse = r->psnr < psnr - opt.maxPsnrDrop;
+        fprintf(stderr, "%-48s fps %9.2f -> %9.2f (%+6.1f%%)  kb/s %+6.2f%%  PSNR %+7.3f dB%s\n",
+                r->name, fps, r->fps, fps > 0 ? 100 * (r->fps / fps - 1) : 0,
+                bitrate > 0 ? 100 * (r->bitrate / bitrate - 1) : 0, r->psnr - psnr,
+                bSlower || bLarger || bWorse ? "  REGRESSION" : "");
+        regressions += bSlower || bLarger || bWorse;
+    }
+    bool bReadError = !!ferror(fh);
+    fclose(fh);
+    if (bReadError)
+    {
+        fprintf(stderr, "x265-bench [error]: unable to read baseline %s\n", opt.baselineFile);
+        return -1;
+    }
+
+    if (matched < numResults)
+        fprintf(stderr, "x265-bench [warning]: %d of %d results not in the baseline\n", numResults - matched, numResults);
+
+    return regressions;
+}
+
+void showHelp()
+{
+    printf("Usage: x265-bench [options]\n\n");
+    printf("   --content <list>          Content types: gradient,noise,scenecut,pan,screen. Default all\n");
+    printf("   --res <list>              Resolutions WxH, even. Default 640x360,1280x720\n");
+    printf("   --preset <list>           Presets. Default ultrafast,medium\n");
+    printf("   --threads <list>          Pool threads:frame threads, 0 for auto. Default 1:1,0:0\n");
+    printf("   --frames <integer>        Frames of each sequence. Default 60\n");
+    printf("   --ctu <64|32|16>          CTU size of every preset. Default 64\n");
+    printf("   --repeat <integer>        Runs of each encode, the fastest is reported. Default 1\n");
+    printf("   --json <filename>         Write the results to a file. Default stdout\n");
+    printf("   --baseline <filename>     Compare against the JSON results of a previous run\n");
+    printf("   --max-slowdown <float>    Fps loss in percent which is a regression. Default 5\n");
+    printf("   --max-bitrate <float>     Bitrate gain in percent which is a regression. Default 0.5\n");
+    printf("   --max-psnr-drop <float>   PSNR loss in dB which is a regression. Default 0.02\n");
+}
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    opt.contents = "gradient,noise,scenecut,pan,screen";
+    opt.resolutions = "640x360,1280x720";
+    opt.presets = "ultrafast,medium";
+    opt.threads = "1:1,0:0";
+    opt.jsonFile = NULL;
+    opt.baselineFile = NULL;
+    opt.frames = 60;
+    opt.ctuSize = 64;
+    opt.repeat = 1;
+    opt.maxSlowdown = 5;
+    opt.maxBitrateGain = 0.5;
+    opt.maxPsnrDrop = 0.02;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+        {
+            showHelp();
+            return 0;
+        }
+        if (!value)
+        {
+            fprintf(stderr, "x265-bench [error]: missing value or unknown option %s\n", arg);
+            return 2;
+        }
+        i++;
+        if (!strcmp(arg, "--content")) opt.contents = value;
+        else if (!strcmp(arg, "--res")) opt.resolutions = value;
+        else if (!strcmp(arg, "--preset")) opt.presets = value;
+        else if (!strcmp(arg, "--threads")) opt.threads = value;
+        else if (!strcmp(arg, "--frames")) opt.frames = atoi(value);
+        else if (!strcmp(arg, "--ctu")) opt.ctuSize = atoi(value);
+        else if (!strcmp(arg, "--repeat")) opt.repeat = atoi(value);
+        else if (!strcmp(arg, "--json")) opt.jsonFile = value;
+        else if (!strcmp(arg, "--baseline")) opt.baselineFile = value;
+        else if (!strcmp(arg, "--max-slowdown")) opt.maxSlowdown = atof(value);
+        else if (!strcmp(arg, "--max-bitrate")) opt.maxBitrateGain = atof(value);
+        else if (!strcmp(arg, "--max-psnr-drop")) opt.maxPsnrDrop = atof(value);
+        else
+        {
+            fprintf(stderr, "x265-bench [error]: unknown option %s\n", arg);
+            return 2;
+        }
+    }
+    if (opt.frames < 1 || opt.repeat < 1)
+    {
+        fprintf(stderr, "x265-bench [error]: invalid frame or repeat count\n");
+        return 2;
+    }
+
+    /* count the runs */
+    int numRuns = 0;
+    {
+        char item[64];
+        int n[4] = { 0, 0, 0, 0 };
+        const char* lists[4] = { opt.contents, opt.resolutions, opt.presets, opt.threads };
+        for (int l = 0; l < 4; l++)
+            for (const char* p = lists[l]; nextItem(p, item, sizeof(item));)
+                n[l]++;
+        numRuns = n[0] * n[1] * n[2] * n[3];
+    }
+
+    Result* results = (Result*)calloc(numRuns ? numRuns : 1, sizeof(Result));
+    if (!results)
+        return 2;
+    int numResults = 0;
+    bool bError = false;
+
+    char resItem[64];
+    for (const char* resList = opt.resolutions; nextItem(resList, resItem, sizeof(resItem)) && !bError;)
+    {
+        int width = 0, height = 0;
+        if (sscanf(resItem, "%dx%d", &width, &height) != 2 || width < 64 || height < 64 || (width | height) & 1)
+        {
+            fprintf(stderr, "x265-bench [error]: invalid resolution %s\n", resItem);
+            bError = true;
+            break;
+        }
+
+        size_t frameSize = (size_t)width * height * 3 / 2;
+        uint8_t* buffer = (uint8_t*)malloc(frameSize * opt.frames);
+        uint8_t** frames = (uint8_t**)malloc(sizeof(uint8_t*) * opt.frames);
+        if (!buffer || !frames)
+        {
+            fprintf(stderr, "x265-bench [error]: unable to allocate %d frames of %s\n", opt.frames, resItem);
+            free(buffer);
+            free(frames);
+            bError = true;
+            break;
+        }
+
+        char contentItem[64];
+        for (const char* contentList = opt.contents; nextItem(contentList, contentItem, sizeof(contentItem)) && !bError;)
+        {
+            int content = 0;
+            while (contentNames[content] && strcmp(contentNames[content], contentItem))
+                content++;
+            if (!contentNames[content])
+            {
+                fprintf(stderr, "x265-bench [error]: unknown content %s\n", contentItem);
+                bError = true;
+                break;
+            }
+
+            for (int i = 0; i < opt.frames; i++)
+            {
+                frames[i] = buffer + frameSize * i;
+                uint8_t* planes[3] = { frames[i], frames[i] + width * height, frames[i] + width * height + (width >> 1) * (height >> 1) };
+                generateFrame((Content)content, i, width, height, planes);
+            }
+
+            char presetItem[64];
+            for (const char* presetList = opt.presets; nextItem(presetList, presetItem, sizeof(presetItem)) && !bError;)
+            {
+                char threadItem[64];
+                for (const char* threadList = opt.threads; nextItem(threadList, threadItem, sizeof(threadItem)) && !bError;)
+                {
+                    int poolThreads = 0, frameThreads = 0;
+                    if (sscanf(threadItem, "%d:%d", &poolThreads, &frameThreads) < 1)
+                    {
+                        fprintf(stderr, "x265-bench [error]: invalid thread configuration %s\n", threadItem);
+                        bError = true;
+                        break;
+                    }
+
+                    Result& r = results[numResults];
+                    sprintf(r.name, "%.15s-%dx%d-%.15s-%dx%d", contentItem, width, height, presetItem, poolThreads, frameThreads);
+                    sprintf(r.content, "%.15s", contentItem);
+                    sprintf(r.preset, "%.15s", presetItem);
+                    r.width = width;
+                    r.height = height;
+                    r.poolThreads = poolThreads;
+                    r.frameThreads = frameThreads;
+
+                    for (int rep = 0; rep < opt.repeat && !bError; rep++)
+                        bError = !runEncode(opt, presetItem, poolThreads, frameThreads, width, height, frames, r);
+                    if (bError)
+                        break;
+
+                    fprintf(stderr, "%-48s %9.2f fps %10.2f kb/s %8.3f dB\n", r.name, r.fps, r.bitrate, r.psnr);
+                    numResults++;
+                }
+            }
+        }
+
+        free(buffer);
+        free(frames);
+    }
+
+    FILE* fh = opt.jsonFile ? fopen(opt.jsonFile, "wb") : stdout;
+    if (!fh)
+    {
+        fprintf(stderr, "x265-bench [error]: unable to write %s\n", opt.jsonFile);
+        bError = true;
+    }
+    else
+    {
+        fprintf(fh, "{\n  \"version\": \"%s\",\n  \"build\": \"%s\",\n  \"frames\": %d,\n  \"ctu\": %d,\n  \"results\": [\n",
+                x265_version_str, x265_build_info_str, opt.frames, opt.ctuSize);
+        for (int i = 0; i < numResults; i++)
+            writeResult(fh, results[i], i + 1 == numResults);
+        fprintf(fh, "  ]\n}\n");
+        if (fh != stdout)
+            fclose(fh);
+    }
+
+    int regressions = 0;
+    if (opt.baselineFile && !bError)
+    {
+        regressions = compareBaseline(opt, results, numResults);
+        if (regressions < 0)
+            bError = true;
+        else
+            fprintf(stderr, "x265-bench: %d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    }
+
+    free(results);
+    x265_cleanup();
+
+    return bError ? 2 : regressions ? 1 : 0;
+}
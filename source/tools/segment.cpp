@@ -0,0 +1,685 @@
+/*****************************************************************************
+ * Copyright (C) 2014 x265 project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+/* x265-segment: helper for multipass stats and segmented (chunked) encodes
+ * of one title.
+ *
+ * A title is split into frame ranges which are encoded independently, each
+ * with --seek/--frames and --segment-start <first frame>. Every segment
+ * starts with an IDR picture and no picture references across a segment
+ * boundary, so the segments can be encoded concurrently.
+ *
+ *   x265-segment stats <title.stats> <seg0.stats> [seg1.stats ...]
+ *      merges the first pass stats (and .cutree files) of the segments into
+ *      one title-wide stats file, renumbering frames so they are contiguous.
+ *      Each segment then runs its last pass against the merged file with its
+ *      --segment-start, so the bit allocation is planned across the title.
+ *
+ *   x265-segment totext|tobinary <in.stats> <out.stats>
+ *      converts stats between the text and the binary (memory mapped) format.
+ *
+ *   x265-segment concat <title.hevc> <seg0.hevc> [seg1.hevc ...]
+ *      stitches the Annex-B bitstreams of the segments. Each segment must
+ *      begin with an IDR, which resets POC, so no slice needs rewriting.
+ *      Parameter sets identical to those of the first segment and the
+ *      encoder info SEI are dropped from the following segments, access
+ *      unit delimiters are kept as they were coded. */
+
+#include "x265.h"
+#include "statsfile.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+using namespace x265;
+
+namespace {
+
+struct Buffer
+{
+    uint8_t* data;
+    size_t   size;
+};
+
+bool readFile(const char* filename, Buffer& buf)
+{
+    buf.data = NULL;
+    buf.size = 0;
+
+    FILE* fh = fopen(filename, "rb");
+    if (!fh)
+    {
+        fprintf(stderr, "x265-segment [error]: unable to open %s\n", filename);
+        return false;
+    }
+
+    bool bError = fseek(fh, 0, SEEK_END) < 0;
+    long fSize = ftell(fh);
+    bError |= fSize < 0;
+    bError |= fseek(fh, 0, SEEK_SET) < 0;
+    if (!bError)
+    {
+        buf.size = (size_t)fSize;
+        buf.data = (uint8_t*)malloc(buf.size + 1);
+        bError = !buf.data || fread(buf.data, 1, buf.size, fh) != buf.size;
+        if (buf.data)
+            buf.data[buf.size] = 0;
+    }
+    fclose(fh);
+
+    if (bError)
+    {
+        fprintf(stderr, "x265-segment [error]: unable to read %s\n", filename);
+        free(buf.data);
+        buf.data = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool fileExists(const char* filename)
+{
+    FILE* fh = fopen(filename, "rb");
+    if (fh)
+        fclose(fh);
+    return !!fh;
+}
+
+char* cutreeFilename(const char* statFilename)
+{
+    size_t len = strlen(statFilename);
+    char* name = (char*)malloc(len + sizeof(".cutree"));
+    if (name)
+    {
+        memcpy(name, statFilename, len);
+        memcpy(name + len, ".cutree", sizeof(".cutree"));
+    }
+    return name;
+}
+
+/* remove " segment-start=N" from an options string so the options of
+ * segments of the same title compare equal */
+void stripSegmentStart(char* opts)
+{
+    char* p = strstr(opts, " segment-start=");
+    if (p)
+    {
+        char* end = p + 1;
+        while (*end && *end != ' ')
+            end++;
+        memmove(p, end, strlen(end) + 1);
+    }
+}
+
+/* first pass stats of a title or segment, in encode order. The CU-tree data
+ * of the entries with bHasCuTree follows in the same order */
+struct Stats
+{
+    char*            options;
+    StatsFileRecord* entries;
+    int              numEntries;
+    uint16_t*        cuTree;
+    int              numCuTree;   /* qp offsets per frame */
+    int              numCuTreeRecords;
+    bool             bBinary;
+};
+
+void freeStats(Stats& stats)
+{
+    free(stats.options);
+    free(stats.entries);
+    free(stats.cuTree);
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool isReferenced(char type) { return type != 'b' && type != 'p'; }
+
+bool loadTextStats(const char* filename, Buffer& buf, Stats& stats)
+{
+    char* line = strchr((char*)buf.data, '\n');
+    if (strncmp((char*)buf.data, "#options: ", 10) || !line)
+    {
+        fprintf(stderr, "x265-segment [error]: %s is not a stats file\n", filename);
+        return false;
+    }
+    *line++ = 0;
+    stats.options = strdup((char*)buf.data + 10);
+
+    int maxEntries = 1;
+    for (char* p = line; (p = strchr(p, ';')) != NULL; p++)
+        maxEntries++;
+    stats.entries = (StatsFileRecord*)calloc(maxEntries, sizeof(StatsFileRecord));
+    if (!stats.options || !stats.entries)
+        return false;
+
+    int numRefs = 0;
+    while (*line)
+    {
+        char* next = strchr(line, ';');
+        if (next)
+            *next++ = 0;
+        else
+            next = line + strlen(line);
+
+        StatsFileRecord& rec = stats.entries[stats.numEntries];
+        int e = sscanf(line, " in:%d out:%d type:%c q:%lf q-aq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf",
+                       &rec.frameNumber, &rec.encodeOrder, &rec.type, &rec.qpRc, &rec.qpAq,
+                       &rec.coeffBits, &rec.mvBits, &rec.miscBits,
+                       &rec.iCuCount, &rec.pCuCount, &rec.skipCuCount);
+        if (e == 11)
+        {
+            numRefs += isReferenced(rec.type);
+            stats.numEntries++;
+        }
+        else if (e > 0 || strspn(line, " \r\n") != strlen(line))
+        {
+            fprintf(stderr, "x265-segment [error]: malformed entry %d in %s\n", stats.numEntries, filename);
+            return false;
+        }
+        line = next;
+    }
+
+    /* the CU-tree side file holds a slice type byte and the qp offsets of
+     * each referenced frame, in encode order */
+    char* cutreeName = cutreeFilename(filename);
+    if (cutreeName && fileExists(cutreeName))
+    {
+        Buffer cutree;
+        bool bOk = readFile(cutreeName, cutree);
+        size_t recordSize = numRefs ? cutree.size / numRefs : 0;
+        if (bOk && (!recordSize || recordSize * numRefs != cutree.size || !(recordSize & 1)))
+        {
+            fprintf(stderr, "x265-segment [error]: %s does not match the frames of %s\n", cutreeName, filename);
+            bOk = false;
+        }
+        if (bOk)
+        {
+            stats.numCuTree = (int)(recordSize / sizeof(uint16_t));
+            stats.cuTree = (uint16_t*)malloc(numRefs * stats.numCuTree * sizeof(uint16_t));
+            bOk = !!stats.cuTree;
+            for (int i = 0; i < stats.numEntries && bOk; i++)
+            {
+                if (!isReferenced(stats.entries[i].type))
+                    continue;
+                memcpy(stats.cuTree + stats.numCuTreeRecords * stats.numCuTree,
+                       cutree.data + stats.numCuTreeRecords * recordSize + 1,
+                       stats.numCuTree * sizeof(uint16_t));
+                stats.entries[i].bHasCuTree = 1;
+                stats.numCuTreeRecords++;
+            }
+        }
+        free(cutree.data);
+        if (!bOk)
+        {
+            free(cutreeName);
+            return false;
+        }
+    }
+    free(cutreeName);
+    return true;
+}
+
+bool loadBinaryStats(const char* filename, Buffer& buf, Stats& stats)
+{
+    const StatsFileHeader* header = (const StatsFileHeader*)buf.data;
+    if (buf.size < sizeof(StatsFileHeader) ||
+        header->version != X265_STATS_VERSION ||
+        header->headerSize != sizeof(StatsFileHeader) ||
+        header->recordSize != sizeof(StatsFileRecord) ||
+        header->optionsOffset >= buf.size ||
+        header->indexOffset > buf.size ||
+        !memchr(buf.data + header->optionsOffset, 0, (size_t)(buf.size - header->optionsOffset)))
+    {
+        fprintf(stderr, "x265-segment [error]: unsupported or damaged binary stats file %s\n", filename);
+        return false;
+    }
+
+    const char* opts = (const char*)buf.data + header->optionsOffset;
+    stats.options = strdup(opts);
+    stats.numCuTree = header->numCuTree;
+    size_t cuTreeSize = (stats.numCuTree + 3) / 4 * 4 * sizeof(uint16_t);
+    size_t pos = (size_t)header->optionsOffset + (strlen(opts) + 8) / 8 * 8;
+    if (pos > header->indexOffset)
+    {
+        fprintf(stderr, "x265-segment [error]: damaged binary stats file %s\n", filename);
+        return false;
+    }
+    int maxEntries = (int)((header->indexOffset - pos) / sizeof(StatsFileRecord));
+    stats.entries = (StatsFileRecord*)calloc(maxEntries + 1, sizeof(StatsFileRecord));
+    stats.cuTree = (uint16_t*)malloc((maxEntries + 1) * stats.numCuTree * sizeof(uint16_t) + 1);
+    if (!stats.options || !stats.entries || !stats.cuTree)
+        return false;
+
+    /* records follow the options in encode order, up to the index */
+    while (pos + sizeof(StatsFileRecord) <= header->indexOffset)
+    {
+        StatsFileRecord& rec = stats.entries[stats.numEntries++];
+        memcpy(&rec, buf.data + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (rec.bHasCuTree)
+        {
+            if (pos + cuTreeSize > header->indexOffset)
+            {
+                fprintf(stderr, "x265-segment [error]: truncated CU-tree data in %s\n", filename);
+                return false;
+            }
+            memcpy(stats.cuTree + stats.numCuTreeRecords++ * stats.numCuTree, buf.data + pos,
+                   stats.numCuTree * sizeof(uint16_t));
+            pos += cuTreeSize;
+        }
+    }
+    stats.bBinary = true;
+    return true;
+}
+
+bool loadStats(const char* filename, Stats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    Buffer buf;
+    if (!readFile(filename, buf))
+        return false;
+    bool bOk;
+    if (buf.size >= 8 && !memcmp(buf.data, X265_STATS_MAGIC, 8))
+        bOk = loadBinaryStats(filename, buf, stats);
+    else
+        bOk = loadTextStats(filename, buf, stats);
+    free(buf.data);
+    if (!bOk)
+        freeStats(stats);
+    else
+        stripSegmentStart(stats.options);
+    return bOk;
+}
+
+bool writeTextStats(const char* filename, const Stats& stats)
+{
+    FILE* out = fopen(filename, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "x265-segment [error]: unable to create %s\n", filename);
+        return false;
+    }
+    bool bError = fprintf(out, "#options: %s\n", stats.options) < 0;
+    for (int i = 0; i < stats.numEntries && !bError; i++)
+    {
+        const StatsFileRecord& rec = stats.entries[i];
+        bError = fprintf(out, "in:%d out:%d type:%c q:%.2f q-aq:%.2f tex:%d mv:%d misc:%d icu:%.2f pcu:%.2f scu:%.2f ;\n",
+                         rec.frameNumber, rec.encodeOrder, rec.type, rec.qpRc, rec.qpAq,
+                         rec.coeffBits, rec.mvBits, rec.miscBits,
+                         rec.iCuCount, rec.pCuCount, rec.skipCuCount) < 0;
+    }
+    bError |= fclose(out) != 0;
+
+    if (stats.numCuTreeRecords && !bError)
+    {
+        char* cutreeName = cutreeFilename(filename);
+        FILE* cutree = cutreeName ? fopen(cutreeName, "wb") : NULL;
+        if (!cutree)
+        {
+            fprintf(stderr, "x265-segment [error]: unable to create CU-tree stats of %s\n", filename);
+            bError = true;
+        }
+        for (int i = 0, k = 0; i < stats.numEntries && cutree && !bError; i++)
+        {
+            if (!stats.entries[i].bHasCuTree)
+                continue;
+            /* slice type values as in the encoder: B 0, P 1, I 2 */
+            char t = stats.entries[i].type;
+            uint8_t sliceType = t == 'I' || t == 'i' ? 2 : t == 'P' || t == 'p' ? 1 : 0;
+            bError = fwrite(&sliceType, 1, 1, cutree) != 1 ||
+                     fwrite(stats.cuTree + k++ * stats.numCuTree, sizeof(uint16_t), stats.numCuTree, cutree) != (size_t)stats.numCuTree;
+        }
+        if (cutree)
+            bError |= fclose(cutree) != 0;
+        free(cutreeName);
+    }
+    if (bError)
+        fprintf(stderr, "x265-segment [error]: unable to write %s\n", filename);
+    return !bError;
+}
+
+bool writeBinaryStats(const char* filename, const Stats& stats)
+{
+    FILE* out = fopen(filename, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "x265-segment [error]: unable to create %s\n", filename);
+        return false;
+    }
+
+    int firstFrame = INT_MAX, lastFrame = -1;
+    for (int i = 0; i < stats.numEntries; i++)
+    {
+        firstFrame = stats.entries[i].frameNumber < firstFrame ? stats.entries[i].frameNumber : firstFrame;
+        lastFrame = stats.entries[i].frameNumber > lastFrame ? stats.entries[i].frameNumber : lastFrame;
+    }
+    if (!stats.numEntries)
+        firstFrame = 0;
+
+    StatsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, X265_STATS_MAGIC, sizeof(header.magic));
+    header.version = X265_STATS_VERSION;
+    header.headerSize = sizeof(StatsFileHeader);
+    header.recordSize = sizeof(StatsFileRecord);
+    header.numCuTree = stats.numCuTreeRecords ? stats.numCuTree : 0;
+    header.numEntries = lastFrame - firstFrame + 1;
+    header.firstFrame = firstFrame;
+    header.optionsOffset = sizeof(StatsFileHeader);
+
+    static const uint8_t pad[8] = { 0 };
+    size_t optsSize = strlen(stats.options) + 1;
+    size_t optsPad = (8 - optsSize % 8) % 8;
+    size_t cuTreePad = ((4 - stats.numCuTree % 4) % 4) * sizeof(uint16_t);
+    uint64_t* index = (uint64_t*)calloc(header.numEntries + 1, sizeof(uint64_t));
+    uint64_t pos = sizeof(header) + optsSize + optsPad;
+
+    bool bError = !index ||
+                  fwrite(&header, sizeof(header), 1, out) != 1 ||
+                  fwrite(stats.options, 1, optsSize, out) != optsSize ||
+                  fwrite(pad, 1, optsPad, out) != optsPad;
+    for (int i = 0, k = 0; i < stats.numEntries && !bError; i++)
+    {
+        const StatsFileRecord& rec = stats.entries[i];
+        index[rec.frameNumber - firstFrame] = pos;
+        bError = fwrite(&rec, sizeof(rec), 1, out) != 1;
+        pos += sizeof(rec);
+        if (rec.bHasCuTree && !bError)
+        {
+            bError = fwrite(stats.cuTree + k++ * stats.numCuTree, sizeof(uint16_t), stats.numCuTree, out) != (size_t)stats.numCuTree ||
+                     fwrite(pad, 1, cuTreePad, out) != cuTreePad;
+            pos += stats.numCuTree * sizeof(uint16_t) + cuTreePad;
+        }
+    }
+    header.indexOffset = pos;
+    bError = bError ||
+             fwrite(index, sizeof(uint64_t), header.numEntries, out) != header.numEntries ||
+             fseek(out, 0, SEEK_SET) ||
+             fwrite(&header, sizeof(header), 1, out) != 1;
+    bError |= fclose(out) != 0;
+    free(index);
+
+    if (bError)
+        fprintf(stderr, "x265-segment [error]: unable to write %s\n", filename);
+    return !bError;
+}
+
+int mergeStats(const char* outName, int numSegments, char** segNames)
+{
+    Stats title;
+    memset(&title, 0, sizeof(title));
+    bool bError = false;
+
+    for (int s = 0; s < numSegments && !bError; s++)
+    {
+        Stats seg;
+        if (!loadStats(segNames[s], seg))
+        {
+            bError = true;
+            break;
+        }
+        if (!s)
+        {
+            title.options = strdup(seg.options);
+            title.numCuTree = seg.numCuTree;
+            title.bBinary = seg.bBinary;
+        }
+        else if (strcmp(title.options, seg.options))
+        {
+            fprintf(stderr, "x265-segment [error]: options of %s differ from those of %s\n", segNames[s], segNames[0]);
+            bError = true;
+        }
+        if (!bError && (!title.numCuTreeRecords != !seg.numCuTreeRecords || title.numCuTree != seg.numCuTree) && s)
+        {
+            fprintf(stderr, "x265-segment [error]: CU-tree stats of %s do not match those of %s\n", segNames[s], segNames[0]);
+            bError = true;
+        }
+
+        StatsFileRecord* entries = (StatsFileRecord*)realloc(title.entries, (title.numEntries + seg.numEntries) * sizeof(StatsFileRecord));
+        uint16_t* cuTree = (uint16_t*)realloc(title.cuTree, ((title.numCuTreeRecords + seg.numCuTreeRecords) * seg.numCuTree + 1) * sizeof(uint16_t));
+        if (entries)
+            title.entries = entries;
+        if (cuTree)
+            title.cuTree = cuTree;
+        if (!bError && entries && cuTree)
+        {
+            /* entries are renumbered relative to the first frame of the segment,
+             * whatever --segment-start the segment was encoded with */
+            int firstFrame = INT_MAX;
+            for (int i = 0; i < seg.numEntries; i++)
+                firstFrame = seg.entries[i].frameNumber < firstFrame ? seg.entries[i].frameNumber : firstFrame;
+            int offset = title.numEntries - firstFrame;
+            for (int i = 0; i < seg.numEntries; i++)
+            {
+                StatsFileRecord& rec = title.entries[title.numEntries + i];
+                rec = seg.entries[i];
+                rec.frameNumber += offset;
+                rec.encodeOrder += offset;
+            }
+            memcpy(title.cuTree + title.numCuTreeRecords * title.numCuTree, seg.cuTree,
+                   seg.numCuTreeRecords * seg.numCuTree * sizeof(uint16_t));
+            title.numEntries += seg.numEntries;
+            title.numCuTreeRecords += seg.numCuTreeRecords;
+            fprintf(stderr, "x265-segment [info]: %s: %d frames, title frames %d - %d\n",
+                    segNames[s], seg.numEntries, title.numEntries - seg.numEntries, title.numEntries - 1);
+        }
+        else if (!bError)
+        {
+            fprintf(stderr, "x265-segment [error]: out of memory\n");
+            bError = true;
+        }
+        freeStats(seg);
+    }
+
+    if (!bError)
+        bError = !(title.bBinary ? writeBinaryStats(outName, title) : writeTextStats(outName, title));
+    if (!bError)
+        fprintf(stderr, "x265-segment [info]: wrote %d frames of %s stats to %s\n",
+                title.numEntries, title.bBinary ? "binary" : "text", outName);
+    freeStats(title);
+    return bError;
+}
+
+int convertStats(const char* inName, const char* outName, bool bBinary)
+{
+    Stats stats;
+    if (!loadStats(inName, stats))
+        return 1;
+    bool bOk = bBinary ? writeBinaryStats(outName, stats) : writeTextStats(outName, stats);
+    if (bOk)
+        fprintf(stderr, "x265-segment [info]: wrote %d frames of %s stats to %s\n",
+                stats.numEntries, bBinary ? "binary" : "text", outName);
+    freeStats(stats);
+    return !bOk;
+}
+
+/* returns the offset of the next start code at or after pos, or size */
+size_t findStartCode(const uint8_t* data, size_t pos, size_t size)
+{
+    for (; pos + 3 <= size; pos++)
+        if (!data[pos] && !data[pos + 1] && data[pos + 2] == 1)
+            return pos;
+    return size;
+}
+
+struct Nal
+{
+    const uint8_t* data;  /* start code included */
+    size_t         size;
+    int            type;
+};
+
+bool isVCL(int type) { return type < NAL_UNIT_VPS; }
+
+bool isIDR(int type)
+{
+    return type == NAL_UNIT_CODED_SLICE_IDR_W_RADL || type == NAL_UNIT_CODED_SLICE_IDR_N_LP;
+}
+
+int concatStreams(const char* outName, int numSegments, char** segNames)
+{
+    FILE* out = fopen(outName, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "x265-segment [error]: unable to create %s\n", outName);
+        return 1;
+    }
+
+    Buffer first = { NULL, 0 };
+    Nal paramSets[3];
+    memset(paramSets, 0, sizeof(paramSets));
+    int bError = 0;
+
+    for (int s = 0; s < numSegments && !bError; s++)
+    {
+        Buffer buf;
+        if (!readFile(segNames[s], buf))
+        {
+            bError = 1;
+            break;
+        }
+
+        bool bSeenVCL = false;
+        int dropped = 0, numAU = 0;
+        size_t pos = findStartCode(buf.data, 0, buf.size);
+        while (pos < buf.size)
+        {
+            /* include a leading zero byte of a four byte start code */
+            size_t start = pos && !buf.data[pos - 1] ? pos - 1 : pos;
+            size_t payload = pos + 3;
+            size_t end = findStartCode(buf.data, payload, buf.size);
+            size_t next = end;
+            while (end > payload && !buf.data[end - 1])
+                end--;
+
+            Nal nal;
+            nal.data = buf.data + start;
+            nal.size = end - start;
+            nal.type = payload < end ? (buf.data[payload] >> 1) & 0x3f : NAL_UNIT_INVALID;
+
+            bool bKeep = true;
+            if (isVCL(nal.type))
+            {
+                if (!bSeenVCL && !isIDR(nal.type))
+                {
+                    fprintf(stderr, "x265-segment [error]: %s does not begin with an IDR picture\n", segNames[s]);
+                    bError = 1;
+                    break;
+                }
+                /* first_slice_segment_in_pic_flag */
+                if (payload + 2 < end && (buf.data[payload + 2] & 0x80))
+                    numAU++;
+                bSeenVCL = true;
+            }
+            else if (nal.type >= NAL_UNIT_VPS && nal.type <= NAL_UNIT_PPS)
+            {
+                Nal& ps = paramSets[nal.type - NAL_UNIT_VPS];
+                if (!s)
+                {
+                    if (!ps.data)
+                        ps = nal;
+                }
+                else if (ps.data && ps.size == nal.size && !memcmp(ps.data, nal.data, nal.size))
+                    bKeep = false;
+            }
+            else if (nal.type == NAL_UNIT_PREFIX_SEI && s && !bSeenVCL)
+            {
+                /* the encoder info SEI is user data unregistered (payload type 5),
+                 * emitted once ahead of the first picture of each segment */
+                if (payload + 2 < end && buf.data[payload + 2] == 5)
+                    bKeep = false;
+            }
+
+            if (bKeep)
+            {
+                if (fwrite(nal.data, 1, nal.size, out) != nal.size)
+                {
+                    fprintf(stderr, "x265-segment [error]: unable to write %s\n", outName);
+                    bError = 1;
+                    break;
+                }
+            }
+            else
+                dropped++;
+            pos = next;
+        }
+
+        if (!bError && !bSeenVCL)
+        {
+            fprintf(stderr, "x265-segment [error]: %s contains no pictures\n", segNames[s]);
+            bError = 1;
+        }
+        if (!bError)
+            fprintf(stderr, "x265-segment [info]: %s: %d pictures, %d NAL units dropped\n", segNames[s], numAU, dropped);
+
+        /* the first segment's parameter sets are compared against later segments */
+        if (!s)
+            first = buf;
+        else
+            free(buf.data);
+    }
+    free(first.data);
+    bError |= fclose(out) != 0;
+    return bError;
+}
+
+void showHelp()
+{
+    printf("x265-segment: multipass stats and segmented encode helper\n\n"
+           "Syntax: x265-segment stats <title.stats> <segment.stats> [segment.stats ...]\n"
+           "        x265-segment concat <title.hevc> <segment.hevc> [segment.hevc ...]\n"
+           "        x265-segment totext <in.stats> <out.stats>\n"
+           "        x265-segment tobinary <in.stats> <out.stats>\n\n"
+           "   stats    Merge the first pass stats files of the segments of a title, in\n"
+           "            display order, into one title-wide stats file of the format of the\n"
+           "            first segment. CU-tree stats of text stats (<name>.cutree) are\n"
+           "            merged alongside when present.\n"
+           "   totext   Convert stats of either format to text stats (and <out>.cutree)\n"
+           "   tobinary Convert stats of either format to binary stats\n"
+           "   concat   Concatenate the Annex-B bitstreams of the segments of a title,\n"
+           "            in display order. Each segment must begin with an IDR picture.\n");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        showHelp();
+        return 1;
+    }
+    if (!strcmp(argv[1], "totext") && argc == 4)
+        return convertStats(argv[2], argv[3], false);
+    if (!strcmp(argv[1], "tobinary") && argc == 4)
+        return convertStats(argv[2], argv[3], true);
+    if (!strcmp(argv[1], "stats"))
+        return mergeStats(argv[2], argc - 3, argv + 3);
+    if (!strcmp(argv[1], "concat"))
+        return concatStreams(argv[2], argc - 3, argv + 3);
+
+    showHelp();
+    return 1;
+}
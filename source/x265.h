@@ -332,6 +332,24 @@ typedef struct x265_stats
     uint64_t  accBits;              /* total bits output thus far */
 
     /* new statistic member variables must be added below this line */
+
+    /* time spent by the stages of all encoded frames, in seconds. The stages
+     * of different frames overlap when more than one frame thread is used */
+    double    lookaheadWaitTime;    /* API blocked on slice type decisions */
+    double    refWaitTime;          /* frame encoders blocked on reference rows */
+    double    rowEncodeTime;        /* CTU row encode time, summed over all rows */
+    double    rowEncodeWallTime;    /* wall time of the CTU row encodes of each frame */
+    double    filterTime;           /* loop filter rows */
+    double    entropyTime;          /* slice entropy coding and NAL serialization */
+    double    apiWaitTime;          /* API blocked waiting for encoded frames */
+
+    /* thread pool activity since the encoder was opened. The pool is shared
+     * by all encoders of the process */
+    uint32_t  poolNumThreads;
+    double    poolBusyTime;         /* summed over all worker threads */
+    double    poolIdleTime;         /* summed over all worker threads */
+    uint64_t  poolNumJobs;          /* jobs performed by the workers */
+    uint64_t  poolNumMisses;        /* job searches which found no work */
 } x265_stats;
 
 /* String values accepted by x265_param_parse() (and CLI) for various parameters */
@@ -365,6 +383,13 @@ typedef struct x265_param
      * process global, the first encoder configures them for all encoders */
     int       cpuid;
 
+    /* Filename of the primitive tuning cache. When set, the first encoder of
+     * the process times the candidate implementations of the hottest
+     * primitives on this CPU and installs the fastest. The choices are cached
+     * in this file for the CPU model and build, later opens only read it.
+     * Default NULL, disabled */
+    const char *primitiveCache;
+
     /* Enable wavefront parallel processing, greatly increases parallelism for
      * less than 1% compression efficiency loss */
     int       bEnableWavefront;
@@ -387,6 +412,13 @@ typedef struct x265_param
      * is generally limited by the the number of CU rows */
     int       frameNumThreads;
 
+    /* When frame threads are used, estimate the vertical reach of the motion of
+     * each frame from the motion vectors of the lookahead and clamp the motion
+     * search of the frame to it, so the frame may begin encoding once fewer
+     * rows of its references are reconstructed. When disabled, the full
+     * searchRange of the references must be available. Default false */
+    int       bDynamicRefLag;
+
     /* The level of logging detail emitted by the encoder. X265_LOG_NONE to
      * X265_LOG_FULL, default is X265_LOG_INFO */
     int       logLevel;
@@ -572,6 +604,13 @@ typedef struct x265_param
      * should detect scene cuts. The default (40) is recommended. */
     int       scenecutThreshold;
 
+    /* Make the B-frame placement and scene cut decisions of the lookahead on
+     * a second downscale of each frame to quarter resolution. Half resolution
+     * frame costs are then only estimated for the frame types and references
+     * finally chosen, as needed by cuTree, VBV lookahead and rate control.
+     * Intended for 4K and larger sources. Default disabled */
+    int       bLookaheadQres;
+
     /*== Intra Coding Tools ==*/
 
     /* Enable constrained intra prediction. This causes intra prediction to
@@ -588,6 +627,13 @@ typedef struct x265_param
     /* Use a faster search method to find the best intra mode. Default is 0 */
     int       bEnableFastIntra;
 
+    /* Speed up intra mode decision by measuring only the modes suggested by
+     * the SATD costs of the enclosing block of twice the size (and fewer when
+     * the lookahead found inter prediction much cheaper), and by running RDO
+     * on several modes only when their SATD costs are close. Applies to intra
+     * analysis at all RD levels. Default disabled */
+    int       bEnableFastIntraModes;
+
     /*== Inter Coding Tools ==*/
 
     /* ME search method (DIA, HEX, UMH, STAR, FULL). The search patterns
@@ -654,6 +700,21 @@ typedef struct x265_param
      * skip blocks. Default is disabled */
     int       bEnableEarlySkip;
 
+    /* Predict the range of CU depths worth analyzing for each CTU of P and B
+     * slices from the depths of the co-located CTUs in the nearest references
+     * and of the already coded neighbor CTUs, and skip evaluating CU sizes
+     * outside that range. CTUs where lowres costs indicate intra content or
+     * where AQ offsets vary widely are left unrestricted. 0 disables, 1
+     * spans the depths of the co-located and neighbor CTUs, 2 spans only the
+     * depths of the co-located CTUs. Default is 0 */
+    int       depthPrediction;
+
+    /* Code CTUs of P and B slices whose source samples differ by at most one
+     * from the co-located samples of the nearest reference directly as a
+     * zero-motion merge skip, bypassing mode analysis. Intended for static
+     * content such as surveillance and screen capture. Default disabled */
+    int       bEnableStaticSkip;
+
     /* Apply an optional penalty to the estimated cost of 32x32 intra blocks in
      * non-intra slices. 0 is disabled, 1 enables a small penalty, and 2 enables
      * a full penalty. This favors inter-coding and its low bitrate over
@@ -694,6 +755,25 @@ typedef struct x265_param
      * the encoder must perform. Default X265_ANALYSIS_OFF */
     int       analysisMode;
 
+    /* Filename of the analysis file. When set, the encoder itself saves the
+     * analysis of every frame into this file (X265_ANALYSIS_SAVE) or reuses
+     * the split, mode and motion decisions read from it (X265_ANALYSIS_LOAD),
+     * and the analysisData buffers of x265_picture are ignored. A file saved
+     * at another resolution or CTU size is scaled and only seeds the CU depth
+     * range and motion searches of the loading encode. The string remains
+     * owned by the caller, the encoder keeps its own copy; the one allocated
+     * by x265_param_parse() is released with free(). Default NULL */
+    const char* analysisFileName;
+
+    /* Target encode speed in frames per second. When non-zero, the encoder
+     * measures the time taken by each frame and adjusts the analysis effort of
+     * the following frames (rdLevel, subpelRefine, searchRange,
+     * maxNumMergeCand, rect/AMP partitions and early skip) in order to hold
+     * this speed. Effort is only ever reduced below the configured values,
+     * never increased above them. Intended for live encodes. Default 0
+     * (disabled) */
+    double    targetFps;
+
     /*== Coding tools ==*/
 
     /* Enable the implicit signaling of the sign bit of the last coefficient of
@@ -826,6 +906,15 @@ typedef struct x265_param
          * interpreted as the initial fill in kbits. Default is 0.9 */
         double    vbvBufferInit;
 
+        /* Low-latency VBV rate control for frame threaded realtime encodes.
+         * The frames being encoded publish the bits they are predicted to use
+         * as their rows are coded, and the VBV plan of each new frame uses
+         * these predictions instead of the worst case of the planned sizes.
+         * VBV row re-encodes which only correct the QP of a row are refused
+         * when they would discard more than half a row of CTUs, those which
+         * prevent an underflow are still taken. Default disabled */
+        int       bLowLatency;
+
         /* Enable CUTree ratecontrol. This keeps track of the CUs that propagate temporally
          * across frames and assigns more bits to these CUs. Improves encode efficiency.
          * Default: enabled */
@@ -847,6 +936,21 @@ typedef struct x265_param
         /* Filename of the 2pass output/input stats file */
         char*     statFileName;
 
+        /* Title-wide frame number of the first frame of this encode, for
+         * segmented (chunked) multi-pass encodes. A first pass numbers its
+         * stats entries from this offset, so the stats of all segments may be
+         * merged into one title-wide stats file. A later pass reads its frames
+         * starting at this offset in the merged stats file, while the bit
+         * allocation is planned across the whole title. Default 0 */
+        int       segmentStart;
+
+        /* Write the stats of a multi pass encode in a versioned binary format
+         * which holds the CU-tree data of each frame next to its stats and an
+         * index by frame number. A later pass memory maps the file rather than
+         * parsing it. The format of a stats file to be read is detected
+         * automatically. Default disabled (text stats) */
+        int       bBinaryStats;
+
         /* temporally blur quants */
         double    qblur;
 
@@ -1086,7 +1190,9 @@ x265_encoder* x265_encoder_open(x265_param *);
  *      by the caller.  useful when the calling application needs to know
  *      how x265_encoder_open has changed the parameters.
  *      note that the data accessible through pointers in the returned param struct
- *      (e.g. filenames) should not be modified by the calling application. */
+ *      (e.g. filenames) should not be modified by the calling application, and
+ *      that the analysis file name belongs to the encoder and is only valid
+ *      until x265_encoder_close. */
 void x265_encoder_parameters(x265_encoder *, x265_param *);
 
 /* x265_encoder_headers: